@@ -107,6 +107,7 @@ engine_config(const char* cfgfile,
             ecfg->db_host = strdup_or_null(oldcfg->db_host);
             ecfg->db_username = strdup_or_null(oldcfg->db_username);
             ecfg->db_password = strdup_or_null(oldcfg->db_password);
+            ecfg->db_journal = strdup_or_null(oldcfg->db_journal);
             ecfg->db_port = oldcfg->db_port;
             ecfg->db_type = oldcfg->db_type;
         } else {
@@ -127,6 +128,7 @@ engine_config(const char* cfgfile,
             ecfg->db_host = parse_conf_db_host(cfgfile);
             ecfg->db_username = parse_conf_db_username(cfgfile);
             ecfg->db_password = parse_conf_db_password(cfgfile);
+            ecfg->db_journal = parse_conf_db_journal(cfgfile);
             ecfg->db_port = parse_conf_db_port(cfgfile);
             ecfg->db_type = parse_conf_db_type(cfgfile);
         }
@@ -510,6 +512,7 @@ engine_config_cleanup(engineconfig_type* config)
     free((void*) config->db_host);
     free((void*) config->db_username);
     free((void*) config->db_password);
+    free((void*) config->db_journal);
     engine_config_freehsms(config->repositories);
     config->repositories = NULL;
     engine_config_freelistener(config->interfaces);
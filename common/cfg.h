@@ -48,6 +48,7 @@ struct engineconfig_repository {
     uint8_t use_pubkey;
     uint8_t require_backup;
     unsigned int allow_extract;
+    unsigned int keygen_threads;
 };
 
 struct engineconfig_listener {
@@ -92,6 +93,7 @@ struct engineconfig_struct {
     const char* db_host; /* Datastore/MySQL/Host */
     const char* db_username; /* Datastore/MySQL/Username */
     const char* db_password; /* Datastore/MySQL/Password */
+    const char* db_journal; /* Datastore/SQLite/@Journal */
     const char* notify_command;
     int use_syslog;
     int num_worker_threads_enforcer;
@@ -242,15 +242,16 @@ cmdhandler_handle_client_conversation(struct cmdhandler_ctx_struct* context)
             }
         } else {
             bufpos += numread;
-            r = extract_msg(buf, &bufpos, ODS_SE_MAXLINE, &exitcode, context);
-            if (r == -1) {
-                ods_log_error("[%s] Error receiving message from client.", module_str);
-                break;
-            } else if (r == 1) {
+            /* A client may pipeline commands, answer all complete ones */
+            while ((r = extract_msg(buf, &bufpos, ODS_SE_MAXLINE, &exitcode, context)) == 1) {
                 if (!client_exit(context->sockfd, exitcode)) {
                     ods_log_error("[%s] Error sending message to client.", module_str);
                 }
             }
+            if (r == -1) {
+                ods_log_error("[%s] Error receiving message from client.", module_str);
+                break;
+            }
         }
     }
 }
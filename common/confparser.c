@@ -245,6 +245,7 @@ parse_conf_repositories(const char* cfgfile)
             cur->require_backup = 0;
             cur->use_pubkey = 1;
             cur->allow_extract = 0;
+            cur->keygen_threads = 1;
             cur->next = NULL;
 
             if (prev)
@@ -268,6 +269,12 @@ parse_conf_repositories(const char* cfgfile)
                     cur->use_pubkey = 0;
                 if (xmlStrEqual(curNode->name, (const xmlChar *)"AllowExtraction"))
                     cur->allow_extract = 1;
+                if (xmlStrEqual(curNode->name, (const xmlChar *)"KeygenThreads")) {
+                    xmlChar *threads = xmlNodeGetContent(curNode);
+                    if (threads && atoi((char *)threads) > 0)
+                        cur->keygen_threads = atoi((char *)threads);
+                    xmlFree(threads);
+                }
 
                 curNode = curNode->next;
             }
@@ -720,6 +727,21 @@ parse_conf_db_port(const char* cfgfile)
     return port;
 }
 
+const char*
+parse_conf_db_journal(const char* cfgfile)
+{
+    const char* dup = NULL;
+    const char* str = parse_conf_string(cfgfile,
+                                        "//Configuration/Enforcer/Datastore/SQLite/@Journal",
+                                        0);
+
+    if (str) {
+        dup = strdup(str);
+        free((void*)str);
+    }
+    return dup;
+}
+
 engineconfig_database_type_t
 parse_conf_db_type(const char *cfgfile) {
     const char* str = NULL;
@@ -86,6 +86,7 @@ const char* parse_conf_datastore(const char* cfgfile);
 const char* parse_conf_db_host(const char* cfgfile);
 const char* parse_conf_db_username(const char* cfgfile);
 const char* parse_conf_db_password(const char* cfgfile);
+const char* parse_conf_db_journal(const char* cfgfile);
 engineconfig_database_type_t parse_conf_db_type(const char *cfgfile);
 
 /**
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2017 Stichting NLnet Labs
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "config.h"
+
+#include "log.h"
+#include "str.h"
+#include "cmdhandler.h"
+#include "clientpipe.h"
+#include "db/db_backend.h"
+
+#include "daemon/dbstats_cmd.h"
+
+static const char *module_str = "dbstats_cmd";
+
+static void
+usage(int sockfd)
+{
+	client_printf(sockfd,
+		"dbstats\n"
+	);
+}
+
+static void
+help(int sockfd)
+{
+	client_printf(sockfd,
+		"Show database statistics: the number of queries and rows fetched so\n"
+		"far, how often a prepared statement could be taken from the\n"
+		"statement cache and how often a pooled connection could be reused.\n\n"
+	);
+}
+
+static int
+run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
+{
+	unsigned long hits, misses;
+	unsigned long opened, reused, reconnects;
+	(void)context;
+	(void)cmd;
+
+	ods_log_debug("[%s] database statistics command", module_str);
+
+	db_backend_factory_statement_cache_stats(&hits, &misses);
+	client_printf(sockfd, "Queries:                %lu\n", hits + misses);
+	client_printf(sockfd, "Rows fetched:           %lu\n",
+		db_backend_factory_rows_fetched());
+	client_printf(sockfd, "Statement cache hits:   %lu\n", hits);
+	client_printf(sockfd, "Statement cache misses: %lu\n", misses);
+	if (hits + misses) {
+		client_printf(sockfd, "Statement cache hit ratio: %.1f%%\n",
+			100.0 * hits / (hits + misses));
+	}
+	db_backend_factory_pool_stats(&opened, &reused, &reconnects);
+	if (opened) {
+		client_printf(sockfd, "Connections opened:     %lu\n", opened);
+		client_printf(sockfd, "Connections reused:     %lu\n", reused);
+		client_printf(sockfd, "Reconnects:             %lu\n", reconnects);
+	}
+	return 0;
+}
+
+struct cmd_func_block dbstats_funcblock = {
+	"dbstats", &usage, &help, NULL, &run
+};
@@ -18,6 +18,7 @@
 #include "daemon/time_leap_cmd.h"
 #include "daemon/queue_cmd.h"
 #include "daemon/verbosity_cmd.h"
+#include "daemon/dbstats_cmd.h"
 #include "daemon/ctrl_cmd.h"
 #include "enforcer/update_repositorylist_cmd.h"
 #include "enforcer/repositorylist_cmd.h"
@@ -98,6 +99,7 @@ static struct cmd_func_block* enforcecommands[] = {
         &flush_funcblock,
         &ctrl_funcblock,
         &verbosity_funcblock,
+        &dbstats_funcblock,
         &help_funcblock,
         NULL
 };
@@ -49,7 +49,10 @@
 #include "db/db_configuration.h"
 #include "db/db_connection.h"
 #include "db/database_version.h"
+#include "db/dbw.h"
 #include "hsmkey/hsm_key_factory.h"
+#include "signconf/signer_notify.h"
+#include "enforcer/enforce_task.h"
 #include "libhsm.h"
 #include "locks.h"
 
@@ -297,6 +300,24 @@ setup_database(engine_type* engine)
             return 1;
         }
         dbcfg = NULL;
+        if (engine->config->db_journal) {
+            if (!(dbcfg = db_configuration_new())
+                || db_configuration_set_name(dbcfg, "journal")
+                || db_configuration_set_value(dbcfg, engine->config->db_journal)
+                || db_configuration_list_add(engine->dbcfg_list, dbcfg))
+            {
+                db_configuration_free(dbcfg);
+                db_configuration_list_free(engine->dbcfg_list);
+                engine->dbcfg_list = NULL;
+                fprintf(stderr, "setup configuration journal failed\n");
+                return 1;
+            }
+            dbcfg = NULL;
+        }
+        /* In WAL mode readers see a consistent snapshot while a writer
+         * commits, they do not need to wait for each other. */
+        dbw_snapshot_reads(engine->config->db_journal
+            && !strcmp(engine->config->db_journal, "wal"));
     }
     else if (engine->config->db_type == ENFORCER_DATABASE_TYPE_MYSQL) {
         if (!(dbcfg = db_configuration_new())
@@ -379,6 +400,12 @@ setup_database(engine_type* engine)
             return 1;
         }
         dbcfg = NULL;
+        dbw_snapshot_reads(1);
+        /* Row locks let zones commit without waiting for each other */
+        dbw_concurrent_commits(1);
+        /* Each query is a round trip to the server, read the tables of a
+         * full fetch side by side on pooled connections */
+        dbw_parallel_reads(4);
     }
     else {
         return 1;
@@ -394,6 +421,7 @@ setup_database(engine_type* engine)
 static void
 desetup_database(engine_type* engine)
 {
+    dbw_cache_enable(0);
     db_configuration_list_free(engine->dbcfg_list);
     engine->dbcfg_list = NULL;
 }
@@ -452,6 +480,8 @@ engine_setup()
             " up properly.");
         return ODS_STATUS_DB_ERR;
     }
+    /* Workers and commands share one in-memory copy of the database */
+    dbw_cache_enable(1);
 
     /* create command handler (before chowning socket file) */
     engine->cmdhandler = cmdhandler_create(engine->config->clisock_filename_enforcer, enforcercommands, engine, (void*(*)(void*)) &get_database_connection, (void(*)(void*))&db_connection_free);
@@ -606,6 +636,8 @@ engine_teardown(engine_type* engine)
         cmdhandler_cleanup(engine->cmdhandler);
         engine->cmdhandler = NULL;
     }
+    signer_notify_close();
+    enforce_task_purge();
     desetup_database(engine);
 }
 
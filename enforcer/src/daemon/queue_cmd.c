@@ -44,6 +44,7 @@
 
 #include "daemon/queue_cmd.h"
 #include "scheduler/task.h"
+#include "enforcer/enforce_task.h"
 
 static const char *module_str = "queue_cmd";
 
@@ -78,6 +79,7 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
 	ldns_rbnode_t* node = LDNS_RBTREE_NULL;
 	task_type* task = NULL;
 	int num_waiting;
+	size_t zones;
         engine_type* engine = getglobalcontext(context);
 	(void)cmd;
 
@@ -106,6 +108,14 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
 	} else if (nextFireTime >= 0) {
 			client_printf(sockfd, "Next task scheduled immediately\n");
 	} /* else: no tasks scheduled at all. */
+
+	/* zones enforced in waves */
+	zones = enforce_task_waiting(&nextFireTime);
+	if (zones) {
+		strftime(strtime, sizeof(strtime), "%c", localtime_r(&nextFireTime, &strtime_struct));
+		client_printf(sockfd, "There %s %zu %s waiting for the next change, first on %s\n",
+			(zones==1)?"is":"are", zones, (zones==1)?"zone":"zones", strtime);
+	}
 	
 	/* list tasks */
 	pthread_mutex_lock(&engine->taskq->schedule_lock);
@@ -150,6 +160,7 @@ run_flush(int sockfd, cmdhandler_ctx_type* context, char *cmd)
 	ods_log_assert(engine->taskq);
 
 	schedule_flush(engine->taskq);
+	enforce_task_flush_waiting(engine);
         
 	client_printf(sockfd, "All tasks scheduled immediately.\n");
 	ods_log_verbose("[cmdhandler] all tasks scheduled immediately");
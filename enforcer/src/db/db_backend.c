@@ -121,6 +121,34 @@ int db_backend_handle_create(const db_backend_handle_t* backend_handle, const db
     return backend_handle->create_function((void*)backend_handle->data, object, object_field_list, value_set);
 }
 
+int db_backend_handle_create_many(const db_backend_handle_t* backend_handle, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* const* value_sets, size_t count) {
+    size_t i;
+    int ret;
+
+    if (!backend_handle) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!object) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!object_field_list) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!value_sets) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    if (backend_handle->create_many_function) {
+        return backend_handle->create_many_function((void*)backend_handle->data, object, object_field_list, value_sets, count);
+    }
+    for (i = 0; i < count; i++) {
+        if ((ret = db_backend_handle_create(backend_handle, object, object_field_list, value_sets[i]))) {
+            return ret;
+        }
+    }
+    return DB_OK;
+}
+
 db_result_list_t* db_backend_handle_read(const db_backend_handle_t* backend_handle, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list) {
     if (!backend_handle) {
         return NULL;
@@ -135,6 +163,44 @@ db_result_list_t* db_backend_handle_read(const db_backend_handle_t* backend_hand
     return backend_handle->read_function((void*)backend_handle->data, object, join_list, clause_list);
 }
 
+db_result_columns_t* db_backend_handle_read_columns(const db_backend_handle_t* backend_handle, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list) {
+    db_result_columns_t* columns;
+    db_result_list_t* result_list;
+    const db_result_t* result;
+    size_t fields;
+
+    if (!backend_handle) {
+        return NULL;
+    }
+    if (!object) {
+        return NULL;
+    }
+
+    if (backend_handle->read_columns_function) {
+        return backend_handle->read_columns_function((void*)backend_handle->data, object, join_list, clause_list);
+    }
+
+    fields = db_object_field_list_size(db_object_object_field_list(object));
+    if (!(columns = db_result_columns_new(fields))) {
+        return NULL;
+    }
+    if (!(result_list = db_backend_handle_read(backend_handle, object, join_list, clause_list))) {
+        db_result_columns_free(columns);
+        return NULL;
+    }
+    result = db_result_list_next(result_list);
+    while (result) {
+        if (db_result_columns_add_result(columns, result)) {
+            db_result_list_free(result_list);
+            db_result_columns_free(columns);
+            return NULL;
+        }
+        result = db_result_list_next(result_list);
+    }
+    db_result_list_free(result_list);
+    return columns;
+}
+
 int db_backend_handle_update(const db_backend_handle_t* backend_handle, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* value_set, const db_clause_list_t* clause_list) {
     if (!backend_handle) {
         return DB_ERROR_UNKNOWN;
@@ -186,6 +252,39 @@ int db_backend_handle_count(const db_backend_handle_t* backend_handle, const db_
     return backend_handle->count_function((void*)backend_handle->data, object, join_list, clause_list, count);
 }
 
+int db_backend_handle_transaction_begin(const db_backend_handle_t* backend_handle) {
+    if (!backend_handle) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!backend_handle->transaction_begin_function) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    return backend_handle->transaction_begin_function((void*)backend_handle->data);
+}
+
+int db_backend_handle_transaction_commit(const db_backend_handle_t* backend_handle) {
+    if (!backend_handle) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!backend_handle->transaction_commit_function) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    return backend_handle->transaction_commit_function((void*)backend_handle->data);
+}
+
+int db_backend_handle_transaction_rollback(const db_backend_handle_t* backend_handle) {
+    if (!backend_handle) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!backend_handle->transaction_rollback_function) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    return backend_handle->transaction_rollback_function((void*)backend_handle->data);
+}
+
 int db_backend_handle_set_initialize(db_backend_handle_t* backend_handle, db_backend_handle_initialize_t initialize_function) {
     if (!backend_handle) {
         return DB_ERROR_UNKNOWN;
@@ -240,6 +339,15 @@ int db_backend_handle_set_create(db_backend_handle_t* backend_handle, db_backend
     return DB_OK;
 }
 
+int db_backend_handle_set_create_many(db_backend_handle_t* backend_handle, db_backend_handle_create_many_t create_many_function) {
+    if (!backend_handle) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    backend_handle->create_many_function = create_many_function;
+    return DB_OK;
+}
+
 int db_backend_handle_set_read(db_backend_handle_t* backend_handle, db_backend_handle_read_t read_function) {
     if (!backend_handle) {
         return DB_ERROR_UNKNOWN;
@@ -249,6 +357,15 @@ int db_backend_handle_set_read(db_backend_handle_t* backend_handle, db_backend_h
     return DB_OK;
 }
 
+int db_backend_handle_set_read_columns(db_backend_handle_t* backend_handle, db_backend_handle_read_columns_t read_columns_function) {
+    if (!backend_handle) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    backend_handle->read_columns_function = read_columns_function;
+    return DB_OK;
+}
+
 int db_backend_handle_set_update(db_backend_handle_t* backend_handle, db_backend_handle_update_t update_function) {
     if (!backend_handle) {
         return DB_ERROR_UNKNOWN;
@@ -433,6 +550,26 @@ int db_backend_create(const db_backend_t* backend, const db_object_t* object, co
     return db_backend_handle_create(backend->handle, object, object_field_list, value_set);
 }
 
+int db_backend_create_many(const db_backend_t* backend, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* const* value_sets, size_t count) {
+    if (!backend) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!object) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!object_field_list) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!value_sets) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!backend->handle) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    return db_backend_handle_create_many(backend->handle, object, object_field_list, value_sets, count);
+}
+
 db_result_list_t* db_backend_read(const db_backend_t* backend, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list) {
     if (!backend) {
         return NULL;
@@ -447,6 +584,20 @@ db_result_list_t* db_backend_read(const db_backend_t* backend, const db_object_t
     return db_backend_handle_read(backend->handle, object, join_list, clause_list);
 }
 
+db_result_columns_t* db_backend_read_columns(const db_backend_t* backend, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list) {
+    if (!backend) {
+        return NULL;
+    }
+    if (!object) {
+        return NULL;
+    }
+    if (!backend->handle) {
+        return NULL;
+    }
+
+    return db_backend_handle_read_columns(backend->handle, object, join_list, clause_list);
+}
+
 int db_backend_update(const db_backend_t* backend, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* value_set, const db_clause_list_t* clause_list) {
     if (!backend) {
         return DB_ERROR_UNKNOWN;
@@ -498,6 +649,39 @@ int db_backend_count(const db_backend_t* backend, const db_object_t* object, con
     return db_backend_handle_count(backend->handle, object, join_list, clause_list, count);
 }
 
+int db_backend_transaction_begin(const db_backend_t* backend) {
+    if (!backend) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!backend->handle) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    return db_backend_handle_transaction_begin(backend->handle);
+}
+
+int db_backend_transaction_commit(const db_backend_t* backend) {
+    if (!backend) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!backend->handle) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    return db_backend_handle_transaction_commit(backend->handle);
+}
+
+int db_backend_transaction_rollback(const db_backend_t* backend) {
+    if (!backend) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!backend->handle) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    return db_backend_handle_transaction_rollback(backend->handle);
+}
+
 /* DB BACKEND FACTORY */
 
 db_backend_t* db_backend_factory_get_backend(const char* name) {
@@ -536,3 +720,51 @@ db_backend_t* db_backend_factory_get_backend(const char* name) {
 
     return backend;
 }
+
+void db_backend_factory_statement_cache_stats(unsigned long* hits, unsigned long* misses) {
+    unsigned long backend_hits, backend_misses;
+
+    if (!hits || !misses) {
+        return;
+    }
+    *hits = 0;
+    *misses = 0;
+
+#if defined(ENFORCER_DATABASE_SQLITE3)
+    db_backend_sqlite_statement_cache_stats(&backend_hits, &backend_misses);
+    *hits += backend_hits;
+    *misses += backend_misses;
+#endif
+#if defined(ENFORCER_DATABASE_MYSQL)
+    db_backend_mysql_statement_cache_stats(&backend_hits, &backend_misses);
+    *hits += backend_hits;
+    *misses += backend_misses;
+#endif
+    (void)backend_hits;
+    (void)backend_misses;
+}
+
+void db_backend_factory_pool_stats(unsigned long* opened, unsigned long* reused, unsigned long* reconnects) {
+    if (!opened || !reused || !reconnects) {
+        return;
+    }
+    *opened = 0;
+    *reused = 0;
+    *reconnects = 0;
+
+#if defined(ENFORCER_DATABASE_MYSQL)
+    db_backend_mysql_pool_stats(opened, reused, reconnects);
+#endif
+}
+
+unsigned long db_backend_factory_rows_fetched(void) {
+    unsigned long rows = 0;
+
+#if defined(ENFORCER_DATABASE_SQLITE3)
+    rows += db_backend_sqlite_rows_fetched();
+#endif
+#if defined(ENFORCER_DATABASE_MYSQL)
+    rows += db_backend_mysql_rows_fetched();
+#endif
+    return rows;
+}
@@ -88,6 +88,18 @@ typedef int (*db_backend_handle_last_id_t)(void* data, int *last_id);
  */
 typedef int (*db_backend_handle_create_t)(void* data, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* value_set);
 
+/**
+ * Function pointer for creating `count` objects in a database backend with
+ * one statement. The backend handle specific data is supplied in `data`.
+ * \param[in] data a void pointer.
+ * \param[in] object a db_object_t pointer.
+ * \param[in] object_field_list a db_object_field_list_t pointer.
+ * \param[in] value_sets an array of `count` db_value_set_t pointers.
+ * \param[in] count a size_t.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+typedef int (*db_backend_handle_create_many_t)(void* data, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* const* value_sets, size_t count);
+
 /**
  * Function pointer for reading objects from database backend. The backend
  * handle specific data is supplied in `data`.
@@ -100,6 +112,18 @@ typedef int (*db_backend_handle_create_t)(void* data, const db_object_t* object,
  */
 typedef db_result_list_t* (*db_backend_handle_read_t)(void* data, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list);
 
+/**
+ * Function pointer for reading objects from database backend into a column
+ * oriented result set. The backend handle specific data is supplied in `data`.
+ * \param[in] data a void pointer.
+ * \param[in] object a db_object_t pointer.
+ * \param[in] join_list a db_join_list_t pointer.
+ * \param[in] clause_list a db_clause_list_t pointer.
+ * \return a db_result_columns_t pointer, with no rows if no objects where
+ * read, or NULL on error.
+ */
+typedef db_result_columns_t* (*db_backend_handle_read_columns_t)(void* data, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list);
+
 /**
  * Function pointer for updating objects in a database backend. The backend
  * handle specific data is supplied in `data`.
@@ -176,7 +200,9 @@ struct db_backend_handle {
     db_backend_handle_disconnect_t disconnect_function;
     db_backend_handle_last_id_t last_id_function;
     db_backend_handle_create_t create_function;
+    db_backend_handle_create_many_t create_many_function;
     db_backend_handle_read_t read_function;
+    db_backend_handle_read_columns_t read_columns_function;
     db_backend_handle_update_t update_function;
     db_backend_handle_delete_t delete_function;
     db_backend_handle_count_t count_function;
@@ -227,6 +253,19 @@ int db_backend_handle_connect(const db_backend_handle_t* backend_handle, const d
  */
 int db_backend_handle_create(const db_backend_handle_t* backend_handle, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* value_set);
 
+/**
+ * Create `count` objects in the database, one for each value set in
+ * `value_sets`. Backends without a function for this create the objects one
+ * by one. The id of the created objects is not available afterwards.
+ * \param[in] backend_handle a db_backend_handle_t pointer.
+ * \param[in] object a db_object_t pointer.
+ * \param[in] object_field_list a db_object_field_list_t pointer.
+ * \param[in] value_sets an array of `count` db_value_set_t pointers.
+ * \param[in] count a size_t.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_backend_handle_create_many(const db_backend_handle_t* backend_handle, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* const* value_sets, size_t count);
+
 /**
  * Read an object or objects from the database.
  * \param[in] backend_handle a db_backend_handle_t pointer.
@@ -238,6 +277,17 @@ int db_backend_handle_create(const db_backend_handle_t* backend_handle, const db
  */
 db_result_list_t* db_backend_handle_read(const db_backend_handle_t* backend_handle, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list);
 
+/**
+ * Read an object or objects from the database into a column oriented result
+ * set. Backends without a read columns function are read row by row.
+ * \param[in] backend_handle a db_backend_handle_t pointer.
+ * \param[in] object a db_object_t pointer.
+ * \param[in] join_list a db_join_list_t pointer.
+ * \param[in] clause_list a db_clause_list_t pointer.
+ * \return a db_result_columns_t pointer or NULL on error.
+ */
+db_result_columns_t* db_backend_handle_read_columns(const db_backend_handle_t* backend_handle, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list);
+
 /**
  * Update an object or objects in the database.
  * \param[in] backend_handle a db_backend_handle_t pointer.
@@ -269,6 +319,27 @@ int db_backend_handle_delete(const db_backend_handle_t* backend_handle, const db
  */
 int db_backend_handle_count(const db_backend_handle_t* backend_handle, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list, size_t* count);
 
+/**
+ * Begin a transaction for a database backend handle.
+ * \param[in] backend_handle a db_backend_handle_t pointer.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_backend_handle_transaction_begin(const db_backend_handle_t* backend_handle);
+
+/**
+ * Commit a transaction for a database backend handle.
+ * \param[in] backend_handle a db_backend_handle_t pointer.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_backend_handle_transaction_commit(const db_backend_handle_t* backend_handle);
+
+/**
+ * Roll back a transaction for a database backend handle.
+ * \param[in] backend_handle a db_backend_handle_t pointer.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_backend_handle_transaction_rollback(const db_backend_handle_t* backend_handle);
+
 /**
  * Set the initialize function of a database backend handle.
  * \param[in] backend_handle a db_backend_handle_t pointer.
@@ -311,6 +382,14 @@ int db_backend_handle_set_last_id(db_backend_handle_t* backend_handle, db_backen
  */
 int db_backend_handle_set_create(db_backend_handle_t* backend_handle, db_backend_handle_create_t create_function);
 
+/**
+ * Set the create many function of a database backend handle.
+ * \param[in] backend_handle a db_backend_handle_t pointer.
+ * \param[in] create_many_function a db_backend_handle_create_many_t.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_backend_handle_set_create_many(db_backend_handle_t* backend_handle, db_backend_handle_create_many_t create_many_function);
+
 /**
  * Set the read function of a database backend handle.
  * \param[in] backend_handle a db_backend_handle_t pointer.
@@ -319,6 +398,14 @@ int db_backend_handle_set_create(db_backend_handle_t* backend_handle, db_backend
  */
 int db_backend_handle_set_read(db_backend_handle_t* backend_handle, db_backend_handle_read_t read_function);
 
+/**
+ * Set the read columns function of a database backend handle.
+ * \param[in] backend_handle a db_backend_handle_t pointer.
+ * \param[in] read_columns_function a db_backend_handle_read_columns_t.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_backend_handle_set_read_columns(db_backend_handle_t* backend_handle, db_backend_handle_read_columns_t read_columns_function);
+
 /**
  * Set the update function of a database backend handle.
  * \param[in] backend_handle a db_backend_handle_t pointer.
@@ -459,6 +546,18 @@ int db_backend_last_id(const db_backend_t* backend, int *last_id);
  */
 int db_backend_create(const db_backend_t* backend, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* value_set);
 
+/**
+ * Create `count` objects in the database, one for each value set in
+ * `value_sets`.
+ * \param[in] backend a db_backend_t pointer.
+ * \param[in] object a db_object_t pointer.
+ * \param[in] object_field_list a db_object_field_list_t pointer.
+ * \param[in] value_sets an array of `count` db_value_set_t pointers.
+ * \param[in] count a size_t.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_backend_create_many(const db_backend_t* backend, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* const* value_sets, size_t count);
+
 /**
  * Read an object or objects from the database.
  * \param[in] backend a db_backend_t pointer.
@@ -470,6 +569,17 @@ int db_backend_create(const db_backend_t* backend, const db_object_t* object, co
  */
 db_result_list_t* db_backend_read(const db_backend_t* backend, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list);
 
+/**
+ * Read an object or objects from the database into a column oriented result
+ * set.
+ * \param[in] backend a db_backend_t pointer.
+ * \param[in] object a db_object_t pointer.
+ * \param[in] join_list a db_join_list_t pointer.
+ * \param[in] clause_list a db_clause_list_t pointer.
+ * \return a db_result_columns_t pointer or NULL on error.
+ */
+db_result_columns_t* db_backend_read_columns(const db_backend_t* backend, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list);
+
 /**
  * Update an object or objects in the database.
  * \param[in] backend a db_backend_t pointer.
@@ -501,6 +611,27 @@ int db_backend_delete(const db_backend_t* backend, const db_object_t* object, co
  */
 int db_backend_count(const db_backend_t* backend, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list, size_t* count);
 
+/**
+ * Begin a transaction for a database backend.
+ * \param[in] backend a db_backend_t pointer.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_backend_transaction_begin(const db_backend_t* backend);
+
+/**
+ * Commit a transaction for a database backend.
+ * \param[in] backend a db_backend_t pointer.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_backend_transaction_commit(const db_backend_t* backend);
+
+/**
+ * Roll back a transaction for a database backend.
+ * \param[in] backend a db_backend_t pointer.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_backend_transaction_rollback(const db_backend_t* backend);
+
 /**
  * Get a new database backend by the name supplied in `name`.
  * \param[in] name a character pointer.
@@ -509,4 +640,27 @@ int db_backend_count(const db_backend_t* backend, const db_object_t* object, con
  */
 db_backend_t* db_backend_factory_get_backend(const char* name);
 
+/**
+ * Get the prepared statement cache hit and miss counters summed over all
+ * database backends.
+ * \param[out] hits the number of statements taken from the cache.
+ * \param[out] misses the number of statements that had to be prepared.
+ */
+void db_backend_factory_statement_cache_stats(unsigned long* hits, unsigned long* misses);
+
+/**
+ * Get the number of rows fetched summed over all database backends.
+ * \return the number of rows.
+ */
+unsigned long db_backend_factory_rows_fetched(void);
+
+/**
+ * Get the connection counters of the database backends that keep a pool of
+ * connections, all zero for those that do not.
+ * \param[out] opened the number of connections made to the server.
+ * \param[out] reused the number of connects served from the pool.
+ * \param[out] reconnects the number of times a lost connection was replaced.
+ */
+void db_backend_factory_pool_stats(unsigned long* opened, unsigned long* reused, unsigned long* reconnects);
+
 #endif
@@ -33,6 +33,7 @@
 #include "log.h"
 
 #include <mysql/mysql.h>
+#include <mysql/errmsg.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -48,6 +49,48 @@ static int db_backend_mysql_transaction_rollback(void*);
  */
 static int __mysql_initialized = 0;
 
+/**
+ * Prepared statement cache hit and miss counters for all MySQL backends.
+ */
+static pthread_mutex_t __mysql_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long __mysql_cache_hits = 0;
+static unsigned long __mysql_cache_misses = 0;
+static unsigned long __mysql_rows = 0;
+
+/**
+ * Idle connections kept for the next connect with the same settings, shared
+ * by all MySQL backends. Command handlers and parallel table reads connect
+ * and disconnect often, making a connection to a remote server takes several
+ * round trips.
+ */
+typedef struct db_backend_mysql_pooled {
+    MYSQL* db;
+    char* key;
+    time_t idle_since;
+} db_backend_mysql_pooled_t;
+
+static pthread_mutex_t __mysql_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static db_backend_mysql_pooled_t __mysql_pool[DB_BACKEND_MYSQL_POOL_SIZE];
+static int __mysql_pool_size = 0;
+static unsigned long __mysql_pool_opened = 0;
+static unsigned long __mysql_pool_reused = 0;
+static unsigned long __mysql_pool_reconnects = 0;
+
+typedef struct db_backend_mysql_statement db_backend_mysql_statement_t;
+
+/**
+ * A cached prepared statement, keyed by the SQL it was prepared from. A
+ * statement that is in use is not handed out again until it is released by
+ * the finish function, which resets it instead of freeing it.
+ */
+typedef struct db_backend_mysql_cache {
+    char* sql;
+    unsigned int hash;
+    db_backend_mysql_statement_t* statement;
+    int in_use;
+    unsigned long used;
+} db_backend_mysql_cache_t;
+
 /**
  * The MySQL database backend specific data.
  */
@@ -60,6 +103,12 @@ typedef struct db_backend_mysql {
     const char* db_pass;
     const char* db_name;
     int db_port;
+    char* pool_key;
+    time_t last_used;
+    int statements;
+    unsigned long rows;
+    db_backend_mysql_cache_t cache[DB_BACKEND_MYSQL_STATEMENT_CACHE];
+    unsigned long cache_tick;
 } db_backend_mysql_t;
 
 
@@ -81,9 +130,10 @@ struct db_backend_mysql_bind {
 /**
  * The MySQL database backend specific data for statements.
  */
-typedef struct db_backend_mysql_statement {
+struct db_backend_mysql_statement {
     db_backend_mysql_t* backend_mysql;
     MYSQL_STMT* statement;
+    char* sql;
     MYSQL_BIND* mysql_bind_input;
     db_backend_mysql_bind_t* bind_input;
     db_backend_mysql_bind_t* bind_input_end;
@@ -93,16 +143,14 @@ typedef struct db_backend_mysql_statement {
     db_object_field_list_t* object_field_list;
     int fields;
     int bound;
-} db_backend_mysql_statement_t;
+};
 
 
 
 /**
- * MySQL finish function.
- *
  * Frees all data related to a db_backend_mysql_statement_t.
  */
-static inline void __db_backend_mysql_finish(db_backend_mysql_statement_t* statement) {
+static void __db_backend_mysql_statement_free(db_backend_mysql_statement_t* statement) {
     db_backend_mysql_bind_t* bind;
 
     if (!statement) {
@@ -134,38 +182,246 @@ static inline void __db_backend_mysql_finish(db_backend_mysql_statement_t* state
     if (statement->object_field_list) {
         db_object_field_list_free(statement->object_field_list);
     }
+    free(statement->sql);
 
     free(statement);
 }
 
+/**
+ * MySQL finish function.
+ *
+ * Cached statements are reset and released back to the cache, others are
+ * freed.
+ */
+static inline void __db_backend_mysql_finish(db_backend_mysql_statement_t* statement) {
+    db_backend_mysql_t* backend_mysql;
+    int i;
+
+    if (!statement) {
+        return;
+    }
+
+    if ((backend_mysql = statement->backend_mysql)) {
+        backend_mysql->statements--;
+        if (backend_mysql->rows) {
+            pthread_mutex_lock(&__mysql_cache_mutex);
+            __mysql_rows += backend_mysql->rows;
+            pthread_mutex_unlock(&__mysql_cache_mutex);
+            backend_mysql->rows = 0;
+        }
+        for (i = 0; i < DB_BACKEND_MYSQL_STATEMENT_CACHE; i++) {
+            if (backend_mysql->cache[i].statement == statement) {
+                mysql_stmt_free_result(statement->statement);
+                mysql_stmt_reset(statement->statement);
+                statement->bound = 0;
+                backend_mysql->cache[i].in_use = 0;
+                return;
+            }
+        }
+    }
+    __db_backend_mysql_statement_free(statement);
+}
+
+/**
+ * Free all cached statements, must be done when the connection is closed or
+ * lost. Statements in use are only removed from the cache and will be freed
+ * when released.
+ */
+static void __db_backend_mysql_cache_flush(db_backend_mysql_t* backend_mysql) {
+    int i;
+
+    for (i = 0; i < DB_BACKEND_MYSQL_STATEMENT_CACHE; i++) {
+        if (backend_mysql->cache[i].statement && !backend_mysql->cache[i].in_use) {
+            __db_backend_mysql_statement_free(backend_mysql->cache[i].statement);
+        }
+        free(backend_mysql->cache[i].sql);
+    }
+    memset(backend_mysql->cache, 0, sizeof(backend_mysql->cache));
+}
+
+static unsigned int __db_backend_mysql_hash(const char* sql) {
+    unsigned int hash = 2166136261u;
+
+    while (*sql) {
+        hash = (hash ^ (unsigned char)*sql++) * 16777619u;
+    }
+    return hash;
+}
+
+static void __db_backend_mysql_cache_count(int hit) {
+    pthread_mutex_lock(&__mysql_cache_mutex);
+    if (hit) {
+        __mysql_cache_hits++;
+    }
+    else {
+        __mysql_cache_misses++;
+    }
+    pthread_mutex_unlock(&__mysql_cache_mutex);
+}
+
+/**
+ * Open a new connection with the settings of the backend.
+ */
+static MYSQL* __db_backend_mysql_open(db_backend_mysql_t* backend_mysql) {
+    MYSQL* db;
+
+    if (!(db = mysql_init(NULL))
+        || mysql_options(db, MYSQL_OPT_CONNECT_TIMEOUT, &backend_mysql->timeout)
+        || !mysql_real_connect(db,
+                               backend_mysql->db_host, backend_mysql->db_user, backend_mysql->db_pass,
+                               backend_mysql->db_name, backend_mysql->db_port, NULL, 0)
+        || mysql_autocommit(db, 1))
+    {
+        if (db) {
+            ods_log_error("db_backend_mysql: connect failed %d: %s", mysql_errno(db), mysql_error(db));
+            mysql_close(db);
+        }
+        return NULL;
+    }
+
+    pthread_mutex_lock(&__mysql_pool_mutex);
+    __mysql_pool_opened++;
+    pthread_mutex_unlock(&__mysql_pool_mutex);
+    return db;
+}
+
+/**
+ * Take the most recently pooled connection made with the same settings.
+ * Connections that have been idle for a while are pinged first, those the
+ * server has dropped are closed.
+ */
+static MYSQL* __db_backend_mysql_pool_get(const char* key) {
+    MYSQL* db;
+    time_t idle_since = 0;
+    int i;
+
+    for (;;) {
+        db = NULL;
+        pthread_mutex_lock(&__mysql_pool_mutex);
+        for (i = __mysql_pool_size - 1; i >= 0; i--) {
+            if (!strcmp(__mysql_pool[i].key, key)) {
+                db = __mysql_pool[i].db;
+                idle_since = __mysql_pool[i].idle_since;
+                free(__mysql_pool[i].key);
+                __mysql_pool[i] = __mysql_pool[--__mysql_pool_size];
+                break;
+            }
+        }
+        pthread_mutex_unlock(&__mysql_pool_mutex);
+
+        if (!db) {
+            return NULL;
+        }
+        if (time(NULL) < idle_since + DB_BACKEND_MYSQL_PING_INTERVAL
+            || !mysql_ping(db))
+        {
+            pthread_mutex_lock(&__mysql_pool_mutex);
+            __mysql_pool_reused++;
+            pthread_mutex_unlock(&__mysql_pool_mutex);
+            return db;
+        }
+        mysql_close(db);
+    }
+}
+
+/**
+ * Put a connection in the pool, or close it if the pool is full.
+ */
+static void __db_backend_mysql_pool_put(const char* key, MYSQL* db) {
+    char* copy = strdup(key);
+
+    pthread_mutex_lock(&__mysql_pool_mutex);
+    if (copy && __mysql_pool_size < DB_BACKEND_MYSQL_POOL_SIZE) {
+        __mysql_pool[__mysql_pool_size].db = db;
+        __mysql_pool[__mysql_pool_size].key = copy;
+        __mysql_pool[__mysql_pool_size].idle_since = time(NULL);
+        __mysql_pool_size++;
+        db = NULL;
+        copy = NULL;
+    }
+    pthread_mutex_unlock(&__mysql_pool_mutex);
+
+    free(copy);
+    if (db) {
+        mysql_close(db);
+    }
+}
+
+/**
+ * Close all pooled connections.
+ */
+static void __db_backend_mysql_pool_drain(void) {
+    pthread_mutex_lock(&__mysql_pool_mutex);
+    while (__mysql_pool_size > 0) {
+        __mysql_pool_size--;
+        mysql_close(__mysql_pool[__mysql_pool_size].db);
+        free(__mysql_pool[__mysql_pool_size].key);
+    }
+    pthread_mutex_unlock(&__mysql_pool_mutex);
+}
+
+/**
+ * Replace a lost connection with a new one. Cached statements belong to the
+ * old connection and are flushed.
+ */
+static int __db_backend_mysql_reconnect(db_backend_mysql_t* backend_mysql) {
+    ods_log_warning("db_backend_mysql: connection lost, trying to reconnect");
+    __db_backend_mysql_cache_flush(backend_mysql);
+    if (backend_mysql->db) {
+        mysql_close(backend_mysql->db);
+        backend_mysql->db = NULL;
+    }
+
+    pthread_mutex_lock(&__mysql_pool_mutex);
+    __mysql_pool_reconnects++;
+    pthread_mutex_unlock(&__mysql_pool_mutex);
+
+    if (!(backend_mysql->db = __db_backend_mysql_open(backend_mysql))) {
+        ods_log_error("db_backend_mysql: reconnect failed");
+        return DB_ERROR_UNKNOWN;
+    }
+    backend_mysql->last_used = time(NULL);
+    return DB_OK;
+}
 
+/**
+ * Make sure a connection that has been idle for a while is still there and
+ * reconnect if it was lost. Connections in use are not pinged for every
+ * statement, that would double the round trips. A connection lost within a
+ * transaction is not replaced as that would silently drop the transaction.
+ */
 static inline void checkconnection(db_backend_mysql_t* backend_mysql)
 {
-    MYSQL_RES *result;
-    if(mysql_query(backend_mysql->db, "SELECT 1")) {
-        ods_log_warning("db_backend_mysql: connection lost, trying to reconnect");
-        if(!mysql_real_connect(backend_mysql->db, backend_mysql->db_host, backend_mysql->db_user, backend_mysql->db_pass,
-                               backend_mysql->db_name, backend_mysql->db_port, NULL, 0) ||
-            mysql_autocommit(backend_mysql->db, 1)) {
-                if (backend_mysql->db) {
-                    ods_log_error("db_backend_mysql: reconnect failed %d: %s", mysql_errno(backend_mysql->db), mysql_error(backend_mysql->db));
-                    mysql_close(backend_mysql->db);
-                    backend_mysql->db = NULL;
-                }
-        }
-    } else {
-          result = mysql_store_result(backend_mysql->db);
-          mysql_free_result(result);
+    time_t now = time(NULL);
+
+    if (backend_mysql->db
+        && now < backend_mysql->last_used + DB_BACKEND_MYSQL_PING_INTERVAL)
+    {
+        backend_mysql->last_used = now;
+        return;
     }
+    backend_mysql->last_used = now;
+    if (backend_mysql->db && !mysql_ping(backend_mysql->db)) {
+        return;
+    }
+    if (backend_mysql->transaction) {
+        ods_log_error("db_backend_mysql: connection lost during transaction");
+        return;
+    }
+    (void)__db_backend_mysql_reconnect(backend_mysql);
 }
 
 /**
  * MySQL prepare function.
  *
  * Creates a db_backend_mysql_statement_t based on a SQL string and an object
- * field list.
+ * field list. Statements are taken from the cache if the same SQL has been
+ * prepared before and is not in use, otherwise the new statement is put in the
+ * cache replacing the least recently used statement that is not in use.
  */
 static inline int __db_backend_mysql_prepare(db_backend_mysql_t* backend_mysql, db_backend_mysql_statement_t** statement, const char* sql, size_t size, const db_object_field_list_t* object_field_list) {
+    db_backend_mysql_cache_t* entry = NULL;
+    unsigned int hash;
     unsigned long i, params;
     db_backend_mysql_bind_t* bind;
     const db_object_field_t* object_field;
@@ -176,7 +432,7 @@ static inline int __db_backend_mysql_prepare(db_backend_mysql_t* backend_mysql,
     if (!backend_mysql) {
         return DB_ERROR_UNKNOWN;
     }
-    if (!backend_mysql->db) {
+    if (!backend_mysql->pool_key) {
         return DB_ERROR_UNKNOWN;
     }
     if (!statement) {
@@ -190,12 +446,40 @@ static inline int __db_backend_mysql_prepare(db_backend_mysql_t* backend_mysql,
     }
 
     checkconnection(backend_mysql);
+    if (!backend_mysql->db) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    ods_log_debug("%s", sql);
+    backend_mysql->cache_tick++;
+
+    hash = __db_backend_mysql_hash(sql);
+    for (i = 0; i < DB_BACKEND_MYSQL_STATEMENT_CACHE; i++) {
+        db_backend_mysql_cache_t* cached = &(backend_mysql->cache[i]);
+
+        if (cached->statement
+            && !cached->in_use
+            && cached->hash == hash
+            && !strcmp(cached->sql, sql))
+        {
+            cached->in_use = 1;
+            cached->used = backend_mysql->cache_tick;
+            *statement = cached->statement;
+            backend_mysql->statements++;
+            __db_backend_mysql_cache_count(1);
+            return DB_OK;
+        }
+        if (!cached->in_use && (!entry || cached->used < entry->used)) {
+            entry = cached;
+        }
+    }
+    __db_backend_mysql_cache_count(0);
 
     /*
      * Prepare the statement.
      */
-    ods_log_debug("%s", sql);
     if (!(*statement = calloc(1, sizeof(db_backend_mysql_statement_t)))
+        || !((*statement)->sql = strdup(sql))
         || !((*statement)->statement = mysql_stmt_init(backend_mysql->db))
         || mysql_stmt_prepare((*statement)->statement, sql, size))
     {
@@ -209,6 +493,7 @@ static inline int __db_backend_mysql_prepare(db_backend_mysql_t* backend_mysql,
     }
 
     (*statement)->backend_mysql = backend_mysql;
+    backend_mysql->statements++;
 
     /*
      * Create the input binding based on the number of parameters in the SQL
@@ -528,6 +813,24 @@ static inline int __db_backend_mysql_prepare(db_backend_mysql_t* backend_mysql,
         mysql_free_result(result_metadata);
     }
 
+    /*
+     * If all cached statements are in use the statement is not cached and
+     * will be freed when finished.
+     */
+    if (entry) {
+        if (entry->statement) {
+            __db_backend_mysql_statement_free(entry->statement);
+        }
+        free(entry->sql);
+        memset(entry, 0, sizeof(db_backend_mysql_cache_t));
+        if ((entry->sql = strdup(sql))) {
+            entry->hash = hash;
+            entry->statement = *statement;
+            entry->in_use = 1;
+            entry->used = backend_mysql->cache_tick;
+        }
+    }
+
     return DB_OK;
 }
 
@@ -618,6 +921,48 @@ static inline int __db_backend_mysql_fetch(db_backend_mysql_statement_t* stateme
         return DB_ERROR_UNKNOWN;
     }
 
+    if (statement->backend_mysql) {
+        statement->backend_mysql->rows++;
+    }
+    return DB_OK;
+}
+
+/**
+ * Whether a failed statement may be run again on a new connection. Either
+ * the connection was already gone and the statement was never sent, or it
+ * was lost while running a statement that only reads. Never inside a
+ * transaction.
+ */
+static int __db_backend_mysql_retryable(db_backend_mysql_statement_t* statement) {
+    unsigned int err = mysql_stmt_errno(statement->statement);
+
+    if (!statement->backend_mysql || statement->backend_mysql->transaction) {
+        return 0;
+    }
+    return err == CR_SERVER_GONE_ERROR
+        || (err == CR_SERVER_LOST && mysql_stmt_field_count(statement->statement) > 0);
+}
+
+/**
+ * Reconnect and prepare the statement again on the new connection. The
+ * statement is no longer cached afterwards and is freed when finished.
+ */
+static int __db_backend_mysql_reprepare(db_backend_mysql_statement_t* statement) {
+    db_backend_mysql_t* backend_mysql = statement->backend_mysql;
+
+    if (__db_backend_mysql_reconnect(backend_mysql)) {
+        return DB_ERROR_UNKNOWN;
+    }
+    mysql_stmt_close(statement->statement);
+    statement->bound = 0;
+    if (!(statement->statement = mysql_stmt_init(backend_mysql->db))
+        || mysql_stmt_prepare(statement->statement, statement->sql, strlen(statement->sql)))
+    {
+        if (statement->statement) {
+            ods_log_info("DB prepare Err %d: %s", mysql_stmt_errno(statement->statement), mysql_stmt_error(statement->statement));
+        }
+        return DB_ERROR_UNKNOWN;
+    }
     return DB_OK;
 }
 
@@ -645,11 +990,21 @@ static inline int __db_backend_mysql_execute(db_backend_mysql_statement_t* state
     }
 
     /*
-     * Execute the statement.
+     * Execute the statement, once more on a new connection if the old one
+     * was lost and that is safe.
      */
     if (mysql_stmt_execute(statement->statement)) {
-        ods_log_info("DB execute Err %d: %s", mysql_stmt_errno(statement->statement), mysql_stmt_error(statement->statement));
-        return DB_ERROR_UNKNOWN;
+        if (!__db_backend_mysql_retryable(statement)
+            || __db_backend_mysql_reprepare(statement)
+            || (statement->mysql_bind_input
+                && mysql_stmt_bind_param(statement->statement, statement->mysql_bind_input))
+            || mysql_stmt_execute(statement->statement))
+        {
+            if (statement->statement) {
+                ods_log_info("DB execute Err %d: %s", mysql_stmt_errno(statement->statement), mysql_stmt_error(statement->statement));
+            }
+            return DB_ERROR_UNKNOWN;
+        }
     }
 
     return DB_OK;
@@ -679,6 +1034,7 @@ static int db_backend_mysql_shutdown(void* data) {
     }
 
     if (__mysql_initialized) {
+        __db_backend_mysql_pool_drain();
         mysql_library_end();
         __mysql_initialized = 0;
     }
@@ -695,6 +1051,7 @@ static int db_backend_mysql_connect(void* data, const db_configuration_list_t* c
     const db_configuration_t* timeout_configuration;
     int timeout;
     unsigned int port = 0;
+    size_t key_size;
 
     if (!__mysql_initialized) {
         return DB_ERROR_UNKNOWN;
@@ -730,24 +1087,37 @@ static int db_backend_mysql_connect(void* data, const db_configuration_list_t* c
     }
 
     backend_mysql->db_host = (host ? db_configuration_value(host) : NULL);
+    key_size = 5 + 10
+        + (host ? strlen(db_configuration_value(host)) : 0)
+        + (user ? strlen(db_configuration_value(user)) : 0)
+        + (pass ? strlen(db_configuration_value(pass)) : 0)
+        + (db ? strlen(db_configuration_value(db)) : 0);
     backend_mysql->db_user = (user ? db_configuration_value(user) : NULL);
     backend_mysql->db_pass = (pass ? db_configuration_value(pass) : NULL);
     backend_mysql->db_port = port;
     backend_mysql->db_name = (db   ? db_configuration_value(db)   : NULL);
-    if (!(backend_mysql->db = mysql_init(NULL))
-        || mysql_options(backend_mysql->db, MYSQL_OPT_CONNECT_TIMEOUT, &backend_mysql->timeout)
-        || !mysql_real_connect(backend_mysql->db,
-                               backend_mysql->db_host, backend_mysql->db_user, backend_mysql->db_pass,
-                               backend_mysql->db_name, backend_mysql->db_port, NULL, 0)
-        || mysql_autocommit(backend_mysql->db, 1))
+
+    /*
+     * Connections in the pool are only reused by backends connecting with
+     * the very same settings.
+     */
+    free(backend_mysql->pool_key);
+    if (!(backend_mysql->pool_key = calloc(1, key_size))) {
+        return DB_ERROR_UNKNOWN;
+    }
+    snprintf(backend_mysql->pool_key, key_size, "%s\n%s\n%s\n%s\n%u",
+        backend_mysql->db_host ? backend_mysql->db_host : "",
+        backend_mysql->db_user ? backend_mysql->db_user : "",
+        backend_mysql->db_pass ? backend_mysql->db_pass : "",
+        backend_mysql->db_name ? backend_mysql->db_name : "",
+        port);
+
+    if (!(backend_mysql->db = __db_backend_mysql_pool_get(backend_mysql->pool_key))
+        && !(backend_mysql->db = __db_backend_mysql_open(backend_mysql)))
     {
-        if (backend_mysql->db) {
-            ods_log_error("db_backend_mysql: connect failed %d: %s", mysql_errno(backend_mysql->db), mysql_error(backend_mysql->db));
-            mysql_close(backend_mysql->db);
-            backend_mysql->db = NULL;
-        }
         return DB_ERROR_UNKNOWN;
     }
+    backend_mysql->last_used = time(NULL);
 
     return DB_OK;
 }
@@ -765,12 +1135,28 @@ static int db_backend_mysql_disconnect(void* data) {
         return DB_ERROR_UNKNOWN;
     }
 
-    if (backend_mysql->transaction) {
-        db_backend_mysql_transaction_rollback(backend_mysql);
+    /*
+     * A connection is only put back in the pool when it is known to be back
+     * in autocommit mode, outside of any transaction, and no statement on it
+     * is still in use.
+     */
+    if ((backend_mysql->transaction
+            && db_backend_mysql_transaction_rollback(backend_mysql))
+        || backend_mysql->statements > 0)
+    {
+        __db_backend_mysql_cache_flush(backend_mysql);
+        mysql_close(backend_mysql->db);
+        backend_mysql->db = NULL;
+        free(backend_mysql->pool_key);
+        backend_mysql->pool_key = NULL;
+        return DB_OK;
     }
 
-    mysql_close(backend_mysql->db);
+    __db_backend_mysql_cache_flush(backend_mysql);
+    __db_backend_mysql_pool_put(backend_mysql->pool_key, backend_mysql->db);
     backend_mysql->db = NULL;
+    free(backend_mysql->pool_key);
+    backend_mysql->pool_key = NULL;
 
     return DB_OK;
 }
@@ -786,6 +1172,7 @@ static int db_backend_mysql_disconnect(void* data) {
  */
 static int __db_backend_mysql_build_clause(const db_object_t* object, const db_clause_list_t* clause_list, char** sqlp, int* left) {
     const db_clause_t* clause;
+    const char* collate;
     int first, ret;
 
     if (!clause_list) {
@@ -831,6 +1218,12 @@ static int __db_backend_mysql_build_clause(const db_object_t* object, const db_c
             *left -= ret;
         }
 
+        /*
+         * Text is ordered by the collation of the column, which is case
+         * insensitive by default. Order text ranges by byte as SQLite and
+         * strcmp() do.
+         */
+        collate = (db_value_type(db_clause_value(clause)) == DB_TYPE_TEXT ? "BINARY " : "");
         switch (db_clause_type(clause)) {
         case DB_CLAUSE_EQUAL:
             if ((ret = snprintf(*sqlp, *left, " %s.%s = ?",
@@ -851,36 +1244,36 @@ static int __db_backend_mysql_build_clause(const db_object_t* object, const db_c
             break;
 
         case DB_CLAUSE_LESS_THEN:
-            if ((ret = snprintf(*sqlp, *left, " %s.%s < ?",
+            if ((ret = snprintf(*sqlp, *left, " %s.%s < %s?",
                 db_object_table(object),
-                db_clause_field(clause))) >= *left)
+                db_clause_field(clause), collate)) >= *left)
             {
                 return DB_ERROR_UNKNOWN;
             }
             break;
 
         case DB_CLAUSE_LESS_OR_EQUAL:
-            if ((ret = snprintf(*sqlp, *left, " %s.%s <= ?",
+            if ((ret = snprintf(*sqlp, *left, " %s.%s <= %s?",
                 db_object_table(object),
-                db_clause_field(clause))) >= *left)
+                db_clause_field(clause), collate)) >= *left)
             {
                 return DB_ERROR_UNKNOWN;
             }
             break;
 
         case DB_CLAUSE_GREATER_OR_EQUAL:
-            if ((ret = snprintf(*sqlp, *left, " %s.%s >= ?",
+            if ((ret = snprintf(*sqlp, *left, " %s.%s >= %s?",
                 db_object_table(object),
-                db_clause_field(clause))) >= *left)
+                db_clause_field(clause), collate)) >= *left)
             {
                 return DB_ERROR_UNKNOWN;
             }
             break;
 
         case DB_CLAUSE_GREATER_THEN:
-            if ((ret = snprintf(*sqlp, *left, " %s.%s > ?",
+            if ((ret = snprintf(*sqlp, *left, " %s.%s > %s?",
                 db_object_table(object),
-                db_clause_field(clause))) >= *left)
+                db_clause_field(clause), collate)) >= *left)
             {
                 return DB_ERROR_UNKNOWN;
             }
@@ -1332,13 +1725,14 @@ db_backend_mysql_last_id(void *data, int *last_id)
     return (*last_id) ?  DB_OK : DB_ERROR_UNKNOWN;
 }
 
-static int db_backend_mysql_create(void* data, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* value_set) {
+static int db_backend_mysql_create_many(void* data, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* const* value_sets, size_t count) {
     db_backend_mysql_t* backend_mysql = (db_backend_mysql_t*)data;
     const db_object_field_t* object_field;
     const db_object_field_t* revision_field = NULL;
     char sql[4*1024];
     char* sqlp;
     int ret, left, first;
+    size_t row;
     db_backend_mysql_statement_t* statement = NULL;
     db_backend_mysql_bind_t* bind;
     db_value_t revision = DB_VALUE_EMPTY;
@@ -1355,7 +1749,7 @@ static int db_backend_mysql_create(void* data, const db_object_t* object, const
     if (!object_field_list) {
         return DB_ERROR_UNKNOWN;
     }
-    if (!value_set) {
+    if (!value_sets || !count) {
         return DB_ERROR_UNKNOWN;
     }
 
@@ -1385,6 +1779,9 @@ static int db_backend_mysql_create(void* data, const db_object_t* object, const
         /*
          * Special case when tables has no fields except maybe a primary key.
          */
+        if (count > 1) {
+            return DB_ERROR_UNKNOWN;
+        }
         if ((ret = snprintf(sqlp, left, "INSERT INTO %s () VALUES ()", db_object_table(object))) >= left) {
             return DB_ERROR_UNKNOWN;
         }
@@ -1440,59 +1837,70 @@ static int db_backend_mysql_create(void* data, const db_object_t* object, const
             left -= ret;
         }
 
-        if ((ret = snprintf(sqlp, left, " ) VALUES (")) >= left) {
+        if ((ret = snprintf(sqlp, left, " ) VALUES")) >= left) {
             return DB_ERROR_UNKNOWN;
         }
         sqlp += ret;
         left -= ret;
 
         /*
-         * Mark all the fields for binding from the object_field_list.
+         * Add a list of placeholders for each row.
          */
-        object_field = db_object_field_list_begin(object_field_list);
-        first = 1;
-        while (object_field) {
-            if (first) {
-                if ((ret = snprintf(sqlp, left, " ?")) >= left) {
-                    return DB_ERROR_UNKNOWN;
-                }
-                first = 0;
-            }
-            else {
-                if ((ret = snprintf(sqlp, left, ", ?")) >= left) {
-                    return DB_ERROR_UNKNOWN;
-                }
+        for (row = 0; row < count; row++) {
+            if ((ret = snprintf(sqlp, left, row ? ", (" : " (")) >= left) {
+                return DB_ERROR_UNKNOWN;
             }
             sqlp += ret;
             left -= ret;
 
-            object_field = db_object_field_next(object_field);
-        }
-
-        /*
-         * Mark revision field for binding if we have one.
-         */
-        if (revision_field) {
-            if (first) {
-                if ((ret = snprintf(sqlp, left, " ?")) >= left) {
-                    return DB_ERROR_UNKNOWN;
+            /*
+             * Mark all the fields for binding from the object_field_list.
+             */
+            object_field = db_object_field_list_begin(object_field_list);
+            first = 1;
+            while (object_field) {
+                if (first) {
+                    if ((ret = snprintf(sqlp, left, " ?")) >= left) {
+                        return DB_ERROR_UNKNOWN;
+                    }
+                    first = 0;
                 }
-                first = 0;
+                else {
+                    if ((ret = snprintf(sqlp, left, ", ?")) >= left) {
+                        return DB_ERROR_UNKNOWN;
+                    }
+                }
+                sqlp += ret;
+                left -= ret;
+
+                object_field = db_object_field_next(object_field);
             }
-            else {
-                if ((ret = snprintf(sqlp, left, ", ?")) >= left) {
-                    return DB_ERROR_UNKNOWN;
+
+            /*
+             * Mark revision field for binding if we have one.
+             */
+            if (revision_field) {
+                if (first) {
+                    if ((ret = snprintf(sqlp, left, " ?")) >= left) {
+                        return DB_ERROR_UNKNOWN;
+                    }
+                    first = 0;
                 }
+                else {
+                    if ((ret = snprintf(sqlp, left, ", ?")) >= left) {
+                        return DB_ERROR_UNKNOWN;
+                    }
+                }
+                sqlp += ret;
+                left -= ret;
+            }
+
+            if ((ret = snprintf(sqlp, left, " )")) >= left) {
+                return DB_ERROR_UNKNOWN;
             }
             sqlp += ret;
             left -= ret;
         }
-
-        if ((ret = snprintf(sqlp, left, " )")) >= left) {
-            return DB_ERROR_UNKNOWN;
-        }
-        sqlp += ret;
-        left -= ret;
     }
 
     /*
@@ -1507,32 +1915,36 @@ static int db_backend_mysql_create(void* data, const db_object_t* object, const
     }
 
     /*
-     * Bind all the values from value_set.
-     */
-    if (__db_backend_mysql_bind_value_set(&bind, value_set)) {
-        __db_backend_mysql_finish(statement);
-        return DB_ERROR_UNKNOWN;
-    }
-
-    /*
-     * Bind the revision field value if we have one.
+     * Bind all the values from each value set, followed by the revision.
      */
-    if (revision_field) {
-        if (db_value_from_int64(&revision, 1)
-            || __db_backend_mysql_bind_value(bind, &revision))
-        {
-            db_value_reset(&revision);
+    for (row = 0; row < count; row++) {
+        if (__db_backend_mysql_bind_value_set(&bind, value_sets[row])) {
             __db_backend_mysql_finish(statement);
             return DB_ERROR_UNKNOWN;
         }
-        db_value_reset(&revision);
+
+        /*
+         * Bind the revision field value if we have one.
+         */
+        if (revision_field) {
+            if (!bind
+                || db_value_from_int64(&revision, 1)
+                || __db_backend_mysql_bind_value(bind, &revision))
+            {
+                db_value_reset(&revision);
+                __db_backend_mysql_finish(statement);
+                return DB_ERROR_UNKNOWN;
+            }
+            db_value_reset(&revision);
+            bind = bind->next;
+        }
     }
 
     /*
      * Execute the SQL.
      */
     if (__db_backend_mysql_execute(statement)
-        || mysql_stmt_affected_rows(statement->statement) != 1)
+        || mysql_stmt_affected_rows(statement->statement) != count)
     {
         __db_backend_mysql_finish(statement);
         return DB_ERROR_UNKNOWN;
@@ -1542,27 +1954,23 @@ static int db_backend_mysql_create(void* data, const db_object_t* object, const
     return DB_OK;
 }
 
-static db_result_list_t* db_backend_mysql_read(void* data, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list) {
-    db_backend_mysql_t* backend_mysql = (db_backend_mysql_t*)data;
+static int db_backend_mysql_create(void* data, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* value_set) {
+    return db_backend_mysql_create_many(data, object, object_field_list, &value_set, 1);
+}
+
+/**
+ * Prepare, bind and execute the SELECT for reading an object or objects,
+ * returns the statement ready to be fetched from or NULL on error.
+ */
+static db_backend_mysql_statement_t* __db_backend_mysql_select(db_backend_mysql_t* backend_mysql, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list) {
     const db_object_field_t* object_field;
     const db_join_t* join;
     char sql[4*1024];
     char* sqlp;
     int ret, left, first;
-    db_result_list_t* result_list;
     db_backend_mysql_statement_t* statement = NULL;
     db_backend_mysql_bind_t* bind;
 
-    if (!__mysql_initialized) {
-        return NULL;
-    }
-    if (!backend_mysql) {
-        return NULL;
-    }
-    if (!object) {
-        return NULL;
-    }
-
     left = sizeof(sql);
     sqlp = sql;
     memset(sql, 0, left);
@@ -1654,6 +2062,28 @@ static db_result_list_t* db_backend_mysql_read(void* data, const db_object_t* ob
         return NULL;
     }
 
+    return statement;
+}
+
+static db_result_list_t* db_backend_mysql_read(void* data, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list) {
+    db_backend_mysql_t* backend_mysql = (db_backend_mysql_t*)data;
+    db_result_list_t* result_list;
+    db_backend_mysql_statement_t* statement;
+
+    if (!__mysql_initialized) {
+        return NULL;
+    }
+    if (!backend_mysql) {
+        return NULL;
+    }
+    if (!object) {
+        return NULL;
+    }
+
+    if (!(statement = __db_backend_mysql_select(backend_mysql, object, join_list, clause_list))) {
+        return NULL;
+    }
+
     if (!(result_list = db_result_list_new())
         || db_result_list_set_next(result_list, db_backend_mysql_next, statement, mysql_stmt_affected_rows(statement->statement)))
     {
@@ -1664,6 +2094,101 @@ static db_result_list_t* db_backend_mysql_read(void* data, const db_object_t* ob
     return result_list;
 }
 
+/**
+ * Copy the output binds of the fetched row of a statement into a new row of
+ * columns.
+ */
+static int __db_backend_mysql_columns_row(db_backend_mysql_statement_t* statement, db_result_columns_t* columns) {
+    const db_object_field_t* object_field;
+    db_backend_mysql_bind_t* bind;
+    MYSQL_BIND* mysql_bind;
+    size_t field;
+    int ret;
+
+    if (db_result_columns_add_row(columns)) {
+        return DB_ERROR_UNKNOWN;
+    }
+    object_field = db_object_field_list_begin(statement->object_field_list);
+    bind = statement->bind_output;
+    field = 0;
+    while (object_field) {
+        if (!bind || !(mysql_bind = bind->bind) || !mysql_bind->buffer) {
+            return DB_ERROR_UNKNOWN;
+        }
+
+        switch (mysql_bind->buffer_type) {
+        case MYSQL_TYPE_LONG:
+            if (mysql_bind->is_unsigned) {
+                ret = db_result_columns_set_int(columns, field, *((db_type_uint32_t*)mysql_bind->buffer));
+            }
+            else {
+                ret = db_result_columns_set_int(columns, field, *((db_type_int32_t*)mysql_bind->buffer));
+            }
+            break;
+
+        case MYSQL_TYPE_LONGLONG:
+            ret = db_result_columns_set_int(columns, field, *((db_type_int64_t*)mysql_bind->buffer));
+            break;
+
+        case MYSQL_TYPE_STRING:
+            ret = db_result_columns_set_text(columns, field, (char*)mysql_bind->buffer, bind->length);
+            break;
+
+        default:
+            return DB_ERROR_UNKNOWN;
+        }
+        if (ret) {
+            return ret;
+        }
+
+        object_field = db_object_field_next(object_field);
+        field++;
+        bind = bind->next;
+    }
+    return DB_OK;
+}
+
+static db_result_columns_t* db_backend_mysql_read_columns(void* data, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list) {
+    db_backend_mysql_t* backend_mysql = (db_backend_mysql_t*)data;
+    db_backend_mysql_statement_t* statement;
+    db_result_columns_t* columns;
+
+    if (!__mysql_initialized) {
+        return NULL;
+    }
+    if (!backend_mysql) {
+        return NULL;
+    }
+    if (!object) {
+        return NULL;
+    }
+
+    if (!(statement = __db_backend_mysql_select(backend_mysql, object, join_list, clause_list))) {
+        return NULL;
+    }
+    if (!(columns = db_result_columns_new(statement->fields))) {
+        __db_backend_mysql_finish(statement);
+        return NULL;
+    }
+    while (!__db_backend_mysql_fetch(statement)) {
+        if (__db_backend_mysql_columns_row(statement, columns)) {
+            db_result_columns_free(columns);
+            __db_backend_mysql_finish(statement);
+            return NULL;
+        }
+    }
+    /*
+     * The fetch also fails at the end of the rows, only then is there no
+     * error set on the statement.
+     */
+    if (mysql_stmt_errno(statement->statement)) {
+        db_result_columns_free(columns);
+        columns = NULL;
+    }
+    __db_backend_mysql_finish(statement);
+    return columns;
+}
+
 static int db_backend_mysql_update(void* data, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* value_set, const db_clause_list_t* clause_list) {
     db_backend_mysql_t* backend_mysql = (db_backend_mysql_t*)data;
     const db_object_field_t* object_field;
@@ -2152,14 +2677,13 @@ static void db_backend_mysql_free(void* data) {
         if (backend_mysql->db) {
             (void)db_backend_mysql_disconnect(backend_mysql);
         }
+        free(backend_mysql->pool_key);
         free(backend_mysql);
     }
 }
 
 static int db_backend_mysql_transaction_begin(void* data) {
     db_backend_mysql_t* backend_mysql = (db_backend_mysql_t*)data;
-    static const char* sql = "BEGIN TRANSACTION";
-    db_backend_mysql_statement_t* statement = NULL;
 
     if (!__mysql_initialized) {
         return DB_ERROR_UNKNOWN;
@@ -2171,15 +2695,18 @@ static int db_backend_mysql_transaction_begin(void* data) {
         return DB_ERROR_UNKNOWN;
     }
 
-    if (__db_backend_mysql_prepare(backend_mysql, &statement, sql, strlen(sql), NULL)) {
+    /*
+     * Transaction statements can not be prepared, turning off autocommit
+     * starts a transaction instead.
+     */
+    checkconnection(backend_mysql);
+    if (!backend_mysql->db) {
         return DB_ERROR_UNKNOWN;
     }
-
-    if (__db_backend_mysql_execute(statement)) {
-        __db_backend_mysql_finish(statement);
+    if (mysql_autocommit(backend_mysql->db, 0)) {
+        ods_log_info("DB begin Err %d: %s", mysql_errno(backend_mysql->db), mysql_error(backend_mysql->db));
         return DB_ERROR_UNKNOWN;
     }
-    __db_backend_mysql_finish(statement);
 
     backend_mysql->transaction = 1;
     return DB_OK;
@@ -2187,8 +2714,6 @@ static int db_backend_mysql_transaction_begin(void* data) {
 
 static int db_backend_mysql_transaction_commit(void* data) {
     db_backend_mysql_t* backend_mysql = (db_backend_mysql_t*)data;
-    static const char* sql = "COMMIT TRANSACTION";
-    db_backend_mysql_statement_t* statement = NULL;
 
     if (!__mysql_initialized) {
         return DB_ERROR_UNKNOWN;
@@ -2199,25 +2724,24 @@ static int db_backend_mysql_transaction_commit(void* data) {
     if (!backend_mysql->transaction) {
         return DB_ERROR_UNKNOWN;
     }
-
-    if (__db_backend_mysql_prepare(backend_mysql, &statement, sql, strlen(sql), NULL)) {
+    if (!backend_mysql->db) {
         return DB_ERROR_UNKNOWN;
     }
 
-    if (__db_backend_mysql_execute(statement)) {
-        __db_backend_mysql_finish(statement);
+    backend_mysql->transaction = 0;
+    if (mysql_commit(backend_mysql->db)) {
+        ods_log_info("DB commit Err %d: %s", mysql_errno(backend_mysql->db), mysql_error(backend_mysql->db));
+        (void)mysql_autocommit(backend_mysql->db, 1);
+        return DB_ERROR_UNKNOWN;
+    }
+    if (mysql_autocommit(backend_mysql->db, 1)) {
         return DB_ERROR_UNKNOWN;
     }
-    __db_backend_mysql_finish(statement);
-
-    backend_mysql->transaction = 0;
     return DB_OK;
 }
 
 static int db_backend_mysql_transaction_rollback(void* data) {
     db_backend_mysql_t* backend_mysql = (db_backend_mysql_t*)data;
-    static const char* sql = "ROLLBACK TRANSACTION";
-    db_backend_mysql_statement_t* statement = NULL;
 
     if (!__mysql_initialized) {
         return DB_ERROR_UNKNOWN;
@@ -2228,18 +2752,19 @@ static int db_backend_mysql_transaction_rollback(void* data) {
     if (!backend_mysql->transaction) {
         return DB_ERROR_UNKNOWN;
     }
-
-    if (__db_backend_mysql_prepare(backend_mysql, &statement, sql, strlen(sql), NULL)) {
+    if (!backend_mysql->db) {
         return DB_ERROR_UNKNOWN;
     }
 
-    if (__db_backend_mysql_execute(statement)) {
-        __db_backend_mysql_finish(statement);
+    backend_mysql->transaction = 0;
+    if (mysql_rollback(backend_mysql->db)) {
+        ods_log_info("DB rollback Err %d: %s", mysql_errno(backend_mysql->db), mysql_error(backend_mysql->db));
+        (void)mysql_autocommit(backend_mysql->db, 1);
+        return DB_ERROR_UNKNOWN;
+    }
+    if (mysql_autocommit(backend_mysql->db, 1)) {
         return DB_ERROR_UNKNOWN;
     }
-    __db_backend_mysql_finish(statement);
-
-    backend_mysql->transaction = 0;
     return DB_OK;
 }
 
@@ -2256,7 +2781,9 @@ db_backend_handle_t* db_backend_mysql_new_handle(void) {
             || db_backend_handle_set_disconnect(backend_handle, db_backend_mysql_disconnect)
             || db_backend_handle_set_last_id(backend_handle, db_backend_mysql_last_id)
             || db_backend_handle_set_create(backend_handle, db_backend_mysql_create)
+            || db_backend_handle_set_create_many(backend_handle, db_backend_mysql_create_many)
             || db_backend_handle_set_read(backend_handle, db_backend_mysql_read)
+            || db_backend_handle_set_read_columns(backend_handle, db_backend_mysql_read_columns)
             || db_backend_handle_set_update(backend_handle, db_backend_mysql_update)
             || db_backend_handle_set_delete(backend_handle, db_backend_mysql_delete)
             || db_backend_handle_set_count(backend_handle, db_backend_mysql_count)
@@ -2272,3 +2799,37 @@ db_backend_handle_t* db_backend_mysql_new_handle(void) {
     }
     return backend_handle;
 }
+
+void db_backend_mysql_statement_cache_stats(unsigned long* hits, unsigned long* misses) {
+    pthread_mutex_lock(&__mysql_cache_mutex);
+    if (hits) {
+        *hits = __mysql_cache_hits;
+    }
+    if (misses) {
+        *misses = __mysql_cache_misses;
+    }
+    pthread_mutex_unlock(&__mysql_cache_mutex);
+}
+
+void db_backend_mysql_pool_stats(unsigned long* opened, unsigned long* reused, unsigned long* reconnects) {
+    pthread_mutex_lock(&__mysql_pool_mutex);
+    if (opened) {
+        *opened = __mysql_pool_opened;
+    }
+    if (reused) {
+        *reused = __mysql_pool_reused;
+    }
+    if (reconnects) {
+        *reconnects = __mysql_pool_reconnects;
+    }
+    pthread_mutex_unlock(&__mysql_pool_mutex);
+}
+
+unsigned long db_backend_mysql_rows_fetched(void) {
+    unsigned long rows;
+
+    pthread_mutex_lock(&__mysql_cache_mutex);
+    rows = __mysql_rows;
+    pthread_mutex_unlock(&__mysql_cache_mutex);
+    return rows;
+}
@@ -35,6 +35,9 @@
 #define DB_BACKEND_MYSQL_DEFAULT_TIMEOUT 30
 #define DB_BACKEND_MYSQL_STRING_MIN_SIZE 64
 #define DB_BACKEND_MYSQL_STRING_MAX_SIZE 4096
+#define DB_BACKEND_MYSQL_STATEMENT_CACHE 64
+#define DB_BACKEND_MYSQL_POOL_SIZE 16
+#define DB_BACKEND_MYSQL_PING_INTERVAL 30
 
 /**
  * Create a new database backend handle for SQLite.
@@ -42,4 +45,27 @@
  */
 db_backend_handle_t* db_backend_mysql_new_handle(void);
 
+/**
+ * Get the prepared statement cache hit and miss counters of all MySQL
+ * database backends.
+ * \param[out] hits the number of statements taken from the cache.
+ * \param[out] misses the number of statements that had to be prepared.
+ */
+void db_backend_mysql_statement_cache_stats(unsigned long* hits, unsigned long* misses);
+
+/**
+ * Get the number of rows fetched by all MySQL database backends.
+ * \return the number of rows.
+ */
+unsigned long db_backend_mysql_rows_fetched(void);
+
+/**
+ * Get the connection counters of all MySQL database backends.
+ * \param[out] opened the number of connections made to the server.
+ * \param[out] reused the number of connects served from the pool of idle
+ * connections.
+ * \param[out] reconnects the number of times a lost connection was replaced.
+ */
+void db_backend_mysql_pool_stats(unsigned long* opened, unsigned long* reused, unsigned long* reconnects);
+
 #endif
@@ -60,6 +60,27 @@ static int __sqlite3_initialized = 0;
 static pthread_mutex_t __sqlite_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t __sqlite_cond = PTHREAD_COND_INITIALIZER;
 
+/**
+ * Prepared statement cache hit and miss counters for all SQLite backends.
+ */
+static pthread_mutex_t __sqlite_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long __sqlite_cache_hits = 0;
+static unsigned long __sqlite_cache_misses = 0;
+static unsigned long __sqlite_rows = 0;
+
+/**
+ * A cached prepared statement, keyed by the SQL it was prepared from. A
+ * statement that is in use is not handed out again until it is released by
+ * the finalize function, which resets it instead of finalizing it.
+ */
+typedef struct db_backend_sqlite_cache {
+    char* sql;
+    unsigned int hash;
+    sqlite3_stmt* statement;
+    int in_use;
+    unsigned long used;
+} db_backend_sqlite_cache_t;
+
 /**
  * The SQLite database backend specific data.
  */
@@ -69,6 +90,9 @@ typedef struct db_backend_sqlite {
     int timeout;
     int time;
     long usleep;
+    db_backend_sqlite_cache_t cache[DB_BACKEND_SQLITE_STATEMENT_CACHE];
+    unsigned long cache_tick;
+    unsigned long rows;
 } db_backend_sqlite_t;
 
 
@@ -136,11 +160,54 @@ static int __db_backend_sqlite_busy_handler(void *data, int retry) {
     return 1;
 }
 
+static unsigned int __db_backend_sqlite_hash(const char* sql) {
+    unsigned int hash = 2166136261u;
+
+    while (*sql) {
+        hash = (hash ^ (unsigned char)*sql++) * 16777619u;
+    }
+    return hash;
+}
+
+static void __db_backend_sqlite_cache_count(int hit) {
+    pthread_mutex_lock(&__sqlite_cache_mutex);
+    if (hit) {
+        __sqlite_cache_hits++;
+    }
+    else {
+        __sqlite_cache_misses++;
+    }
+    pthread_mutex_unlock(&__sqlite_cache_mutex);
+}
+
+/**
+ * Finalize all cached statements, must be done before the database is closed.
+ * Statements in use are only removed from the cache and will be finalized
+ * when released.
+ */
+static void __db_backend_sqlite_cache_flush(db_backend_sqlite_t* backend_sqlite) {
+    int i;
+
+    for (i = 0; i < DB_BACKEND_SQLITE_STATEMENT_CACHE; i++) {
+        if (backend_sqlite->cache[i].statement && !backend_sqlite->cache[i].in_use) {
+            sqlite3_finalize(backend_sqlite->cache[i].statement);
+        }
+        free(backend_sqlite->cache[i].sql);
+    }
+    memset(backend_sqlite->cache, 0, sizeof(backend_sqlite->cache));
+}
+
 /**
  * SQLite prepare function.
+ *
+ * Statements are taken from the cache if the same SQL has been prepared
+ * before and is not in use, otherwise the statement is prepared and put in
+ * the cache replacing the least recently used statement that is not in use.
  */
 static inline int __db_backend_sqlite_prepare(db_backend_sqlite_t* backend_sqlite, sqlite3_stmt** statement, const char* sql, size_t size) {
-    int ret;
+    db_backend_sqlite_cache_t* entry = NULL;
+    unsigned int hash;
+    int ret, i;
 
     if (!backend_sqlite) {
         return DB_ERROR_UNKNOWN;
@@ -160,6 +227,29 @@ static inline int __db_backend_sqlite_prepare(db_backend_sqlite_t* backend_sqlit
 
     ods_log_debug("%s", sql);
     backend_sqlite->time = time(NULL);
+    backend_sqlite->cache_tick++;
+
+    hash = __db_backend_sqlite_hash(sql);
+    for (i = 0; i < DB_BACKEND_SQLITE_STATEMENT_CACHE; i++) {
+        db_backend_sqlite_cache_t* cached = &(backend_sqlite->cache[i]);
+
+        if (cached->statement
+            && !cached->in_use
+            && cached->hash == hash
+            && !strcmp(cached->sql, sql))
+        {
+            cached->in_use = 1;
+            cached->used = backend_sqlite->cache_tick;
+            *statement = cached->statement;
+            __db_backend_sqlite_cache_count(1);
+            return DB_OK;
+        }
+        if (!cached->in_use && (!entry || cached->used < entry->used)) {
+            entry = cached;
+        }
+    }
+    __db_backend_sqlite_cache_count(0);
+
     ret = sqlite3_prepare_v2(backend_sqlite->db,
         sql,
         size,
@@ -175,6 +265,24 @@ static inline int __db_backend_sqlite_prepare(db_backend_sqlite_t* backend_sqlit
         return DB_ERROR_UNKNOWN;
     }
 
+    /*
+     * If all cached statements are in use the statement is not cached and
+     * will be finalized when released.
+     */
+    if (entry) {
+        if (entry->statement) {
+            sqlite3_finalize(entry->statement);
+        }
+        free(entry->sql);
+        memset(entry, 0, sizeof(db_backend_sqlite_cache_t));
+        if ((entry->sql = strdup(sql))) {
+            entry->hash = hash;
+            entry->statement = *statement;
+            entry->in_use = 1;
+            entry->used = backend_sqlite->cache_tick;
+        }
+    }
+
     return DB_OK;
 }
 
@@ -197,6 +305,9 @@ static inline int __db_backend_sqlite_step(db_backend_sqlite_t* backend_sqlite,
 
     backend_sqlite->time = time(NULL);
     ret = sqlite3_step(statement);
+    if (ret == SQLITE_ROW) {
+        backend_sqlite->rows++;
+    }
     /*
     if (ret == SQLITE_BUSY) {
         ods_log_deeebug("db_backend_sqlite_step: Database busy, waiting...");
@@ -239,14 +350,39 @@ static inline int __db_backend_sqlite_step(db_backend_sqlite_t* backend_sqlite,
 /**
  * SQLite finalize function.
  *
- * This will also signal the pthread cond that is used for busy handler.
+ * Cached statements are reset and released back to the cache, others are
+ * finalized. This will also signal the pthread cond that is used for busy
+ * handler.
  */
-static inline int __db_backend_sqlite_finalize(sqlite3_stmt* statement) {
-    int ret;
+static inline int __db_backend_sqlite_finalize(db_backend_sqlite_t* backend_sqlite, sqlite3_stmt* statement) {
+    int ret, i;
 
-    ret = sqlite3_finalize(statement);
+    for (i = 0; i < DB_BACKEND_SQLITE_STATEMENT_CACHE; i++) {
+        if (backend_sqlite->cache[i].statement == statement) {
+            break;
+        }
+    }
+    if (statement && i < DB_BACKEND_SQLITE_STATEMENT_CACHE) {
+        ret = sqlite3_reset(statement);
+        sqlite3_clear_bindings(statement);
+        backend_sqlite->cache[i].in_use = 0;
+    }
+    else {
+        ret = sqlite3_finalize(statement);
+    }
     pthread_cond_broadcast(&__sqlite_cond);
 
+    /*
+     * Rows are counted per backend while stepping and added to the shared
+     * counter once per statement.
+     */
+    if (backend_sqlite->rows) {
+        pthread_mutex_lock(&__sqlite_cache_mutex);
+        __sqlite_rows += backend_sqlite->rows;
+        pthread_mutex_unlock(&__sqlite_cache_mutex);
+        backend_sqlite->rows = 0;
+    }
+
     return ret;
 }
 
@@ -289,6 +425,7 @@ static int db_backend_sqlite_connect(void* data, const db_configuration_list_t*
     const db_configuration_t* file;
     const db_configuration_t* timeout;
     const db_configuration_t* usleep;
+    const db_configuration_t* journal;
     int ret;
 
     if (!__sqlite3_initialized) {
@@ -340,6 +477,30 @@ static int db_backend_sqlite_connect(void* data, const db_configuration_list_t*
         backend_sqlite->db = NULL;
         return DB_ERROR_UNKNOWN;
     }
+
+    /*
+     * In WAL mode readers do not block the writer and the writer does not
+     * block readers. The journal mode is persistent in the database file, so
+     * the default rollback journal is set explicitly as well to switch a
+     * database back from WAL.
+     */
+    journal = db_configuration_list_find(configuration_list, "journal");
+    if (journal && !strcmp(db_configuration_value(journal), "wal")) {
+        if ((ret = sqlite3_exec(backend_sqlite->db, "PRAGMA journal_mode=WAL", NULL, NULL, NULL)) != SQLITE_OK
+            || (ret = sqlite3_exec(backend_sqlite->db, "PRAGMA synchronous=NORMAL", NULL, NULL, NULL)) != SQLITE_OK)
+        {
+            ods_log_error("db_backend_sqlite: unable to enable WAL journal mode, error %d", ret);
+            sqlite3_close(backend_sqlite->db);
+            backend_sqlite->db = NULL;
+            return DB_ERROR_UNKNOWN;
+        }
+    }
+    else if ((ret = sqlite3_exec(backend_sqlite->db, "PRAGMA journal_mode=DELETE", NULL, NULL, NULL)) != SQLITE_OK) {
+        ods_log_error("db_backend_sqlite: unable to set DELETE journal mode, error %d", ret);
+        sqlite3_close(backend_sqlite->db);
+        backend_sqlite->db = NULL;
+        return DB_ERROR_UNKNOWN;
+    }
     /*
      * Enable This line to log complete queries to stdout.
      * sqlite3_trace(backend_sqlite->db, printf, "SQL: %s\n");
@@ -365,6 +526,7 @@ static int db_backend_sqlite_disconnect(void* data) {
     if (backend_sqlite->transaction) {
         db_backend_sqlite_transaction_rollback(backend_sqlite);
     }
+    __db_backend_sqlite_cache_flush(backend_sqlite);
     ret = sqlite3_close(backend_sqlite->db);
     if (ret != SQLITE_OK) {
         return DB_ERROR_UNKNOWN;
@@ -679,7 +841,7 @@ static db_result_t* db_backend_sqlite_next(void* data, int finish) {
     }
 
     if (finish) {
-        __db_backend_sqlite_finalize(statement->statement);
+        __db_backend_sqlite_finalize(statement->backend_sqlite, statement->statement);
         free(statement);
         return NULL;
     }
@@ -833,29 +995,30 @@ db_backend_sqlite_last_id(void* data, int *last_id)
     }
     int ret = __db_backend_sqlite_step(backend_sqlite, statement);
     if (ret != SQLITE_DONE && ret != SQLITE_ROW) {
-        __db_backend_sqlite_finalize(statement);
+        __db_backend_sqlite_finalize(backend_sqlite, statement);
         return DB_ERROR_UNKNOWN;
     }
     *last_id = sqlite3_column_int(statement, 0);
     ret = sqlite3_errcode(backend_sqlite->db);
     if ((ret != SQLITE_OK && ret != SQLITE_ROW && ret != SQLITE_DONE)) {
-        __db_backend_sqlite_finalize(statement);
+        __db_backend_sqlite_finalize(backend_sqlite, statement);
         return DB_ERROR_UNKNOWN;
     }
-    __db_backend_sqlite_finalize(statement);
+    __db_backend_sqlite_finalize(backend_sqlite, statement);
     return DB_OK;
 }
 
-static int db_backend_sqlite_create(void* data, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* value_set) {
+static int db_backend_sqlite_create_many(void* data, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* const* value_sets, size_t count) {
     db_backend_sqlite_t* backend_sqlite = (db_backend_sqlite_t*)data;
     const db_object_field_t* object_field;
     const db_object_field_t* revision_field = NULL;
+    const db_value_set_t* value_set;
     const db_value_t* value;
     char sql[4*1024];
     char* sqlp;
     int ret, left, bind, first;
     sqlite3_stmt* statement = NULL;
-    size_t value_pos;
+    size_t value_pos, row;
     int to_int;
     sqlite3_int64 to_int64;
     db_type_int32_t int32;
@@ -875,7 +1038,7 @@ static int db_backend_sqlite_create(void* data, const db_object_t* object, const
     if (!object_field_list) {
         return DB_ERROR_UNKNOWN;
     }
-    if (!value_set) {
+    if (!value_sets || !count) {
         return DB_ERROR_UNKNOWN;
     }
 
@@ -905,6 +1068,9 @@ static int db_backend_sqlite_create(void* data, const db_object_t* object, const
         /*
          * Special case when tables has no fields except maybe a primary key.
          */
+        if (count > 1) {
+            return DB_ERROR_UNKNOWN;
+        }
         if ((ret = snprintf(sqlp, left, "INSERT INTO %s DEFAULT VALUES", db_object_table(object))) >= left) {
             return DB_ERROR_UNKNOWN;
         }
@@ -960,59 +1126,70 @@ static int db_backend_sqlite_create(void* data, const db_object_t* object, const
             left -= ret;
         }
 
-        if ((ret = snprintf(sqlp, left, " ) VALUES (")) >= left) {
+        if ((ret = snprintf(sqlp, left, " ) VALUES")) >= left) {
             return DB_ERROR_UNKNOWN;
         }
         sqlp += ret;
         left -= ret;
 
         /*
-         * Mark all the fields for binding from the object_field_list.
+         * Add a list of placeholders for each row.
          */
-        object_field = db_object_field_list_begin(object_field_list);
-        first = 1;
-        while (object_field) {
-            if (first) {
-                if ((ret = snprintf(sqlp, left, " ?")) >= left) {
-                    return DB_ERROR_UNKNOWN;
-                }
-                first = 0;
-            }
-            else {
-                if ((ret = snprintf(sqlp, left, ", ?")) >= left) {
-                    return DB_ERROR_UNKNOWN;
-                }
+        for (row = 0; row < count; row++) {
+            if ((ret = snprintf(sqlp, left, row ? ", (" : " (")) >= left) {
+                return DB_ERROR_UNKNOWN;
             }
             sqlp += ret;
             left -= ret;
 
-            object_field = db_object_field_next(object_field);
-        }
-
-        /*
-         * Mark revision field for binding if we have one.
-         */
-        if (revision_field) {
-            if (first) {
-                if ((ret = snprintf(sqlp, left, " ?")) >= left) {
-                    return DB_ERROR_UNKNOWN;
+            /*
+             * Mark all the fields for binding from the object_field_list.
+             */
+            object_field = db_object_field_list_begin(object_field_list);
+            first = 1;
+            while (object_field) {
+                if (first) {
+                    if ((ret = snprintf(sqlp, left, " ?")) >= left) {
+                        return DB_ERROR_UNKNOWN;
+                    }
+                    first = 0;
                 }
-                first = 0;
+                else {
+                    if ((ret = snprintf(sqlp, left, ", ?")) >= left) {
+                        return DB_ERROR_UNKNOWN;
+                    }
+                }
+                sqlp += ret;
+                left -= ret;
+
+                object_field = db_object_field_next(object_field);
             }
-            else {
-                if ((ret = snprintf(sqlp, left, ", ?")) >= left) {
-                    return DB_ERROR_UNKNOWN;
+
+            /*
+             * Mark revision field for binding if we have one.
+             */
+            if (revision_field) {
+                if (first) {
+                    if ((ret = snprintf(sqlp, left, " ?")) >= left) {
+                        return DB_ERROR_UNKNOWN;
+                    }
+                    first = 0;
+                }
+                else {
+                    if ((ret = snprintf(sqlp, left, ", ?")) >= left) {
+                        return DB_ERROR_UNKNOWN;
+                    }
                 }
+                sqlp += ret;
+                left -= ret;
+            }
+
+            if ((ret = snprintf(sqlp, left, " )")) >= left) {
+                return DB_ERROR_UNKNOWN;
             }
             sqlp += ret;
             left -= ret;
         }
-
-        if ((ret = snprintf(sqlp, left, " )")) >= left) {
-            return DB_ERROR_UNKNOWN;
-        }
-        sqlp += ret;
-        left -= ret;
     }
 
     /*
@@ -1023,102 +1200,108 @@ static int db_backend_sqlite_create(void* data, const db_object_t* object, const
     }
 
     /*
-     * Bind all the values from value_set.
+     * Bind all the values from each value set, followed by the revision.
      */
     bind = 1;
-    for (value_pos = 0; value_pos < db_value_set_size(value_set); value_pos++) {
-        if (!(value = db_value_set_at(value_set, value_pos))) {
-            __db_backend_sqlite_finalize(statement);
+    for (row = 0; row < count; row++) {
+        if (!(value_set = value_sets[row])) {
+            __db_backend_sqlite_finalize(backend_sqlite, statement);
             return DB_ERROR_UNKNOWN;
         }
-
-        switch (db_value_type(value)) {
-        case DB_TYPE_INT32:
-            if (db_value_to_int32(value, &int32)) {
-                __db_backend_sqlite_finalize(statement);
-                return DB_ERROR_UNKNOWN;
-            }
-            to_int = int32;
-            ret = sqlite3_bind_int(statement, bind++, to_int);
-            if (ret != SQLITE_OK) {
-                __db_backend_sqlite_finalize(statement);
+        for (value_pos = 0; value_pos < db_value_set_size(value_set); value_pos++) {
+            if (!(value = db_value_set_at(value_set, value_pos))) {
+                __db_backend_sqlite_finalize(backend_sqlite, statement);
                 return DB_ERROR_UNKNOWN;
             }
-            break;
 
-        case DB_TYPE_UINT32:
-            if (db_value_to_uint32(value, &uint32)) {
-                __db_backend_sqlite_finalize(statement);
-                return DB_ERROR_UNKNOWN;
-            }
-            to_int = uint32;
-            ret = sqlite3_bind_int(statement, bind++, to_int);
-            if (ret != SQLITE_OK) {
-                __db_backend_sqlite_finalize(statement);
-                return DB_ERROR_UNKNOWN;
-            }
-            break;
+            switch (db_value_type(value)) {
+            case DB_TYPE_INT32:
+                if (db_value_to_int32(value, &int32)) {
+                    __db_backend_sqlite_finalize(backend_sqlite, statement);
+                    return DB_ERROR_UNKNOWN;
+                }
+                to_int = int32;
+                ret = sqlite3_bind_int(statement, bind++, to_int);
+                if (ret != SQLITE_OK) {
+                    __db_backend_sqlite_finalize(backend_sqlite, statement);
+                    return DB_ERROR_UNKNOWN;
+                }
+                break;
 
-        case DB_TYPE_INT64:
-            if (db_value_to_int64(value, &int64)) {
-                __db_backend_sqlite_finalize(statement);
-                return DB_ERROR_UNKNOWN;
-            }
-            to_int64 = int64;
-            ret = sqlite3_bind_int64(statement, bind++, to_int64);
-            if (ret != SQLITE_OK) {
-                __db_backend_sqlite_finalize(statement);
-                return DB_ERROR_UNKNOWN;
-            }
-            break;
+            case DB_TYPE_UINT32:
+                if (db_value_to_uint32(value, &uint32)) {
+                    __db_backend_sqlite_finalize(backend_sqlite, statement);
+                    return DB_ERROR_UNKNOWN;
+                }
+                to_int = uint32;
+                ret = sqlite3_bind_int(statement, bind++, to_int);
+                if (ret != SQLITE_OK) {
+                    __db_backend_sqlite_finalize(backend_sqlite, statement);
+                    return DB_ERROR_UNKNOWN;
+                }
+                break;
 
-        case DB_TYPE_UINT64:
-            if (db_value_to_uint64(value, &uint64)) {
-                __db_backend_sqlite_finalize(statement);
-                return DB_ERROR_UNKNOWN;
-            }
-            to_int64 = uint64;
-            ret = sqlite3_bind_int64(statement, bind++, to_int64);
-            if (ret != SQLITE_OK) {
-                __db_backend_sqlite_finalize(statement);
-                return DB_ERROR_UNKNOWN;
-            }
-            break;
+            case DB_TYPE_INT64:
+                if (db_value_to_int64(value, &int64)) {
+                    __db_backend_sqlite_finalize(backend_sqlite, statement);
+                    return DB_ERROR_UNKNOWN;
+                }
+                to_int64 = int64;
+                ret = sqlite3_bind_int64(statement, bind++, to_int64);
+                if (ret != SQLITE_OK) {
+                    __db_backend_sqlite_finalize(backend_sqlite, statement);
+                    return DB_ERROR_UNKNOWN;
+                }
+                break;
 
-        case DB_TYPE_TEXT:
-            ret = sqlite3_bind_text(statement, bind++, db_value_text(value), -1, SQLITE_TRANSIENT);
-            if (ret != SQLITE_OK) {
-                __db_backend_sqlite_finalize(statement);
-                return DB_ERROR_UNKNOWN;
-            }
-            break;
+            case DB_TYPE_UINT64:
+                if (db_value_to_uint64(value, &uint64)) {
+                    __db_backend_sqlite_finalize(backend_sqlite, statement);
+                    return DB_ERROR_UNKNOWN;
+                }
+                to_int64 = uint64;
+                ret = sqlite3_bind_int64(statement, bind++, to_int64);
+                if (ret != SQLITE_OK) {
+                    __db_backend_sqlite_finalize(backend_sqlite, statement);
+                    return DB_ERROR_UNKNOWN;
+                }
+                break;
 
-        case DB_TYPE_ENUM:
-            if (db_value_enum_value(value, &to_int)) {
-                __db_backend_sqlite_finalize(statement);
+            case DB_TYPE_TEXT:
+                ret = sqlite3_bind_text(statement, bind++, db_value_text(value), -1, SQLITE_TRANSIENT);
+                if (ret != SQLITE_OK) {
+                    __db_backend_sqlite_finalize(backend_sqlite, statement);
+                    return DB_ERROR_UNKNOWN;
+                }
+                break;
+
+            case DB_TYPE_ENUM:
+                if (db_value_enum_value(value, &to_int)) {
+                    __db_backend_sqlite_finalize(backend_sqlite, statement);
+                    return DB_ERROR_UNKNOWN;
+                }
+                ret = sqlite3_bind_int(statement, bind++, to_int);
+                if (ret != SQLITE_OK) {
+                    __db_backend_sqlite_finalize(backend_sqlite, statement);
+                    return DB_ERROR_UNKNOWN;
+                }
+                break;
+
+            default:
+                __db_backend_sqlite_finalize(backend_sqlite, statement);
                 return DB_ERROR_UNKNOWN;
             }
-            ret = sqlite3_bind_int(statement, bind++, to_int);
+        }
+
+        /*
+         * Bind the revision field value if we have one.
+         */
+        if (revision_field) {
+            ret = sqlite3_bind_int(statement, bind++, 1);
             if (ret != SQLITE_OK) {
-                __db_backend_sqlite_finalize(statement);
+                __db_backend_sqlite_finalize(backend_sqlite, statement);
                 return DB_ERROR_UNKNOWN;
             }
-            break;
-
-        default:
-            __db_backend_sqlite_finalize(statement);
-            return DB_ERROR_UNKNOWN;
-        }
-    }
-
-    /*
-     * Bind the revision field value if we have one.
-     */
-    if (revision_field) {
-        ret = sqlite3_bind_int(statement, bind++, 1);
-        if (ret != SQLITE_OK) {
-            __db_backend_sqlite_finalize(statement);
-            return DB_ERROR_UNKNOWN;
         }
     }
 
@@ -1126,34 +1309,30 @@ static int db_backend_sqlite_create(void* data, const db_object_t* object, const
      * Execute the SQL.
      */
     if (__db_backend_sqlite_step(backend_sqlite, statement) != SQLITE_DONE) {
-        __db_backend_sqlite_finalize(statement);
+        __db_backend_sqlite_finalize(backend_sqlite, statement);
         return DB_ERROR_UNKNOWN;
     }
-    __db_backend_sqlite_finalize(statement);
+    __db_backend_sqlite_finalize(backend_sqlite, statement);
 
     return DB_OK;
 }
 
-static db_result_list_t* db_backend_sqlite_read(void* data, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list) {
-    db_backend_sqlite_t* backend_sqlite = (db_backend_sqlite_t*)data;
+static int db_backend_sqlite_create(void* data, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* value_set) {
+    return db_backend_sqlite_create_many(data, object, object_field_list, &value_set, 1);
+}
+
+/**
+ * Prepare and bind the SELECT for reading an object or objects, returns the
+ * statement ready to be stepped or NULL on error.
+ */
+static db_backend_sqlite_statement_t* __db_backend_sqlite_select(db_backend_sqlite_t* backend_sqlite, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list) {
     const db_object_field_t* object_field;
     const db_join_t* join;
     char sql[4*1024];
     char* sqlp;
     int ret, left, first, fields, bind;
-    db_result_list_t* result_list;
     db_backend_sqlite_statement_t* statement;
 
-    if (!__sqlite3_initialized) {
-        return NULL;
-    }
-    if (!backend_sqlite) {
-        return NULL;
-    }
-    if (!object) {
-        return NULL;
-    }
-
     left = sizeof(sql);
     sqlp = sql;
     memset(sql, 0, left);
@@ -1240,23 +1419,143 @@ static db_result_list_t* db_backend_sqlite_read(void* data, const db_object_t* o
     if (clause_list) {
         bind = 1;
         if (__db_backend_sqlite_bind_clause(statement->statement, clause_list, &bind)) {
-            __db_backend_sqlite_finalize(statement->statement);
+            __db_backend_sqlite_finalize(statement->backend_sqlite, statement->statement);
             free(statement);
             return NULL;
         }
     }
 
+    return statement;
+}
+
+static db_result_list_t* db_backend_sqlite_read(void* data, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list) {
+    db_backend_sqlite_t* backend_sqlite = (db_backend_sqlite_t*)data;
+    db_result_list_t* result_list;
+    db_backend_sqlite_statement_t* statement;
+
+    if (!__sqlite3_initialized) {
+        return NULL;
+    }
+    if (!backend_sqlite) {
+        return NULL;
+    }
+    if (!object) {
+        return NULL;
+    }
+
+    if (!(statement = __db_backend_sqlite_select(backend_sqlite, object, join_list, clause_list))) {
+        return NULL;
+    }
+
     if (!(result_list = db_result_list_new())
         || db_result_list_set_next(result_list, db_backend_sqlite_next, statement, 0))
     {
         db_result_list_free(result_list);
-        __db_backend_sqlite_finalize(statement->statement);
+        __db_backend_sqlite_finalize(statement->backend_sqlite, statement->statement);
         free(statement);
         return NULL;
     }
     return result_list;
 }
 
+/**
+ * Copy the fields of the current row of a statement into a new row of columns.
+ */
+static int __db_backend_sqlite_columns_row(db_backend_sqlite_statement_t* statement, db_result_columns_t* columns) {
+    sqlite3_stmt* stmt = statement->statement;
+    const db_object_field_t* object_field;
+    const unsigned char* text;
+    int bind, ret;
+
+    if (db_result_columns_add_row(columns)) {
+        return DB_ERROR_UNKNOWN;
+    }
+    object_field = db_object_field_list_begin(db_object_object_field_list(statement->object));
+    bind = 0;
+    while (object_field) {
+        switch (db_object_field_type(object_field)) {
+        case DB_TYPE_PRIMARY_KEY:
+        case DB_TYPE_ENUM:
+        case DB_TYPE_INT32:
+        case DB_TYPE_UINT32:
+        case DB_TYPE_INT64:
+        case DB_TYPE_UINT64:
+            ret = db_result_columns_set_int(columns, bind, sqlite3_column_int64(stmt, bind));
+            break;
+
+        case DB_TYPE_TEXT:
+            if (!(text = sqlite3_column_text(stmt, bind))) {
+                return DB_ERROR_UNKNOWN;
+            }
+            ret = db_result_columns_set_text(columns, bind, (const char*)text, sqlite3_column_bytes(stmt, bind));
+            break;
+
+        case DB_TYPE_ANY:
+        case DB_TYPE_REVISION:
+            switch (sqlite3_column_type(stmt, bind)) {
+            case SQLITE_INTEGER:
+                ret = db_result_columns_set_int(columns, bind, sqlite3_column_int64(stmt, bind));
+                break;
+
+            case SQLITE_TEXT:
+                if (!(text = sqlite3_column_text(stmt, bind))) {
+                    return DB_ERROR_UNKNOWN;
+                }
+                ret = db_result_columns_set_text(columns, bind, (const char*)text, sqlite3_column_bytes(stmt, bind));
+                break;
+
+            default:
+                return DB_ERROR_UNKNOWN;
+            }
+            break;
+
+        default:
+            return DB_ERROR_UNKNOWN;
+        }
+        if (ret) {
+            return ret;
+        }
+        object_field = db_object_field_next(object_field);
+        bind++;
+    }
+    return DB_OK;
+}
+
+static db_result_columns_t* db_backend_sqlite_read_columns(void* data, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list) {
+    db_backend_sqlite_t* backend_sqlite = (db_backend_sqlite_t*)data;
+    db_backend_sqlite_statement_t* statement;
+    db_result_columns_t* columns;
+    int ret;
+
+    if (!__sqlite3_initialized) {
+        return NULL;
+    }
+    if (!backend_sqlite) {
+        return NULL;
+    }
+    if (!object) {
+        return NULL;
+    }
+
+    if (!(statement = __db_backend_sqlite_select(backend_sqlite, object, join_list, clause_list))) {
+        return NULL;
+    }
+    if ((columns = db_result_columns_new(statement->fields))) {
+        while ((ret = __db_backend_sqlite_step(backend_sqlite, statement->statement)) == SQLITE_ROW) {
+            if (__db_backend_sqlite_columns_row(statement, columns)) {
+                break;
+            }
+        }
+        if (ret != SQLITE_DONE) {
+            db_result_columns_free(columns);
+            columns = NULL;
+        }
+    }
+    __db_backend_sqlite_finalize(statement->backend_sqlite, statement->statement);
+    free(statement);
+    return columns;
+}
+
 static int db_backend_sqlite_update(void* data, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* value_set, const db_clause_list_t* clause_list) {
     db_backend_sqlite_t* backend_sqlite = (db_backend_sqlite_t*)data;
     const db_object_field_t* object_field;
@@ -1441,59 +1740,59 @@ static int db_backend_sqlite_update(void* data, const db_object_t* object, const
     bind = 1;
     for (value_pos = 0; value_pos < db_value_set_size(value_set); value_pos++) {
         if (!(value = db_value_set_at(value_set, value_pos))) {
-            __db_backend_sqlite_finalize(statement);
+            __db_backend_sqlite_finalize(backend_sqlite, statement);
             return DB_ERROR_UNKNOWN;
         }
 
         switch (db_value_type(value)) {
         case DB_TYPE_INT32:
             if (db_value_to_int32(value, &int32)) {
-                __db_backend_sqlite_finalize(statement);
+                __db_backend_sqlite_finalize(backend_sqlite, statement);
                 return DB_ERROR_UNKNOWN;
             }
             to_int = int32;
             ret = sqlite3_bind_int(statement, bind++, to_int);
             if (ret != SQLITE_OK) {
-                __db_backend_sqlite_finalize(statement);
+                __db_backend_sqlite_finalize(backend_sqlite, statement);
                 return DB_ERROR_UNKNOWN;
             }
             break;
 
         case DB_TYPE_UINT32:
             if (db_value_to_uint32(value, &uint32)) {
-                __db_backend_sqlite_finalize(statement);
+                __db_backend_sqlite_finalize(backend_sqlite, statement);
                 return DB_ERROR_UNKNOWN;
             }
             to_int = uint32;
             ret = sqlite3_bind_int(statement, bind++, to_int);
             if (ret != SQLITE_OK) {
-                __db_backend_sqlite_finalize(statement);
+                __db_backend_sqlite_finalize(backend_sqlite, statement);
                 return DB_ERROR_UNKNOWN;
             }
             break;
 
         case DB_TYPE_INT64:
             if (db_value_to_int64(value, &int64)) {
-                __db_backend_sqlite_finalize(statement);
+                __db_backend_sqlite_finalize(backend_sqlite, statement);
                 return DB_ERROR_UNKNOWN;
             }
             to_int64 = int64;
             ret = sqlite3_bind_int64(statement, bind++, to_int64);
             if (ret != SQLITE_OK) {
-                __db_backend_sqlite_finalize(statement);
+                __db_backend_sqlite_finalize(backend_sqlite, statement);
                 return DB_ERROR_UNKNOWN;
             }
             break;
 
         case DB_TYPE_UINT64:
             if (db_value_to_uint64(value, &uint64)) {
-                __db_backend_sqlite_finalize(statement);
+                __db_backend_sqlite_finalize(backend_sqlite, statement);
                 return DB_ERROR_UNKNOWN;
             }
             to_int64 = uint64;
             ret = sqlite3_bind_int64(statement, bind++, to_int64);
             if (ret != SQLITE_OK) {
-                __db_backend_sqlite_finalize(statement);
+                __db_backend_sqlite_finalize(backend_sqlite, statement);
                 return DB_ERROR_UNKNOWN;
             }
             break;
@@ -1501,25 +1800,25 @@ static int db_backend_sqlite_update(void* data, const db_object_t* object, const
         case DB_TYPE_TEXT:
             ret = sqlite3_bind_text(statement, bind++, db_value_text(value), -1, SQLITE_TRANSIENT);
             if (ret != SQLITE_OK) {
-                __db_backend_sqlite_finalize(statement);
+                __db_backend_sqlite_finalize(backend_sqlite, statement);
                 return DB_ERROR_UNKNOWN;
             }
             break;
 
         case DB_TYPE_ENUM:
             if (db_value_enum_value(value, &to_int)) {
-                __db_backend_sqlite_finalize(statement);
+                __db_backend_sqlite_finalize(backend_sqlite, statement);
                 return DB_ERROR_UNKNOWN;
             }
             ret = sqlite3_bind_int(statement, bind++, to_int);
             if (ret != SQLITE_OK) {
-                __db_backend_sqlite_finalize(statement);
+                __db_backend_sqlite_finalize(backend_sqlite, statement);
                 return DB_ERROR_UNKNOWN;
             }
             break;
 
         default:
-            __db_backend_sqlite_finalize(statement);
+            __db_backend_sqlite_finalize(backend_sqlite, statement);
             return DB_ERROR_UNKNOWN;
         }
     }
@@ -1530,7 +1829,7 @@ static int db_backend_sqlite_update(void* data, const db_object_t* object, const
     if (revision_field) {
         ret = sqlite3_bind_int64(statement, bind++, revision_number + 1);
         if (ret != SQLITE_OK) {
-            __db_backend_sqlite_finalize(statement);
+            __db_backend_sqlite_finalize(backend_sqlite, statement);
             return DB_ERROR_UNKNOWN;
         }
     }
@@ -1540,7 +1839,7 @@ static int db_backend_sqlite_update(void* data, const db_object_t* object, const
      */
     if (clause_list) {
         if (__db_backend_sqlite_bind_clause(statement, clause_list, &bind)) {
-            __db_backend_sqlite_finalize(statement);
+            __db_backend_sqlite_finalize(backend_sqlite, statement);
             return DB_ERROR_UNKNOWN;
         }
     }
@@ -1549,10 +1848,10 @@ static int db_backend_sqlite_update(void* data, const db_object_t* object, const
      * Execute the SQL.
      */
     if (__db_backend_sqlite_step(backend_sqlite, statement) != SQLITE_DONE) {
-        __db_backend_sqlite_finalize(statement);
+        __db_backend_sqlite_finalize(backend_sqlite, statement);
         return DB_ERROR_UNKNOWN;
     }
-    __db_backend_sqlite_finalize(statement);
+    __db_backend_sqlite_finalize(backend_sqlite, statement);
 
     /*
      * If we are using revision we have to have a positive number of changes
@@ -1651,16 +1950,16 @@ static int db_backend_sqlite_delete(void* data, const db_object_t* object, const
     if (clause_list) {
         bind = 1;
         if (__db_backend_sqlite_bind_clause(statement, clause_list, &bind)) {
-            __db_backend_sqlite_finalize(statement);
+            __db_backend_sqlite_finalize(backend_sqlite, statement);
             return DB_ERROR_UNKNOWN;
         }
     }
 
     if (__db_backend_sqlite_step(backend_sqlite, statement) != SQLITE_DONE) {
-        __db_backend_sqlite_finalize(statement);
+        __db_backend_sqlite_finalize(backend_sqlite, statement);
         return DB_ERROR_UNKNOWN;
     }
-    __db_backend_sqlite_finalize(statement);
+    __db_backend_sqlite_finalize(backend_sqlite, statement);
 
     /*
      * If we are using revision we have to have a positive number of changes
@@ -1751,26 +2050,26 @@ static int db_backend_sqlite_count(void* data, const db_object_t* object, const
     if (clause_list) {
         bind = 1;
         if (__db_backend_sqlite_bind_clause(statement, clause_list, &bind)) {
-            __db_backend_sqlite_finalize(statement);
+            __db_backend_sqlite_finalize(backend_sqlite, statement);
             return DB_ERROR_UNKNOWN;
         }
     }
 
     ret = __db_backend_sqlite_step(backend_sqlite, statement);
     if (ret != SQLITE_DONE && ret != SQLITE_ROW) {
-        __db_backend_sqlite_finalize(statement);
+        __db_backend_sqlite_finalize(backend_sqlite, statement);
         return DB_ERROR_UNKNOWN;
     }
 
     sqlite_count = sqlite3_column_int(statement, 0);
     ret = sqlite3_errcode(backend_sqlite->db);
     if ((ret != SQLITE_OK && ret != SQLITE_ROW && ret != SQLITE_DONE)) {
-        __db_backend_sqlite_finalize(statement);
+        __db_backend_sqlite_finalize(backend_sqlite, statement);
         return DB_ERROR_UNKNOWN;
     }
 
     *count = sqlite_count;
-    __db_backend_sqlite_finalize(statement);
+    __db_backend_sqlite_finalize(backend_sqlite, statement);
     return DB_OK;
 }
 
@@ -1805,10 +2104,10 @@ static int db_backend_sqlite_transaction_begin(void* data) {
     }
 
     if (__db_backend_sqlite_step(backend_sqlite, statement) != SQLITE_DONE) {
-        __db_backend_sqlite_finalize(statement);
+        __db_backend_sqlite_finalize(backend_sqlite, statement);
         return DB_ERROR_UNKNOWN;
     }
-    __db_backend_sqlite_finalize(statement);
+    __db_backend_sqlite_finalize(backend_sqlite, statement);
 
     backend_sqlite->transaction = 1;
     return DB_OK;
@@ -1834,10 +2133,10 @@ static int db_backend_sqlite_transaction_commit(void* data) {
     }
 
     if (__db_backend_sqlite_step(backend_sqlite, statement) != SQLITE_DONE) {
-        __db_backend_sqlite_finalize(statement);
+        __db_backend_sqlite_finalize(backend_sqlite, statement);
         return DB_ERROR_UNKNOWN;
     }
-    __db_backend_sqlite_finalize(statement);
+    __db_backend_sqlite_finalize(backend_sqlite, statement);
 
     backend_sqlite->transaction = 0;
     return DB_OK;
@@ -1863,10 +2162,10 @@ static int db_backend_sqlite_transaction_rollback(void* data) {
     }
 
     if (__db_backend_sqlite_step(backend_sqlite, statement) != SQLITE_DONE) {
-        __db_backend_sqlite_finalize(statement);
+        __db_backend_sqlite_finalize(backend_sqlite, statement);
         return DB_ERROR_UNKNOWN;
     }
-    __db_backend_sqlite_finalize(statement);
+    __db_backend_sqlite_finalize(backend_sqlite, statement);
 
     backend_sqlite->transaction = 0;
     return DB_OK;
@@ -1885,7 +2184,9 @@ db_backend_handle_t* db_backend_sqlite_new_handle(void) {
             || db_backend_handle_set_disconnect(backend_handle, db_backend_sqlite_disconnect)
             || db_backend_handle_set_last_id(backend_handle, db_backend_sqlite_last_id)
             || db_backend_handle_set_create(backend_handle, db_backend_sqlite_create)
+            || db_backend_handle_set_create_many(backend_handle, db_backend_sqlite_create_many)
             || db_backend_handle_set_read(backend_handle, db_backend_sqlite_read)
+            || db_backend_handle_set_read_columns(backend_handle, db_backend_sqlite_read_columns)
             || db_backend_handle_set_update(backend_handle, db_backend_sqlite_update)
             || db_backend_handle_set_delete(backend_handle, db_backend_sqlite_delete)
             || db_backend_handle_set_count(backend_handle, db_backend_sqlite_count)
@@ -1903,3 +2204,23 @@ db_backend_handle_t* db_backend_sqlite_new_handle(void) {
     free(backend_sqlite);
     return NULL;
 }
+
+void db_backend_sqlite_statement_cache_stats(unsigned long* hits, unsigned long* misses) {
+    pthread_mutex_lock(&__sqlite_cache_mutex);
+    if (hits) {
+        *hits = __sqlite_cache_hits;
+    }
+    if (misses) {
+        *misses = __sqlite_cache_misses;
+    }
+    pthread_mutex_unlock(&__sqlite_cache_mutex);
+}
+
+unsigned long db_backend_sqlite_rows_fetched(void) {
+    unsigned long rows;
+
+    pthread_mutex_lock(&__sqlite_cache_mutex);
+    rows = __sqlite_rows;
+    pthread_mutex_unlock(&__sqlite_cache_mutex);
+    return rows;
+}
@@ -34,6 +34,7 @@
 
 #define DB_BACKEND_SQLITE_DEFAULT_TIMEOUT 30
 #define DB_BACKEND_SQLITE_DEFAULT_USLEEP 200000
+#define DB_BACKEND_SQLITE_STATEMENT_CACHE 64
 
 /**
  * Create a new database backend handle for SQLite.
@@ -41,4 +42,18 @@
  */
 db_backend_handle_t* db_backend_sqlite_new_handle(void);
 
+/**
+ * Get the prepared statement cache hit and miss counters of all SQLite
+ * database backends.
+ * \param[out] hits the number of statements taken from the cache.
+ * \param[out] misses the number of statements that had to be prepared.
+ */
+void db_backend_sqlite_statement_cache_stats(unsigned long* hits, unsigned long* misses);
+
+/**
+ * Get the number of rows fetched by all SQLite database backends.
+ * \return the number of rows.
+ */
+unsigned long db_backend_sqlite_rows_fetched(void);
+
 #endif
@@ -32,6 +32,29 @@
 
 
 #include <stdlib.h>
+#include <pthread.h>
+
+static pthread_mutex_t writes_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long writes = 0;
+
+/*
+ * Account for a write request on connection, after it was made so the change
+ * is visible to others once it is counted. A transaction commit counts as a
+ * write as well, unless no write was requested since the last commit or
+ * rollback: read only transactions do not change the database. Requests are
+ * counted whether they succeed or not, the counters only tell if the
+ * database might have changed.
+ */
+static void db_connection_written(const db_connection_t* connection) {
+    if (connection->untracked) {
+        return;
+    }
+    /* Bookkeeping only, not part of what the connection promises. */
+    ((db_connection_t*)connection)->uncommitted = 1;
+    pthread_mutex_lock(&writes_lock);
+    writes++;
+    pthread_mutex_unlock(&writes_lock);
+}
 
 
 
@@ -42,6 +65,25 @@ db_connection_t* db_connection_new(void) {
     return connection;
 }
 
+db_connection_t* db_connection_new_copy(const db_connection_t* from_connection) {
+    db_connection_t* connection;
+
+    if (!from_connection) {
+        return NULL;
+    }
+
+    if (!(connection = db_connection_new())
+        || db_connection_set_configuration_list(connection, from_connection->configuration_list)
+        || db_connection_setup(connection)
+        || db_connection_connect(connection))
+    {
+        db_connection_free(connection);
+        return NULL;
+    }
+    connection->untracked = from_connection->untracked;
+    return connection;
+}
+
 void db_connection_free(db_connection_t* connection) {
     if (connection) {
         if (connection->backend) {
@@ -111,6 +153,8 @@ int db_connection_last_id(const db_connection_t* connection, int *last_id) {
 }
 
 int db_connection_create(const db_connection_t* connection, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* value_set) {
+    int ret;
+
     if (!connection) {
         return DB_ERROR_UNKNOWN;
     }
@@ -127,7 +171,33 @@ int db_connection_create(const db_connection_t* connection, const db_object_t* o
         return DB_ERROR_UNKNOWN;
     }
 
-    return db_backend_create(connection->backend, object, object_field_list, value_set);
+    ret = db_backend_create(connection->backend, object, object_field_list, value_set);
+    db_connection_written(connection);
+    return ret;
+}
+
+int db_connection_create_many(const db_connection_t* connection, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* const* value_sets, size_t count) {
+    int ret;
+
+    if (!connection) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!object) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!object_field_list) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!value_sets) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!connection->backend) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    ret = db_backend_create_many(connection->backend, object, object_field_list, value_sets, count);
+    db_connection_written(connection);
+    return ret;
 }
 
 db_result_list_t* db_connection_read(const db_connection_t* connection, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list) {
@@ -144,7 +214,23 @@ db_result_list_t* db_connection_read(const db_connection_t* connection, const db
     return db_backend_read(connection->backend, object, join_list, clause_list);
 }
 
+db_result_columns_t* db_connection_read_columns(const db_connection_t* connection, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list) {
+    if (!connection) {
+        return NULL;
+    }
+    if (!object) {
+        return NULL;
+    }
+    if (!connection->backend) {
+        return NULL;
+    }
+
+    return db_backend_read_columns(connection->backend, object, join_list, clause_list);
+}
+
 int db_connection_update(const db_connection_t* connection, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* value_set, const db_clause_list_t* clause_list) {
+    int ret;
+
     if (!connection) {
         return DB_ERROR_UNKNOWN;
     }
@@ -161,10 +247,14 @@ int db_connection_update(const db_connection_t* connection, const db_object_t* o
         return DB_ERROR_UNKNOWN;
     }
 
-    return db_backend_update(connection->backend, object, object_field_list, value_set, clause_list);
+    ret = db_backend_update(connection->backend, object, object_field_list, value_set, clause_list);
+    db_connection_written(connection);
+    return ret;
 }
 
 int db_connection_delete(const db_connection_t* connection, const db_object_t* object, const db_clause_list_t* clause_list) {
+    int ret;
+
     if (!connection) {
         return DB_ERROR_UNKNOWN;
     }
@@ -175,7 +265,9 @@ int db_connection_delete(const db_connection_t* connection, const db_object_t* o
         return DB_ERROR_UNKNOWN;
     }
 
-    return db_backend_delete(connection->backend, object, clause_list);
+    ret = db_backend_delete(connection->backend, object, clause_list);
+    db_connection_written(connection);
+    return ret;
 }
 
 int db_connection_count(const db_connection_t* connection, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list, size_t* count) {
@@ -194,3 +286,62 @@ int db_connection_count(const db_connection_t* connection, const db_object_t* ob
 
     return db_backend_count(connection->backend, object, join_list, clause_list, count);
 }
+
+int db_connection_transaction_begin(const db_connection_t* connection) {
+    if (!connection) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!connection->backend) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    return db_backend_transaction_begin(connection->backend);
+}
+
+int db_connection_transaction_commit(const db_connection_t* connection) {
+    int ret;
+
+    if (!connection) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!connection->backend) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    ret = db_backend_transaction_commit(connection->backend);
+    if (connection->uncommitted) {
+        db_connection_written(connection);
+        ((db_connection_t*)connection)->uncommitted = 0;
+    }
+    return ret;
+}
+
+int db_connection_transaction_rollback(const db_connection_t* connection) {
+    if (!connection) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!connection->backend) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    ((db_connection_t*)connection)->uncommitted = 0;
+    return db_backend_transaction_rollback(connection->backend);
+}
+
+unsigned long db_connection_writes(void) {
+    unsigned long n;
+
+    pthread_mutex_lock(&writes_lock);
+    n = writes;
+    pthread_mutex_unlock(&writes_lock);
+    return n;
+}
+
+void db_connection_track_writes(const db_connection_t* connection, int track) {
+    if (!connection) {
+        return;
+    }
+
+    /* Bookkeeping only, not part of what the connection promises. */
+    ((db_connection_t*)connection)->untracked = !track;
+}
@@ -46,6 +46,8 @@ typedef struct db_connection db_connection_t;
 struct db_connection {
     const db_configuration_list_t* configuration_list;
     db_backend_t* backend;
+    int untracked;
+    int uncommitted;
 };
 
 /**
@@ -54,6 +56,14 @@ struct db_connection {
  */
 db_connection_t* db_connection_new(void);
 
+/**
+ * Create a new database connection to the same database as another one, set
+ * up and connected. The configuration list is shared with `from_connection`.
+ * \param[in] from_connection a db_connection_t pointer.
+ * \return a db_connection_t pointer or NULL on error.
+ */
+db_connection_t* db_connection_new_copy(const db_connection_t* from_connection);
+
 /**
  * Delete a database connection and the database backend within.
  * \param[in] connection a db_connection_t pointer.
@@ -97,6 +107,19 @@ int db_connection_last_id(const db_connection_t* connection, int *last_id);
  */
 int db_connection_create(const db_connection_t* connection, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* value_set);
 
+/**
+ * Create `count` objects in the database with one request, one for each value
+ * set in `value_sets`. The id of the created objects is not available
+ * afterwards.
+ * \param[in] connection a db_connection_t pointer.
+ * \param[in] object a db_object_t pointer.
+ * \param[in] object_field_list a db_object_field_list_t pointer.
+ * \param[in] value_sets an array of `count` db_value_set_t pointers.
+ * \param[in] count a size_t.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_connection_create_many(const db_connection_t* connection, const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* const* value_sets, size_t count);
+
 /**
  * Read an object or objects from the database.
  * \param[in] connection a db_connection_t pointer.
@@ -108,6 +131,17 @@ int db_connection_create(const db_connection_t* connection, const db_object_t* o
  */
 db_result_list_t* db_connection_read(const db_connection_t* connection, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list);
 
+/**
+ * Read an object or objects from the database into a column oriented result
+ * set.
+ * \param[in] connection a db_connection_t pointer.
+ * \param[in] object a db_object_t pointer.
+ * \param[in] join_list a db_join_list_t pointer.
+ * \param[in] clause_list a db_clause_list_t pointer.
+ * \return a db_result_columns_t pointer or NULL on error.
+ */
+db_result_columns_t* db_connection_read_columns(const db_connection_t* connection, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list);
+
 /**
  * Update an object or objects in the database.
  * \param[in] connection a db_connection_t pointer.
@@ -139,4 +173,42 @@ int db_connection_delete(const db_connection_t* connection, const db_object_t* o
  */
 int db_connection_count(const db_connection_t* connection, const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list, size_t* count);
 
+/**
+ * Begin a transaction on the database connection. Everything done on the
+ * connection until the transaction is committed or rolled back is part of it.
+ * \param[in] connection a db_connection_t pointer.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_connection_transaction_begin(const db_connection_t* connection);
+
+/**
+ * Commit the transaction on the database connection.
+ * \param[in] connection a db_connection_t pointer.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_connection_transaction_commit(const db_connection_t* connection);
+
+/**
+ * Roll back the transaction on the database connection.
+ * \param[in] connection a db_connection_t pointer.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_connection_transaction_rollback(const db_connection_t* connection);
+
+/**
+ * Get the number of create, update, delete and commit requests made through
+ * the database connections of this process so far.
+ * \return the number of write requests.
+ */
+unsigned long db_connection_writes(void);
+
+/**
+ * Leave the write requests made through a database connection out of
+ * db_connection_writes(), or count them again. For callers that keep track
+ * of their own changes.
+ * \param[in] connection a db_connection_t pointer.
+ * \param[in] track zero to stop counting, non-zero to count again.
+ */
+void db_connection_track_writes(const db_connection_t* connection, int track);
+
 #endif
@@ -426,6 +426,28 @@ int db_object_create(db_object_t* object, const db_object_field_list_t* object_f
     return r;
 }
 
+int db_object_create_many(db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* const* value_sets, size_t count) {
+    if (!object) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!value_sets) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!object->connection) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!object->table) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!object->primary_key_name) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!object_field_list) {
+        object_field_list = object->object_field_list;
+    }
+    return db_connection_create_many(object->connection, object, object_field_list, value_sets, count);
+}
+
 db_result_list_t* db_object_read(const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list) {
     if (!object) {
         return NULL;
@@ -443,6 +465,23 @@ db_result_list_t* db_object_read(const db_object_t* object, const db_join_list_t
     return db_connection_read(object->connection, object, join_list, clause_list);
 }
 
+db_result_columns_t* db_object_read_columns(const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list) {
+    if (!object) {
+        return NULL;
+    }
+    if (!object->connection) {
+        return NULL;
+    }
+    if (!object->table) {
+        return NULL;
+    }
+    if (!object->primary_key_name) {
+        return NULL;
+    }
+
+    return db_connection_read_columns(object->connection, object, join_list, clause_list);
+}
+
 int db_object_update(const db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* value_set, const db_clause_list_t* clause_list) {
     if (!object) {
         return DB_ERROR_UNKNOWN;
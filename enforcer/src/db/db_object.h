@@ -287,6 +287,18 @@ int db_object_set_object_field_list(db_object_t* object, db_object_field_list_t*
  */
 int db_object_create(db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* value_set);
 
+/**
+ * Create `count` objects in the database with one statement, one for each
+ * value set in `value_sets`. Unlike db_object_create() the id of the created
+ * objects is not available afterwards.
+ * \param[in] object a db_object_t pointer.
+ * \param[in] object_field_list a db_object_field_list_t pointer.
+ * \param[in] value_sets an array of `count` db_value_set_t pointers.
+ * \param[in] count a size_t.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_object_create_many(db_object_t* object, const db_object_field_list_t* object_field_list, const db_value_set_t* const* value_sets, size_t count);
+
 /**
  * Read an object or objects from the database.
  * \param[in] object a db_object_t pointer.
@@ -297,6 +309,16 @@ int db_object_create(db_object_t* object, const db_object_field_list_t* object_f
  */
 db_result_list_t* db_object_read(const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list);
 
+/**
+ * Read an object or objects from the database into a column oriented result
+ * set, with a column for each field of the object in order.
+ * \param[in] object a db_object_t pointer.
+ * \param[in] join_list a db_join_list_t pointer.
+ * \param[in] clause_list a db_clause_list_t pointer.
+ * \return a db_result_columns_t pointer or NULL on error.
+ */
+db_result_columns_t* db_object_read_columns(const db_object_t* object, const db_join_list_t* join_list, const db_clause_list_t* clause_list);
+
 /**
  * Update an object or objects in the database.
  * \param[in] object a db_object_t pointer.
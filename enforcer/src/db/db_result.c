@@ -30,6 +30,8 @@
 #include "db_result.h"
 #include "db_error.h"
 
+#include <string.h>
+
 
 /* DB RESULT */
 
@@ -369,3 +371,278 @@ int db_result_list_fetch_all(db_result_list_t* result_list) {
 
     return DB_OK;
 }
+
+/* DB RESULT COLUMNS */
+
+/* Size of the arena blocks, text longer than this gets a block of its own. */
+#define DB_RESULT_ARENA_SIZE (16*1024)
+
+static char* db_result_arena_copy(db_result_columns_t* columns, const char* text, size_t length) {
+    struct db_result_arena* arena = columns->arena;
+    char* copy;
+
+    if (!arena || arena->size - arena->used < length + 1) {
+        size_t size = DB_RESULT_ARENA_SIZE;
+        if (size < length + 1) {
+            size = length + 1;
+        }
+        if (!(arena = malloc(sizeof(struct db_result_arena) + size))) {
+            return NULL;
+        }
+        arena->size = size;
+        arena->used = 0;
+        if (columns->arena && size == length + 1) {
+            /*
+             * Keep filling the current block, this one is full already.
+             */
+            arena->next = columns->arena->next;
+            columns->arena->next = arena;
+        }
+        else {
+            arena->next = columns->arena;
+            columns->arena = arena;
+        }
+    }
+
+    copy = arena->data + arena->used;
+    memcpy(copy, text, length);
+    copy[length] = 0;
+    arena->used += length + 1;
+    return copy;
+}
+
+db_result_columns_t* db_result_columns_new(size_t fields) {
+    db_result_columns_t* columns;
+
+    if (!fields) {
+        return NULL;
+    }
+
+    if (!(columns = (db_result_columns_t*)calloc(1, sizeof(db_result_columns_t)))) {
+        return NULL;
+    }
+    if (!(columns->column = (struct db_result_column*)calloc(fields, sizeof(struct db_result_column)))) {
+        free(columns);
+        return NULL;
+    }
+    columns->fields = fields;
+    return columns;
+}
+
+void db_result_columns_free(db_result_columns_t* columns) {
+    struct db_result_arena* arena;
+    size_t field;
+
+    if (columns) {
+        if (columns->column) {
+            for (field = 0; field < columns->fields; field++) {
+                free(columns->column[field].int64);
+                free((void*)columns->column[field].text);
+            }
+            free(columns->column);
+        }
+        while ((arena = columns->arena)) {
+            columns->arena = arena->next;
+            free(arena);
+        }
+        free(columns);
+    }
+}
+
+int db_result_columns_reserve(db_result_columns_t* columns, size_t rows) {
+    struct db_result_column* column;
+    db_type_int64_t* int64;
+    const char** text;
+    size_t field;
+
+    if (!columns) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (rows <= columns->capacity) {
+        return DB_OK;
+    }
+
+    for (field = 0; field < columns->fields; field++) {
+        column = &(columns->column[field]);
+        if (!(int64 = (db_type_int64_t*)realloc(column->int64, rows * sizeof(db_type_int64_t)))) {
+            return DB_ERROR_UNKNOWN;
+        }
+        column->int64 = int64;
+        if (column->text) {
+            if (!(text = (const char**)realloc((void*)column->text, rows * sizeof(const char*)))) {
+                return DB_ERROR_UNKNOWN;
+            }
+            column->text = text;
+        }
+    }
+    columns->capacity = rows;
+    return DB_OK;
+}
+
+int db_result_columns_add_row(db_result_columns_t* columns) {
+    size_t field, row;
+
+    if (!columns) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (columns->rows == columns->capacity
+        && db_result_columns_reserve(columns, columns->capacity ? columns->capacity * 2 : 64))
+    {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    row = columns->rows++;
+    for (field = 0; field < columns->fields; field++) {
+        columns->column[field].int64[row] = 0;
+        if (columns->column[field].text) {
+            columns->column[field].text[row] = NULL;
+        }
+    }
+    return DB_OK;
+}
+
+int db_result_columns_set_int(db_result_columns_t* columns, size_t field, db_type_int64_t value) {
+    if (!columns) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!columns->rows) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (field >= columns->fields) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    columns->column[field].int64[columns->rows - 1] = value;
+    return DB_OK;
+}
+
+int db_result_columns_set_text(db_result_columns_t* columns, size_t field, const char* text, size_t length) {
+    struct db_result_column* column;
+    const char* copy;
+
+    if (!columns) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!text) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!columns->rows) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (field >= columns->fields) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    column = &(columns->column[field]);
+    if (!column->text
+        && !(column->text = (const char**)calloc(columns->capacity, sizeof(const char*))))
+    {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!(copy = db_result_arena_copy(columns, text, length))) {
+        return DB_ERROR_UNKNOWN;
+    }
+    column->text[columns->rows - 1] = copy;
+    column->int64[columns->rows - 1] = -1;
+    return DB_OK;
+}
+
+int db_result_columns_add_result(db_result_columns_t* columns, const db_result_t* result) {
+    const db_value_set_t* value_set;
+    const db_value_t* value;
+    size_t field;
+    int ret;
+
+    if (!columns) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!(value_set = db_result_value_set(result))) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (db_value_set_size(value_set) != columns->fields) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (db_result_columns_add_row(columns)) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    for (field = 0; field < columns->fields; field++) {
+        value = db_value_set_at(value_set, field);
+        switch (db_value_type(value)) {
+        case DB_TYPE_INT32:
+            ret = db_result_columns_set_int(columns, field, value->int32);
+            break;
+
+        case DB_TYPE_UINT32:
+            ret = db_result_columns_set_int(columns, field, value->uint32);
+            break;
+
+        case DB_TYPE_INT64:
+            ret = db_result_columns_set_int(columns, field, value->int64);
+            break;
+
+        case DB_TYPE_UINT64:
+            ret = db_result_columns_set_int(columns, field, (db_type_int64_t)value->uint64);
+            break;
+
+        case DB_TYPE_ENUM:
+            ret = db_result_columns_set_int(columns, field, value->enum_value);
+            break;
+
+        case DB_TYPE_TEXT:
+            ret = db_result_columns_set_text(columns, field, value->text, strlen(value->text));
+            break;
+
+        case DB_TYPE_EMPTY:
+            ret = DB_OK;
+            break;
+
+        default:
+            ret = DB_ERROR_UNKNOWN;
+            break;
+        }
+        if (ret) {
+            return ret;
+        }
+    }
+    return DB_OK;
+}
+
+size_t db_result_columns_rows(const db_result_columns_t* columns) {
+    if (!columns) {
+        return 0;
+    }
+
+    return columns->rows;
+}
+
+db_type_int64_t db_result_columns_int(const db_result_columns_t* columns, size_t row, size_t field) {
+    if (!columns) {
+        return 0;
+    }
+    if (row >= columns->rows) {
+        return 0;
+    }
+    if (field >= columns->fields) {
+        return 0;
+    }
+
+    return columns->column[field].int64[row];
+}
+
+const char* db_result_columns_text(const db_result_columns_t* columns, size_t row, size_t field) {
+    if (!columns) {
+        return NULL;
+    }
+    if (row >= columns->rows) {
+        return NULL;
+    }
+    if (field >= columns->fields) {
+        return NULL;
+    }
+    if (!columns->column[field].text) {
+        return NULL;
+    }
+
+    return columns->column[field].text[row];
+}
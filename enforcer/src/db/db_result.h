@@ -32,8 +32,10 @@
 
 struct db_result;
 struct db_result_list;
+struct db_result_columns;
 typedef struct db_result db_result_t;
 typedef struct db_result_list db_result_list_t;
+typedef struct db_result_columns db_result_columns_t;
 
 /**
  * Function pointer for walking a db_result_list. The backend handle specific
@@ -206,4 +208,122 @@ size_t db_result_list_size(const db_result_list_t* result_list);
  */
 int db_result_list_fetch_all(db_result_list_t* result_list);
 
+/**
+ * A column of a database result set. Integers, including enumerations and
+ * primary keys, are kept in `int64`. Text is kept in `text`, which is only
+ * allocated once the column has text and is NULL for rows without text.
+ */
+struct db_result_column {
+    db_type_int64_t* int64;
+    const char** text;
+};
+
+/**
+ * A block of memory holding the text of a db_result_columns_t.
+ */
+struct db_result_arena {
+    struct db_result_arena* next;
+    size_t size;
+    size_t used;
+    char data[];
+};
+
+/**
+ * A column oriented set of database results, filled by the backend one row at
+ * a time. All text is copied into arena blocks owned by the set so reading a
+ * result set takes a handful of allocations instead of several for each value.
+ * The set and everything returned from it is freed at once with
+ * db_result_columns_free().
+ */
+struct db_result_columns {
+    size_t fields;
+    size_t rows;
+    size_t capacity;
+    struct db_result_column* column;
+    struct db_result_arena* arena;
+};
+
+/**
+ * Create a new database result set with a number of fields per row.
+ * \param[in] fields a size_t.
+ * \return a db_result_columns_t pointer or NULL on error.
+ */
+db_result_columns_t* db_result_columns_new(size_t fields);
+
+/**
+ * Delete a database result set including all text within the set.
+ * \param[in] columns a db_result_columns_t pointer.
+ */
+void db_result_columns_free(db_result_columns_t* columns);
+
+/**
+ * Make room for at least `rows` rows in a database result set.
+ * \param[in] columns a db_result_columns_t pointer.
+ * \param[in] rows a size_t.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_result_columns_reserve(db_result_columns_t* columns, size_t rows);
+
+/**
+ * Add an empty row to a database result set, it becomes the row that the set
+ * functions write to.
+ * \param[in] columns a db_result_columns_t pointer.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_result_columns_add_row(db_result_columns_t* columns);
+
+/**
+ * Set an integer field of the last row of a database result set.
+ * \param[in] columns a db_result_columns_t pointer.
+ * \param[in] field a size_t.
+ * \param[in] value a db_type_int64_t.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_result_columns_set_int(db_result_columns_t* columns, size_t field, db_type_int64_t value);
+
+/**
+ * Set a text field of the last row of a database result set, the text is
+ * copied into the set.
+ * \param[in] columns a db_result_columns_t pointer.
+ * \param[in] field a size_t.
+ * \param[in] text a character pointer.
+ * \param[in] length a size_t with the length of text, without terminator.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_result_columns_set_text(db_result_columns_t* columns, size_t field, const char* text, size_t length);
+
+/**
+ * Add the values of a database result as a row to a database result set.
+ * \param[in] columns a db_result_columns_t pointer.
+ * \param[in] result a db_result_t pointer.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int db_result_columns_add_result(db_result_columns_t* columns, const db_result_t* result);
+
+/**
+ * Return the number of rows in a database result set.
+ * \param[in] columns a db_result_columns_t pointer.
+ * \return a size_t.
+ */
+size_t db_result_columns_rows(const db_result_columns_t* columns);
+
+/**
+ * Get an integer field of a row in a database result set.
+ * \param[in] columns a db_result_columns_t pointer.
+ * \param[in] row a size_t.
+ * \param[in] field a size_t.
+ * \return the value, 0 on error or -1 if the field holds text.
+ */
+db_type_int64_t db_result_columns_int(const db_result_columns_t* columns, size_t row, size_t field);
+
+/**
+ * Get a text field of a row in a database result set, valid until the set is
+ * freed.
+ * \param[in] columns a db_result_columns_t pointer.
+ * \param[in] row a size_t.
+ * \param[in] field a size_t.
+ * \return a character pointer or NULL on error or if the field has no text.
+ */
+const char* db_result_columns_text(const db_result_columns_t* columns, size_t row, size_t field);
+
 #endif
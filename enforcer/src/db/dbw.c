@@ -1,5 +1,7 @@
 #include <string.h>
+#include <limits.h>
 #include <pthread.h>
+#include <fnmatch.h>
 
 #include "config.h"
 
@@ -11,6 +13,71 @@
 #include "db/dbw.h"
 
 static pthread_rwlock_t db_lock = PTHREAD_RWLOCK_INITIALIZER;
+static int snapshot_reads = 0;
+static int parallel_reads = 0;
+
+/* State cache, see dbw_cache_enable() */
+static pthread_rwlock_t cache_lock = PTHREAD_RWLOCK_INITIALIZER;
+static int cache_enabled = 0;
+static struct dbw_db *cache = NULL;
+static unsigned long cache_writes = 0; /* db_connection_writes() when loaded */
+static time_t cache_verified = 0;
+
+/* Commits of different zones may run in parallel, see
+ * dbw_concurrent_commits(). A commit confined to a zone holds one of
+ * zone_locks and db_lock for reading, others hold db_lock for writing. */
+#define DBW_ZONE_LOCKS 64
+static int concurrent_commits = 0;
+static pthread_once_t zone_locks_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t zone_locks[DBW_ZONE_LOCKS];
+
+static void
+zone_locks_init(void)
+{
+    for (int i = 0; i < DBW_ZONE_LOCKS; i++)
+        (void)pthread_mutex_init(&zone_locks[i], NULL);
+}
+
+void
+dbw_concurrent_commits(int enable)
+{
+    concurrent_commits = enable;
+}
+
+static struct dbw_db *cache_fetch(db_connection_t *conn,
+    char const **zonenames, size_t n, int mask);
+
+void
+dbw_snapshot_reads(int enable)
+{
+    snapshot_reads = enable;
+}
+
+void
+dbw_parallel_reads(int threads)
+{
+    parallel_reads = threads;
+}
+
+/* Start reading several tables. The rows read must be consistent with each
+ * other: either all readers share db_lock and wait for writers, or each
+ * reader reads in its own transaction and sees a snapshot of the database. */
+static int
+dbw_read_begin(const db_connection_t *conn)
+{
+    if (snapshot_reads)
+        return db_connection_transaction_begin(conn);
+    return pthread_rwlock_rdlock(&db_lock);
+}
+
+static void
+dbw_read_end(const db_connection_t *conn)
+{
+    if (snapshot_reads)
+        (void)db_connection_transaction_commit(conn);
+    else
+        (void)pthread_rwlock_unlock(&db_lock);
+}
 
 const char *
 dbw_enum2txt(const char *c[], int n)
@@ -28,6 +95,174 @@ dbw_txt2enum(const char *c[], const char *txt)
     return -1;
 }
 
+/**
+ * Hash index over the rows of a dbw_list, either on a name or on the
+ * primary id. Open addressing with linear probing so rows with an equal key
+ * are found in the order they were added, just like a scan of the list.
+ *
+ * Rows created by the dbw_new_* functions have no name or id yet when they
+ * are added. Those are parked in 'unkeyed' and moved to the table on the
+ * next lookup once the caller has filled them in (or they are committed).
+ */
+struct dbw_index {
+    char const *(*name)(struct dbrow *); /* NULL: index on id */
+    size_t size; /* always a power of 2 */
+    size_t used;
+    struct dbrow **slot;
+    size_t unkeyed_n;
+    struct dbrow **unkeyed;
+};
+
+static char const *index_zone_name(struct dbrow *r) { return ((struct dbw_zone *)r)->name; }
+static char const *index_policy_name(struct dbrow *r) { return ((struct dbw_policy *)r)->name; }
+static char const *index_hsmkey_locator(struct dbrow *r) { return ((struct dbw_hsmkey *)r)->locator; }
+
+static size_t
+index_hash_name(char const *name)
+{
+    /* FNV-1a */
+    size_t h = 2166136261u;
+    for (; *name; name++) {
+        h ^= (unsigned char)*name;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static size_t
+index_hash_id(int id)
+{
+    return (size_t)id * 2654435761u;
+}
+
+/* return 1 if row has a usable key, hash in *h */
+static int
+index_key(struct dbw_index *index, struct dbrow *row, size_t *h)
+{
+    if (index->name) {
+        char const *name = index->name(row);
+        if (!name) return 0;
+        *h = index_hash_name(name);
+    } else {
+        if (row->id <= 0) return 0;
+        *h = index_hash_id(row->id);
+    }
+    return 1;
+}
+
+static int
+index_grow(struct dbw_index *index)
+{
+    size_t size = index->size ? index->size * 2 : 64;
+    struct dbrow **slot = calloc(size, sizeof (struct dbrow *));
+    if (!slot) return 1;
+    for (size_t i = 0; i < index->size; i++) {
+        struct dbrow *row = index->slot[i];
+        size_t h;
+        if (!row) continue;
+        (void)index_key(index, row, &h);
+        while (slot[h & (size-1)]) h++;
+        slot[h & (size-1)] = row;
+    }
+    free(index->slot);
+    index->slot = slot;
+    index->size = size;
+    return 0;
+}
+
+static int
+index_add(struct dbw_index *index, struct dbrow *row)
+{
+    size_t h;
+    if (!index_key(index, row, &h)) {
+        struct dbrow **new = realloc(index->unkeyed,
+            (index->unkeyed_n + 1) * sizeof (struct dbrow *));
+        if (!new) return 1;
+        new[index->unkeyed_n++] = row;
+        index->unkeyed = new;
+        return 0;
+    }
+    /* keep load factor under 1/2 */
+    if (2 * (index->used + 1) > index->size && index_grow(index)) return 1;
+    while (index->slot[h & (index->size-1)]) h++;
+    index->slot[h & (index->size-1)] = row;
+    index->used++;
+    return 0;
+}
+
+/* Move rows that since got a name or id to the table */
+static void
+index_drain(struct dbw_index *index)
+{
+    size_t n = index->unkeyed_n;
+    struct dbrow **unkeyed = index->unkeyed;
+    size_t h;
+    size_t i;
+    if (!n) return;
+    for (i = 0; i < n; i++) {
+        if (index_key(index, unkeyed[i], &h)) break;
+    }
+    if (i == n) return; /* none of them got a key yet */
+    index->unkeyed = NULL;
+    index->unkeyed_n = 0;
+    for (size_t i = 0; i < n; i++) {
+        (void)index_add(index, unkeyed[i]);
+    }
+    free(unkeyed);
+}
+
+static void
+index_free(struct dbw_index *index)
+{
+    if (!index) return;
+    free(index->slot);
+    free(index->unkeyed);
+    free(index);
+}
+
+static struct dbw_index *
+index_new(struct dbw_list *list, char const *(*name)(struct dbrow *))
+{
+    struct dbw_index *index = calloc(1, sizeof (struct dbw_index));
+    if (!index) return NULL;
+    index->name = name;
+    for (size_t i = 0; i < list->n; i++) {
+        if (index_add(index, list->set[i])) {
+            index_free(index);
+            return NULL;
+        }
+    }
+    return index;
+}
+
+static struct dbrow *
+index_find_name(struct dbw_index *index, char const *name)
+{
+    index_drain(index);
+    if (!index->size) return NULL;
+    size_t h = index_hash_name(name);
+    struct dbrow *row;
+    while ((row = index->slot[h & (index->size-1)])) {
+        if (!strcmp(index->name(row), name)) return row;
+        h++;
+    }
+    return NULL;
+}
+
+static struct dbrow *
+index_find_id(struct dbw_index *index, int id)
+{
+    index_drain(index);
+    if (!index->size) return NULL;
+    size_t h = index_hash_id(id);
+    struct dbrow *row;
+    while ((row = index->slot[h & (index->size-1)])) {
+        if (row->id == id) return row;
+        h++;
+    }
+    return NULL;
+}
+
 static void
 dbw_list_free(struct dbw_list *dbw_list)
 {
@@ -35,10 +270,22 @@ dbw_list_free(struct dbw_list *dbw_list)
     for (size_t i = 0; i < dbw_list->n; i++) {
         dbw_list->free(dbw_list->set[i]);
     }
+    index_free(dbw_list->index);
     free(dbw_list->set);
     free(dbw_list);
 }
 
+void
+dbw_list_reindex(struct dbw_list *list)
+{
+    struct dbw_index *index;
+    if (!list->index) return;
+    index = index_new(list, list->index->name);
+    /* On allocation failure lookups fall back to scanning the list */
+    index_free(list->index);
+    list->index = index;
+}
+
 static void
 dbw_policy_free(struct dbrow *row)
 {
@@ -123,113 +370,193 @@ dbw_hsmkey_free(struct dbrow *row)
     free(hsmkey);
 }
 
-static int
-dbxvalue2int(struct db_value const *val)
+/* The copy functions below return a clean copy of a row without any links
+ * to other rows. Foreign keys are taken from the linked parents if there
+ * are any, rows inserted by dbw_commit() only have those up to date. */
+
+static struct dbrow *
+dbw_policy_copy(struct dbrow *row)
 {
-    switch (val->type) {
-        case DB_TYPE_INT32:  return (int)val->int32;
-        case DB_TYPE_UINT32: return (int)val->uint32;
-        case DB_TYPE_INT64:  return (int)val->int64;
-        case DB_TYPE_UINT64: return (int)val->uint64;
-        default: return -1;
+    struct dbw_policy *policy = (struct dbw_policy *)row;
+    struct dbw_policy *copy = malloc(sizeof (struct dbw_policy));
+    if (!copy) return NULL;
+    *copy = *policy;
+    copy->dirty = DBW_CLEAN;
+    copy->scratch = 0;
+    copy->policykey_count = 0;
+    copy->policykey = NULL;
+    copy->hsmkey_count = 0;
+    copy->hsmkey = NULL;
+    copy->zone_count = 0;
+    copy->zone = NULL;
+    copy->name = strdup(policy->name);
+    copy->description = strdup(policy->description);
+    copy->denial_salt = strdup(policy->denial_salt);
+    if (!copy->name || !copy->description || !copy->denial_salt) {
+        dbw_policy_free((struct dbrow *)copy);
+        return NULL;
     }
+    return (struct dbrow *)copy;
 }
 
-static int dbw_policy_revision(const db_connection_t *dbconn, struct db_value *id)
+static struct dbrow *
+dbw_policykey_copy(struct dbrow *row)
 {
-    policy_t *dbx_obj = policy_new(dbconn);
-    int rev = -1;
-    if (dbx_obj && !policy_get_by_id(dbx_obj, id))
-        rev = dbxvalue2int(&dbx_obj->rev);
-    policy_free(dbx_obj);
-    return rev;
+    struct dbw_policykey *policykey = (struct dbw_policykey *)row;
+    struct dbw_policykey *copy = malloc(sizeof (struct dbw_policykey));
+    if (!copy) return NULL;
+    *copy = *policykey;
+    copy->dirty = DBW_CLEAN;
+    copy->scratch = 0;
+    if (policykey->policy) copy->policy_id = policykey->policy->id;
+    copy->policy = NULL;
+    copy->repository = strdup(policykey->repository);
+    if (!copy->repository) {
+        free(copy);
+        return NULL;
+    }
+    return (struct dbrow *)copy;
 }
 
-static int dbw_policykey_revision(const db_connection_t *dbconn, struct db_value *id)
+static struct dbrow *
+dbw_zone_copy(struct dbrow *row)
 {
-    policy_key_t *dbx_obj = policy_key_new(dbconn);
-    int rev = -1;
-    if (dbx_obj && !policy_key_get_by_id(dbx_obj, id))
-        rev = dbxvalue2int(&dbx_obj->rev);
-    policy_key_free(dbx_obj);
-    return rev;
+    struct dbw_zone *zone = (struct dbw_zone *)row;
+    struct dbw_zone *copy = malloc(sizeof (struct dbw_zone));
+    if (!copy) return NULL;
+    *copy = *zone;
+    copy->dirty = DBW_CLEAN;
+    copy->scratch = 0;
+    if (zone->policy) copy->policy_id = zone->policy->id;
+    copy->policy = NULL;
+    copy->key_count = 0;
+    copy->key = NULL;
+    copy->keydependency_count = 0;
+    copy->keydependency = NULL;
+    copy->name = strdup(zone->name);
+    copy->signconf_path = strdup(zone->signconf_path);
+    copy->input_adapter_uri = strdup(zone->input_adapter_uri);
+    copy->input_adapter_type = strdup(zone->input_adapter_type);
+    copy->output_adapter_uri = strdup(zone->output_adapter_uri);
+    copy->output_adapter_type = strdup(zone->output_adapter_type);
+    if (!copy->name || !copy->signconf_path ||
+        !copy->input_adapter_uri || !copy->input_adapter_type ||
+        !copy->output_adapter_uri || !copy->output_adapter_type)
+    {
+        dbw_zone_free((struct dbrow *)copy);
+        return NULL;
+    }
+    return (struct dbrow *)copy;
 }
 
-static int dbw_zone_revision(const db_connection_t *dbconn, struct db_value *id)
+static struct dbrow *
+dbw_key_copy(struct dbrow *row)
 {
-    zone_db_t *dbx_obj = zone_db_new(dbconn);
-    int rev = -1;
-    if (dbx_obj && !zone_db_get_by_id(dbx_obj, id))
-        rev = dbxvalue2int(&dbx_obj->rev);
-    zone_db_free(dbx_obj);
-    return rev;
-}
-
-static int dbw_key_revision(const db_connection_t *dbconn, struct db_value *id)
+    struct dbw_key *key = (struct dbw_key *)row;
+    struct dbw_key *copy = malloc(sizeof (struct dbw_key));
+    if (!copy) return NULL;
+    *copy = *key;
+    copy->dirty = DBW_CLEAN;
+    copy->scratch = 0;
+    if (key->zone) copy->zone_id = key->zone->id;
+    copy->zone = NULL;
+    if (key->hsmkey) copy->hsmkey_id = key->hsmkey->id;
+    copy->hsmkey = NULL;
+    copy->keystate_count = 0;
+    copy->keystate = NULL;
+    copy->from_keydependency_count = 0;
+    copy->from_keydependency = NULL;
+    copy->to_keydependency_count = 0;
+    copy->to_keydependency = NULL;
+    return (struct dbrow *)copy;
+}
+
+static struct dbrow *
+dbw_keystate_copy(struct dbrow *row)
 {
-    key_data_t *dbx_obj = key_data_new(dbconn);
-    int rev = -1;
-    if (dbx_obj && !key_data_get_by_id(dbx_obj, id))
-        rev = dbxvalue2int(&dbx_obj->rev);
-    key_data_free(dbx_obj);
-    return rev;
+    struct dbw_keystate *keystate = (struct dbw_keystate *)row;
+    struct dbw_keystate *copy = malloc(sizeof (struct dbw_keystate));
+    if (!copy) return NULL;
+    *copy = *keystate;
+    copy->dirty = DBW_CLEAN;
+    copy->scratch = 0;
+    if (keystate->key) copy->key_id = keystate->key->id;
+    copy->key = NULL;
+    return (struct dbrow *)copy;
 }
 
-static int dbw_keystate_revision(const db_connection_t *dbconn, struct db_value *id)
+static struct dbrow *
+dbw_keydependency_copy(struct dbrow *row)
 {
-    key_state_t *dbx_obj = key_state_new(dbconn);
-    int rev = -1;
-    if (dbx_obj && !key_state_get_by_id(dbx_obj, id))
-        rev = dbxvalue2int(&dbx_obj->rev);
-    key_state_free(dbx_obj);
-    return rev;
-}
-
-static int dbw_keydependency_revision(const db_connection_t *dbconn, struct db_value *id)
+    struct dbw_keydependency *keydependency = (struct dbw_keydependency *)row;
+    struct dbw_keydependency *copy = malloc(sizeof (struct dbw_keydependency));
+    if (!copy) return NULL;
+    *copy = *keydependency;
+    copy->dirty = DBW_CLEAN;
+    copy->scratch = 0;
+    if (keydependency->zone) copy->zone_id = keydependency->zone->id;
+    copy->zone = NULL;
+    if (keydependency->fromkey) copy->fromkey_id = keydependency->fromkey->id;
+    copy->fromkey = NULL;
+    if (keydependency->tokey) copy->tokey_id = keydependency->tokey->id;
+    copy->tokey = NULL;
+    return (struct dbrow *)copy;
+}
+
+static struct dbrow *
+dbw_hsmkey_copy(struct dbrow *row)
 {
-    key_dependency_t *dbx_obj = key_dependency_new(dbconn);
-    int rev = -1;
-    if (dbx_obj && !key_dependency_get_by_id(dbx_obj, id))
-        rev = dbxvalue2int(&dbx_obj->rev);
-    key_dependency_free(dbx_obj);
-    return rev;
+    struct dbw_hsmkey *hsmkey = (struct dbw_hsmkey *)row;
+    struct dbw_hsmkey *copy = malloc(sizeof (struct dbw_hsmkey));
+    if (!copy) return NULL;
+    *copy = *hsmkey;
+    copy->dirty = DBW_CLEAN;
+    copy->scratch = 0;
+    if (hsmkey->policy) copy->policy_id = hsmkey->policy->id;
+    copy->policy = NULL;
+    copy->key_count = 0;
+    copy->key = NULL;
+    copy->foreign_key_count = 0;
+    copy->locator = strdup(hsmkey->locator);
+    copy->repository = strdup(hsmkey->repository);
+    if (!copy->locator || !copy->repository) {
+        dbw_hsmkey_free((struct dbrow *)copy);
+        return NULL;
+    }
+    return (struct dbrow *)copy;
 }
 
-static int dbw_hsmkey_revision(const db_connection_t *dbconn, struct db_value *id)
+static int
+dbxvalue2int(struct db_value const *val)
 {
-    hsm_key_t *dbx_obj = hsm_key_new(dbconn);
-    int rev = -1;
-    if (dbx_obj && !hsm_key_get_by_id(dbx_obj, id))
-        rev = dbxvalue2int(&dbx_obj->rev);
-    hsm_key_free(dbx_obj);
-    return rev;
+    switch (val->type) {
+        case DB_TYPE_INT32:  return (int)val->int32;
+        case DB_TYPE_UINT32: return (int)val->uint32;
+        case DB_TYPE_INT64:  return (int)val->int64;
+        case DB_TYPE_UINT64: return (int)val->uint64;
+        default: return -1;
+    }
 }
 
 static int
 dbw_policy_update(const db_connection_t *dbconn, struct dbrow *row)
 {
-    struct db_value id;
     policy_t *dbx_obj;
     struct dbw_policy *policy = (struct dbw_policy *)row;
     int ret;
 
-    memset(&id, 0, sizeof (id));
     if (!(dbx_obj = policy_new(dbconn))) {
         return 1;
     }
 
     switch (row->dirty) {
-        case DBW_DELETE:
-            if (db_value_from_int32(&id, row->id) || policy_get_by_id(dbx_obj, &id))
-                return 1;
-            ret = policy_delete(dbx_obj);
-            policy_free(dbx_obj);
-            return ret;
         case DBW_UPDATE:
-            if (db_value_from_int32(&id, row->id) || policy_get_by_id(dbx_obj, &id))
+            if (db_value_from_int32(&dbx_obj->id, row->id)
+                || db_value_from_int32(&dbx_obj->rev, row->revision))
+            {
+                policy_free(dbx_obj);
                 return 1;
-            free(dbx_obj->name);
-            free(dbx_obj->description);
+            }
         case DBW_INSERT: /* fall through intentional */
             free(dbx_obj->denial_salt);
     }
@@ -287,27 +614,22 @@ dbw_policy_update(const db_connection_t *dbconn, struct dbrow *row)
 static int
 dbw_policykey_update(const db_connection_t *dbconn, struct dbrow *row)
 {
-    struct db_value id;
     policy_key_t *dbx_obj;
     struct dbw_policykey *policykey = (struct dbw_policykey *)row;
     int ret;
 
-    memset(&id, 0, sizeof (id));
     if (!(dbx_obj = policy_key_new(dbconn))) {
         return 1;
     }
 
     switch (row->dirty) {
-        case DBW_DELETE:
-            if (db_value_from_int32(&id, row->id) || policy_key_get_by_id(dbx_obj, &id))
-                return 1;
-            ret = policy_key_delete(dbx_obj);
-            policy_key_free(dbx_obj);
-            return ret;
         case DBW_UPDATE:
-            if (db_value_from_int32(&id, row->id) || policy_key_get_by_id(dbx_obj, &id))
+            if (db_value_from_int32(&dbx_obj->id, row->id)
+                || db_value_from_int32(&dbx_obj->rev, row->revision))
+            {
+                policy_key_free(dbx_obj);
                 return 1;
-            free(dbx_obj->repository);
+            }
         case DBW_INSERT: /* fall through intentional */
             {/*pass*/}
     }
@@ -338,37 +660,11 @@ dbw_policykey_update(const db_connection_t *dbconn, struct dbrow *row)
     return ret;
 }
 
-static int
-dbw_zone_update(const db_connection_t *dbconn, struct dbrow *row)
+static void
+dbw_zone_to_dbx(zone_db_t *dbx_obj, struct dbw_zone *zone)
 {
-    struct db_value id;
-    zone_db_t *dbx_obj;
-    struct dbw_zone *zone = (struct dbw_zone *)row;
-    int ret;
-
-    memset(&id, 0, sizeof (id));
-    if (!(dbx_obj = zone_db_new(dbconn))) {
-        return 1;
-    }
-
-    switch (row->dirty) {
-        case DBW_DELETE:
-            if (db_value_from_int32(&id, row->id) || zone_db_get_by_id(dbx_obj, &id))
-                return 1;
-            ret = zone_db_delete(dbx_obj);
-            zone_db_free(dbx_obj);
-            return ret;
-        case DBW_UPDATE:
-            if (db_value_from_int32(&id, row->id) || zone_db_get_by_id(dbx_obj, &id))
-                return 1;
-            free(dbx_obj->name);
-            free(dbx_obj->signconf_path);
-            free(dbx_obj->input_adapter_uri);
-            free(dbx_obj->output_adapter_uri);
-        case DBW_INSERT: /* fall through intentional */
-            free(dbx_obj->input_adapter_type);
-            free(dbx_obj->output_adapter_type);
-    }
+    free(dbx_obj->input_adapter_type);
+    free(dbx_obj->output_adapter_type);
 
     dbx_obj->policy_id.type = DB_TYPE_INT32;
     dbx_obj->policy_id.int32 = zone->policy->id;
@@ -391,6 +687,27 @@ dbw_zone_update(const db_connection_t *dbconn, struct dbrow *row)
     dbx_obj->next_ksk_roll                  = zone->next_ksk_roll;
     dbx_obj->next_zsk_roll                  = zone->next_zsk_roll;
     dbx_obj->next_csk_roll                  = zone->next_csk_roll;
+}
+
+static int
+dbw_zone_update(const db_connection_t *dbconn, struct dbrow *row)
+{
+    zone_db_t *dbx_obj;
+    struct dbw_zone *zone = (struct dbw_zone *)row;
+    int ret;
+
+    if (!(dbx_obj = zone_db_new(dbconn))) {
+        return 1;
+    }
+
+    if (row->dirty == DBW_UPDATE
+        && (db_value_from_int32(&dbx_obj->id, row->id)
+            || db_value_from_int32(&dbx_obj->rev, row->revision)))
+    {
+        zone_db_free(dbx_obj);
+        return 1;
+    }
+    dbw_zone_to_dbx(dbx_obj, zone);
 
     if (row->dirty == DBW_UPDATE) {
         ret = zone_db_update(dbx_obj);
@@ -405,26 +722,22 @@ dbw_zone_update(const db_connection_t *dbconn, struct dbrow *row)
 static int
 dbw_key_update(const db_connection_t *dbconn, struct dbrow *row)
 {
-    struct db_value id;
     key_data_t *dbx_obj;
     struct dbw_key *key = (struct dbw_key *)row;
     int ret;
 
-    memset(&id, 0, sizeof (id));
     if (!(dbx_obj = key_data_new(dbconn))) {
         return 1;
     }
 
     switch (row->dirty) {
-        case DBW_DELETE:
-            if (db_value_from_int32(&id, row->id) || key_data_get_by_id(dbx_obj, &id))
-                return 1;
-            ret = key_data_delete(dbx_obj);
-            key_data_free(dbx_obj);
-            return ret;
         case DBW_UPDATE:
-            if (db_value_from_int32(&id, row->id) || key_data_get_by_id(dbx_obj, &id))
+            if (db_value_from_int32(&dbx_obj->id, row->id)
+                || db_value_from_int32(&dbx_obj->rev, row->revision))
+            {
+                key_data_free(dbx_obj);
                 return 1;
+            }
         case DBW_INSERT: /* fall through intentional */
             {/* pass */}
     }
@@ -462,26 +775,22 @@ dbw_key_update(const db_connection_t *dbconn, struct dbrow *row)
 static int
 dbw_keystate_update(const db_connection_t *dbconn, struct dbrow *row)
 {
-    struct db_value id;
     key_state_t *dbx_obj;
     struct dbw_keystate *keystate = (struct dbw_keystate *)row;
     int ret;
 
-    memset(&id, 0, sizeof (id));
     if (!(dbx_obj = key_state_new(dbconn))) {
         return 1;
     }
 
     switch (row->dirty) {
-        case DBW_DELETE:
-            if (db_value_from_int32(&id, row->id) || key_state_get_by_id(dbx_obj, &id))
-                return 1;
-            ret = key_state_delete(dbx_obj);
-            key_state_free(dbx_obj);
-            return ret;
         case DBW_UPDATE:
-            if (db_value_from_int32(&id, row->id) || key_state_get_by_id(dbx_obj, &id))
+            if (db_value_from_int32(&dbx_obj->id, row->id)
+                || db_value_from_int32(&dbx_obj->rev, row->revision))
+            {
+                key_state_free(dbx_obj);
                 return 1;
+            }
         case DBW_INSERT: /* fall through intentional */
             {/* pass */}
     }
@@ -510,23 +819,19 @@ dbw_keystate_update(const db_connection_t *dbconn, struct dbrow *row)
 static int
 dbw_keydependency_update(const db_connection_t *dbconn, struct dbrow *row)
 {
-    struct db_value id;
     key_dependency_t *dbx_obj;
     struct dbw_keydependency *keydependency = (struct dbw_keydependency *)row;
     int ret;
 
-    memset(&id, 0, sizeof (id));
     dbx_obj = key_dependency_new(dbconn);
     switch (row->dirty) {
-        case DBW_DELETE:
-            if (db_value_from_int32(&id, row->id) || key_dependency_get_by_id(dbx_obj, &id))
-                return 1;
-            ret = key_dependency_delete(dbx_obj);
-            key_dependency_free(dbx_obj);
-            return ret;
         case DBW_UPDATE:
-            if (db_value_from_int32(&id, row->id) || key_dependency_get_by_id(dbx_obj, &id))
+            if (db_value_from_int32(&dbx_obj->id, row->id)
+                || db_value_from_int32(&dbx_obj->rev, row->revision))
+            {
+                key_dependency_free(dbx_obj);
                 return 1;
+            }
             ods_log_assert(0); //Update had never existed.
         case DBW_INSERT: /* fall through intentional */
             {/* pass */}
@@ -551,28 +856,21 @@ dbw_keydependency_update(const db_connection_t *dbconn, struct dbrow *row)
 static int
 dbw_hsmkey_update(const db_connection_t *dbconn, struct dbrow *row)
 {
-    struct db_value id;
     hsm_key_t *dbx_obj;
     struct dbw_hsmkey *hsmkey = (struct dbw_hsmkey *)row;
-    int ret;
 
-    memset(&id, 0, sizeof (id));
     if (!(dbx_obj = hsm_key_new(dbconn))) {
         return 1;
     }
 
     switch (row->dirty) {
-        case DBW_DELETE:
-            if (db_value_from_int32(&id, row->id) || hsm_key_get_by_id(dbx_obj, &id))
-                return 1;
-            ret = hsm_key_delete(dbx_obj);
-            hsm_key_free(dbx_obj);
-            return ret;
         case DBW_UPDATE:
-            if (db_value_from_int32(&id, row->id) || hsm_key_get_by_id(dbx_obj, &id))
+            if (db_value_from_int32(&dbx_obj->id, row->id)
+                || db_value_from_int32(&dbx_obj->rev, row->revision))
+            {
+                hsm_key_free(dbx_obj);
                 return 1;
-            free(dbx_obj->locator);
-            free(dbx_obj->repository);
+            }
         case DBW_INSERT: /* fall through intentional */
             {/* pass */}
     }
@@ -608,43 +906,18 @@ dbw_hsmkey_update(const db_connection_t *dbconn, struct dbrow *row)
     return r;
 }
 
-#define GT(x)   ((x)>0)
-#define LTE(x)   ((x)<=0)
-/**
- * cmp -,0,+: lt, eq, gt
- */
-static void
-quicksort(struct dbrow **row, int first, int last,
-    int (*cmp)(struct dbrow*, struct dbrow*))
-{
-    /** not very efficient for already sorted lists! */
-    int pivot, j, i;
-    struct dbrow *temp;
-    if(first >= last) return;
-    pivot = i = first;
-    j = last;
-    while (i < j) {
-        while (i < last && LTE(cmp(row[i], row[pivot]))) i++;
-        while (GT(cmp(row[j], row[pivot]))) j--;
-        if (i < j) {
-            temp = row[i];
-            row[i] = row[j];
-            row[j] = temp;
-        }
-    }
-    temp = row[pivot];
-    row[pivot] = row[j];
-    row[j] = temp;
-    quicksort(row, first, j-1, cmp);
-    quicksort(row, j+1, last, cmp);
-}
-static int cmp_id(struct dbrow *l, struct dbrow *r) { return l->id - r->id; }
-static int cmp_int0(struct dbrow *l, struct dbrow *r) { return l->int0 - r->int0; }
-static int cmp_int1(struct dbrow *l, struct dbrow *r) { return l->int1 - r->int1; }
-static int cmp_int2(struct dbrow *l, struct dbrow *r) { return l->int2 - r->int2; }
-static void sort_list(struct dbw_list *list, int (*cmp)(struct dbrow*, struct dbrow*))
+/* qsort() comparators on the id or a parent id of rows */
+#define ROW(p) (*(struct dbrow * const *)(p))
+static int cmp_int(int l, int r) { return (l > r) - (l < r); }
+static int cmp_id(const void *l, const void *r) { return cmp_int(ROW(l)->id, ROW(r)->id); }
+static int cmp_int0(const void *l, const void *r) { return cmp_int(ROW(l)->int0, ROW(r)->int0); }
+static int cmp_int1(const void *l, const void *r) { return cmp_int(ROW(l)->int1, ROW(r)->int1); }
+static int cmp_int2(const void *l, const void *r) { return cmp_int(ROW(l)->int2, ROW(r)->int2); }
+static void sort_list(struct dbw_list *list, int (*cmp)(const void *, const void *))
 {
-    quicksort(list->set, 0, list->n-1, cmp);
+    /* Lists read from the database are usually sorted already, which is
+     * no problem for qsort() */
+    if (list->n) qsort(list->set, list->n, sizeof (struct dbrow *), cmp);
 }
 static void sort_list_by_parent_id(struct dbw_list *list, int pidx)
 {
@@ -659,7 +932,7 @@ static void sort_list_by_parent_id(struct dbw_list *list, int pidx)
 static void
 sort_by_id(struct dbw_list *list)
 {
-    quicksort(list->set, 0, list->n-1, cmp_id);
+    sort_list(list, cmp_id);
 }
 
 
@@ -742,39 +1015,70 @@ static void merge_zn_dp(struct dbw_list *l, struct dbw_list *r) { merge(l, 2, r,
 static void merge_kf_dp(struct dbw_list *l, struct dbw_list *r) { merge(l, 3, r, 1); }
 static void merge_kt_dp(struct dbw_list *l, struct dbw_list *r) { merge(l, 4, r, 2); }
 
+/* Link the rows of all tables of db to each other */
+static void
+dbw_merge(struct dbw_db *db)
+{
+    merge_pl_pk(db->policies, db->policykeys);
+    merge_pl_hk(db->policies, db->hsmkeys);
+    merge_pl_zn(db->policies, db->zones);
+    merge_zn_kd(db->zones,    db->keys);
+    merge_kd_ks(db->keys,     db->keystates);
+    merge_hk_kd(db->hsmkeys,  db->keys);
+    merge_zn_dp(db->zones,    db->keydependencies);
+    merge_kt_dp(db->keys,     db->keydependencies);
+    merge_kf_dp(db->keys,     db->keydependencies);
+}
+
 /**
  *  DBX to DBW conversions
  *
  */
 
-static struct dbw_zone *
-zone_dbx_to_dbw(const zone_db_t *dbx_item)
+/* The converters below read a row of the columns read with the object of the
+ * matching dbx list, the field numbers follow the order of its fields. */
+
+static int
+colint(const db_result_columns_t *cols, size_t r, size_t f)
+{
+    return (int)db_result_columns_int(cols, r, f);
+}
+
+static char *
+coltext(const db_result_columns_t *cols, size_t r, size_t f)
+{
+    const char *text = db_result_columns_text(cols, r, f);
+    return text ? strdup(text) : NULL;
+}
+
+static struct dbrow *
+zone_columns_to_dbw(const db_result_columns_t *cols, size_t r)
 {
     struct dbw_zone *row = calloc(1, sizeof (struct dbw_zone));
     if (!row) return NULL;
 
-    row->id                  = dbxvalue2int(&dbx_item->id);
-    row->revision            = dbxvalue2int(&dbx_item->rev);
-    row->policy_id           = dbxvalue2int(&dbx_item->policy_id);
+    row->id                  = colint(cols, r, 0);
+    row->revision            = colint(cols, r, 1);
+    row->policy_id           = colint(cols, r, 2);
     row->policy              = NULL;
 
-    row->name                = strdup(dbx_item->name);
-    row->next_change         = (time_t)dbx_item->next_change;
-    row->signconf_needs_writing = dbx_item->signconf_needs_writing;
-    row->signconf_path       = strdup(dbx_item->signconf_path);
-    row->input_adapter_uri   = strdup(dbx_item->input_adapter_uri);
-    row->input_adapter_type  = strdup(dbx_item->input_adapter_type);
-    row->output_adapter_uri  = strdup(dbx_item->output_adapter_uri);
-    row->output_adapter_type = strdup(dbx_item->output_adapter_type);
-    row->next_ksk_roll       = dbx_item->next_ksk_roll;
-    row->next_zsk_roll       = dbx_item->next_zsk_roll;
-    row->next_csk_roll       = dbx_item->next_csk_roll;
-    row->ttl_end_ds          = dbx_item->ttl_end_ds;
-    row->ttl_end_dk          = dbx_item->ttl_end_dk;
-    row->ttl_end_rs          = dbx_item->ttl_end_rs;
-    row->roll_ksk_now        = dbx_item->roll_ksk_now;
-    row->roll_zsk_now        = dbx_item->roll_zsk_now;
-    row->roll_csk_now        = dbx_item->roll_csk_now;
+    row->name                = coltext(cols, r, 3);
+    row->signconf_needs_writing = (unsigned int)db_result_columns_int(cols, r, 4);
+    row->signconf_path       = coltext(cols, r, 5);
+    row->next_change         = (time_t)colint(cols, r, 6);
+    row->ttl_end_ds          = (unsigned int)db_result_columns_int(cols, r, 7);
+    row->ttl_end_dk          = (unsigned int)db_result_columns_int(cols, r, 8);
+    row->ttl_end_rs          = (unsigned int)db_result_columns_int(cols, r, 9);
+    row->roll_ksk_now        = (unsigned int)db_result_columns_int(cols, r, 10);
+    row->roll_zsk_now        = (unsigned int)db_result_columns_int(cols, r, 11);
+    row->roll_csk_now        = (unsigned int)db_result_columns_int(cols, r, 12);
+    row->input_adapter_type  = coltext(cols, r, 13);
+    row->input_adapter_uri   = coltext(cols, r, 14);
+    row->output_adapter_type = coltext(cols, r, 15);
+    row->output_adapter_uri  = coltext(cols, r, 16);
+    row->next_ksk_roll       = (unsigned int)db_result_columns_int(cols, r, 17);
+    row->next_zsk_roll       = (unsigned int)db_result_columns_int(cols, r, 18);
+    row->next_csk_roll       = (unsigned int)db_result_columns_int(cols, r, 19);
 
     if (!row->name || !row->signconf_path ||
         !row->input_adapter_uri || !row->input_adapter_type ||
@@ -789,50 +1093,50 @@ zone_dbx_to_dbw(const zone_db_t *dbx_item)
         free(row);
         return NULL;
     }
-    return row;
+    return (struct dbrow *)row;
 }
 
-static struct dbw_policykey *
-policykey_dbx_to_dbw(const policy_key_t *dbx_item)
+static struct dbrow *
+policykey_columns_to_dbw(const db_result_columns_t *cols, size_t r)
 {
     struct dbw_policykey *row = calloc(1, sizeof (struct dbw_policykey));
     if (!row) return NULL;
 
-    row->id                             = dbxvalue2int(&dbx_item->id);
-    row->revision                       = dbxvalue2int(&dbx_item->rev);
-    row->policy_id                      = dbxvalue2int(&dbx_item->policy_id);
+    row->id                             = colint(cols, r, 0);
+    row->revision                       = colint(cols, r, 1);
+    row->policy_id                      = colint(cols, r, 2);
     row->policy                         = NULL;
 
-    row->repository                     = strdup(dbx_item->repository);
+    row->repository                     = coltext(cols, r, 7);
 
     if (!row->repository) {
         free(row);
         return NULL;
     }
-    row->role                           = dbx_item->role;
-    row->algorithm                      = dbx_item->algorithm;
-    row->bits                           = dbx_item->bits;
-    row->lifetime                       = dbx_item->lifetime;
-    row->standby                        = dbx_item->standby;
-    row->manual_rollover                = dbx_item->manual_rollover;
-    row->rfc5011                        = dbx_item->rfc5011;
-    row->minimize                       = dbx_item->minimize;
+    row->role                           = colint(cols, r, 3);
+    row->algorithm                      = colint(cols, r, 4);
+    row->bits                           = colint(cols, r, 5);
+    row->lifetime                       = colint(cols, r, 6);
+    row->standby                        = colint(cols, r, 8);
+    row->manual_rollover                = colint(cols, r, 9);
+    row->rfc5011                        = colint(cols, r, 10);
+    row->minimize                       = colint(cols, r, 11);
 
-    return row;
+    return (struct dbrow *)row;
 }
 
-static struct dbw_policy *
-policy_dbx_to_dbw(const policy_t *dbx_item)
+static struct dbrow *
+policy_columns_to_dbw(const db_result_columns_t *cols, size_t r)
 {
     struct dbw_policy *row = calloc(1, sizeof (struct dbw_policy));
     if (!row) return NULL;
 
-    row->id                  = dbxvalue2int(&dbx_item->id);
-    row->revision            = dbxvalue2int(&dbx_item->rev);
+    row->id                  = colint(cols, r, 0);
+    row->revision            = colint(cols, r, 1);
 
-    row->name                = strdup(dbx_item->name);
-    row->description          = strdup(dbx_item->description);
-    row->denial_salt          = strdup(dbx_item->denial_salt);
+    row->name                = coltext(cols, r, 2);
+    row->description          = coltext(cols, r, 3);
+    row->denial_salt          = coltext(cols, r, 19);
 
     if (!row->name || !row->description || !row->denial_salt) {
         free(row->name);
@@ -841,119 +1145,119 @@ policy_dbx_to_dbw(const policy_t *dbx_item)
         free(row);
         return NULL;
     }
-    row->passthrough                    = dbx_item->passthrough;
-    row->signatures_resign              = dbx_item->signatures_resign;
-    row->signatures_refresh             = dbx_item->signatures_refresh;
-    row->signatures_jitter              = dbx_item->signatures_jitter;
-    row->signatures_inception_offset    = dbx_item->signatures_inception_offset;
-    row->signatures_validity_default    = dbx_item->signatures_validity_default;
-    row->signatures_validity_denial     = dbx_item->signatures_validity_denial;
-    row->signatures_validity_keyset     = dbx_item->signatures_validity_keyset;
-    row->signatures_max_zone_ttl        = dbx_item->signatures_max_zone_ttl;
-    row->denial_type                    = dbx_item->denial_type;
-    row->denial_optout                  = dbx_item->denial_optout;
-    row->denial_ttl                     = dbx_item->denial_ttl;
-    row->denial_resalt                  = dbx_item->denial_resalt;
-    row->denial_algorithm               = dbx_item->denial_algorithm;
-    row->denial_iterations              = dbx_item->denial_iterations;
-    row->denial_salt_length             = dbx_item->denial_salt_length;
-    row->denial_salt_last_change        = dbx_item->denial_salt_last_change;
-    row->keys_ttl                       = dbx_item->keys_ttl;
-    row->keys_retire_safety             = dbx_item->keys_retire_safety;
-    row->keys_publish_safety            = dbx_item->keys_publish_safety;
-    row->keys_shared                    = dbx_item->keys_shared;
-    row->keys_purge_after               = dbx_item->keys_purge_after;
-    row->zone_propagation_delay         = dbx_item->zone_propagation_delay;
-    row->zone_soa_ttl                   = dbx_item->zone_soa_ttl;
-    row->zone_soa_minimum               = dbx_item->zone_soa_minimum;
-    row->zone_soa_serial                = dbx_item->zone_soa_serial;
-    row->parent_registration_delay      = dbx_item->parent_registration_delay;
-    row->parent_propagation_delay       = dbx_item->parent_propagation_delay;
-    row->parent_ds_ttl                  = dbx_item->parent_ds_ttl;
-    row->parent_soa_ttl                 = dbx_item->parent_soa_ttl;
-    row->parent_soa_minimum             = dbx_item->parent_soa_minimum;
-    return row;
-}
-
-static struct dbw_key *
-key_dbx_to_dbw(const key_data_t *dbx_item)
+    row->signatures_resign              = colint(cols, r, 4);
+    row->signatures_refresh             = colint(cols, r, 5);
+    row->signatures_jitter              = colint(cols, r, 6);
+    row->signatures_inception_offset    = colint(cols, r, 7);
+    row->signatures_validity_default    = colint(cols, r, 8);
+    row->signatures_validity_denial     = colint(cols, r, 9);
+    row->signatures_validity_keyset     = colint(cols, r, 10);
+    row->signatures_max_zone_ttl        = colint(cols, r, 11);
+    row->denial_type                    = colint(cols, r, 12);
+    row->denial_optout                  = colint(cols, r, 13);
+    row->denial_ttl                     = colint(cols, r, 14);
+    row->denial_resalt                  = colint(cols, r, 15);
+    row->denial_algorithm               = colint(cols, r, 16);
+    row->denial_iterations              = colint(cols, r, 17);
+    row->denial_salt_length             = colint(cols, r, 18);
+    row->denial_salt_last_change        = colint(cols, r, 20);
+    row->keys_ttl                       = colint(cols, r, 21);
+    row->keys_retire_safety             = colint(cols, r, 22);
+    row->keys_publish_safety            = colint(cols, r, 23);
+    row->keys_shared                    = colint(cols, r, 24);
+    row->keys_purge_after               = colint(cols, r, 25);
+    row->zone_propagation_delay         = colint(cols, r, 26);
+    row->zone_soa_ttl                   = colint(cols, r, 27);
+    row->zone_soa_minimum               = colint(cols, r, 28);
+    row->zone_soa_serial                = colint(cols, r, 29);
+    row->parent_registration_delay      = colint(cols, r, 30);
+    row->parent_propagation_delay       = colint(cols, r, 31);
+    row->parent_ds_ttl                  = colint(cols, r, 32);
+    row->parent_soa_ttl                 = colint(cols, r, 33);
+    row->parent_soa_minimum             = colint(cols, r, 34);
+    row->passthrough                    = colint(cols, r, 35);
+    return (struct dbrow *)row;
+}
+
+static struct dbrow *
+key_columns_to_dbw(const db_result_columns_t *cols, size_t r)
 {
     struct dbw_key *row = calloc(1, sizeof (struct dbw_key));
     if (!row) return NULL;
 
-    row->id                  = dbxvalue2int(&dbx_item->id);
-    row->revision            = dbxvalue2int(&dbx_item->rev);
-    row->zone_id             = dbxvalue2int(&dbx_item->zone_id);
+    row->id                  = colint(cols, r, 0);
+    row->revision            = colint(cols, r, 1);
+    row->zone_id             = colint(cols, r, 2);
     row->zone                = NULL;
-    row->hsmkey_id           = dbxvalue2int(&dbx_item->hsm_key_id);
+    row->hsmkey_id           = colint(cols, r, 3);
     row->hsmkey              = NULL;
 
-    row->role                = dbx_item->role;
-    row->ds_at_parent        = dbx_item->ds_at_parent;
-    row->algorithm           = dbx_item->algorithm;
-    row->inception           = dbx_item->inception;
-    row->introducing         = dbx_item->introducing;
-    row->should_revoke       = dbx_item->should_revoke;
-    row->standby             = dbx_item->standby;
-    row->active_zsk          = dbx_item->active_zsk;
-    row->active_ksk          = dbx_item->active_ksk;
-    row->publish             = dbx_item->publish;
-    row->keytag              = dbx_item->keytag;
-    row->minimize            = dbx_item->minimize;
-    return row;
+    row->algorithm           = colint(cols, r, 4);
+    row->inception           = colint(cols, r, 5);
+    row->role                = colint(cols, r, 6);
+    row->introducing         = colint(cols, r, 7);
+    row->should_revoke       = colint(cols, r, 8);
+    row->standby             = colint(cols, r, 9);
+    row->active_zsk          = colint(cols, r, 10);
+    row->publish             = colint(cols, r, 11);
+    row->active_ksk          = colint(cols, r, 12);
+    row->ds_at_parent        = colint(cols, r, 13);
+    row->keytag              = colint(cols, r, 14);
+    row->minimize            = colint(cols, r, 15);
+    return (struct dbrow *)row;
 }
 
-static struct dbw_keystate *
-keystate_dbx_to_dbw(const key_state_t *dbx_item)
+static struct dbrow *
+keystate_columns_to_dbw(const db_result_columns_t *cols, size_t r)
 {
     struct dbw_keystate *row = calloc(1, sizeof (struct dbw_keystate));
     if (!row) return NULL;
 
-    row->id                  = dbxvalue2int(&dbx_item->id);
-    row->revision            = dbxvalue2int(&dbx_item->rev);
-    row->key_id              = dbxvalue2int(&dbx_item->key_data_id);
+    row->id                  = colint(cols, r, 0);
+    row->revision            = colint(cols, r, 1);
+    row->key_id              = colint(cols, r, 2);
     row->key                 = NULL;
 
-    row->type                = dbx_item->type;
-    row->state               = dbx_item->state;
-    row->last_change         = dbx_item->last_change;
-    row->minimize            = dbx_item->minimize;
-    row->ttl                 = dbx_item->ttl;
-    return row;
+    row->type                = colint(cols, r, 3);
+    row->state               = colint(cols, r, 4);
+    row->last_change         = colint(cols, r, 5);
+    row->minimize            = colint(cols, r, 6);
+    row->ttl                 = colint(cols, r, 7);
+    return (struct dbrow *)row;
 }
 
-static struct dbw_keydependency *
-keydependency_dbx_to_dbw(const key_dependency_t *dbx_item)
+static struct dbrow *
+keydependency_columns_to_dbw(const db_result_columns_t *cols, size_t r)
 {
     struct dbw_keydependency *row = calloc(1, sizeof (struct dbw_keydependency));
     if (!row) return NULL;
 
-    row->id                  = dbxvalue2int(&dbx_item->id);
-    row->revision            = dbxvalue2int(&dbx_item->rev);
-    row->zone_id             = dbxvalue2int(&dbx_item->zone_id);
+    row->id                  = colint(cols, r, 0);
+    row->revision            = colint(cols, r, 1);
+    row->zone_id             = colint(cols, r, 2);
     row->zone                = NULL;
-    row->fromkey_id          = dbxvalue2int(&dbx_item->from_key_data_id);
+    row->fromkey_id          = colint(cols, r, 3);
     row->fromkey             = NULL;
-    row->tokey_id            = dbxvalue2int(&dbx_item->to_key_data_id);
+    row->tokey_id            = colint(cols, r, 4);
     row->tokey               = NULL;
 
-    row->type                = dbx_item->type;
-    return row;
+    row->type                = colint(cols, r, 5);
+    return (struct dbrow *)row;
 }
 
-static struct dbw_hsmkey *
-hsmkey_dbx_to_dbw(const hsm_key_t *dbx_item)
+static struct dbrow *
+hsmkey_columns_to_dbw(const db_result_columns_t *cols, size_t r)
 {
     struct dbw_hsmkey *row = calloc(1, sizeof (struct dbw_hsmkey));
     if (!row) return NULL;
 
-    row->id                  = dbxvalue2int(&dbx_item->id);
-    row->revision            = dbxvalue2int(&dbx_item->rev);
-    row->policy_id           = dbxvalue2int(&dbx_item->policy_id);
+    row->id                  = colint(cols, r, 0);
+    row->revision            = colint(cols, r, 1);
+    row->policy_id           = colint(cols, r, 2);
     row->policy              = NULL;
-    
-    row->locator             = strdup(dbx_item->locator);
-    row->repository          = strdup(dbx_item->repository);
+
+    row->locator             = coltext(cols, r, 3);
+    row->repository          = coltext(cols, r, 11);
 
     if (!row->locator || !row->repository) {
         free(row->locator);
@@ -961,442 +1265,2322 @@ hsmkey_dbx_to_dbw(const hsm_key_t *dbx_item)
         free(row);
         return NULL;
     }
-    row->state               = dbx_item->state;
-    row->bits                = dbx_item->bits;
-    row->algorithm           = dbx_item->algorithm;
-    row->role                = dbx_item->role;
-    row->inception           = dbx_item->inception;
-    row->is_revoked          = dbx_item->is_revoked;
-    row->key_type            = dbx_item->key_type;
-    row->backup              = dbx_item->backup;
-    return row;
+    row->state               = colint(cols, r, 4);
+    row->bits                = colint(cols, r, 5);
+    row->algorithm           = colint(cols, r, 6);
+    row->role                = colint(cols, r, 7);
+    row->inception           = colint(cols, r, 8);
+    row->is_revoked          = colint(cols, r, 9);
+    row->key_type            = colint(cols, r, 10);
+    row->backup              = colint(cols, r, 12);
+    return (struct dbrow *)row;
+}
+
+/* Convert every row of cols and add it to list. */
+static int
+list_from_columns(struct dbw_list *list, const db_result_columns_t *cols,
+    struct dbrow *(*convert)(const db_result_columns_t *, size_t))
+{
+    size_t n = db_result_columns_rows(cols);
+    if (!n) return 0;
+    if (!(list->set = calloc(n, sizeof (struct dbrow *)))) return 1;
+    for (size_t r = 0; r < n; r++) {
+        struct dbrow *row = convert(cols, r);
+        if (!row) return 1;
+        list->set[list->n++] = row;
+    }
+    return 0;
 }
 
+static int dbw_zone_insert(const db_connection_t *dbconn, struct dbrow **rows,
+    size_t n);
+
 /**
  *  BASIC FETCHES
  *
  */
 
 static struct dbw_list *
-dbw_zones(db_connection_t *dbconn, int fetch)
+dbw_zones(db_connection_t *dbconn, int fetch,
+    const db_clause_list_t *clause_list)
 {
-    zone_list_db_t* dbx_list = NULL;
-    size_t n = 0;
+    db_result_columns_t *cols = NULL;
     if (fetch) {
-        dbx_list = zone_list_db_new_get(dbconn);
-        if (!dbx_list) return NULL;
-        n = zone_list_db_size(dbx_list);
+        zone_list_db_t* dbx_list = zone_list_db_new(dbconn);
+        if (dbx_list) cols = db_object_read_columns(dbx_list->dbo, NULL, clause_list);
+        zone_list_db_free(dbx_list);
+        if (!cols) return NULL;
     }
     struct dbw_list *list = calloc(1, sizeof (struct dbw_list));
     if (!list) {
-        zone_list_db_free(dbx_list);
+        db_result_columns_free(cols);
         return NULL;
     }
     list->free = dbw_zone_free;
     list->update = dbw_zone_update;
-    list->revision = dbw_zone_revision;
+    list->insert = dbw_zone_insert;
+    list->copy = dbw_zone_copy;
+    list->table = "zone";
     if (fetch) {
-        list->set = calloc(n, sizeof (struct dbw_zone *));
-        if (!list->set) {
+        int r = list_from_columns(list, cols, zone_columns_to_dbw);
+        db_result_columns_free(cols);
+        if (r) {
             dbw_list_free(list);
-            zone_list_db_free(dbx_list);
             return NULL;
         }
-        const zone_db_t* dbx_item;
-        while ((dbx_item = zone_list_db_next(dbx_list)) != NULL && list->n < n) {
-            struct dbrow *row = (struct dbrow *)zone_dbx_to_dbw(dbx_item);
-            if (!row) {
-                dbw_list_free(list);
-                zone_list_db_free(dbx_list);
-                return NULL;
-            }
-            list->set[list->n++] = row;
-        }
-        zone_list_db_free(dbx_list);
+    }
+    if (!(list->index = index_new(list, index_zone_name))) {
+        dbw_list_free(list);
+        return NULL;
     }
     return list;
 }
 
 static struct dbw_list *
-dbw_keys(db_connection_t *dbconn, int fetch)
+dbw_keys(db_connection_t *dbconn, int fetch,
+    const db_clause_list_t *clause_list)
 {
-    key_data_list_t* dbx_list = NULL;
-    size_t n = 0;
+    db_result_columns_t *cols = NULL;
     if (fetch) {
-        dbx_list = key_data_list_new_get(dbconn);
-        if (!dbx_list) return NULL;
-        n = key_data_list_size(dbx_list);
+        key_data_list_t* dbx_list = key_data_list_new(dbconn);
+        if (dbx_list) cols = db_object_read_columns(dbx_list->dbo, NULL, clause_list);
+        key_data_list_free(dbx_list);
+        if (!cols) return NULL;
     }
     struct dbw_list *list = calloc(1, sizeof (struct dbw_list));
     if (!list) {
-        key_data_list_free(dbx_list);
+        db_result_columns_free(cols);
         return NULL;
     }
     list->free = dbw_key_free;
     list->update = dbw_key_update;
-    list->revision = dbw_key_revision;
+    list->copy = dbw_key_copy;
+    list->table = "keyData";
     if (fetch) {
-        list->set = calloc(n, sizeof (struct dbw_key *));
-        if (!list->set) {
+        int r = list_from_columns(list, cols, key_columns_to_dbw);
+        db_result_columns_free(cols);
+        if (r) {
             dbw_list_free(list);
-            key_data_list_free(dbx_list);
             return NULL;
         }
-        const key_data_t* dbx_item;
-        while ((dbx_item = key_data_list_next(dbx_list)) != NULL && list->n < n) {
-            struct dbrow *row = (struct dbrow *)key_dbx_to_dbw(dbx_item);
-            if (!row) {
-                dbw_list_free(list);
-                key_data_list_free(dbx_list);
-                return NULL;
-            }
-            list->set[list->n++] = row;
-        }
-        key_data_list_free(dbx_list);
     }
     return list;
 }
 
 static struct dbw_list *
-dbw_keystates(db_connection_t *dbconn, int fetch)
+dbw_keystates(db_connection_t *dbconn, int fetch,
+    const db_clause_list_t *clause_list)
 {
-    key_state_list_t* dbx_list = NULL;
-    size_t n = 0;
+    db_result_columns_t *cols = NULL;
     if (fetch) {
-        dbx_list = key_state_list_new_get(dbconn);
-        if (!dbx_list) return NULL;
-        n = key_state_list_size(dbx_list);
+        key_state_list_t* dbx_list = key_state_list_new(dbconn);
+        if (dbx_list) cols = db_object_read_columns(dbx_list->dbo, NULL, clause_list);
+        key_state_list_free(dbx_list);
+        if (!cols) return NULL;
     }
     struct dbw_list *list = calloc(1, sizeof (struct dbw_list));
     if (!list) {
-        key_state_list_free(dbx_list);
+        db_result_columns_free(cols);
         return NULL;
     }
     list->free = dbw_keystate_free;
     list->update = dbw_keystate_update;
-    list->revision = dbw_keystate_revision;
+    list->copy = dbw_keystate_copy;
+    list->table = "keyState";
     if (fetch) {
-        list->set = calloc(n, sizeof (struct dbw_keystate *));
-        if (!list->set) {
+        int r = list_from_columns(list, cols, keystate_columns_to_dbw);
+        db_result_columns_free(cols);
+        if (r) {
             dbw_list_free(list);
-            key_state_list_free(dbx_list);
             return NULL;
         }
-        const key_state_t* dbx_item;
-        while ((dbx_item = key_state_list_next(dbx_list)) != NULL && list->n < n) {
-            struct dbrow *row = (struct dbrow *)keystate_dbx_to_dbw(dbx_item);
-            if (!row) {
-                dbw_list_free(list);
-                key_state_list_free(dbx_list);
-                return NULL;
-            }
-            list->set[list->n++] = row;
-        }
-        key_state_list_free(dbx_list);
     }
     return list;
 }
 
 static struct dbw_list *
-dbw_keydependencies(db_connection_t *dbconn, int fetch)
+dbw_keydependencies(db_connection_t *dbconn, int fetch,
+    const db_clause_list_t *clause_list)
 {
-    key_dependency_list_t* dbx_list = NULL;
-    size_t n = 0;
+    db_result_columns_t *cols = NULL;
     if (fetch) {
-        dbx_list = key_dependency_list_new_get(dbconn);
-        if (!dbx_list) return NULL;
-        n = key_dependency_list_size(dbx_list);
+        key_dependency_list_t* dbx_list = key_dependency_list_new(dbconn);
+        if (dbx_list) cols = db_object_read_columns(dbx_list->dbo, NULL, clause_list);
+        key_dependency_list_free(dbx_list);
+        if (!cols) return NULL;
     }
     struct dbw_list *list = calloc(1, sizeof (struct dbw_list));
     if (!list) {
-        key_dependency_list_free(dbx_list);
+        db_result_columns_free(cols);
         return NULL;
     }
     list->free = dbw_keydependency_free;
     list->update = dbw_keydependency_update;
-    list->revision = dbw_keydependency_revision;
+    list->copy = dbw_keydependency_copy;
+    list->table = "keyDependency";
     if (fetch) {
-    list->set = calloc(n, sizeof (struct dbw_keydependency *));
-        if (!list->set) {
+        int r = list_from_columns(list, cols, keydependency_columns_to_dbw);
+        db_result_columns_free(cols);
+        if (r) {
             dbw_list_free(list);
-            key_dependency_list_free(dbx_list);
             return NULL;
         }
-        const key_dependency_t* dbx_item;
-        while ((dbx_item = key_dependency_list_next(dbx_list)) != NULL && list->n < n) {
-            struct dbrow *row = (struct dbrow *)keydependency_dbx_to_dbw(dbx_item);
-            if (!row) {
-                dbw_list_free(list);
-                key_dependency_list_free(dbx_list);
-                return NULL;
-            }
-            list->set[list->n++] = row;
-        }
-        key_dependency_list_free(dbx_list);
     }
     return list;
 }
 
 static struct dbw_list *
-dbw_hsmkeys(db_connection_t *dbconn, int fetch)
+dbw_hsmkeys(db_connection_t *dbconn, int fetch,
+    const db_clause_list_t *clause_list)
 {
-    hsm_key_list_t* dbx_list = NULL;
-    size_t n = 0;
+    db_result_columns_t *cols = NULL;
     if (fetch) {
-        dbx_list = hsm_key_list_new_get(dbconn);
-        if (!dbx_list) return NULL;
-        n = hsm_key_list_size(dbx_list);
+        hsm_key_list_t* dbx_list = hsm_key_list_new(dbconn);
+        if (dbx_list) cols = db_object_read_columns(dbx_list->dbo, NULL, clause_list);
+        hsm_key_list_free(dbx_list);
+        if (!cols) return NULL;
     }
     struct dbw_list *list = calloc(1, sizeof (struct dbw_list));
     if (!list) {
-        hsm_key_list_free(dbx_list);
+        db_result_columns_free(cols);
         return NULL;
     }
     list->free = dbw_hsmkey_free;
     list->update = dbw_hsmkey_update;
-    list->revision = dbw_hsmkey_revision;
+    list->copy = dbw_hsmkey_copy;
+    list->table = "hsmKey";
     if (fetch) {
-        list->set = calloc(n, sizeof (struct dbw_hsmkey *));
-        if (!list->set) {
+        int r = list_from_columns(list, cols, hsmkey_columns_to_dbw);
+        db_result_columns_free(cols);
+        if (r) {
             dbw_list_free(list);
-            hsm_key_list_free(dbx_list);
             return NULL;
         }
-        const hsm_key_t* dbx_item;
-        while ((dbx_item = hsm_key_list_next(dbx_list)) != NULL && list->n < n) {
-            struct dbrow *row = (struct dbrow *)hsmkey_dbx_to_dbw(dbx_item);
-            if (!row) {
-                dbw_list_free(list);
-                hsm_key_list_free(dbx_list);
-                return NULL;
-            }
-            list->set[list->n++] = row;
-        }
-        hsm_key_list_free(dbx_list);
+    }
+    if (!(list->index = index_new(list, index_hsmkey_locator))) {
+        dbw_list_free(list);
+        return NULL;
     }
     return list;
 }
 
 
 static struct dbw_list *
-dbw_policies(db_connection_t *dbconn, int fetch)
+dbw_policies(db_connection_t *dbconn, int fetch,
+    const db_clause_list_t *clause_list)
 {
-    policy_list_t* dbx_list = NULL;
-    size_t n = 0;
+    db_result_columns_t *cols = NULL;
     if (fetch) {
-        dbx_list = policy_list_new_get(dbconn);
-        if (!dbx_list) return NULL;
-        n = policy_list_size(dbx_list);
+        policy_list_t* dbx_list = policy_list_new(dbconn);
+        if (dbx_list) cols = db_object_read_columns(dbx_list->dbo, NULL, clause_list);
+        policy_list_free(dbx_list);
+        if (!cols) return NULL;
     }
     struct dbw_list *list = calloc(1, sizeof (struct dbw_list));
     if (!list) {
-        policy_list_free(dbx_list);
+        db_result_columns_free(cols);
         return NULL;
     }
     list->free = dbw_policy_free;
     list->update = dbw_policy_update;
-    list->revision = dbw_policy_revision;
+    list->copy = dbw_policy_copy;
+    list->table = "policy";
     if (fetch) {
-        list->set = calloc(n, sizeof (struct dbw_policy *));
-        if (!list->set) {
+        int r = list_from_columns(list, cols, policy_columns_to_dbw);
+        db_result_columns_free(cols);
+        if (r) {
             dbw_list_free(list);
-            policy_list_free(dbx_list);
             return NULL;
         }
-        const policy_t* dbx_item;
-        while ((dbx_item = policy_list_next(dbx_list)) != NULL && list->n < n) {
-            struct dbrow *row = (struct dbrow *)policy_dbx_to_dbw(dbx_item);
-            if (!row) {
-                dbw_list_free(list);
-                policy_list_free(dbx_list);
-                return NULL;
-            }
-            list->set[list->n++] = row;
-        }
-        policy_list_free(dbx_list);
+    }
+    if (!(list->index = index_new(list, index_policy_name))) {
+        dbw_list_free(list);
+        return NULL;
     }
     return list;
 }
 
 static struct dbw_list *
-dbw_policykeys(db_connection_t *dbconn, int fetch)
+dbw_policykeys(db_connection_t *dbconn, int fetch,
+    const db_clause_list_t *clause_list)
 {
-    policy_key_list_t* dbx_list = NULL;
-    size_t n = 0;
+    db_result_columns_t *cols = NULL;
     if (fetch) {
-        dbx_list = policy_key_list_new_get(dbconn);
-        if (!dbx_list) return NULL;
-        n = policy_key_list_size(dbx_list);
+        policy_key_list_t* dbx_list = policy_key_list_new(dbconn);
+        if (dbx_list) cols = db_object_read_columns(dbx_list->dbo, NULL, clause_list);
+        policy_key_list_free(dbx_list);
+        if (!cols) return NULL;
     }
     struct dbw_list *list = calloc(1, sizeof (struct dbw_list));
     if (!list) {
-        policy_key_list_free(dbx_list);
+        db_result_columns_free(cols);
         return NULL;
     }
     list->free = dbw_policykey_free;
     list->update = dbw_policykey_update;
-    list->revision = dbw_policykey_revision;
+    list->copy = dbw_policykey_copy;
+    list->table = "policyKey";
     if (fetch) {
-        list->set = calloc(n, sizeof (struct dbw_policykey *));
-        if (!list->set) {
+        int r = list_from_columns(list, cols, policykey_columns_to_dbw);
+        db_result_columns_free(cols);
+        if (r) {
             dbw_list_free(list);
-            policy_key_list_free(dbx_list);
             return NULL;
         }
-        const policy_key_t* dbx_item;
-        while ((dbx_item = policy_key_list_next(dbx_list)) != NULL && list->n < n) {
-            struct dbrow *row = (struct dbrow *)policykey_dbx_to_dbw(dbx_item);
-            if (!row) {
-                dbw_list_free(list);
-                policy_key_list_free(dbx_list);
-                return NULL;
-            }
-            list->set[list->n++] = row;
-        }
-        policy_key_list_free(dbx_list);
     }
-    return list;
+    if (!(list->index = index_new(list, NULL))) {
+        dbw_list_free(list);
+        return NULL;
+    }
+    return list;
+}
+
+void
+dbw_free(struct dbw_db *db)
+{
+    dbw_list_free(db->policies);
+    dbw_list_free(db->zones);
+    dbw_list_free(db->keys);
+    dbw_list_free(db->keystates);
+    dbw_list_free(db->hsmkeys);
+    dbw_list_free(db->policykeys);
+    dbw_list_free(db->keydependencies);
+    free(db);
+}
+
+#define DBW_TABLES 7
+
+/* A table to read, see dbw_read_tables() */
+struct table_read {
+    struct dbw_list *(*read)(db_connection_t *, int, const db_clause_list_t *);
+    int flag;
+    struct dbw_list **list;
+};
+
+/* Tables shared by the threads of dbw_read_parallel() */
+struct parallel_read {
+    db_connection_t *conn;
+    struct table_read *tables;
+    int mask;
+    int next;
+    pthread_mutex_t lock;
+};
+
+/* Read tables on a connection of our own until there are none left. Tables
+ * are left NULL if the connection can not be made or the read fails. */
+static void *
+parallel_read_tables(void *arg)
+{
+    struct parallel_read *pr = arg;
+    db_connection_t *conn = db_connection_new_copy(pr->conn);
+    if (!conn) return NULL;
+    for (;;) {
+        int t = -1;
+        (void)pthread_mutex_lock(&pr->lock);
+        if (pr->next < DBW_TABLES) t = pr->next++;
+        (void)pthread_mutex_unlock(&pr->lock);
+        if (t < 0) break;
+        *pr->tables[t].list = pr->tables[t].read(conn,
+            pr->mask & pr->tables[t].flag, NULL);
+    }
+    db_connection_free(conn);
+    return NULL;
+}
+
+/* Read the tables with several threads, see dbw_parallel_reads(). Each
+ * connection reads in a snapshot of its own, holding db_lock for writing
+ * keeps out the commits of this process so all of them see the same state.
+ * Whatever the threads did not read is read on conn. Returns 0 on success. */
+static int
+dbw_read_parallel(db_connection_t *conn, struct table_read *tables, int mask)
+{
+    pthread_t threads[DBW_TABLES];
+    struct parallel_read pr;
+    int n = parallel_reads < DBW_TABLES ? parallel_reads : DBW_TABLES;
+    int started = 0;
+
+    pr.conn = conn;
+    pr.tables = tables;
+    pr.mask = mask;
+    pr.next = 0;
+    if (pthread_mutex_init(&pr.lock, NULL)) return 1;
+    if (pthread_rwlock_wrlock(&db_lock)) {
+        (void)pthread_mutex_destroy(&pr.lock);
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        if (!pthread_create(&threads[started], NULL, parallel_read_tables, &pr))
+            started++;
+    }
+    for (int i = 0; i < started; i++) {
+        (void)pthread_join(threads[i], NULL);
+    }
+    for (int t = 0; t < DBW_TABLES; t++) {
+        if (*tables[t].list) continue;
+        *tables[t].list = tables[t].read(conn, mask & tables[t].flag, NULL);
+    }
+    (void)pthread_rwlock_unlock(&db_lock);
+    (void)pthread_mutex_destroy(&pr.lock);
+    return 0;
+}
+
+/* Read the tables in mask into db as one consistent state, the others are
+ * left empty. Returns 0 on success. */
+static int
+dbw_read_tables(struct dbw_db *db, db_connection_t *conn, int mask)
+{
+    struct table_read tables[DBW_TABLES] = {
+        {dbw_policies,        DBW_F_POLICY,        &db->policies},
+        {dbw_zones,           DBW_F_ZONE,          &db->zones},
+        {dbw_keys,            DBW_F_KEY,           &db->keys},
+        {dbw_keystates,       DBW_F_KEYSTATE,      &db->keystates},
+        {dbw_hsmkeys,         DBW_F_HSMKEY,        &db->hsmkeys},
+        {dbw_policykeys,      DBW_F_POLICYKEY,     &db->policykeys},
+        {dbw_keydependencies, DBW_F_KEYDEPENDENCY, &db->keydependencies},
+    };
+
+    if (parallel_reads > 1) {
+        if (dbw_read_parallel(conn, tables, mask)) return 1;
+    } else {
+        if (dbw_read_begin(conn)) return 1;
+        for (int t = 0; t < DBW_TABLES; t++) {
+            *tables[t].list = tables[t].read(conn, mask & tables[t].flag, NULL);
+        }
+        dbw_read_end(conn);
+    }
+    return !db->policies || !db->zones || !db->keys || !db->keystates ||
+        !db->hsmkeys || !db->policykeys || !db->keydependencies;
+}
+
+struct dbw_db *
+dbw_fetch_filtered(db_connection_t *conn, int mask)
+{
+    struct dbw_db *db;
+    if (cache_enabled && (db = cache_fetch(conn, NULL, 0, mask))) return db;
+    db = calloc(1, sizeof(struct dbw_db));
+    if (!db) {
+        ods_log_error("[dbw_fetch] Memory allocation failure.");
+        return NULL;
+    }
+
+    db->conn = conn;
+    if (dbw_read_tables(db, conn, mask)) {
+        dbw_free(db);
+        ods_log_error("[dbw_fetch] Failed to read from database.");
+        return NULL;
+    }
+    dbw_merge(db);
+    return db;
+}
+
+struct dbw_db *
+dbw_fetch(db_connection_t *conn)
+{
+    return dbw_fetch_filtered(conn, DBW_F_ALL);
+}
+
+/* Sorted set of unique ids, such as the ids, or parent ids if pidx >= 0,
+ * of the rows in a list. Looking these up beats scanning the list when
+ * handling many zones. */
+struct idset {
+    int *id;
+    size_t n;
+};
+
+static int cmp_ids(const void *l, const void *r) { return cmp_int(*(int const *)l, *(int const *)r); }
+
+static int
+idset_add(struct idset *ids, int id)
+{
+    int *set = realloc(ids->id, (ids->n + 1) * sizeof (int));
+    if (!set) return 1;
+    ids->id = set;
+    ids->id[ids->n++] = id;
+    return 0;
+}
+
+static void
+idset_sort(struct idset *ids)
+{
+    size_t n = 0;
+    if (!ids->n) return;
+    qsort(ids->id, ids->n, sizeof (int), cmp_ids);
+    for (size_t i = 1; i < ids->n; i++) {
+        if (ids->id[i] != ids->id[n]) ids->id[++n] = ids->id[i];
+    }
+    ids->n = n + 1;
+}
+
+static int
+idset_of(struct idset *ids, struct dbw_list *list, int pidx)
+{
+    ids->id = NULL;
+    ids->n = 0;
+    for (size_t i = 0; i < list->n; i++) {
+        int *val = &list->set[i]->id;
+        void *ptr;
+        if (pidx >= 0) get_ref(list->set[i], pidx, &val, &ptr);
+        if (idset_add(ids, *val)) return 1;
+    }
+    idset_sort(ids);
+    return 0;
+}
+
+static int
+idset_has(struct idset *ids, int id)
+{
+    return ids->n && bsearch(&id, ids->id, ids->n, sizeof (int), cmp_ids);
+}
+
+/* Add "field op value" to clause_list. The operator of the first clause in
+ * a list is ignored by the backends. */
+static int
+clause_add_int(db_clause_list_t *clause_list, char const *field,
+    db_clause_type_t type, db_clause_operator_t op, int value)
+{
+    db_clause_t *clause;
+    if (!(clause = db_clause_new())
+        || db_clause_set_field(clause, field)
+        || db_clause_set_type(clause, type)
+        || db_clause_set_operator(clause, op)
+        || db_value_from_int32(db_clause_get_value(clause), value)
+        || db_clause_list_add(clause_list, clause))
+    {
+        db_clause_free(clause);
+        return 1;
+    }
+    return 0;
+}
+
+static int
+clause_add_text(db_clause_list_t *clause_list, char const *field,
+    db_clause_type_t type, db_clause_operator_t op, char const *value)
+{
+    db_clause_t *clause;
+    if (!(clause = db_clause_new())
+        || db_clause_set_field(clause, field)
+        || db_clause_set_type(clause, type)
+        || db_clause_set_operator(clause, op)
+        || db_value_from_text(db_clause_get_value(clause), value)
+        || db_clause_list_add(clause_list, clause))
+    {
+        db_clause_free(clause);
+        return 1;
+    }
+    return 0;
+}
+
+/* Rows per query when reading rows by id or name. Bounded by the size of
+ * the query buffers of the backends. */
+#define DBW_FETCH_BATCH 64
+
+typedef struct dbw_list *(*dbw_table_fn)(db_connection_t *, int,
+    const db_clause_list_t *);
+
+/* Move the rows of from to the end of list and free from */
+static int
+list_append(struct dbw_list *list, struct dbw_list *from)
+{
+    struct dbrow **set;
+    if (from->n) {
+        set = realloc(list->set, (list->n + from->n) * sizeof (struct dbrow *));
+        if (!set) {
+            dbw_list_free(from);
+            return 1;
+        }
+        memcpy(&set[list->n], from->set, from->n * sizeof (struct dbrow *));
+        list->set = set;
+        for (size_t i = 0; list->index && i < from->n; i++) {
+            /* On allocation failure lookups fall back to scanning */
+            if (index_add(list->index, from->set[i])) {
+                index_free(list->index);
+                list->index = NULL;
+            }
+        }
+        list->n += from->n;
+    }
+    index_free(from->index);
+    free(from->set);
+    free(from);
+    return 0;
+}
+
+/* Read the rows of table where field equals one of ids, a batch of ids per
+ * query. */
+static struct dbw_list *
+fetch_any_id(db_connection_t *conn, dbw_table_fn table, char const *field,
+    struct idset *ids)
+{
+    struct dbw_list *list = table(conn, 0, NULL);
+    for (size_t i = 0; list && i < ids->n; i += DBW_FETCH_BATCH) {
+        db_clause_list_t *clause_list = db_clause_list_new();
+        struct dbw_list *part = NULL;
+        for (size_t j = i; clause_list && j < ids->n && j < i + DBW_FETCH_BATCH; j++) {
+            if (clause_add_int(clause_list, field, DB_CLAUSE_EQUAL,
+                    DB_CLAUSE_OPERATOR_OR, ids->id[j]))
+            {
+                db_clause_list_free(clause_list);
+                clause_list = NULL;
+            }
+        }
+        if (clause_list) part = table(conn, 1, clause_list);
+        db_clause_list_free(clause_list);
+        if (!part || list_append(list, part)) {
+            dbw_list_free(list);
+            list = NULL;
+        }
+    }
+    return list;
+}
+
+/* Number of keys referring to hsmkey that belong to other zones than zone */
+static int
+count_foreign_keys(const db_connection_t *conn, struct dbw_hsmkey *hsmkey,
+    struct dbw_zone *zone)
+{
+    size_t count = 0;
+    int r = 1;
+    key_data_t *dbx_obj = key_data_new(conn);
+    db_clause_list_t *clause_list = db_clause_list_new();
+    if (dbx_obj && clause_list
+        && !clause_add_int(clause_list, "hsmKeyId", DB_CLAUSE_EQUAL,
+            DB_CLAUSE_OPERATOR_AND, hsmkey->id)
+        && !clause_add_int(clause_list, "zoneId", DB_CLAUSE_NOT_EQUAL,
+            DB_CLAUSE_OPERATOR_AND, zone->id)
+        && !key_data_count(dbx_obj, clause_list, &count))
+    {
+        hsmkey->foreign_key_count = count;
+        r = 0;
+    }
+    db_clause_list_free(clause_list);
+    key_data_free(dbx_obj);
+    return r;
+}
+
+/* The clause lists generated for a zone grow with the number of keys, the
+ * backends build their queries in fixed size buffers. Zones with an absurd
+ * amount of keys fall back to a full fetch. */
+#define DBW_FETCH_ZONE_MAX_KEYS 64
+
+/* Append the hsmkeys of a policy in state to list, leaving out those with
+ * an id in skip. */
+static int
+fetch_policy_hsmkeys(db_connection_t *conn, struct dbw_list *list,
+    struct idset *skip, int policy_id, int state)
+{
+    db_clause_list_t *clause_list = db_clause_list_new();
+    struct dbw_list *part = NULL;
+    size_t n = 0;
+    if (clause_list
+        && !clause_add_int(clause_list, "policyId", DB_CLAUSE_EQUAL,
+            DB_CLAUSE_OPERATOR_AND, policy_id)
+        && !clause_add_int(clause_list, "state", DB_CLAUSE_EQUAL,
+            DB_CLAUSE_OPERATOR_AND, state))
+    {
+        part = dbw_hsmkeys(conn, 1, clause_list);
+    }
+    db_clause_list_free(clause_list);
+    if (!part) return 1;
+    for (size_t i = 0; i < part->n; i++) {
+        if (idset_has(skip, part->set[i]->id))
+            part->free(part->set[i]);
+        else
+            part->set[n++] = part->set[i];
+    }
+    part->n = n;
+    return list_append(list, part);
+}
+
+/* Read the zone, everything it links to and the hsmkeys of its policy that
+ * are candidates for new keys. Must be called between dbw_read_begin() and
+ * dbw_read_end(). Returns 0 on success. */
+static int
+dbw_fetch_zone_tables(struct dbw_db *db, db_connection_t *conn,
+    char const *zonename, int *fallback)
+{
+    db_clause_list_t *clause_list;
+    struct dbw_zone *zone;
+    struct idset ids = {NULL, 0};
+    int r = 1;
+
+    if (!(clause_list = db_clause_list_new())) return 1;
+    if (clause_add_text(clause_list, "name", DB_CLAUSE_EQUAL,
+            DB_CLAUSE_OPERATOR_AND, zonename)) {
+        db_clause_list_free(clause_list);
+        return 1;
+    }
+    db->zones = dbw_zones(conn, 1, clause_list);
+    db_clause_list_free(clause_list);
+    if (!db->zones) return 1;
+    if (db->zones->n != 1) {
+        /* Unknown zone, leave the other tables empty. */
+        db->policies        = dbw_policies(conn, 0, NULL);
+        db->keys            = dbw_keys(conn, 0, NULL);
+        db->keystates       = dbw_keystates(conn, 0, NULL);
+        db->hsmkeys         = dbw_hsmkeys(conn, 0, NULL);
+        db->policykeys      = dbw_policykeys(conn, 0, NULL);
+        db->keydependencies = dbw_keydependencies(conn, 0, NULL);
+        return 0;
+    }
+    zone = (struct dbw_zone *)db->zones->set[0];
+
+    if (!(clause_list = db_clause_list_new())) return 1;
+    if (clause_add_int(clause_list, "zoneId", DB_CLAUSE_EQUAL,
+            DB_CLAUSE_OPERATOR_AND, zone->id))
+    {
+        db_clause_list_free(clause_list);
+        return 1;
+    }
+    db->keys = dbw_keys(conn, 1, clause_list);
+    db->keydependencies = dbw_keydependencies(conn, 1, clause_list);
+    db_clause_list_free(clause_list);
+    if (!db->keys || !db->keydependencies) return 1;
+    if (db->keys->n > DBW_FETCH_ZONE_MAX_KEYS) {
+        *fallback = 1;
+        return 1;
+    }
+
+    /* Keystates of the zone's keys */
+    if (idset_of(&ids, db->keys, -1)) goto out;
+    if (!(db->keystates = fetch_any_id(conn, dbw_keystates, "keyDataId", &ids)))
+        goto out;
+    free(ids.id);
+
+    /* The hsmkeys in use by the zone, they might belong to a previous
+     * policy. Plus the hsmkeys of the policy that are candidates for new
+     * keys: unused ones and, for policies sharing keys, shared ones. */
+    if (idset_of(&ids, db->keys, 1)) goto out;
+    if (!(db->hsmkeys = fetch_any_id(conn, dbw_hsmkeys, "id", &ids))) goto out;
+    if (fetch_policy_hsmkeys(conn, db->hsmkeys, &ids, zone->policy_id,
+            DBW_HSMKEY_UNUSED)
+        || fetch_policy_hsmkeys(conn, db->hsmkeys, &ids, zone->policy_id,
+            DBW_HSMKEY_SHARED)) goto out;
+
+    /* The zone's policy and the policies of any of the hsmkeys above */
+    free(ids.id);
+    ids.id = NULL;
+    ids.n = 0;
+    if (idset_add(&ids, zone->policy_id)) goto out;
+    for (size_t h = 0; h < db->hsmkeys->n; h++) {
+        if (idset_add(&ids, ((struct dbw_hsmkey *)db->hsmkeys->set[h])->policy_id))
+            goto out;
+    }
+    idset_sort(&ids);
+    if (!(db->policies = fetch_any_id(conn, dbw_policies, "id", &ids))) goto out;
+
+    if (!(clause_list = db_clause_list_new())) goto out;
+    if (clause_add_int(clause_list, "policyId", DB_CLAUSE_EQUAL,
+            DB_CLAUSE_OPERATOR_AND, zone->policy_id))
+    {
+        db_clause_list_free(clause_list);
+        goto out;
+    }
+    db->policykeys = dbw_policykeys(conn, 1, clause_list);
+    db_clause_list_free(clause_list);
+    if (!db->policykeys) goto out;
+
+    /* Shared hsmkeys may be used by keys of zones we did not load. They
+     * must be accounted for so the hsmkey is not released prematurely. */
+    for (size_t h = 0; h < db->hsmkeys->n; h++) {
+        struct dbw_hsmkey *hsmkey = (struct dbw_hsmkey *)db->hsmkeys->set[h];
+        if (hsmkey->state != DBW_HSMKEY_SHARED) continue;
+        if (count_foreign_keys(conn, hsmkey, zone)) goto out;
+    }
+    r = 0;
+out:
+    free(ids.id);
+    return r;
+}
+
+struct dbw_db *
+dbw_fetch_zone(db_connection_t *conn, char const *zonename)
+{
+    int fallback = 0;
+    struct dbw_db *db;
+    if (cache_enabled && (db = cache_fetch(conn, &zonename, 1, 0))) return db;
+    db = calloc(1, sizeof(struct dbw_db));
+    if (!db) {
+        ods_log_error("[dbw_fetch_zone] Memory allocation failure.");
+        return NULL;
+    }
+
+    if (dbw_read_begin(conn)) {
+        ods_log_error("[dbw_fetch_zone] Unable to obtain database read lock.");
+        free(db);
+        return NULL;
+    }
+    db->conn = conn;
+    int r = dbw_fetch_zone_tables(db, conn, zonename, &fallback);
+    dbw_read_end(conn);
+
+    if (fallback) {
+        ods_log_debug("[dbw_fetch_zone] zone %s has too many keys for a "
+            "scoped fetch, reading entire database.", zonename);
+        dbw_free(db);
+        return dbw_fetch(conn);
+    }
+    if (r || !db->policies || !db->zones || !db->keys || !db->keystates ||
+            !db->hsmkeys || !db->policykeys || !db->keydependencies)
+    {
+        dbw_free(db);
+        ods_log_error("[dbw_fetch_zone] Failed to read from database.");
+        return NULL;
+    }
+    if (db->zones->n == 1) db->zone_id = db->zones->set[0]->id;
+    dbw_merge(db);
+    return db;
+}
+
+/* Read the zones with one of names, a batch of names per query */
+static struct dbw_list *
+fetch_zones_by_name(db_connection_t *conn, char const **names, size_t n)
+{
+    struct dbw_list *list = dbw_zones(conn, 0, NULL);
+    for (size_t i = 0; list && i < n; i += DBW_FETCH_BATCH) {
+        db_clause_list_t *clause_list = db_clause_list_new();
+        struct dbw_list *part = NULL;
+        for (size_t j = i; clause_list && j < n && j < i + DBW_FETCH_BATCH; j++) {
+            if (clause_add_text(clause_list, "name", DB_CLAUSE_EQUAL,
+                    DB_CLAUSE_OPERATOR_OR, names[j]))
+            {
+                db_clause_list_free(clause_list);
+                clause_list = NULL;
+            }
+        }
+        if (clause_list) part = dbw_zones(conn, 1, clause_list);
+        db_clause_list_free(clause_list);
+        if (!part || list_append(list, part)) {
+            dbw_list_free(list);
+            list = NULL;
+        }
+    }
+    return list;
+}
+
+/* Set foreign_key_count of hsmkey to the number of keys using it that are
+ * not in keys. */
+static int
+count_foreign_keys_of(const db_connection_t *conn, struct dbw_hsmkey *hsmkey,
+    struct dbw_list *keys)
+{
+    size_t count = 0;
+    int r = 1;
+    key_data_t *dbx_obj = key_data_new(conn);
+    db_clause_list_t *clause_list = db_clause_list_new();
+    if (dbx_obj && clause_list
+        && !clause_add_int(clause_list, "hsmKeyId", DB_CLAUSE_EQUAL,
+            DB_CLAUSE_OPERATOR_AND, hsmkey->id)
+        && !key_data_count(dbx_obj, clause_list, &count))
+    {
+        for (size_t k = 0; k < keys->n; k++) {
+            if (((struct dbw_key *)keys->set[k])->hsmkey_id == hsmkey->id)
+                count--;
+        }
+        hsmkey->foreign_key_count = count;
+        r = 0;
+    }
+    db_clause_list_free(clause_list);
+    key_data_free(dbx_obj);
+    return r;
+}
+
+/* Like dbw_fetch_zone_tables() for all zones in names. Queries are per
+ * table for all zones at once rather than per zone. Tables not in mask
+ * are left empty, the zone table is always read. */
+static int
+dbw_fetch_zones_tables(struct dbw_db *db, db_connection_t *conn,
+    char const **names, size_t n, int mask)
+{
+    struct idset zones = {NULL, 0}, keys = {NULL, 0}, hsmkeys = {NULL, 0};
+    struct idset policies = {NULL, 0}, other = {NULL, 0}, none = {NULL, 0};
+    struct dbw_list *list;
+    int r = 1;
+
+#define MASKED(F, IDS) ((mask & (F)) ? (IDS) : &none)
+    if (!(db->zones = fetch_zones_by_name(conn, names, n))) return 1;
+    if (idset_of(&zones, db->zones, -1) || idset_of(&policies, db->zones, 0))
+        goto out;
+    if (!(db->keys = fetch_any_id(conn, dbw_keys, "zoneId",
+            MASKED(DBW_F_KEY, &zones)))) goto out;
+    if (!(db->keydependencies = fetch_any_id(conn, dbw_keydependencies,
+            "zoneId", MASKED(DBW_F_KEYDEPENDENCY, &zones)))) goto out;
+    if (idset_of(&keys, db->keys, -1)) goto out;
+    if (!(db->keystates = fetch_any_id(conn, dbw_keystates, "keyDataId",
+            MASKED(DBW_F_KEYSTATE, &keys)))) goto out;
+
+    /* All hsmkeys of the policies, plus those in use by the zones that
+     * belong to other policies */
+    if (!(db->hsmkeys = fetch_any_id(conn, dbw_hsmkeys, "policyId",
+            MASKED(DBW_F_HSMKEY, &policies)))) goto out;
+    if (idset_of(&hsmkeys, db->hsmkeys, -1)) goto out;
+    for (size_t k = 0; k < db->keys->n; k++) {
+        int hsmkey_id = ((struct dbw_key *)db->keys->set[k])->hsmkey_id;
+        if (idset_has(&hsmkeys, hsmkey_id)) continue;
+        if (idset_add(&other, hsmkey_id)) goto out;
+    }
+    idset_sort(&other);
+    if (!(list = fetch_any_id(conn, dbw_hsmkeys, "id",
+            MASKED(DBW_F_HSMKEY, &other)))
+        || list_append(db->hsmkeys, list)) goto out;
+
+    /* The zones' policies and the policies of any of the hsmkeys above */
+    for (size_t h = 0; h < db->hsmkeys->n; h++) {
+        if (idset_add(&policies, ((struct dbw_hsmkey *)db->hsmkeys->set[h])->policy_id))
+            goto out;
+    }
+    idset_sort(&policies);
+    if (!(db->policies = fetch_any_id(conn, dbw_policies, "id",
+            MASKED(DBW_F_POLICY, &policies)))) goto out;
+    free(policies.id);
+    if (idset_of(&policies, db->zones, 0)) goto out;
+    if (!(db->policykeys = fetch_any_id(conn, dbw_policykeys, "policyId",
+            MASKED(DBW_F_POLICYKEY, &policies)))) goto out;
+#undef MASKED
+
+    /* Shared hsmkeys may be used by keys of zones we did not load */
+    for (size_t h = 0; h < db->hsmkeys->n; h++) {
+        struct dbw_hsmkey *hsmkey = (struct dbw_hsmkey *)db->hsmkeys->set[h];
+        if (hsmkey->state != DBW_HSMKEY_SHARED) continue;
+        if (count_foreign_keys_of(conn, hsmkey, db->keys)) goto out;
+    }
+    r = 0;
+out:
+    free(zones.id);
+    free(keys.id);
+    free(hsmkeys.id);
+    free(policies.id);
+    free(other.id);
+    return r;
+}
+
+/* dbw_fetch_zones() without taking the path of dbw_fetch_zone() for a
+ * single zone, names no longer in the database are simply not read. */
+static struct dbw_db *
+fetch_zones(db_connection_t *conn, char const **zonenames, size_t n, int mask)
+{
+    struct dbw_db *db;
+    if (cache_enabled && (db = cache_fetch(conn, zonenames, n, 0))) return db;
+    db = calloc(1, sizeof(struct dbw_db));
+    if (!db) {
+        ods_log_error("[dbw_fetch_zones] Memory allocation failure.");
+        return NULL;
+    }
+    if (dbw_read_begin(conn)) {
+        ods_log_error("[dbw_fetch_zones] Unable to obtain database read lock.");
+        free(db);
+        return NULL;
+    }
+    db->conn = conn;
+    int r = dbw_fetch_zones_tables(db, conn, zonenames, n, mask);
+    dbw_read_end(conn);
+    if (r || !db->policies || !db->zones || !db->keys || !db->keystates ||
+            !db->hsmkeys || !db->policykeys || !db->keydependencies)
+    {
+        dbw_free(db);
+        ods_log_error("[dbw_fetch_zones] Failed to read from database.");
+        return NULL;
+    }
+    dbw_merge(db);
+    return db;
+}
+
+struct dbw_db *
+dbw_fetch_zones(db_connection_t *conn, char const **zonenames, size_t n,
+    int mask)
+{
+    if (n == 1 && mask == DBW_F_ALL) return dbw_fetch_zone(conn, zonenames[0]);
+    return fetch_zones(conn, zonenames, n, mask);
+}
+
+/* Literal part of a fnmatch(3) pattern up to its first special character */
+static size_t
+pattern_prefix(char const *pattern)
+{
+    size_t len = strcspn(pattern, "*?[\\");
+    return len;
+}
+
+/* Add clauses limiting zone names to those starting with the first len
+ * characters of prefix. */
+static int
+clause_add_prefix(db_clause_list_t *clause_list, char const *prefix,
+    size_t len)
+{
+    char *upper;
+    int r;
+
+    if (!len) return 0;
+    if (!(upper = strndup(prefix, len))) return 1;
+    r = clause_add_text(clause_list, "name", DB_CLAUSE_GREATER_OR_EQUAL,
+        DB_CLAUSE_OPERATOR_AND, upper);
+    /* Names before prefix with its last character incremented. Past the
+     * maximum only the lower bound applies. */
+    while (!r && len && (unsigned char)upper[len-1] == 0xFF) upper[--len] = '\0';
+    if (!r && len) {
+        upper[len-1]++;
+        r = clause_add_text(clause_list, "name", DB_CLAUSE_LESS_THEN,
+            DB_CLAUSE_OPERATOR_AND, upper);
+    }
+    free(upper);
+    return r;
+}
+
+static int cmp_names(const void *l, const void *r) { return strcmp(*(char * const *)l, *(char * const *)r); }
+
+ssize_t
+dbw_zone_names(db_connection_t *conn, struct dbw_zone_filter const *filter,
+    char ***names)
+{
+    db_clause_list_t *clause_list;
+    struct dbw_list *zones = NULL, *policies = NULL;
+    ssize_t n = 0;
+    int r = 1;
+
+    *names = NULL;
+    if (!(clause_list = db_clause_list_new())) return -1;
+    if (dbw_read_begin(conn)) {
+        db_clause_list_free(clause_list);
+        return -1;
+    }
+    if (filter->policy) {
+        db_clause_list_t *by_name = db_clause_list_new();
+        if (by_name && !clause_add_text(by_name, "name", DB_CLAUSE_EQUAL,
+                DB_CLAUSE_OPERATOR_AND, filter->policy))
+        {
+            policies = dbw_policies(conn, 1, by_name);
+        }
+        db_clause_list_free(by_name);
+        if (!policies) goto out;
+        if (!policies->n) {
+            /* Unknown policy, no zones */
+            r = 0;
+            goto out;
+        }
+        if (clause_add_int(clause_list, "policyId", DB_CLAUSE_EQUAL,
+                DB_CLAUSE_OPERATOR_AND, policies->set[0]->id)) goto out;
+    }
+    if (filter->after && clause_add_text(clause_list, "name",
+            DB_CLAUSE_GREATER_THEN, DB_CLAUSE_OPERATOR_AND, filter->after))
+        goto out;
+    if (filter->pattern && clause_add_prefix(clause_list, filter->pattern,
+            pattern_prefix(filter->pattern)))
+        goto out;
+    if (!(zones = dbw_zones(conn, 1, clause_list))) goto out;
+    if (zones->n && !(*names = calloc(zones->n, sizeof (char *)))) goto out;
+    for (size_t z = 0; z < zones->n; z++) {
+        struct dbw_zone *zone = (struct dbw_zone *)zones->set[z];
+        if (filter->pattern && fnmatch(filter->pattern, zone->name, 0)) continue;
+        /* Take the name, the row is freed below */
+        (*names)[n++] = zone->name;
+        zone->name = NULL;
+    }
+    if (n) qsort(*names, n, sizeof (char *), cmp_names);
+    r = 0;
+out:
+    dbw_read_end(conn);
+    db_clause_list_free(clause_list);
+    dbw_list_free(zones);
+    dbw_list_free(policies);
+    if (r) {
+        dbw_names_free(*names, n);
+        *names = NULL;
+        return -1;
+    }
+    return n;
+}
+
+void
+dbw_names_free(char **names, size_t n)
+{
+    if (!names) return;
+    for (size_t i = 0; i < n; i++) free(names[i]);
+    free(names);
+}
+
+int
+dbw_foreach_zone(db_connection_t *conn, struct dbw_zone_filter const *filter,
+    int mask, size_t limit, int (*cb)(struct dbw_db *db, struct dbw_zone *zone,
+    void *arg), void *arg, char **next)
+{
+    char **names;
+    ssize_t n = dbw_zone_names(conn, filter, &names);
+    size_t end;
+    int r = 0;
+
+    if (next) *next = NULL;
+    if (n < 0) return 1;
+    end = (limit && limit < (size_t)n) ? limit : (size_t)n;
+    for (size_t i = 0; !r && i < end; i += DBW_FETCH_BATCH) {
+        size_t page = end - i < DBW_FETCH_BATCH ? end - i : DBW_FETCH_BATCH;
+        struct dbw_db *db = fetch_zones(conn, (char const **)&names[i], page,
+            mask);
+        if (!db) {
+            r = 1;
+            break;
+        }
+        for (size_t z = i; !r && z < i + page; z++) {
+            struct dbw_zone *zone = dbw_get_zone(db, names[z]);
+            /* Deleted since its name was read */
+            if (!zone) continue;
+            r = cb(db, zone, arg);
+        }
+        dbw_free(db);
+    }
+    if (!r && end < (size_t)n && next && end && !(*next = strdup(names[end-1])))
+        r = 1;
+    dbw_names_free(names, n);
+    return r;
+}
+
+/* Rows per statement when verifying revisions and deleting. Bounded by the
+ * size of the query buffers of the backends. */
+#define DBW_COMMIT_BATCH 64
+
+/* Object with just the id and optionally the rev field of table. Enough to
+ * read revisions and to delete rows by id. */
+static db_object_t *
+dbw_object_new(const db_connection_t *conn, char const *table, int with_rev)
+{
+    db_object_field_list_t *object_field_list;
+    db_object_field_t *object_field;
+    db_object_t *object;
+
+    if (!(object = db_object_new())
+        || db_object_set_connection(object, conn)
+        || db_object_set_table(object, table)
+        || db_object_set_primary_key_name(object, "id")
+        || !(object_field_list = db_object_field_list_new()))
+    {
+        db_object_free(object);
+        return NULL;
+    }
+    if (!(object_field = db_object_field_new())
+        || db_object_field_set_name(object_field, "id")
+        || db_object_field_set_type(object_field, DB_TYPE_PRIMARY_KEY)
+        || db_object_field_list_add(object_field_list, object_field))
+    {
+        db_object_field_free(object_field);
+        db_object_field_list_free(object_field_list);
+        db_object_free(object);
+        return NULL;
+    }
+    if (with_rev && (!(object_field = db_object_field_new())
+        || db_object_field_set_name(object_field, "rev")
+        || db_object_field_set_type(object_field, DB_TYPE_REVISION)
+        || db_object_field_list_add(object_field_list, object_field)))
+    {
+        db_object_field_free(object_field);
+        db_object_field_list_free(object_field_list);
+        db_object_free(object);
+        return NULL;
+    }
+    if (db_object_set_object_field_list(object, object_field_list)) {
+        db_object_field_list_free(object_field_list);
+        db_object_free(object);
+        return NULL;
+    }
+    return object;
+}
+
+/* Rows per multi-row insert. A zone row has 19 values, this keeps the
+ * statement within the query buffers and below the 999 variables an older
+ * SQLite allows. */
+#define DBW_INSERT_BATCH 32
+
+/* Collect the next max rows from list, starting at *i, that have the given
+ * dirty state. Returns the number of rows in batch. */
+static size_t
+next_batch(struct dbw_list *list, size_t *i, int dirty, struct dbrow **batch,
+    size_t max)
+{
+    size_t n = 0;
+    for (; *i < list->n && n < max; (*i)++) {
+        if (list->set[*i]->dirty == dirty) batch[n++] = list->set[*i];
+    }
+    return n;
+}
+
+/* Clause list matching any row with the id of one of the rows in batch */
+static db_clause_list_t *
+clauses_batch(struct dbrow **batch, size_t n)
+{
+    db_clause_list_t *clause_list = db_clause_list_new();
+    if (!clause_list) return NULL;
+    for (size_t i = 0; i < n; i++) {
+        if (clause_add_int(clause_list, "id", DB_CLAUSE_EQUAL,
+                DB_CLAUSE_OPERATOR_OR, batch[i]->id))
+        {
+            db_clause_list_free(clause_list);
+            return NULL;
+        }
+    }
+    return clause_list;
+}
+
+/* Compare the revisions in the database against those of the rows in batch.
+ * Returns 0 if all rows are present and unchanged. */
+static int
+verify_batch(const db_object_t *object, struct dbrow **batch, size_t n)
+{
+    db_clause_list_t *clause_list;
+    db_result_columns_t *cols;
+    size_t found = 0, rows;
+    int r = 0;
+
+    if (!(clause_list = clauses_batch(batch, n))) return 1;
+    cols = db_object_read_columns(object, NULL, clause_list);
+    db_clause_list_free(clause_list);
+    if (!cols) return 1;
+    rows = db_result_columns_rows(cols);
+    for (size_t row = 0; !r && row < rows; row++) {
+        int id, rev;
+        size_t i;
+        id = colint(cols, row, 0);
+        rev = colint(cols, row, 1);
+        for (i = 0; i < n && batch[i]->id != id; i++);
+        if (i == n) continue;
+        found++;
+        if (batch[i]->revision != rev) {
+            ods_log_debug("[dbw_verify_revisions] collision detected on id %d", id);
+            r = 1;
+        }
+    }
+    db_result_columns_free(cols);
+    if (!r && found != n) {
+        ods_log_debug("[dbw_verify_revisions] collision detected, record removed");
+        r = 1;
+    }
+    return r;
+}
+
+static int
+dbw_verify_list_revisions(const db_connection_t *conn, struct dbw_list *list)
+{
+    struct dbrow *batch[DBW_COMMIT_BATCH];
+    db_object_t *object;
+    size_t i = 0, n;
+    int r = 0;
+
+    if (!(object = dbw_object_new(conn, list->table, 1))) return 1;
+    while (!r && (n = next_batch(list, &i, DBW_UPDATE, batch,
+            DBW_COMMIT_BATCH))) {
+        r = verify_batch(object, batch, n);
+    }
+    db_object_free(object);
+    return r;
+}
+
+static int
+dbw_verify_revisions(struct dbw_db *db)
+{
+    int r = 0;
+    ods_log_debug("[dbw_verify_revisions] verifying policies");
+    r |= dbw_verify_list_revisions(db->conn, db->policies);
+    ods_log_debug("[dbw_verify_revisions] verifying policykeys");
+    r |= dbw_verify_list_revisions(db->conn, db->policykeys);
+    ods_log_debug("[dbw_verify_revisions] verifying zones");
+    r |= dbw_verify_list_revisions(db->conn, db->zones);
+    ods_log_debug("[dbw_verify_revisions] verifying hsmkeys");
+    r |= dbw_verify_list_revisions(db->conn, db->hsmkeys);
+    ods_log_debug("[dbw_verify_revisions] verifying keys");
+    r |= dbw_verify_list_revisions(db->conn, db->keys);
+    ods_log_debug("[dbw_verify_revisions] verifying keystates");
+    r |= dbw_verify_list_revisions(db->conn, db->keystates);
+    ods_log_debug("[dbw_verify_revisions] verifying keydependencies");
+    r |= dbw_verify_list_revisions(db->conn, db->keydependencies);
+    return r;
+}
+
+/* Delete all rows of list marked DBW_DELETE, DBW_COMMIT_BATCH per query */
+static int
+dbw_delete_list(const db_connection_t *conn, struct dbw_list *list)
+{
+    struct dbrow *batch[DBW_COMMIT_BATCH];
+    db_clause_list_t *clause_list;
+    db_object_t *object = NULL;
+    size_t i = 0, n;
+    int r = 0;
+
+    while (!r && (n = next_batch(list, &i, DBW_DELETE, batch,
+            DBW_COMMIT_BATCH))) {
+        if (!object && !(object = dbw_object_new(conn, list->table, 0))) {
+            return 1;
+        }
+        if (!(clause_list = clauses_batch(batch, n))) {
+            r = 1;
+            break;
+        }
+        r = db_object_delete(object, clause_list);
+        db_clause_list_free(clause_list);
+        /* TODO: if successful, DELETED rows will be clean and dbw_db
+         * structure will not be safe to reuse. We should remove these items
+         * completely (see lookahead_cmd.c) */
+        while (!r && n) batch[--n]->dirty = DBW_CLEAN;
+    }
+    db_object_free(object);
+    return r;
+}
+
+/* Insert zones with a single statement. The database picks the ids, they
+ * are read back by name afterwards. */
+static int
+dbw_zone_insert(const db_connection_t *dbconn, struct dbrow **rows, size_t n)
+{
+    zone_db_t *dbx_objs[DBW_INSERT_BATCH];
+    zone_list_db_t *dbx_list;
+    const zone_db_t *dbx_item;
+    db_clause_list_t *clause_list;
+    size_t i, found = 0;
+    int r = 0;
+
+    if (n > DBW_INSERT_BATCH) return 1;
+    for (i = 0; i < n; i++) {
+        if (!(dbx_objs[i] = zone_db_new(dbconn))) {
+            while (i) zone_db_free(dbx_objs[--i]);
+            return 1;
+        }
+        dbw_zone_to_dbx(dbx_objs[i], (struct dbw_zone *)rows[i]);
+    }
+    r = zone_db_create_many(dbx_objs, n);
+    for (i = 0; i < n; i++) zone_db_free(dbx_objs[i]);
+    if (r) return r;
+
+    if (!(clause_list = db_clause_list_new())) return 1;
+    for (i = 0; i < n; i++) {
+        if (clause_add_text(clause_list, "name", DB_CLAUSE_EQUAL,
+                DB_CLAUSE_OPERATOR_OR, ((struct dbw_zone *)rows[i])->name))
+        {
+            db_clause_list_free(clause_list);
+            return 1;
+        }
+    }
+    dbx_list = zone_list_db_new(dbconn);
+    if (!dbx_list || zone_list_db_get_by_clauses(dbx_list, clause_list)) {
+        zone_list_db_free(dbx_list);
+        db_clause_list_free(clause_list);
+        return 1;
+    }
+    db_clause_list_free(clause_list);
+    while ((dbx_item = zone_list_db_next(dbx_list))) {
+        for (i = 0; i < n; i++) {
+            if (strcmp(((struct dbw_zone *)rows[i])->name, dbx_item->name)) continue;
+            rows[i]->id = dbxvalue2int(&dbx_item->id);
+            found++;
+            break;
+        }
+    }
+    zone_list_db_free(dbx_list);
+    return found != n;
+}
+
+static int
+dbw_commit_list(const db_connection_t *conn, struct dbw_list *list)
+{
+    if (dbw_delete_list(conn, list)) return 1;
+    if (list->insert) {
+        struct dbrow *batch[DBW_INSERT_BATCH];
+        size_t i = 0, n;
+        while ((n = next_batch(list, &i, DBW_INSERT, batch, DBW_INSERT_BATCH))) {
+            int r = list->insert(conn, batch, n);
+            if (r) return r;
+            while (n) batch[--n]->dirty = DBW_CLEAN;
+        }
+    }
+    for (size_t i = 0; i < list->n; i++) {
+        struct dbrow *row = list->set[i];
+        if (!row->dirty) continue;
+        int r = list->update(conn, row);
+        if (r) return r;
+        row->dirty = DBW_CLEAN;
+    }
+    return 0;
+}
+
+/**
+ *  STATE CACHE
+ *
+ * The cache holds all tables in memory. Its rows are not linked to each
+ * other and each table is sorted on id. Fetches get private copies of the
+ * rows they need, linked like they would be when read from the database.
+ * Only the fetch and commit functions touch the cache, always with
+ * cache_lock held.
+ *
+ * Rows committed by dbw_commit() are written through. Its writes are left
+ * out of the write counter of the db_connection layer, any other write, by
+ * dbx objects or another connection, leaves the counter ahead of the cache
+ * and it is reloaded on the next fetch. Other processes writing to the
+ * database are not counted. Those changes are found by comparing the
+ * revision of every row with the database now and then.
+ */
+
+/* Seconds between comparing the revisions of all cached rows */
+#define DBW_CACHE_VERIFY_INTERVAL 60
+
+/* Tables of db in the order they are committed */
+static void
+db_lists(struct dbw_db *db, struct dbw_list *lists[DBW_TABLES])
+{
+    lists[0] = db->policies;
+    lists[1] = db->policykeys;
+    lists[2] = db->zones;
+    lists[3] = db->hsmkeys;
+    lists[4] = db->keys;
+    lists[5] = db->keystates;
+    lists[6] = db->keydependencies;
+}
+
+/* Position of the row with id in a cache table, or where it would go */
+static size_t
+cache_find(struct dbw_list *list, int id)
+{
+    size_t lo = 0, hi = list->n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (list->set[mid]->id < id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static struct dbrow *
+cache_get(struct dbw_list *list, int id)
+{
+    size_t i = cache_find(list, id);
+    if (i < list->n && list->set[i]->id == id) return list->set[i];
+    return NULL;
+}
+
+/* Reverse index from hsmkeys to the zones using them: the number of cached
+ * keys per hsmkey and zone, sorted by hsmkey and zone. With shared keys one
+ * hsmkey may be in use by thousands of zones, this finds them without
+ * walking all keys. Maintained along with the cache under cache_lock. */
+struct hsmkey_use {
+    int hsmkey_id;
+    int zone_id;
+    int count;
+};
+static struct hsmkey_use *cache_uses = NULL;
+static size_t cache_uses_n = 0;
+
+static int
+cmp_uses(const void *a, const void *b)
+{
+    const struct hsmkey_use *x = a, *y = b;
+    if (x->hsmkey_id != y->hsmkey_id) return x->hsmkey_id < y->hsmkey_id ? -1 : 1;
+    if (x->zone_id != y->zone_id) return x->zone_id < y->zone_id ? -1 : 1;
+    return 0;
+}
+
+/* Position of the first use of hsmkey_id by zone_id or a later zone */
+static size_t
+uses_find(int hsmkey_id, int zone_id)
+{
+    struct hsmkey_use use = {hsmkey_id, zone_id, 0};
+    size_t lo = 0, hi = cache_uses_n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cmp_uses(&cache_uses[mid], &use) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Add delta keys to the uses of hsmkey_id by zone_id */
+static int
+uses_add(int hsmkey_id, int zone_id, int delta)
+{
+    size_t i = uses_find(hsmkey_id, zone_id);
+    if (i < cache_uses_n && cache_uses[i].hsmkey_id == hsmkey_id
+        && cache_uses[i].zone_id == zone_id)
+    {
+        cache_uses[i].count += delta;
+        if (cache_uses[i].count > 0) return 0;
+        memmove(&cache_uses[i], &cache_uses[i+1],
+            (cache_uses_n - i - 1) * sizeof (struct hsmkey_use));
+        cache_uses_n--;
+        return 0;
+    }
+    if (delta <= 0) return 0;
+    struct hsmkey_use *uses = realloc(cache_uses,
+        (cache_uses_n + 1) * sizeof (struct hsmkey_use));
+    if (!uses) return 1;
+    cache_uses = uses;
+    memmove(&cache_uses[i+1], &cache_uses[i],
+        (cache_uses_n - i) * sizeof (struct hsmkey_use));
+    cache_uses[i].hsmkey_id = hsmkey_id;
+    cache_uses[i].zone_id = zone_id;
+    cache_uses[i].count = delta;
+    cache_uses_n++;
+    return 0;
+}
+
+static void
+uses_free(void)
+{
+    free(cache_uses);
+    cache_uses = NULL;
+    cache_uses_n = 0;
+}
+
+/* Build the reverse index from the keys in the cache */
+static int
+uses_load(struct dbw_list *keys)
+{
+    size_t n = 0;
+    uses_free();
+    if (!keys->n) return 0;
+    if (!(cache_uses = calloc(keys->n, sizeof (struct hsmkey_use)))) return 1;
+    for (size_t k = 0; k < keys->n; k++) {
+        struct dbw_key *key = (struct dbw_key *)keys->set[k];
+        cache_uses[k].hsmkey_id = key->hsmkey_id;
+        cache_uses[k].zone_id = key->zone_id;
+        cache_uses[k].count = 1;
+    }
+    qsort(cache_uses, keys->n, sizeof (struct hsmkey_use), cmp_uses);
+    for (size_t k = 0; k < keys->n; k++) {
+        if (n && !cmp_uses(&cache_uses[n-1], &cache_uses[k]))
+            cache_uses[n-1].count++;
+        else
+            cache_uses[n++] = cache_uses[k];
+    }
+    cache_uses_n = n;
+    return 0;
+}
+
+/* Index of the rows of a cache table by parent: the parent id (int0) and
+ * id of every row, sorted. Finds the keys and dependencies of a zone, the
+ * keystates of a key and the hsmkeys and policykeys of a policy without
+ * walking whole tables. Kept for the tables in cache_by_parent, maintained
+ * along with the cache under cache_lock. */
+struct cache_ref {
+    int parent_id;
+    int id;
+};
+struct cache_refs {
+    struct cache_ref *set;
+    size_t n;
+};
+static struct cache_refs cache_children[DBW_TABLES];
+/* Tables in the order of db_lists() that have a cache_children index */
+static const int cache_by_parent[DBW_TABLES] = {0, 1, 0, 1, 1, 1, 1};
+#define CACHE_POLICYKEYS 1
+#define CACHE_HSMKEYS 3
+#define CACHE_KEYS 4
+#define CACHE_KEYSTATES 5
+#define CACHE_KEYDEPENDENCIES 6
+
+/* Zones of the cache sorted by name */
+static struct dbrow **cache_zone_names = NULL;
+static size_t cache_zone_names_n = 0;
+
+static int
+cmp_refs(const void *a, const void *b)
+{
+    const struct cache_ref *x = a, *y = b;
+    if (x->parent_id != y->parent_id) return x->parent_id < y->parent_id ? -1 : 1;
+    if (x->id != y->id) return x->id < y->id ? -1 : 1;
+    return 0;
+}
+
+/* Position of the first ref of parent_id to id or a later id */
+static size_t
+refs_find(struct cache_refs *refs, int parent_id, int id)
+{
+    struct cache_ref ref = {parent_id, id};
+    size_t lo = 0, hi = refs->n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cmp_refs(&refs->set[mid], &ref) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static int
+refs_add(struct cache_refs *refs, int parent_id, int id)
+{
+    size_t i = refs_find(refs, parent_id, id);
+    if (i < refs->n && refs->set[i].parent_id == parent_id
+        && refs->set[i].id == id) return 0;
+    struct cache_ref *set = realloc(refs->set,
+        (refs->n + 1) * sizeof (struct cache_ref));
+    if (!set) return 1;
+    refs->set = set;
+    memmove(&refs->set[i+1], &refs->set[i],
+        (refs->n - i) * sizeof (struct cache_ref));
+    refs->set[i].parent_id = parent_id;
+    refs->set[i].id = id;
+    refs->n++;
+    return 0;
+}
+
+static void
+refs_del(struct cache_refs *refs, int parent_id, int id)
+{
+    size_t i = refs_find(refs, parent_id, id);
+    if (i == refs->n || refs->set[i].parent_id != parent_id
+        || refs->set[i].id != id) return;
+    memmove(&refs->set[i], &refs->set[i+1],
+        (refs->n - i - 1) * sizeof (struct cache_ref));
+    refs->n--;
+}
+
+static int
+refs_load(struct cache_refs *refs, struct dbw_list *list)
+{
+    refs->n = 0;
+    if (!list->n) return 0;
+    if (!(refs->set = calloc(list->n, sizeof (struct cache_ref)))) return 1;
+    for (size_t i = 0; i < list->n; i++) {
+        refs->set[i].parent_id = list->set[i]->int0;
+        refs->set[i].id = list->set[i]->id;
+    }
+    qsort(refs->set, list->n, sizeof (struct cache_ref), cmp_refs);
+    refs->n = list->n;
+    return 0;
 }
 
-void
-dbw_free(struct dbw_db *db)
+static int
+cmp_zone_names(const void *a, const void *b)
 {
-    dbw_list_free(db->policies);
-    dbw_list_free(db->zones);
-    dbw_list_free(db->keys);
-    dbw_list_free(db->keystates);
-    dbw_list_free(db->hsmkeys);
-    dbw_list_free(db->policykeys);
-    dbw_list_free(db->keydependencies);
-    free(db);
+    return strcmp((*(struct dbw_zone * const *)a)->name,
+        (*(struct dbw_zone * const *)b)->name);
 }
 
-struct dbw_db *
-dbw_fetch_filtered(db_connection_t *conn, int mask)
+/* Position of the zone called name in cache_zone_names, or where it would
+ * go */
+static size_t
+zone_names_find(char const *name)
+{
+    size_t lo = 0, hi = cache_zone_names_n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strcmp(((struct dbw_zone *)cache_zone_names[mid])->name, name) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static struct dbw_zone *
+zone_names_get(char const *name)
+{
+    size_t i = zone_names_find(name);
+    if (i < cache_zone_names_n
+        && !strcmp(((struct dbw_zone *)cache_zone_names[i])->name, name))
+    {
+        return (struct dbw_zone *)cache_zone_names[i];
+    }
+    return NULL;
+}
+
+/* Put zone at its place in cache_zone_names, replacing old if set */
+static int
+zone_names_set(struct dbw_zone *old, struct dbw_zone *zone)
+{
+    size_t i;
+    if (old) {
+        i = zone_names_find(old->name);
+        if (i < cache_zone_names_n && cache_zone_names[i] == (struct dbrow *)old) {
+            memmove(&cache_zone_names[i], &cache_zone_names[i+1],
+                (cache_zone_names_n - i - 1) * sizeof (struct dbrow *));
+            cache_zone_names_n--;
+        }
+    }
+    if (!zone) return 0;
+    struct dbrow **set = realloc(cache_zone_names,
+        (cache_zone_names_n + 1) * sizeof (struct dbrow *));
+    if (!set) return 1;
+    cache_zone_names = set;
+    i = zone_names_find(zone->name);
+    memmove(&cache_zone_names[i+1], &cache_zone_names[i],
+        (cache_zone_names_n - i) * sizeof (struct dbrow *));
+    cache_zone_names[i] = (struct dbrow *)zone;
+    cache_zone_names_n++;
+    return 0;
+}
+
+static void
+indices_free(void)
+{
+    for (int t = 0; t < DBW_TABLES; t++) {
+        free(cache_children[t].set);
+        cache_children[t].set = NULL;
+        cache_children[t].n = 0;
+    }
+    free(cache_zone_names);
+    cache_zone_names = NULL;
+    cache_zone_names_n = 0;
+}
+
+/* Build the indices of the cache tables in db */
+static int
+indices_load(struct dbw_db *db)
+{
+    struct dbw_list *lists[DBW_TABLES];
+
+    indices_free();
+    db_lists(db, lists);
+    for (int t = 0; t < DBW_TABLES; t++) {
+        if (cache_by_parent[t] && refs_load(&cache_children[t], lists[t]))
+            return 1;
+    }
+    if (!db->zones->n) return 0;
+    if (!(cache_zone_names = malloc(db->zones->n * sizeof (struct dbrow *))))
+        return 1;
+    memcpy(cache_zone_names, db->zones->set,
+        db->zones->n * sizeof (struct dbrow *));
+    cache_zone_names_n = db->zones->n;
+    qsort(cache_zone_names, cache_zone_names_n, sizeof (struct dbrow *),
+        cmp_zone_names);
+    return 0;
+}
+
+static void
+cache_drop(void)
+{
+    if (cache) dbw_free(cache);
+    cache = NULL;
+    uses_free();
+    indices_free();
+}
+
+/* Read all tables into the cache. Caller must hold cache_lock for writing. */
+static int
+cache_load(db_connection_t *conn)
 {
+    struct dbw_list *lists[DBW_TABLES];
+    /* Counted before reading: later writes may or may not be seen */
+    unsigned long writes = db_connection_writes();
     struct dbw_db *db = calloc(1, sizeof(struct dbw_db));
-    if (!db) {
-        ods_log_error("[dbw_fetch] Memory allocation failure.");
-        return NULL;
+    if (!db) return 1;
+
+    if (dbw_read_tables(db, conn, DBW_F_ALL)) {
+        dbw_free(db);
+        return 1;
+    }
+    db_lists(db, lists);
+    for (int i = 0; i < DBW_TABLES; i++) {
+        index_free(lists[i]->index);
+        lists[i]->index = NULL;
+        sort_by_id(lists[i]);
+    }
+    cache_drop();
+    if (uses_load(db->keys) || indices_load(db)) {
+        uses_free();
+        indices_free();
+        dbw_free(db);
+        return 1;
     }
+    cache = db;
+    cache_writes = writes;
+    cache_verified = time(NULL);
+    ods_log_debug("[dbw_cache] loaded %lu zones, %lu keys",
+        (unsigned long)db->zones->n, (unsigned long)db->keys->n);
+    return 0;
+}
 
-    if (pthread_rwlock_rdlock(&db_lock)) {
-        ods_log_error("[dbw_fetch] Unable to obtain database read lock.");
-        free(db);
-        return NULL;
+/* Compare the revision of every row in a cache table with the database.
+ * Returns 0 if they are all equal and no rows were added or removed. */
+static int
+cache_verify_list(const db_connection_t *conn, struct dbw_list *list)
+{
+    db_object_t *object;
+    db_result_columns_t *cols;
+    size_t rows;
+    int r = 0;
+
+    if (!(object = dbw_object_new(conn, list->table, 1))) return 1;
+    cols = db_object_read_columns(object, NULL, NULL);
+    db_object_free(object);
+    if (!cols) return 1;
+    rows = db_result_columns_rows(cols);
+    for (size_t i = 0; !r && i < rows; i++) {
+        struct dbrow *row = cache_get(list, colint(cols, i, 0));
+        if (!row || row->revision != colint(cols, i, 1)) r = 1;
     }
-    db->conn            = conn;
-    db->policies        = dbw_policies(conn, mask&DBW_F_POLICY);
-    db->zones           = dbw_zones(conn, mask&DBW_F_ZONE);
-    db->keys            = dbw_keys(conn, mask&DBW_F_KEY);
-    db->keystates       = dbw_keystates(conn, mask&DBW_F_KEYSTATE);
-    db->hsmkeys         = dbw_hsmkeys(conn, mask&DBW_F_HSMKEY);
-    db->policykeys      = dbw_policykeys(conn, mask&DBW_F_POLICYKEY);
-    db->keydependencies = dbw_keydependencies(conn, mask&DBW_F_KEYDEPENDENCY);
-    (void)pthread_rwlock_unlock(&db_lock);
+    db_result_columns_free(cols);
+    return r || rows != list->n;
+}
+
+static int
+cache_verify(db_connection_t *conn)
+{
+    struct dbw_list *lists[DBW_TABLES];
+    int r = 0;
+
+    if (dbw_read_begin(conn)) return 1;
+    db_lists(cache, lists);
+    for (int i = 0; !r && i < DBW_TABLES; i++) {
+        r = cache_verify_list(conn, lists[i]);
+    }
+    dbw_read_end(conn);
+    return r;
+}
+
+/* Make sure the cache is loaded and current. On success cache_lock is held
+ * for reading, the caller must release it. */
+static int
+cache_acquire(db_connection_t *conn)
+{
+    if (pthread_rwlock_rdlock(&cache_lock)) return 1;
+    if (cache && cache_writes == db_connection_writes()
+        && time(NULL) < cache_verified + DBW_CACHE_VERIFY_INTERVAL)
+    {
+        return 0;
+    }
+    (void)pthread_rwlock_unlock(&cache_lock);
+
+    if (pthread_rwlock_wrlock(&cache_lock)) return 1;
+    if (cache && cache_writes != db_connection_writes()) {
+        ods_log_debug("[dbw_cache] database was written to, reloading");
+        cache_drop();
+    }
+    if (cache && time(NULL) >= cache_verified + DBW_CACHE_VERIFY_INTERVAL) {
+        if (cache_verify(conn)) {
+            ods_log_info("[dbw_cache] database changed by another process, "
+                "reloading");
+            cache_drop();
+        } else {
+            cache_verified = time(NULL);
+        }
+    }
+    if (!cache && cache_load(conn)) {
+        ods_log_error("[dbw_cache] Failed to read from database.");
+        (void)pthread_rwlock_unlock(&cache_lock);
+        return 1;
+    }
+    (void)pthread_rwlock_unlock(&cache_lock);
+
+    /* A failed commit may drop the cache before we get it back */
+    if (pthread_rwlock_rdlock(&cache_lock)) return 1;
+    if (!cache) {
+        (void)pthread_rwlock_unlock(&cache_lock);
+        return 1;
+    }
+    return 0;
+}
 
+/* A dbw_db with empty tables */
+static struct dbw_db *
+cache_new_db(db_connection_t *conn)
+{
+    struct dbw_db *db = calloc(1, sizeof(struct dbw_db));
+    if (!db) return NULL;
+    db->conn            = conn;
+    db->policies        = dbw_policies(conn, 0, NULL);
+    db->zones           = dbw_zones(conn, 0, NULL);
+    db->keys            = dbw_keys(conn, 0, NULL);
+    db->keystates       = dbw_keystates(conn, 0, NULL);
+    db->hsmkeys         = dbw_hsmkeys(conn, 0, NULL);
+    db->policykeys      = dbw_policykeys(conn, 0, NULL);
+    db->keydependencies = dbw_keydependencies(conn, 0, NULL);
     if (!db->policies || !db->zones || !db->keys || !db->keystates ||
             !db->hsmkeys || !db->policykeys || !db->keydependencies)
     {
         dbw_free(db);
-        ods_log_error("[dbw_fetch] Failed to read from database.");
         return NULL;
     }
-    merge_pl_pk(db->policies, db->policykeys);
-    merge_pl_hk(db->policies, db->hsmkeys);
-    merge_pl_zn(db->policies, db->zones);
-    merge_zn_kd(db->zones,    db->keys);
-    merge_kd_ks(db->keys,     db->keystates);
-    merge_hk_kd(db->hsmkeys,  db->keys);
-    merge_zn_dp(db->zones,    db->keydependencies);
-    merge_kt_dp(db->keys,     db->keydependencies);
-    merge_kf_dp(db->keys,     db->keydependencies);
     return db;
 }
 
-struct dbw_db *
-dbw_fetch(db_connection_t *conn)
+/* Append a copy of row to list. The index is not updated. */
+static int
+cache_copy_row(struct dbw_list *list, struct dbrow *row)
 {
-    return dbw_fetch_filtered(conn, DBW_F_ALL);
+    struct dbrow **set = realloc(list->set, (list->n + 1) * sizeof (struct dbrow *));
+    if (!set) return 1;
+    list->set = set;
+    if (!(list->set[list->n] = list->copy(row))) return 1;
+    list->n++;
+    return 0;
 }
 
 static int
-dbw_commit_list(const db_connection_t *conn, struct dbw_list *list)
+cache_copy_list(struct dbw_list *list, struct dbw_list *from)
 {
-    for (size_t i = 0; i < list->n; i++) {
-        struct dbrow *row = list->set[i];
-        if (!row->dirty) continue;
-        int r = list->update(conn, row);
-        if (r) return r;
-        /* TODO: if successful, DELETED rows will be clean and dbw_db
-         * structure will not be safe to reuse. We should remove these items
-         * completely (see lookahead_cmd.c) */
-        row->dirty = DBW_CLEAN;
+    if (!from->n) return 0;
+    if (!(list->set = calloc(from->n, sizeof (struct dbrow *)))) return 1;
+    for (size_t i = 0; i < from->n; i++) {
+        if (!(list->set[list->n] = list->copy(from->set[i]))) return 1;
+        list->n++;
     }
     return 0;
 }
 
+/* Append copies of the rows of cache table t with parent parent_id to list */
 static int
-dbw_verify_list_revisions(const db_connection_t *conn, struct dbw_list *list)
+cache_copy_children(struct dbw_list *list, int t, int parent_id)
 {
-    struct db_value id;
-    memset(&id, 0, sizeof(struct db_value));
-    id.type = DB_TYPE_INT64;
-    for (size_t i = 0; i < list->n; i++) {
-        struct dbrow *row = list->set[i];
-        if (row->dirty != DBW_UPDATE) continue;
-        id.int64 = row->id;
-        if (list->revision(conn, &id) != row->revision) {
-            ods_log_debug("[dbw_verify_revisions] collision detected on id %d", row->id);
+    struct cache_refs *refs = &cache_children[t];
+    struct dbw_list *lists[DBW_TABLES];
+    struct dbrow *row;
+
+    db_lists(cache, lists);
+    for (size_t i = refs_find(refs, parent_id, INT_MIN);
+        i < refs->n && refs->set[i].parent_id == parent_id; i++)
+    {
+        if ((row = cache_get(lists[t], refs->set[i].id))
+            && cache_copy_row(list, row)) return 1;
+    }
+    return 0;
+}
+
+/* Copy the tables in mask from the cache */
+static int
+cache_copy_tables(struct dbw_db *db, int mask)
+{
+    static const int flags[DBW_TABLES] = {DBW_F_POLICY, DBW_F_POLICYKEY,
+        DBW_F_ZONE, DBW_F_HSMKEY, DBW_F_KEY, DBW_F_KEYSTATE,
+        DBW_F_KEYDEPENDENCY};
+    struct dbw_list *lists[DBW_TABLES];
+    struct dbw_list *from[DBW_TABLES];
+
+    db_lists(db, lists);
+    db_lists(cache, from);
+    for (int i = 0; i < DBW_TABLES; i++) {
+        if (!(mask & flags[i])) continue;
+        if (cache_copy_list(lists[i], from[i])) return 1;
+    }
+    return 0;
+}
+
+
+/* Copy the same rows from the cache dbw_fetch_zone_tables() would read, for
+ * each of the zones in names. Unknown zones are skipped. */
+static int
+cache_copy_zones(struct dbw_db *db, char const **zonenames, size_t n)
+{
+    struct idset zones = {NULL, 0}, hsmkeys = {NULL, 0};
+    struct idset policies = {NULL, 0};
+    char const **names;
+    struct dbw_zone *zone;
+    struct dbrow *row;
+    size_t i;
+    int r = 1;
+
+    if (!n) return 0;
+    if (!(names = malloc(n * sizeof (char *)))) return 1;
+    memcpy(names, zonenames, n * sizeof (char *));
+    qsort(names, n, sizeof (char *), cmp_names);
+    for (i = 0; i < n; i++) {
+        if (i && !strcmp(names[i], names[i-1])) continue;
+        if (!(zone = zone_names_get(names[i]))) continue;
+        if (cache_copy_row(db->zones, (struct dbrow *)zone)) goto out;
+    }
+    free(names);
+    names = NULL;
+    /* Unknown zones, leave the tables empty. */
+    if (!db->zones->n) return 0;
+    if (idset_of(&zones, db->zones, -1)) goto out;
+    /* The policies of the zones, zone->int0 is policy_id */
+    if (idset_of(&policies, db->zones, 0)) goto out;
+
+    for (i = 0; i < zones.n; i++) {
+        if (cache_copy_children(db->keys, CACHE_KEYS, zones.id[i])
+            || cache_copy_children(db->keydependencies,
+                CACHE_KEYDEPENDENCIES, zones.id[i])) goto out;
+    }
+    for (i = 0; i < db->keys->n; i++) {
+        if (cache_copy_children(db->keystates, CACHE_KEYSTATES,
+            db->keys->set[i]->id)) goto out;
+    }
+    /* The hsmkeys in use by the zones plus the candidates for new keys of
+     * their policies: unused and shared ones */
+    if (idset_of(&hsmkeys, db->keys, 1)) goto out;
+    for (i = 0; i < hsmkeys.n; i++) {
+        if ((row = cache_get(cache->hsmkeys, hsmkeys.id[i]))
+            && cache_copy_row(db->hsmkeys, row)) goto out;
+    }
+    for (i = 0; i < policies.n; i++) {
+        struct cache_refs *refs = &cache_children[CACHE_HSMKEYS];
+        for (size_t h = refs_find(refs, policies.id[i], INT_MIN);
+            h < refs->n && refs->set[h].parent_id == policies.id[i]; h++)
+        {
+            struct dbw_hsmkey *hsmkey;
+            if (idset_has(&hsmkeys, refs->set[h].id)) continue;
+            hsmkey = (struct dbw_hsmkey *)cache_get(cache->hsmkeys, refs->set[h].id);
+            if (!hsmkey || (hsmkey->state != DBW_HSMKEY_UNUSED
+                && hsmkey->state != DBW_HSMKEY_SHARED)) continue;
+            if (cache_copy_row(db->hsmkeys, (struct dbrow *)hsmkey)) goto out;
+        }
+        if (cache_copy_children(db->policykeys, CACHE_POLICYKEYS,
+            policies.id[i])) goto out;
+    }
+    /* The zones' policies and the policies of any of the hsmkeys above */
+    for (i = 0; i < db->hsmkeys->n; i++) {
+        if (idset_add(&policies, db->hsmkeys->set[i]->int0)) goto out;
+    }
+    idset_sort(&policies);
+    for (i = 0; i < policies.n; i++) {
+        if ((row = cache_get(cache->policies, policies.id[i]))
+            && cache_copy_row(db->policies, row)) goto out;
+    }
+    /* Keys of zones we did not copy sharing one of the hsmkeys */
+    for (i = 0; i < db->hsmkeys->n; i++) {
+        struct dbw_hsmkey *hsmkey = (struct dbw_hsmkey *)db->hsmkeys->set[i];
+        if (hsmkey->state != DBW_HSMKEY_SHARED) continue;
+        for (size_t u = uses_find(hsmkey->id, INT_MIN);
+            u < cache_uses_n && cache_uses[u].hsmkey_id == hsmkey->id; u++)
+        {
+            if (idset_has(&zones, cache_uses[u].zone_id)) continue;
+            hsmkey->foreign_key_count += cache_uses[u].count;
+        }
+    }
+    r = 0;
+out:
+    free(names);
+    free(zones.id);
+    free(hsmkeys.id);
+    free(policies.id);
+    return r;
+}
+
+/* Fetch from the cache, either the zones in names or the tables in mask.
+ * Returns NULL on failure, the caller may read the database instead. */
+static struct dbw_db *
+cache_fetch(db_connection_t *conn, char const **zonenames, size_t n, int mask)
+{
+    struct dbw_list *lists[DBW_TABLES];
+    struct dbw_db *db;
+    int r;
+
+    if (!(db = cache_new_db(conn))) return NULL;
+    if (cache_acquire(conn)) {
+        dbw_free(db);
+        return NULL;
+    }
+    if (zonenames)
+        r = cache_copy_zones(db, zonenames, n);
+    else
+        r = cache_copy_tables(db, mask);
+    (void)pthread_rwlock_unlock(&cache_lock);
+    if (r) {
+        ods_log_error("[dbw_cache] Memory allocation failure.");
+        dbw_free(db);
+        return NULL;
+    }
+    db_lists(db, lists);
+    for (int i = 0; i < DBW_TABLES; i++) {
+        dbw_list_reindex(lists[i]);
+    }
+    if (zonenames && n == 1 && db->zones->n == 1)
+        db->zone_id = db->zones->set[0]->id;
+    dbw_merge(db);
+    return db;
+}
+
+void
+dbw_cache_enable(int enable)
+{
+    (void)pthread_rwlock_wrlock(&cache_lock);
+    cache_enabled = enable;
+    if (!enable) cache_drop();
+    (void)pthread_rwlock_unlock(&cache_lock);
+}
+
+/* A row dbw_commit() is about to write */
+struct dbw_change {
+    int table; /* index in db_lists() */
+    int dirty;
+    struct dbrow *row;
+};
+
+/* Record the dirty rows of db, dbw_commit() marks them clean. Returns the
+ * number of changes, -1 on failure. */
+static ssize_t
+cache_changes(struct dbw_db *db, struct dbw_change **changes)
+{
+    struct dbw_list *lists[DBW_TABLES];
+    size_t n = 0, c = 0;
+
+    db_lists(db, lists);
+    for (int t = 0; t < DBW_TABLES; t++) {
+        for (size_t i = 0; i < lists[t]->n; i++) {
+            if (lists[t]->set[i]->dirty) n++;
+        }
+    }
+    *changes = NULL;
+    if (!n) return 0;
+    if (!(*changes = calloc(n, sizeof (struct dbw_change)))) return -1;
+    for (int t = 0; t < DBW_TABLES; t++) {
+        for (size_t i = 0; i < lists[t]->n; i++) {
+            struct dbrow *row = lists[t]->set[i];
+            if (!row->dirty) continue;
+            (*changes)[c].table = t;
+            (*changes)[c].dirty = row->dirty;
+            (*changes)[c].row = row;
+            c++;
+        }
+    }
+    return n;
+}
+
+/* Drop the row of cache table t at position i from the indices */
+static void
+cache_unindex(int t, size_t i)
+{
+    struct dbw_list *lists[DBW_TABLES];
+    struct dbrow *old;
+
+    db_lists(cache, lists);
+    old = lists[t]->set[i];
+    if (lists[t] == cache->keys) {
+        struct dbw_key *key = (struct dbw_key *)old;
+        (void)uses_add(key->hsmkey_id, key->zone_id, -1);
+    }
+    if (cache_by_parent[t]) refs_del(&cache_children[t], old->int0, old->id);
+    if (lists[t] == cache->zones) (void)zone_names_set((struct dbw_zone *)old, NULL);
+}
+
+/* Remove the row with id from cache table t, if present */
+static void
+cache_remove(int t, int id)
+{
+    struct dbw_list *lists[DBW_TABLES];
+    struct dbw_list *list;
+    size_t i;
+
+    db_lists(cache, lists);
+    list = lists[t];
+    i = cache_find(list, id);
+    if (i == list->n || list->set[i]->id != id) return;
+    cache_unindex(t, i);
+    list->free(list->set[i]);
+    memmove(&list->set[i], &list->set[i+1],
+        (list->n - i - 1) * sizeof (struct dbrow *));
+    list->n--;
+}
+
+/* Put row in cache table t, replacing the row with the same id. The cache
+ * takes ownership of row, also on failure. */
+static int
+cache_put(int t, struct dbrow *row)
+{
+    struct dbw_list *lists[DBW_TABLES];
+    struct dbw_list *list;
+    size_t i;
+
+    db_lists(cache, lists);
+    list = lists[t];
+    i = cache_find(list, row->id);
+    if (i < list->n && list->set[i]->id == row->id) {
+        cache_unindex(t, i);
+        list->free(list->set[i]);
+        list->set[i] = row;
+    } else {
+        struct dbrow **set = realloc(list->set, (list->n + 1) * sizeof (struct dbrow *));
+        if (!set) {
+            list->free(row);
             return 1;
         }
+        list->set = set;
+        memmove(&list->set[i+1], &list->set[i],
+            (list->n - i) * sizeof (struct dbrow *));
+        list->set[i] = row;
+        list->n++;
+    }
+    if (list == cache->keys) {
+        struct dbw_key *key = (struct dbw_key *)row;
+        if (uses_add(key->hsmkey_id, key->zone_id, 1)) return 1;
     }
+    if (cache_by_parent[t] && refs_add(&cache_children[t], row->int0, row->id))
+        return 1;
+    if (list == cache->zones && zone_names_set(NULL, (struct dbw_zone *)row))
+        return 1;
     return 0;
 }
 
-
+/* Apply a committed change to the cache. Applying it twice is harmless, the
+ * cache might have been reloaded after the commit. */
 static int
-dbw_verify_revisions(struct dbw_db *db)
+cache_apply(struct dbw_change *change)
 {
-    int r = 0;
-    ods_log_debug("[dbw_verify_revisions] verifying policies");
-    r |= dbw_verify_list_revisions(db->conn, db->policies);
-    ods_log_debug("[dbw_verify_revisions] verifying policykeys");
-    r |= dbw_verify_list_revisions(db->conn, db->policykeys);
-    ods_log_debug("[dbw_verify_revisions] verifying zones");
-    r |= dbw_verify_list_revisions(db->conn, db->zones);
-    ods_log_debug("[dbw_verify_revisions] verifying hsmkeys");
-    r |= dbw_verify_list_revisions(db->conn, db->hsmkeys);
-    ods_log_debug("[dbw_verify_revisions] verifying keys");
-    r |= dbw_verify_list_revisions(db->conn, db->keys);
-    ods_log_debug("[dbw_verify_revisions] verifying keystates");
-    r |= dbw_verify_list_revisions(db->conn, db->keystates);
-    ods_log_debug("[dbw_verify_revisions] verifying keydependencies");
-    r |= dbw_verify_list_revisions(db->conn, db->keydependencies);
+    struct dbw_list *lists[DBW_TABLES];
+    struct dbrow *copy;
+
+    if (change->dirty == DBW_DELETE) {
+        cache_remove(change->table, change->row->id);
+        return 0;
+    }
+    db_lists(cache, lists);
+    if (!(copy = lists[change->table]->copy(change->row))) return 1;
+    /* The database bumped the revision */
+    copy->revision = change->dirty == DBW_UPDATE ? change->row->revision + 1 : 1;
+    return cache_put(change->table, copy);
+}
+
+/* Read the rows of a failed commit again. The commit changed nothing, but
+ * some of these rows are stale in either the cache or the committed db.
+ * Rows it would have inserted have no id yet and are not in the cache.
+ * Caller must hold cache_lock for writing. */
+static int
+cache_refresh(db_connection_t *conn, struct dbw_change *changes, ssize_t n)
+{
+    static const dbw_table_fn tables[DBW_TABLES] = {dbw_policies,
+        dbw_policykeys, dbw_zones, dbw_hsmkeys, dbw_keys, dbw_keystates,
+        dbw_keydependencies};
+    struct dbw_list *fresh[DBW_TABLES] = {NULL};
+    struct idset ids[DBW_TABLES];
+    int r = 1;
+
+    memset(ids, 0, sizeof ids);
+    for (ssize_t c = 0; c < n; c++) {
+        if (changes[c].dirty == DBW_INSERT) continue;
+        if (idset_add(&ids[changes[c].table], changes[c].row->id)) goto out;
+    }
+    if (dbw_read_begin(conn)) goto out;
+    for (int t = 0; t < DBW_TABLES; t++) {
+        idset_sort(&ids[t]);
+        if (!(fresh[t] = fetch_any_id(conn, tables[t], "id", &ids[t]))) break;
+    }
+    dbw_read_end(conn);
+    for (int t = 0; t < DBW_TABLES; t++) {
+        if (!fresh[t]) goto out;
+    }
+    for (int t = 0; t < DBW_TABLES; t++) {
+        /* Removed by someone else, or read again below */
+        for (size_t i = 0; i < ids[t].n; i++) cache_remove(t, ids[t].id[i]);
+        while (fresh[t]->n) {
+            if (cache_put(t, fresh[t]->set[--fresh[t]->n])) goto out;
+        }
+    }
+    r = 0;
+out:
+    for (int t = 0; t < DBW_TABLES; t++) {
+        dbw_list_free(fresh[t]);
+        free(ids[t].id);
+    }
     return r;
 }
 
-int
-dbw_commit(struct dbw_db *db)
+/* Update the cache after dbw_commit(). Other commits may have been written
+ * through in the mean time, each row is only written by one of them. */
+static void
+cache_write_through(db_connection_t *conn, struct dbw_change *changes,
+    ssize_t n, int failed)
+{
+    if (pthread_rwlock_wrlock(&cache_lock)) return;
+    if (!cache) {
+        (void)pthread_rwlock_unlock(&cache_lock);
+        return;
+    }
+    if (n < 0) {
+        /* Unknown changes, start over */
+        cache_drop();
+    } else if (failed) {
+        if (cache_refresh(conn, changes, n)) {
+            ods_log_error("[dbw_cache] Failed to read rows of failed commit.");
+            cache_drop();
+        }
+    } else {
+        for (ssize_t c = 0; c < n; c++) {
+            if (cache_apply(&changes[c])) {
+                ods_log_error("[dbw_cache] Memory allocation failure.");
+                cache_drop();
+                break;
+            }
+        }
+    }
+    (void)pthread_rwlock_unlock(&cache_lock);
+}
+
+/* Write all dirty rows of db in a single transaction. Must be called with
+ * db_lock held for writing. */
+static int
+dbw_commit_tables(struct dbw_db *db)
 {
-    if (pthread_rwlock_wrlock(&db_lock)) {
-        ods_log_error("[dbw_commit] Unable to obtain database write lock.");
+    if (db_connection_transaction_begin(db->conn)) {
+        ods_log_error("[dbw_commit] Unable to start database transaction.");
         return 1;
     }
     if (dbw_verify_revisions(db)) {
         ods_log_error("[dbw_commit] Some records are stale, can't commit to database.");
-        (void)pthread_rwlock_unlock(&db_lock);
+        (void)db_connection_transaction_rollback(db->conn);
         return 1;
     }
     int r = 0;
-    r |= dbw_commit_list(db->conn, db->policies);
-    r |= dbw_commit_list(db->conn, db->policykeys);
-    r |= dbw_commit_list(db->conn, db->zones);
-    r |= dbw_commit_list(db->conn, db->hsmkeys);
-    r |= dbw_commit_list(db->conn, db->keys);
-    r |= dbw_commit_list(db->conn, db->keystates);
-    r |= dbw_commit_list(db->conn, db->keydependencies);
+    r = r || dbw_commit_list(db->conn, db->policies);
+    r = r || dbw_commit_list(db->conn, db->policykeys);
+    r = r || dbw_commit_list(db->conn, db->zones);
+    r = r || dbw_commit_list(db->conn, db->hsmkeys);
+    r = r || dbw_commit_list(db->conn, db->keys);
+    r = r || dbw_commit_list(db->conn, db->keystates);
+    r = r || dbw_commit_list(db->conn, db->keydependencies);
+    if (r) {
+        ods_log_error("[dbw_commit] Writing to database failed, rolling back.");
+        (void)db_connection_transaction_rollback(db->conn);
+    } else if (db_connection_transaction_commit(db->conn)) {
+        ods_log_error("[dbw_commit] Unable to commit database transaction.");
+        (void)db_connection_transaction_rollback(db->conn);
+        r = 1;
+    }
+    return r;
+}
+
+/* Zone the changes of db are limited to, 0 if they are not. Only rows of
+ * the zone itself and hsmkeys may have changed. Hsmkeys are shared between
+ * zones, but every update is conditional on the revision in the database.
+ * Of two commits changing the same hsmkey one fails and is retried. */
+static int
+commit_zone(struct dbw_db *db)
+{
+    struct dbw_list *lists[] = {db->policies, db->policykeys, db->zones};
+    if (!db->zone_id) return 0;
+    for (size_t l = 0; l < sizeof lists / sizeof lists[0]; l++) {
+        for (size_t i = 0; i < lists[l]->n; i++) {
+            struct dbrow *row = lists[l]->set[i];
+            if (!row->dirty) continue;
+            if (lists[l] != db->zones || row->id != db->zone_id) return 0;
+        }
+    }
+    return db->zone_id;
+}
+
+int
+dbw_commit(struct dbw_db *db)
+{
+    struct dbw_change *changes = NULL;
+    pthread_mutex_t *zone_lock = NULL;
+    ssize_t n = 0;
+    int zone_id = 0;
+    int r;
+
+    /* Commits confined to one zone exclude only commits of that zone.
+     * Readers must not rely on db_lock to exclude them. */
+    if (concurrent_commits && snapshot_reads) zone_id = commit_zone(db);
+    if (zone_id) {
+        pthread_once(&zone_locks_once, zone_locks_init);
+        zone_lock = &zone_locks[(unsigned)zone_id % DBW_ZONE_LOCKS];
+        r = pthread_rwlock_rdlock(&db_lock);
+        if (!r && (r = pthread_mutex_lock(zone_lock)))
+            (void)pthread_rwlock_unlock(&db_lock);
+    } else {
+        r = pthread_rwlock_wrlock(&db_lock);
+    }
+    if (r) {
+        ods_log_error("[dbw_commit] Unable to obtain database write lock.");
+        return 1;
+    }
+    if (cache_enabled) n = cache_changes(db, &changes);
+    /* Our changes are written through, they must not invalidate the cache */
+    db_connection_track_writes(db->conn, 0);
+    r = dbw_commit_tables(db);
+    db_connection_track_writes(db->conn, 1);
+    if (zone_lock) (void)pthread_mutex_unlock(zone_lock);
     (void)pthread_rwlock_unlock(&db_lock);
+
+    /* Not under db_lock, cache_load() takes it with cache_lock held */
+    if (cache_enabled)
+        cache_write_through((db_connection_t *)db->conn, changes, n, r);
+    free(changes);
     return r;
 }
 
@@ -1404,6 +3588,8 @@ struct dbw_zone *
 dbw_get_zone(struct dbw_db *db, char const *zonename)
 {
     struct dbw_list *list = db->zones;
+    if (list->index)
+        return (struct dbw_zone *)index_find_name(list->index, zonename);
     for (size_t n = 0; n < list->n; n++) {
         struct dbw_zone *zone = (struct dbw_zone *)list->set[n];
         if (!strcmp(zone->name, zonename)) return zone;
@@ -1415,6 +3601,8 @@ struct dbw_policy *
 dbw_get_policy(struct dbw_db *db, char const *policyname)
 {
     struct dbw_list *list = db->policies;
+    if (list->index)
+        return (struct dbw_policy *)index_find_name(list->index, policyname);
     for (size_t n = 0; n < list->n; n++) {
         struct dbw_policy *policy = (struct dbw_policy *)list->set[n];
         if (!strcmp(policy->name, policyname)) return policy;
@@ -1426,6 +3614,8 @@ struct dbw_policykey *
 dbw_get_policykey(struct dbw_db *db, int id)
 {
     struct dbw_list *list = db->policykeys;
+    if (list->index)
+        return (struct dbw_policykey *)index_find_id(list->index, id);
     for (size_t n = 0; n < list->n; n++) {
         struct dbw_policykey *policykey = (struct dbw_policykey *)list->set[n];
         if (id == policykey->id) return policykey;
@@ -1448,6 +3638,8 @@ struct dbw_hsmkey *
 dbw_get_hsmkey(struct dbw_db *db, char const *locator)
 {
     struct dbw_list *list = db->hsmkeys;
+    if (list->index)
+        return (struct dbw_hsmkey *)index_find_name(list->index, locator);
     for (size_t n = 0; n < list->n; n++) {
         struct dbw_hsmkey *hsmkey = (struct dbw_hsmkey *)list->set[n];
         if (!strcmp(locator, hsmkey->locator)) return hsmkey;
@@ -1455,6 +3647,18 @@ dbw_get_hsmkey(struct dbw_db *db, char const *locator)
     return NULL;
 }
 
+int
+dbw_hsmkey_users(struct dbw_hsmkey *hsmkey, struct dbw_key const *except)
+{
+    int users = hsmkey->foreign_key_count;
+    for (size_t k = 0; k < hsmkey->key_count; k++) {
+        struct dbw_key *key = hsmkey->key[k];
+        if (key == except || key->dirty == DBW_DELETE) continue;
+        users++;
+    }
+    return users;
+}
+
 /* Add object to array */
 static int
 append(void ***array, int *count, void *obj)
@@ -1477,6 +3681,7 @@ list_add(struct dbw_list *list, struct dbrow *row)
     new[list->n] = row;
     list->set = new;
     list->n = c;
+    if (list->index) return index_add(list->index, row);
     return 0;
 }
 
@@ -2,6 +2,7 @@
 #define DBW_H
 
 #include <time.h>
+#include <sys/types.h>
 
 #include "db/db_connection.h"
 #include "db/zone_db.h"
@@ -307,6 +308,10 @@ struct dbw_hsmkey {
     unsigned int is_revoked;
     unsigned int key_type;
     unsigned int backup;
+
+    /* Keys of other zones using this hsmkey that are not part of this
+     * dbw_db. Only non-zero after dbw_fetch_zone(). */
+    int foreign_key_count;
 };
 
 struct dbw_zone {
@@ -342,16 +347,23 @@ struct dbw_zone {
     unsigned int roll_csk_now;
 };
 
+struct dbw_index;
+
 struct dbw_list {
     struct dbrow **set;
     size_t n;
     void (*free)(struct dbrow *);
     int (*update)(const db_connection_t *, struct dbrow *);
-    int (*revision)(const db_connection_t *, struct db_value *);
+    /* Insert several rows at once and set their ids, optional */
+    int (*insert)(const db_connection_t *, struct dbrow **, size_t);
+    struct dbrow *(*copy)(struct dbrow *); /* unlinked copy of a row */
+    char const *table; /* Name of the database table */
+    struct dbw_index *index; /* Lookup index used by dbw_get_*, optional */
 };
 
 struct dbw_db {
     const db_connection_t *conn;
+    int zone_id; /* Zone read by dbw_fetch_zone(), 0 for other fetches */
     struct dbw_list *policies;
     struct dbw_list *policykeys;
     struct dbw_list *zones;
@@ -391,8 +403,105 @@ struct dbw_db *dbw_fetch(db_connection_t *conn);
 struct dbw_db *dbw_fetch_filtered(db_connection_t *conn, int mask);
 
 /**
- * Commit changes to the database. Guarded by a R/W lock. Only records marked
- * as dirty will be considered for writing.
+ * Read only what is needed to enforce a single zone: the zone, its policy,
+ * policykeys and hsmkeys, the zone's keys, keystates and keydependencies.
+ * Other zones are not read. Keys of other zones sharing one of the hsmkeys
+ * are counted in hsmkey->foreign_key_count instead. If the zone does not
+ * exist the returned structure is empty.
+ *
+ * return NULL on failure
+ */
+struct dbw_db *dbw_fetch_zone(db_connection_t *conn, char const *zonename);
+
+/**
+ * Read what is needed to enforce all zones in zonenames at once, sharing
+ * their policies and hsmkeys. Like dbw_fetch_zone() other zones are not
+ * read, each table is queried for all zones at once. Unknown zones are
+ * skipped. Only tables included in mask are fetched, the zones always are.
+ * Commits of the result are not concurrent with those of other zones.
+ *
+ * return NULL on failure
+ */
+struct dbw_db *dbw_fetch_zones(db_connection_t *conn, char const **zonenames,
+    size_t n, int mask);
+
+/** Selects zones for dbw_zone_names() and dbw_foreach_zone(). */
+struct dbw_zone_filter {
+    char const *policy;  /** Name of the policy of the zones, or NULL */
+    char const *pattern; /** fnmatch(3) pattern for the zone names, or NULL */
+    char const *after;   /** Only zones sorted after this name, or NULL */
+};
+
+/**
+ * Sorted names of the zones matching filter. Only the zone table is read.
+ * The policy, after and the literal start of pattern are conditions in the
+ * query, the rest of pattern is matched on the rows read.
+ *
+ * return number of names, -1 on failure. Free names with dbw_names_free().
+ */
+ssize_t dbw_zone_names(db_connection_t *conn,
+    struct dbw_zone_filter const *filter, char ***names);
+
+void dbw_names_free(char **names, size_t n);
+
+/**
+ * Call cb for the first limit zones matching filter in order of name, all
+ * of them if limit is 0. Zones are read a page at a time with
+ * dbw_fetch_zones() and mask, db and zone are only valid during the call.
+ * Zones deleted since their names were read are skipped. When
+ * limit leaves zones out and next is not NULL, *next is set to the name of
+ * the last zone passed to cb. Pass it as the after of the filter to
+ * continue. Caller must free *next.
+ *
+ * return 0 on success, 1 on failure, or the nonzero value cb returned.
+ */
+int dbw_foreach_zone(db_connection_t *conn,
+    struct dbw_zone_filter const *filter, int mask, size_t limit,
+    int (*cb)(struct dbw_db *db, struct dbw_zone *zone, void *arg),
+    void *arg, char **next);
+
+/**
+ * Let readers fetch in a transaction of their own instead of taking the
+ * global database lock. Only enable when the database serves readers a
+ * consistent snapshot while a writer commits, such as SQLite in WAL mode or
+ * MySQL. Writers are always serialized by the global lock.
+ */
+void dbw_snapshot_reads(int enable);
+
+/**
+ * Read the tables of a full fetch side by side with up to threads threads,
+ * each on a database connection of its own. Pays off when every query costs
+ * a round trip to a database server. Commits of this process wait for the
+ * reads. 0 or 1 reads the tables one after the other on the connection of
+ * the caller, the default.
+ */
+void dbw_parallel_reads(int threads);
+
+/**
+ * Let commits of a db read by dbw_fetch_zone() run in parallel with those of
+ * other zones, as long as they did not change rows shared with other zones
+ * other than hsmkeys. Needs snapshot reads and a database that handles
+ * concurrent writers well, such as MySQL. Otherwise commits are serialized.
+ */
+void dbw_concurrent_commits(int enable);
+
+/**
+ * Keep a copy of the entire database in memory, shared by all threads.
+ * dbw_fetch(), dbw_fetch_filtered() and dbw_fetch_zone() then copy their
+ * rows from memory instead of querying the database. Changes committed
+ * with dbw_commit() are written through. Any other write to the database
+ * makes the cache reload on the next fetch. Changes by other processes are
+ * found by comparing revisions, at most a minute after they were made. Off
+ * by default.
+ */
+void dbw_cache_enable(int enable);
+
+/**
+ * Commit changes to the database. Guarded by a R/W lock, or a lock of the
+ * zone, see dbw_concurrent_commits(). Only records marked as dirty will be
+ * considered for writing. All changes are written in a single transaction,
+ * on failure nothing is written. The db must not be committed again after a
+ * failure.
  *
  * return 0 on success. 1 otherwise.
  */
@@ -421,6 +530,21 @@ struct dbw_policykey * dbw_get_policykey(struct dbw_db *db, int id);
 struct dbw_hsmkey * dbw_get_hsmkey(struct dbw_db *db, char const *locator);
 struct dbw_keystate * dbw_get_keystate(struct dbw_key *key, int type);
 
+/**
+ * Number of keys still using hsmkey: its keys in db that are not marked for
+ * deletion, other than except, plus the keys of zones outside of db in
+ * foreign_key_count. Takes time in the number of zones using the key, not
+ * in the size of db.
+ */
+int dbw_hsmkey_users(struct dbw_hsmkey *hsmkey, struct dbw_key const *except);
+
+/**
+ * The dbw_get_* lookups above use an index. Rows added with the dbw_add_* and
+ * dbw_new_* functions are indexed automatically. Callers that remove rows
+ * from a list or change their id or name must rebuild the index.
+ */
+void dbw_list_reindex(struct dbw_list *list);
+
 /* TODO functions below this need to be cleaned up / evaluated*/
 
 void dbw_zone_free(struct dbrow *row);
@@ -66,6 +66,7 @@ int main(void) {
         || !CU_add_test(pSuite, "test of db_value_set", test_class_db_value_set)
         || !CU_add_test(pSuite, "test of db_result", test_class_db_result)
         || !CU_add_test(pSuite, "test of db_result_list", test_class_db_result_list)
+        || !CU_add_test(pSuite, "test of db_result_columns", test_class_db_result_columns)
         || !CU_add_test(pSuite, "test of db_value", test_class_db_value)
         || !CU_add_test(pSuite, "test of db_*_free", test_class_end))
     {
@@ -100,7 +101,9 @@ int main(void) {
         || !CU_add_test(pSuite, "test of create object 3", test_database_operations_create_object3)
         || !CU_add_test(pSuite, "test of update object 2", test_database_operations_update_object2)
         || !CU_add_test(pSuite, "test of read all", test_database_operations_read_all)
+        || !CU_add_test(pSuite, "test of read columns", test_database_operations_read_columns)
         || !CU_add_test(pSuite, "test of count", test_database_operations_count)
+        || !CU_add_test(pSuite, "test of counting writes", test_database_operations_count_writes)
         || !CU_add_test(pSuite, "test of delete object 3", test_database_operations_delete_object3)
         || !CU_add_test(pSuite, "test of read object 1 (#3)", test_database_operations_read_object1)
         || !CU_add_test(pSuite, "test of delete object 2", test_database_operations_delete_object2)
@@ -137,6 +140,8 @@ int main(void) {
         || !CU_add_test(pSuite, "test of create object 3", test_database_operations_create_object3)
         || !CU_add_test(pSuite, "test of update object 2", test_database_operations_update_object2)
         || !CU_add_test(pSuite, "test of read all", test_database_operations_read_all)
+        || !CU_add_test(pSuite, "test of read columns", test_database_operations_read_columns)
+        || !CU_add_test(pSuite, "test of counting writes", test_database_operations_count_writes)
         || !CU_add_test(pSuite, "test of delete object 3", test_database_operations_delete_object3)
         || !CU_add_test(pSuite, "test of read object 1 (#3)", test_database_operations_read_object1)
         || !CU_add_test(pSuite, "test of delete object 2", test_database_operations_delete_object2)
@@ -49,6 +49,7 @@ void test_class_db_object(void);
 void test_class_db_value_set(void);
 void test_class_db_result(void);
 void test_class_db_result_list(void);
+void test_class_db_result_columns(void);
 void test_class_db_value(void);
 void test_class_end(void);
 
@@ -70,6 +71,8 @@ void test_database_operations_delete_object2(void);
 void test_database_operations_create_object3(void);
 void test_database_operations_delete_object3(void);
 void test_database_operations_read_all(void);
+void test_database_operations_read_columns(void);
+void test_database_operations_count_writes(void);
 void test_database_operations_count(void);
 
 void test_database_operations_read_object1_2(void);
@@ -569,6 +569,51 @@ void test_class_db_result_list(void) {
     CU_PASS("db_result_free");
 }
 
+void test_class_db_result_columns(void) {
+    db_result_columns_t* columns;
+    char long_text[20*1024];
+    size_t row;
+
+    CU_ASSERT_PTR_NULL(db_result_columns_new(0));
+    CU_ASSERT_PTR_NOT_NULL_FATAL((columns = db_result_columns_new(2)));
+    CU_ASSERT(db_result_columns_rows(columns) == 0);
+    CU_ASSERT(db_result_columns_set_int(columns, 0, 1));
+
+    memset(long_text, 'x', sizeof(long_text) - 1);
+    long_text[sizeof(long_text) - 1] = 0;
+    for (row = 0; row < 100; row++) {
+        CU_ASSERT_FATAL(!db_result_columns_add_row(columns));
+        CU_ASSERT(!db_result_columns_set_int(columns, 0, row));
+        if (row == 50) {
+            CU_ASSERT(!db_result_columns_set_text(columns, 1, long_text, strlen(long_text)));
+        }
+        else if (row % 2) {
+            CU_ASSERT(!db_result_columns_set_text(columns, 1, "test", 4));
+        }
+    }
+    CU_ASSERT(db_result_columns_set_int(columns, 2, 1));
+    CU_ASSERT(db_result_columns_rows(columns) == 100);
+    for (row = 0; row < 100; row++) {
+        CU_ASSERT(db_result_columns_int(columns, row, 0) == (db_type_int64_t)row);
+        if (row == 50) {
+            CU_ASSERT_PTR_NOT_NULL_FATAL(db_result_columns_text(columns, row, 1));
+            CU_ASSERT(!strcmp(db_result_columns_text(columns, row, 1), long_text));
+        }
+        else if (row % 2) {
+            CU_ASSERT_PTR_NOT_NULL_FATAL(db_result_columns_text(columns, row, 1));
+            CU_ASSERT(!strcmp(db_result_columns_text(columns, row, 1), "test"));
+        }
+        else {
+            CU_ASSERT_PTR_NULL(db_result_columns_text(columns, row, 1));
+        }
+    }
+    CU_ASSERT_PTR_NULL(db_result_columns_text(columns, 0, 0));
+    CU_ASSERT_PTR_NULL(db_result_columns_text(columns, 100, 1));
+
+    db_result_columns_free(columns);
+    CU_PASS("db_result_columns_free");
+}
+
 void test_class_db_value(void) {
     char* text = NULL;
     int ret;
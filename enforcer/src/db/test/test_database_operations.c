@@ -1184,6 +1184,33 @@ void test_database_operations_read_all(void) {
     CU_PASS("test_list_free");
 }
 
+void test_database_operations_read_columns(void) {
+    db_result_columns_t* columns;
+    size_t row, names3 = 0, names = 0;
+    const char* name;
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL((test_list = test_list_new(connection)));
+    CU_ASSERT_PTR_NOT_NULL_FATAL((columns = db_object_read_columns(test_list->dbo, NULL, NULL)));
+    CU_ASSERT(db_result_columns_rows(columns) == 3);
+    for (row = 0; row < db_result_columns_rows(columns); row++) {
+        CU_ASSERT(db_result_columns_int(columns, row, 0) > 0);
+        CU_ASSERT_PTR_NOT_NULL_FATAL((name = db_result_columns_text(columns, row, 1)));
+        if (!strcmp(name, "test")) {
+            names++;
+        }
+        else if (!strcmp(name, "name 3")) {
+            names3++;
+        }
+    }
+    CU_ASSERT(names == 1);
+    CU_ASSERT(names3 == 2);
+
+    db_result_columns_free(columns);
+    test_list_free(test_list);
+    test_list = NULL;
+    CU_PASS("test_list_free");
+}
+
 void test_database_operations_count(void) {
     CU_ASSERT_PTR_NOT_NULL_FATAL((test = test_new(connection)));
     CU_ASSERT(test_count_by_name(test, "test") == 1);
@@ -1195,6 +1222,20 @@ void test_database_operations_count(void) {
     CU_PASS("test_free");
 }
 
+void test_database_operations_count_writes(void) {
+    unsigned long writes;
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL((test = test_new(connection)));
+    writes = db_connection_writes();
+    CU_ASSERT_FATAL(!db_connection_transaction_begin(connection));
+    CU_ASSERT(test_count_by_name(test, "test") == 1);
+    CU_ASSERT(!db_connection_transaction_commit(connection));
+    CU_ASSERT(db_connection_writes() == writes);
+    test_free(test);
+    test = NULL;
+    CU_PASS("test_free");
+}
+
 void test_database_operations_read_object1_2(void) {
     CU_ASSERT_PTR_NOT_NULL_FATAL((test2 = test2_new(connection)));
     CU_ASSERT_FATAL(!test2_get_by_name(test2, "test"));
@@ -809,6 +809,49 @@ static void test_zone_list2(void) {
     CU_ASSERT_PTR_NULL(zone_list_db_next(object_list));
 }
 
+static void test_zone_create_many(void) {
+    zone_db_t* objects[3];
+    const zone_db_t* item;
+    db_value_t policy_id = DB_VALUE_EMPTY;
+    char name[16];
+    size_t i;
+
+    if (db_sqlite) {
+        CU_ASSERT(!db_value_from_int32(&policy_id, 1));
+    }
+    if (db_mysql) {
+        CU_ASSERT(!db_value_from_uint64(&policy_id, 1));
+    }
+    for (i = 0; i < 3; i++) {
+        CU_ASSERT_PTR_NOT_NULL_FATAL((objects[i] = zone_db_new(connection)));
+        snprintf(name, sizeof(name), "many %d", (int)i);
+        CU_ASSERT(!zone_db_set_policy_id(objects[i], &policy_id));
+        CU_ASSERT(!zone_db_set_name(objects[i], name));
+        CU_ASSERT(!zone_db_set_signconf_path(objects[i], "signconf_path 1"));
+        CU_ASSERT(!zone_db_set_next_change(objects[i], 3));
+        CU_ASSERT(!zone_db_set_input_adapter_uri(objects[i], "input_adapter_uri 1"));
+        CU_ASSERT(!zone_db_set_output_adapter_uri(objects[i], "output_adapter_uri 1"));
+    }
+    db_value_reset(&policy_id);
+    CU_ASSERT_FATAL(!zone_db_create_many(objects, 3));
+
+    CU_ASSERT_FATAL(!zone_list_db_get(object_list));
+    for (i = 0; i < 3; i++) {
+        CU_ASSERT_PTR_NOT_NULL_FATAL((item = zone_list_db_next(object_list)));
+        snprintf(name, sizeof(name), "many %d", (int)i);
+        CU_ASSERT(!strcmp(zone_db_name(item), name));
+        CU_ASSERT(zone_db_next_change(item) == 3);
+    }
+    CU_ASSERT_PTR_NULL(zone_list_db_next(object_list));
+
+    for (i = 0; i < 3; i++) {
+        snprintf(name, sizeof(name), "many %d", (int)i);
+        CU_ASSERT(!zone_db_get_by_name(objects[i], name));
+        CU_ASSERT(!zone_db_delete(objects[i]));
+        zone_db_free(objects[i]);
+    }
+}
+
 static void test_zone_end(void) {
     if (object) {
         zone_db_free(object);
@@ -842,6 +885,7 @@ static int test_zone_add_tests(CU_pSuite pSuite) {
         || !CU_add_test(pSuite, "verify fields after update (name)", test_zone_verify_name2)
         || !CU_add_test(pSuite, "delete object", test_zone_delete)
         || !CU_add_test(pSuite, "list objects to verify delete", test_zone_list2)
+        || !CU_add_test(pSuite, "create many objects", test_zone_create_many)
         || !CU_add_test(pSuite, "end test", test_zone_end))
     {
         return CU_get_error();
@@ -1203,12 +1203,7 @@ db_clause_t* zone_db_policy_id_clause(db_clause_list_t* clause_list, const db_va
     return clause;
 }
 
-int zone_db_create(zone_db_t* zone) {
-    db_object_field_list_t* object_field_list;
-    db_object_field_t* object_field;
-    db_value_set_t* value_set;
-    int ret;
-
+static int zone_db_create_check(const zone_db_t* zone) {
     if (!zone) {
         return DB_ERROR_UNKNOWN;
     }
@@ -1244,8 +1239,15 @@ int zone_db_create(zone_db_t* zone) {
     }
     /* TODO: validate content more */
 
+    return DB_OK;
+}
+
+static db_object_field_list_t* zone_db_create_object_field_list(void) {
+    db_object_field_list_t* object_field_list;
+    db_object_field_t* object_field;
+
     if (!(object_field_list = db_object_field_list_new())) {
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (!(object_field = db_object_field_new())
@@ -1255,7 +1257,7 @@ int zone_db_create(zone_db_t* zone) {
     {
         db_object_field_free(object_field);
         db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (!(object_field = db_object_field_new())
@@ -1265,7 +1267,7 @@ int zone_db_create(zone_db_t* zone) {
     {
         db_object_field_free(object_field);
         db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (!(object_field = db_object_field_new())
@@ -1275,7 +1277,7 @@ int zone_db_create(zone_db_t* zone) {
     {
         db_object_field_free(object_field);
         db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (!(object_field = db_object_field_new())
@@ -1285,7 +1287,7 @@ int zone_db_create(zone_db_t* zone) {
     {
         db_object_field_free(object_field);
         db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (!(object_field = db_object_field_new())
@@ -1295,7 +1297,7 @@ int zone_db_create(zone_db_t* zone) {
     {
         db_object_field_free(object_field);
         db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (!(object_field = db_object_field_new())
@@ -1305,7 +1307,7 @@ int zone_db_create(zone_db_t* zone) {
     {
         db_object_field_free(object_field);
         db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (!(object_field = db_object_field_new())
@@ -1315,7 +1317,7 @@ int zone_db_create(zone_db_t* zone) {
     {
         db_object_field_free(object_field);
         db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (!(object_field = db_object_field_new())
@@ -1325,7 +1327,7 @@ int zone_db_create(zone_db_t* zone) {
     {
         db_object_field_free(object_field);
         db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (!(object_field = db_object_field_new())
@@ -1335,7 +1337,7 @@ int zone_db_create(zone_db_t* zone) {
     {
         db_object_field_free(object_field);
         db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (!(object_field = db_object_field_new())
@@ -1345,7 +1347,7 @@ int zone_db_create(zone_db_t* zone) {
     {
         db_object_field_free(object_field);
         db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (!(object_field = db_object_field_new())
@@ -1355,7 +1357,7 @@ int zone_db_create(zone_db_t* zone) {
     {
         db_object_field_free(object_field);
         db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (!(object_field = db_object_field_new())
@@ -1365,7 +1367,7 @@ int zone_db_create(zone_db_t* zone) {
     {
         db_object_field_free(object_field);
         db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (!(object_field = db_object_field_new())
@@ -1375,7 +1377,7 @@ int zone_db_create(zone_db_t* zone) {
     {
         db_object_field_free(object_field);
         db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (!(object_field = db_object_field_new())
@@ -1385,7 +1387,7 @@ int zone_db_create(zone_db_t* zone) {
     {
         db_object_field_free(object_field);
         db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (!(object_field = db_object_field_new())
@@ -1395,7 +1397,7 @@ int zone_db_create(zone_db_t* zone) {
     {
         db_object_field_free(object_field);
         db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (!(object_field = db_object_field_new())
@@ -1405,7 +1407,7 @@ int zone_db_create(zone_db_t* zone) {
     {
         db_object_field_free(object_field);
         db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (!(object_field = db_object_field_new())
@@ -1415,7 +1417,7 @@ int zone_db_create(zone_db_t* zone) {
     {
         db_object_field_free(object_field);
         db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (!(object_field = db_object_field_new())
@@ -1425,12 +1427,17 @@ int zone_db_create(zone_db_t* zone) {
     {
         db_object_field_free(object_field);
         db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
+    return object_field_list;
+}
+
+static db_value_set_t* zone_db_create_value_set(const zone_db_t* zone) {
+    db_value_set_t* value_set;
+
     if (!(value_set = db_value_set_new(18))) {
-        db_object_field_list_free(object_field_list);
-        return DB_ERROR_UNKNOWN;
+        return NULL;
     }
 
     if (db_value_copy(db_value_set_get(value_set, 0), &(zone->policy_id))
@@ -1453,6 +1460,26 @@ int zone_db_create(zone_db_t* zone) {
         || db_value_from_uint32(db_value_set_get(value_set, 17), zone->next_csk_roll))
     {
         db_value_set_free(value_set);
+        return NULL;
+    }
+
+    return value_set;
+}
+
+int zone_db_create(zone_db_t* zone) {
+    db_object_field_list_t* object_field_list;
+    db_value_set_t* value_set;
+    int ret;
+
+    if ((ret = zone_db_create_check(zone))) {
+        return ret;
+    }
+
+    if (!(object_field_list = zone_db_create_object_field_list())) {
+        return DB_ERROR_UNKNOWN;
+    }
+
+    if (!(value_set = zone_db_create_value_set(zone))) {
         db_object_field_list_free(object_field_list);
         return DB_ERROR_UNKNOWN;
     }
@@ -1463,6 +1490,47 @@ int zone_db_create(zone_db_t* zone) {
     return ret;
 }
 
+int zone_db_create_many(zone_db_t* const* zones, size_t count) {
+    db_object_field_list_t* object_field_list;
+    db_value_set_t** value_sets;
+    size_t i;
+    int ret = DB_OK;
+
+    if (!zones || !count) {
+        return DB_ERROR_UNKNOWN;
+    }
+    for (i = 0; i < count; i++) {
+        if ((ret = zone_db_create_check(zones[i]))) {
+            return ret;
+        }
+    }
+
+    if (!(object_field_list = zone_db_create_object_field_list())) {
+        return DB_ERROR_UNKNOWN;
+    }
+    if (!(value_sets = calloc(count, sizeof(db_value_set_t*)))) {
+        db_object_field_list_free(object_field_list);
+        return DB_ERROR_UNKNOWN;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (!(value_sets[i] = zone_db_create_value_set(zones[i]))) {
+            ret = DB_ERROR_UNKNOWN;
+            break;
+        }
+    }
+    if (!ret) {
+        ret = db_object_create_many(zones[0]->dbo, object_field_list, (const db_value_set_t* const*)value_sets, count);
+    }
+
+    for (i = 0; i < count; i++) {
+        db_value_set_free(value_sets[i]);
+    }
+    free(value_sets);
+    db_object_field_list_free(object_field_list);
+    return ret;
+}
+
 int zone_db_get_by_id(zone_db_t* zone, const db_value_t* id) {
     db_clause_list_t* clause_list;
     db_clause_t* clause;
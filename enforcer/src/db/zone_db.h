@@ -410,6 +410,15 @@ db_clause_t* zone_db_policy_id_clause(db_clause_list_t* clause_list, const db_va
  */
 int zone_db_create(zone_db_t* zone);
 
+/**
+ * Create zone objects in the database with a single statement. The ids of the
+ * created zones are not set in the zone objects.
+ * \param[in] zones an array of `count` zone_db_t pointers.
+ * \param[in] count a size_t.
+ * \return DB_ERROR_* on failure, otherwise DB_OK.
+ */
+int zone_db_create_many(zone_db_t* const* zones, size_t count);
+
 /**
  * Get a zone object from the database by a id specified in `id`.
  * \param[in] zone a zone_db_t pointer.
@@ -51,6 +51,7 @@ autostart(engine_type* engine)
 	dbconn = get_database_connection(engine);
 
 	schedule_purge(engine->taskq); /* Remove old tasks in queue */
+	enforce_task_purge();
 
 	status = resalt_task_schedule(engine, dbconn);
 	if (status != ODS_STATUS_OK)
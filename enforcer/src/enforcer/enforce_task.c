@@ -37,6 +37,7 @@
 #include "signconf/signconf_task.h"
 #include "keystate/keystate_ds_submit_task.h"
 #include "keystate/keystate_ds_retract_task.h"
+#include "keystate/keystate_ds.h"
 #include "duration.h"
 #include "file.h"
 #include "log.h"
@@ -48,6 +49,18 @@
 
 static const char *module_str = "enforce_task";
 
+/* Seconds DS submissions and retractions are collected for a batched DS
+ * command before it is run for all of them at once. */
+#define DS_BATCH_WINDOW 5
+
+static void
+schedule_ds_task(engine_type *engine, task_type *task, int batched)
+{
+    if (!task) return;
+    if (batched) task->due_date = time_now() + DS_BATCH_WINDOW;
+    (void)schedule_task(engine->taskq, task, 1, 0);
+}
+
 static void
 schedule_ds_tasks(engine_type *engine, struct dbw_zone *zone)
 {
@@ -71,73 +84,410 @@ schedule_ds_tasks(engine_type *engine, struct dbw_zone *zone)
     /* Launch ds-submit task when one of the updated key states has the
      * DS_SUBMIT flag set. */
     if (bSubmitToParent) {
-        task_type *submit = keystate_ds_submit_task(engine, zone->name);
-        schedule_task(engine->taskq, submit, 1, 0);
+        int batched = keystate_ds_command_batched(
+            engine->config->delegation_signer_submit_command);
+        schedule_ds_task(engine, keystate_ds_submit_task(engine,
+            batched ? NULL : zone->name), batched);
     }
     /* Launch ds-retract task when one of the updated key states has the
      * DS_RETRACT flag set. */
     if (bRetractFromParent) {
-        task_type *retract = keystate_ds_retract_task(engine, zone->name);
-        schedule_task(engine->taskq, retract, 1, 0);
+        int batched = keystate_ds_command_batched(
+            engine->config->delegation_signer_retract_command);
+        schedule_ds_task(engine, keystate_ds_retract_task(engine,
+            batched ? NULL : zone->name), batched);
     }
 }
 
+/* Enforce zone in db without committing. Returns the time the zone must
+ * be enforced again, zone_updated is set when db must be committed. */
 static time_t
-perform_enforce(int sockfd, engine_type *engine, char const *zonename,
-    db_connection_t *dbconn)
+enforce_zone(engine_type *engine, struct dbw_db *db, struct dbw_zone *zone,
+    int *zone_updated)
 {
-    struct dbw_db *db = dbw_fetch(dbconn);
-    if (!db) {
-        ods_log_error("[%s] Error reading database", module_str);
-        return -1;
-    }
-    struct dbw_zone *zone = dbw_get_zone(db, zonename);
-    if (!zone) {
-        ods_log_error("[%s] Could not find zone %s in database", module_str, zonename);
-        dbw_free(db);
-        return -1;
-    }
     time_t t_next;
-    int zone_updated = 0;
     if (zone->policy->passthrough) {
         ods_log_info("Passing through zone %s.\n", zone->name);
         t_next = schedule_SUCCESS;
     } else {
-        t_next = update(engine, db, zone, time_now(), &zone_updated);
+        t_next = update(engine, db, zone, time_now(), zone_updated);
     }
-    /* Commit zone to database before we schedule signconf */
     if (zone->next_change != t_next && t_next >= 0) {
-        zone_updated = 1;
+        *zone_updated = 1;
         dbw_mark_dirty((struct dbrow *)zone);
     }
-    if (zone_updated) {
-        zone->next_change = t_next;
-        if (dbw_commit(db)) {
-            ods_log_error("[%s] Unable to commit changes to zone %s to "
-                "database, deferring.", module_str, zonename);
-            dbw_free(db);
-            return schedule_DEFER;
-        }
-    }
+    if (*zone_updated) zone->next_change = t_next;
+    return t_next;
+}
+
+/* Follow up on an enforced zone once its changes are committed */
+static void
+enforce_zone_committed(engine_type *engine, db_connection_t *dbconn,
+    struct dbw_zone *zone)
+{
     if (zone->signconf_needs_writing || zone->policy->passthrough) {
         /* We always write signconf on passthrough, but we won't schedule the
          * zone so the signconf will not be written over and over. Unless
          * scheduled by user or first start which is desirable. */
-        signconf_task_flush_zone(engine, dbconn, zonename);
+        signconf_task_flush_zone(engine, dbconn, zone->name);
     } else {
         ods_log_info("[%s] No changes to signconf file required for zone %s",
-            module_str, zonename);
+            module_str, zone->name);
     }
     schedule_ds_tasks(engine, zone);
+}
+
+static time_t
+perform_enforce(int sockfd, engine_type *engine, char const *zonename,
+    db_connection_t *dbconn)
+{
+    struct dbw_db *db = dbw_fetch_zone(dbconn, zonename);
+    if (!db) {
+        ods_log_error("[%s] Error reading database", module_str);
+        return -1;
+    }
+    struct dbw_zone *zone = dbw_get_zone(db, zonename);
+    if (!zone) {
+        ods_log_error("[%s] Could not find zone %s in database", module_str, zonename);
+        dbw_free(db);
+        return -1;
+    }
+    int zone_updated = 0;
+    time_t t_next = enforce_zone(engine, db, zone, &zone_updated);
+    /* Commit zone to database before we schedule signconf */
+    if (zone_updated && dbw_commit(db)) {
+        ods_log_error("[%s] Unable to commit changes to zone %s to "
+            "database, deferring.", module_str, zonename);
+        dbw_free(db);
+        return schedule_DEFER;
+    }
+    enforce_zone_committed(engine, dbconn, zone);
     dbw_free(db);
     return t_next;
 }
 
+/* Zones waiting for their next change. A binary min-heap on due time, so
+ * the zones that are due can be taken from the top, and a tree on name so
+ * each zone is in the heap only once. Protected by lock. */
+struct waiting_zone {
+    ldns_rbnode_t node;
+    char *name;
+    time_t due;
+    size_t pos; /* index in heap */
+};
+
+static struct {
+    pthread_mutex_t lock;
+    ldns_rbtree_t *names;
+    struct waiting_zone **heap;
+    size_t n;
+    size_t size;
+} waiting = {PTHREAD_MUTEX_INITIALIZER, NULL, NULL, 0, 0};
+
+/* Zones per enforce wave, enforced with a single read and commit */
+#define ENFORCE_WAVE_ZONES 64
+/* Seconds before retrying a wave that failed to read or commit */
+#define ENFORCE_WAVE_RETRY 60
+
+static int
+waiting_cmp(const void *a, const void *b)
+{
+    return strcmp((char const *)a, (char const *)b);
+}
+
+static void
+waiting_place(struct waiting_zone *wz, size_t pos)
+{
+    waiting.heap[pos] = wz;
+    wz->pos = pos;
+}
+
+static void
+waiting_sift_up(struct waiting_zone *wz)
+{
+    size_t pos = wz->pos;
+    while (pos > 0 && waiting.heap[(pos - 1) / 2]->due > wz->due) {
+        waiting_place(waiting.heap[(pos - 1) / 2], pos);
+        pos = (pos - 1) / 2;
+    }
+    waiting_place(wz, pos);
+}
+
+static void
+waiting_sift_down(struct waiting_zone *wz)
+{
+    size_t pos = wz->pos, child;
+    while ((child = 2 * pos + 1) < waiting.n) {
+        if (child + 1 < waiting.n
+            && waiting.heap[child + 1]->due < waiting.heap[child]->due)
+        {
+            child++;
+        }
+        if (waiting.heap[child]->due >= wz->due) break;
+        waiting_place(waiting.heap[child], pos);
+        pos = child;
+    }
+    waiting_place(wz, pos);
+}
+
+/* Let zone wait until due, or until its earlier due time if it is
+ * waiting already. Caller must hold waiting.lock. Returns 0 on success. */
+static int
+waiting_push(char const *zonename, time_t due)
+{
+    ldns_rbnode_t *node;
+    struct waiting_zone *wz;
+
+    if (!waiting.names && !(waiting.names = ldns_rbtree_create(waiting_cmp)))
+        return 1;
+    if ((node = ldns_rbtree_search(waiting.names, zonename))) {
+        wz = (struct waiting_zone *)node->data;
+        if (due < wz->due) {
+            wz->due = due;
+            waiting_sift_up(wz);
+        }
+        return 0;
+    }
+    if (waiting.n == waiting.size) {
+        size_t size = waiting.size ? 2 * waiting.size : 1024;
+        struct waiting_zone **heap = realloc(waiting.heap,
+            size * sizeof (struct waiting_zone *));
+        if (!heap) return 1;
+        waiting.heap = heap;
+        waiting.size = size;
+    }
+    if (!(wz = calloc(1, sizeof (struct waiting_zone)))) return 1;
+    if (!(wz->name = strdup(zonename))) {
+        free(wz);
+        return 1;
+    }
+    wz->due = due;
+    wz->node.key = wz->name;
+    wz->node.data = wz;
+    (void)ldns_rbtree_insert(waiting.names, &wz->node);
+    wz->pos = waiting.n++;
+    waiting_sift_up(wz);
+    return 0;
+}
+
+/* Remove the zone on top of the heap and return its name, to be freed by
+ * the caller. Caller must hold waiting.lock. */
+static char *
+waiting_pop(void)
+{
+    struct waiting_zone *wz = waiting.heap[0];
+    char *name = wz->name;
+
+    (void)ldns_rbtree_delete(waiting.names, name);
+    if (--waiting.n) {
+        waiting_place(waiting.heap[waiting.n], 0);
+        waiting_sift_down(waiting.heap[0]);
+    }
+    free(wz);
+    return name;
+}
+
+/* Due time of the first waiting zone, -1 if none. Caller must hold
+ * waiting.lock. */
+static time_t
+waiting_first(void)
+{
+    return waiting.n ? waiting.heap[0]->due : -1;
+}
+
+/* Number of zones due at now in the subheap at pos. Caller must hold
+ * waiting.lock. */
+static size_t
+waiting_count_due(size_t pos, time_t now)
+{
+    if (pos >= waiting.n || waiting.heap[pos]->due > now) return 0;
+    return 1 + waiting_count_due(2 * pos + 1, now)
+        + waiting_count_due(2 * pos + 2, now);
+}
+
+static time_t enforce_wave_perform(task_type *task, char const *owner,
+    void *userdata, void *context);
+
+/* Make sure a wave is scheduled for the first waiting zone. When one is
+ * already scheduled the scheduler keeps the earliest of the two. */
+static void
+enforce_wave_schedule(engine_type *engine)
+{
+    time_t due;
+
+    pthread_mutex_lock(&waiting.lock);
+    due = waiting_first();
+    pthread_mutex_unlock(&waiting.lock);
+    if (due < 0) return;
+    (void)schedule_task(engine->taskq, task_create(strdup("[enforce wave]"),
+        TASK_CLASS_ENFORCER, TASK_TYPE_ENFORCE, enforce_wave_perform, engine,
+        NULL, due), 1, 0);
+}
+
+/* Let zones wait until due and schedule a wave for them */
+static void
+enforce_wait(engine_type *engine, char const **zonenames, size_t n, time_t due)
+{
+    pthread_mutex_lock(&waiting.lock);
+    for (size_t i = 0; i < n; i++) {
+        if (waiting_push(zonenames[i], due)) {
+            ods_log_error("[%s] Memory allocation failure, zone %s will not "
+                "be enforced", module_str, zonenames[i]);
+        }
+    }
+    pthread_mutex_unlock(&waiting.lock);
+    enforce_wave_schedule(engine);
+}
+
+/* Enforce a zone of a wave that failed to commit on its own and let it
+ * wait for its next change. */
+static void
+enforce_wave_retry(engine_type *engine, db_connection_t *dbconn,
+    char const *zonename)
+{
+    time_t t_next = perform_enforce(-1, engine, zonename, dbconn);
+    if (t_next == schedule_DEFER) t_next = time_now() + ENFORCE_WAVE_RETRY;
+    if (t_next >= 0) enforce_wait(engine, &zonename, 1, t_next);
+}
+
+/* Enforce a wave of zones: read them in one go, update each and commit all
+ * of them at once. */
+static void
+enforce_wave(engine_type *engine, db_connection_t *dbconn, char **zonenames,
+    size_t n)
+{
+    time_t t_next[ENFORCE_WAVE_ZONES];
+    struct dbw_zone *zones[ENFORCE_WAVE_ZONES];
+    int updated = 0;
+    struct dbw_db *db;
+
+    if (!(db = dbw_fetch_zones(dbconn, (char const **)zonenames, n,
+            DBW_F_ALL))) {
+        ods_log_error("[%s] Error reading database, deferring %zu zones",
+            module_str, n);
+        enforce_wait(engine, (char const **)zonenames, n,
+            time_now() + ENFORCE_WAVE_RETRY);
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        int zone_updated = 0;
+        t_next[i] = -1;
+        if (!(zones[i] = dbw_get_zone(db, zonenames[i]))) {
+            /* Deleted while it was waiting */
+            ods_log_info("[%s] Zone %s no longer in database, not enforcing",
+                module_str, zonenames[i]);
+            continue;
+        }
+        t_next[i] = enforce_zone(engine, db, zones[i], &zone_updated);
+        updated |= zone_updated;
+    }
+    /* Commit zones to database before we schedule signconf */
+    if (updated && dbw_commit(db)) {
+        /* Usually a single zone conflicts with another commit, don't let
+         * it hold up the others. */
+        ods_log_warning("[%s] Unable to commit changes to %zu zones to "
+            "database, enforcing them one by one.", module_str, n);
+        for (size_t i = 0; i < n; i++) {
+            if (zones[i]) enforce_wave_retry(engine, dbconn, zonenames[i]);
+        }
+        dbw_free(db);
+        return;
+    }
+    pthread_mutex_lock(&waiting.lock);
+    for (size_t i = 0; i < n; i++) {
+        if (t_next[i] < 0) continue;
+        if (waiting_push(zonenames[i], t_next[i])) {
+            ods_log_error("[%s] Memory allocation failure, zone %s will not "
+                "be enforced", module_str, zonenames[i]);
+        }
+    }
+    pthread_mutex_unlock(&waiting.lock);
+    for (size_t i = 0; i < n; i++) {
+        if (zones[i]) enforce_zone_committed(engine, dbconn, zones[i]);
+    }
+    dbw_free(db);
+}
+
+/* One of the tasks working through the zones that are due, a wave at a
+ * time. Runs again as long as zones are due. */
+static time_t
+enforce_wave_worker_perform(task_type *task, char const *owner,
+    void *userdata, void *context)
+{
+    engine_type *engine = (engine_type *)userdata;
+    char *zonenames[ENFORCE_WAVE_ZONES];
+    time_t now = time_now(), due;
+    size_t n = 0;
+
+    pthread_mutex_lock(&waiting.lock);
+    while (n < ENFORCE_WAVE_ZONES && (due = waiting_first()) >= 0
+        && due <= now)
+    {
+        zonenames[n++] = waiting_pop();
+    }
+    pthread_mutex_unlock(&waiting.lock);
+    if (n) {
+        ods_log_debug("[%s] Enforcing wave of %zu zones", module_str, n);
+        enforce_wave(engine, (db_connection_t *)context, zonenames, n);
+    }
+    for (size_t i = 0; i < n; i++) free(zonenames[i]);
+
+    pthread_mutex_lock(&waiting.lock);
+    due = waiting_first();
+    pthread_mutex_unlock(&waiting.lock);
+    if (due >= 0 && due <= time_now()) return schedule_PROMPTLY;
+    enforce_wave_schedule(engine);
+    return schedule_SUCCESS;
+}
+
+/* Start enough workers for the zones that are due, at most one per worker
+ * thread. */
+static time_t
+enforce_wave_perform(task_type *task, char const *owner, void *userdata,
+    void *context)
+{
+    engine_type *engine = (engine_type *)userdata;
+    size_t workers = 1, due;
+    char name[32];
+    time_t now = time_now();
+
+    if (engine->config->num_worker_threads_enforcer > 1)
+        workers = engine->config->num_worker_threads_enforcer;
+    pthread_mutex_lock(&waiting.lock);
+    due = waiting_count_due(0, now);
+    pthread_mutex_unlock(&waiting.lock);
+    if (!due) {
+        /* Taken by workers still running, or no longer due */
+        enforce_wave_schedule(engine);
+        return schedule_SUCCESS;
+    }
+    if (due > ENFORCE_WAVE_ZONES * workers) {
+        ods_log_info("[%s] Enforcing %zu zones in waves of %d", module_str,
+            due, ENFORCE_WAVE_ZONES);
+    }
+    if (workers > (due + ENFORCE_WAVE_ZONES - 1) / ENFORCE_WAVE_ZONES)
+        workers = (due + ENFORCE_WAVE_ZONES - 1) / ENFORCE_WAVE_ZONES;
+    for (size_t w = 0; w < workers; w++) {
+        /* A fixed set of owners, the scheduler keeps a lock per owner */
+        snprintf(name, sizeof (name), "[enforce wave %zu]", w + 1);
+        (void)schedule_task(engine->taskq, task_create(strdup(name),
+            TASK_CLASS_ENFORCER, TASK_TYPE_ENFORCE,
+            enforce_wave_worker_perform, engine, NULL, now), 1, 0);
+    }
+    return schedule_SUCCESS;
+}
+
 time_t
 enforce_task_perform(task_type* task, char const *owner, void *userdata, void *context)
 {
     db_connection_t* dbconn = (db_connection_t*) context;
-    return perform_enforce(-1, (engine_type *)userdata, owner, dbconn);
+    engine_type *engine = (engine_type *)userdata;
+    time_t t_next = perform_enforce(-1, engine, owner, dbconn);
+    /* Next time the zone is enforced in a wave together with other zones
+     * due at the same time. */
+    if (t_next < 0) return t_next;
+    enforce_wait(engine, &owner, 1, t_next);
+    return schedule_SUCCESS;
 }
 
 task_type *
@@ -153,23 +503,77 @@ enforce_task_flush_zone(engine_type *engine, char const *zonename)
     (void)schedule_task(engine->taskq, enforce_task(engine, zonename), 1, 0);
 }
 
+void
+enforce_task_flush_zones(engine_type *engine, char const **zonenames, size_t n)
+{
+    enforce_wait(engine, zonenames, n, time_now());
+}
+
 void
 enforce_task_flush_policy(engine_type *engine, struct dbw_policy *policy)
 {
+    time_t now = time_now();
+    pthread_mutex_lock(&waiting.lock);
     for (size_t z = 0; z < policy->zone_count; z++) {
-        struct dbw_zone *zone = policy->zone[z];
-        (void)schedule_task(engine->taskq, enforce_task(engine, zone->name), 1, 0);
+        if (waiting_push(policy->zone[z]->name, now)) {
+            ods_log_error("[%s] Memory allocation failure, zone %s will not "
+                "be enforced", module_str, policy->zone[z]->name);
+        }
     }
+    pthread_mutex_unlock(&waiting.lock);
+    enforce_wave_schedule(engine);
 }
 
 void
 enforce_task_flush_all(engine_type *engine, db_connection_t *dbconn)
 {
+    time_t now = time_now();
     struct dbw_db *db = dbw_fetch(dbconn);
     if (!db) ods_fatal_exit("[%s] failed to list zones from DB", module_str);
+    pthread_mutex_lock(&waiting.lock);
     for (size_t z = 0; z < db->zones->n; z++) {
         struct dbw_zone *zone = (struct dbw_zone *)db->zones->set[z];
-        (void)schedule_task(engine->taskq, enforce_task(engine, zone->name), 1, 0);
+        if (waiting_push(zone->name, now)) {
+            ods_log_error("[%s] Memory allocation failure, zone %s will not "
+                "be enforced", module_str, zone->name);
+        }
     }
+    pthread_mutex_unlock(&waiting.lock);
     dbw_free(db);
+    enforce_wave_schedule(engine);
+}
+
+void
+enforce_task_flush_waiting(engine_type *engine)
+{
+    time_t now = time_now();
+    pthread_mutex_lock(&waiting.lock);
+    /* All equal due times keep the heap ordered */
+    for (size_t i = 0; i < waiting.n; i++) waiting.heap[i]->due = now;
+    pthread_mutex_unlock(&waiting.lock);
+    enforce_wave_schedule(engine);
+}
+
+size_t
+enforce_task_waiting(time_t *first)
+{
+    size_t n;
+    pthread_mutex_lock(&waiting.lock);
+    n = waiting.n;
+    if (first) *first = waiting_first();
+    pthread_mutex_unlock(&waiting.lock);
+    return n;
+}
+
+void
+enforce_task_purge(void)
+{
+    pthread_mutex_lock(&waiting.lock);
+    while (waiting.n) free(waiting_pop());
+    free(waiting.heap);
+    waiting.heap = NULL;
+    waiting.size = 0;
+    if (waiting.names) ldns_rbtree_free(waiting.names);
+    waiting.names = NULL;
+    pthread_mutex_unlock(&waiting.lock);
 }
@@ -40,13 +40,29 @@ task_type *enforce_task(engine_type *engine, char const *owner);
 time_t enforce_task_perform(task_type* task, char const *owner, void *context,
     void *dbconn);
 
-/* Schedule enforce tasks for *now* for zone. */
+/* Schedule enforce tasks for *now* for zone. Once enforced every zone
+ * waits for its next change, zones due together are enforced in a wave. */
 void enforce_task_flush_zone(engine_type *engine, char const *zonename);
 
-/* Schedule enforce tasks for *now* for ALL zones of policy. */
+/* Enforce a large number of zones *now*, in waves that share a single
+ * database read and commit. */
+void enforce_task_flush_zones(engine_type *engine, char const **zonenames,
+    size_t n);
+
+/* Enforce ALL zones of policy *now*, in waves. */
 void enforce_task_flush_policy(engine_type *engine, struct dbw_policy *policy);
 
-/* Schedule enforce tasks for *now* for ALL zones. */
+/* Enforce ALL zones *now*, in waves. */
 void enforce_task_flush_all(engine_type *engine, db_connection_t *dbconn);
 
+/* Enforce all zones waiting for their next change *now*. */
+void enforce_task_flush_waiting(engine_type *engine);
+
+/* Number of zones waiting for their next change. When first is not NULL it
+ * is set to the due time of the first of them, -1 if none. */
+size_t enforce_task_waiting(time_t *first);
+
+/* Forget all zones waiting for their next change. */
+void enforce_task_purge(void);
+
 #endif
@@ -116,6 +116,128 @@ getState(struct dbw_key* key, enum dbw_keystate_type type)
     return dbw_get_keystate(key, type)->state;
 }
 
+/* Number of record states, NA included, and of their combinations over
+ * the 4 record types of a key. */
+#define STATES 5
+#define COMBINATIONS (STATES * STATES * STATES * STATES)
+
+/**
+ * Keys of one algorithm in a zone, counted by the states of their records.
+ */
+struct algorithm_counters {
+    int algorithm;
+    int combination[COMBINATIONS]; /* keys per combination of 4 states */
+    int state[4][STATES]; /* keys per state of each record type */
+};
+
+/**
+ * Counters of all keys of a zone. Built when updateZone() starts and kept
+ * current by setState(), so the rules can tell whether a key in some state
+ * exists without visiting every key. Functions given NULL counters scan
+ * the keys instead.
+ */
+struct zone_counters {
+    size_t n;
+    struct algorithm_counters *alg;
+};
+
+static int
+combination(struct dbw_key *key)
+{
+    return getState(key, DBW_DS) + STATES * (getState(key, DBW_RRSIG)
+        + STATES * (getState(key, DBW_DNSKEY)
+        + STATES * getState(key, DBW_RRSIGDNSKEY)));
+}
+
+static struct algorithm_counters *
+counters_for(struct zone_counters *zc, int algorithm)
+{
+    for (size_t a = 0; a < zc->n; a++) {
+        if (zc->alg[a].algorithm == algorithm) return &zc->alg[a];
+    }
+    return NULL;
+}
+
+static void
+count_key(struct zone_counters *zc, struct dbw_key *key, int delta)
+{
+    struct algorithm_counters *ac = counters_for(zc, key->algorithm);
+    if (!ac) {
+        ac = &zc->alg[zc->n++];
+        ac->algorithm = key->algorithm;
+    }
+    ac->combination[combination(key)] += delta;
+    for (int t = 0; t < 4; t++)
+        ac->state[t][getState(key, t)] += delta;
+}
+
+/**
+ * Count the keys of zone.
+ *
+ * \return 0 on success, 1 if the counters can't be used.
+ */
+static int
+zone_counters_init(struct zone_counters *zc, struct dbw_zone *zone)
+{
+    zc->n = 0;
+    zc->alg = NULL;
+    for (size_t k = 0; k < zone->key_count; k++) {
+        if (zone->key[k]->keystate_count < 4) return 1;
+        for (int t = 0; t < 4; t++) {
+            struct dbw_keystate *keystate = dbw_get_keystate(zone->key[k], t);
+            if (!keystate || keystate->state > NA) return 1;
+        }
+    }
+    if (zone->key_count
+        && !(zc->alg = calloc(zone->key_count, sizeof (struct algorithm_counters))))
+        return 1;
+    for (size_t k = 0; k < zone->key_count; k++)
+        count_key(zc, zone->key[k], 1);
+    return 0;
+}
+
+/**
+ * Change the state of a record, keeping zc current.
+ */
+static void
+setState(struct zone_counters *zc, struct dbw_keystate *keystate,
+    enum dbw_keystate_state state)
+{
+    if (zc) count_key(zc, keystate->key, -1);
+    keystate->state = state;
+    if (zc) count_key(zc, keystate->key, 1);
+}
+
+/**
+ * Test if keys of an algorithm with specific states are counted.
+ *
+ * \return 1 on match, 0 otherwise
+ */
+static int
+counted(struct algorithm_counters *ac, const enum dbw_keystate_state mask[4])
+{
+    int lo[4], hi[4], fixed = 0, type = 0;
+
+    for (int i = 0; i < 4; i++) {
+        if (mask[i] == NA) {
+            lo[i] = 0;
+            hi[i] = STATES - 1;
+        } else {
+            lo[i] = hi[i] = mask[i];
+            fixed++;
+            type = i;
+        }
+    }
+    if (fixed == 1) return ac->state[type][mask[type]] > 0;
+    for (int d = lo[3]; d <= hi[3]; d++)
+        for (int c = lo[2]; c <= hi[2]; c++)
+            for (int b = lo[1]; b <= hi[1]; b++)
+                for (int a = lo[0]; a <= hi[0]; a++)
+                    if (ac->combination[a + STATES * (b + STATES * (c + STATES * d))])
+                        return 1;
+    return 0;
+}
+
 /**
  * Given goal and state, what will be the next state?
  *
@@ -175,9 +297,16 @@ match(struct dbw_key *key, int algorithm, int same_algorithm,
  * \return A positive value if a key exists, zero if a key does not exists.
  */
 static int
-exists(struct dbw_zone *zone, int algorithm, int same_algorithm,
-    const enum dbw_keystate_state mask[4])
+exists(struct dbw_zone *zone, struct zone_counters *zc, int algorithm,
+    int same_algorithm, const enum dbw_keystate_state mask[4])
 {
+    if (zc) {
+        for (size_t a = 0; a < zc->n; a++) {
+            if (same_algorithm && zc->alg[a].algorithm != algorithm) continue;
+            if (counted(&zc->alg[a], mask)) return 1;
+        }
+        return 0;
+    }
     for (size_t k = 0; k < zone->key_count; k++) {
         struct dbw_key *key = zone->key[k];
         if (match(key, algorithm, same_algorithm, mask)) return 1;
@@ -250,14 +379,38 @@ dependencies_for_type(struct dbw_keydependency **deplist, int count,
     return c;
 }
 
+/*
+ * Test whether there is a key matching smask without any dependency of
+ * this type, a potential successor for any key.
+ */
+static int
+exists_unencumbered(struct dbw_zone *zone,
+    const enum dbw_keystate_state smask[4], int algorithm,
+    enum dbw_keystate_type type)
+{
+    for (size_t kk = 0; kk < zone->key_count; kk++) {
+        struct dbw_key *S = zone->key[kk];
+        if (!match(S, algorithm, 1, smask)) continue;
+        /* We found a potential S, now test whether it is unencumbered. */
+        if (dependencies_for_type(S->to_keydependency, S->to_keydependency_count, type) != 0)
+            continue;
+        if (dependencies_for_type(S->from_keydependency, S->from_keydependency_count, type) != 0)
+            continue;
+        return 1; /* it is! */
+    }
+    return 0;
+}
+
 /*
  * Given a predecessor key P that matches pmask test whether there is a
- * key S (and an arbitrary amount of P' keys in between) that matches smask
+ * key S (and an arbitrary amount of P' keys in between) that matches smask.
+ * *unencumbered caches exists_unencumbered(), which does not depend on P,
+ * -1 if not known yet.
  */
 static int
 find_succ(struct dbw_key *P, const enum dbw_keystate_state pmask[4],
     const enum dbw_keystate_state smask[4], int algorithm,
-    enum dbw_keystate_type type)
+    enum dbw_keystate_type type, int *unencumbered)
 {
     /* recursive definition */
     for (size_t d = 0; d < P->from_keydependency_count; d++) {
@@ -268,7 +421,7 @@ find_succ(struct dbw_key *P, const enum dbw_keystate_state pmask[4],
         if (match(PP, algorithm, 1, smask)) return 1;
         /* This was not S. Is it a P'? */
         if (!match(PP, algorithm, 1, pmask)) continue;
-        if (find_succ(PP, pmask, smask, algorithm, type)) return 1;
+        if (find_succ(PP, pmask, smask, algorithm, type, unencumbered)) return 1;
     }
     /* From the last P' to S there might not yet been a dependency defined.
      * Test if this is the case. */
@@ -276,17 +429,9 @@ find_succ(struct dbw_key *P, const enum dbw_keystate_state pmask[4],
     if (dependencies_for_type(P->from_keydependency, P->from_keydependency_count, type) != 0)
         return 0;
     /* Scan for potential S */
-    for (size_t kk = 0; kk < P->zone->key_count; kk++) {
-        struct dbw_key *S = P->zone->key[kk];
-        if (!match(S, algorithm, 1, smask)) continue;
-        /* We found a potential S, now test whether it is unencumbered. */
-        if (dependencies_for_type(S->to_keydependency, S->to_keydependency_count, type) != 0)
-            continue;
-        if (dependencies_for_type(S->from_keydependency, S->from_keydependency_count, type) != 0)
-            continue;
-        return 1; /* it is! */
-    }
-    return 0;
+    if (*unencumbered == -1)
+        *unencumbered = exists_unencumbered(P->zone, smask, algorithm, type);
+    return *unencumbered;
 }
 
 static int
@@ -316,10 +461,16 @@ first_of_dependency_chain(struct dbw_key *P, enum dbw_keystate_type type)
  * \return A positive value if a key exists, zero if a key does not exists
  */
 static int
-exists_with_successor(struct dbw_zone *zone, int algorithm, int same_algorithm,
+exists_with_successor(struct dbw_zone *zone, struct zone_counters *zc,
+    int algorithm, int same_algorithm,
     const enum dbw_keystate_state pmask[4],
     const enum dbw_keystate_state smask[4], enum dbw_keystate_type type)
 {
+    int unencumbered = -1;
+    /* Both P and S must exist */
+    if (!exists(zone, zc, algorithm, 1, pmask)
+        || !exists(zone, zc, algorithm, 1, smask))
+        return 0;
     /* try all keys */
     for (size_t k = 0; k < zone->key_count; k++) {
         struct dbw_key *P = zone->key[k];
@@ -328,7 +479,7 @@ exists_with_successor(struct dbw_zone *zone, int algorithm, int same_algorithm,
         /* must match pmask */
         if (!match(P, algorithm, 1, pmask)) continue;
         /* find S*/
-        if (find_succ(P, pmask, smask, algorithm, type)) return 1;
+        if (find_succ(P, pmask, smask, algorithm, type, &unencumbered)) return 1;
 
     }
     return 0;
@@ -346,6 +497,10 @@ static int
 unsignedOk(struct dbw_zone *zone, int algorithm, const enum dbw_keystate_state mask[4],
     enum dbw_keystate_type type)
 {
+    /* The outcome for a key only depends on its state and its DS at
+     * parent, look each combination up once. */
+    signed char known[STATES][DBW_DS_AT_PARENT_GONE+1];
+    memset(known, -1, sizeof (known));
     /* collect the amount of keys in each state */
     for (size_t k = 0; k < zone->key_count; k++) {
         struct dbw_key *key = zone->key[k];
@@ -358,7 +513,14 @@ unsignedOk(struct dbw_zone *zone, int algorithm, const enum dbw_keystate_state m
     if (cmp_mask[type] == HIDDEN || cmp_mask[type] == NA) continue;
 
     cmp_mask[DBW_DS] = NA;
-    if  (!exists_with_ds_state(zone, algorithm, 1, cmp_mask, key->ds_at_parent)) return 0;
+    if (cmp_mask[type] >= STATES || key->ds_at_parent > DBW_DS_AT_PARENT_GONE) {
+        if (!exists_with_ds_state(zone, algorithm, 1, cmp_mask, key->ds_at_parent)) return 0;
+        continue;
+    }
+    signed char *ok = &known[cmp_mask[type]][key->ds_at_parent];
+    if (*ok == -1)
+        *ok = exists_with_ds_state(zone, algorithm, 1, cmp_mask, key->ds_at_parent);
+    if (!*ok) return 0;
     }
 
    return 1;
@@ -368,8 +530,13 @@ unsignedOk(struct dbw_zone *zone, int algorithm, const enum dbw_keystate_state m
  *
  * \return 0 if !HIDDEN DS is found, 1 if no such DS where found */
 static int
-all_DS_hidden(struct dbw_zone *zone, int algorithm)
+all_DS_hidden(struct dbw_zone *zone, struct zone_counters *zc, int algorithm)
 {
+    if (zc) {
+        struct algorithm_counters *ac = counters_for(zc, algorithm);
+        return !ac || !(ac->state[DBW_DS][RUMOURED]
+            + ac->state[DBW_DS][OMNIPRESENT] + ac->state[DBW_DS][UNRETENTIVE]);
+    }
     for (size_t k = 0; k < zone->key_count; k++) {
         struct dbw_key *key = zone->key[k];
         if (key->algorithm != algorithm) continue;
@@ -386,7 +553,7 @@ all_DS_hidden(struct dbw_zone *zone, int algorithm)
  * apply
  */
 static int
-rule1(struct dbw_zone *zone, int algorithm)
+rule1(struct dbw_zone *zone, struct zone_counters *zc, int algorithm)
 {
     static const enum dbw_keystate_state mask[2][4] = {
         { OMNIPRESENT, NA, NA, NA },/* a good key state.  */
@@ -395,9 +562,9 @@ rule1(struct dbw_zone *zone, int algorithm)
     /* Return positive value if any of the masks are found.  */
 #ifdef DEBUG_ENFORCER_LOGIC
     ods_log_error("DEBUG rule1");
-    ods_log_error("%d %d", exists(zone, algorithm, 0, mask[0]), exists(zone, algorithm, 0, mask[1]));
+    ods_log_error("%d %d", exists(zone, zc, algorithm, 0, mask[0]), exists(zone, zc, algorithm, 0, mask[1]));
 #endif
-    return (exists(zone, algorithm, 0, mask[0]) || exists(zone, algorithm, 0, mask[1]));
+    return (exists(zone, zc, algorithm, 0, mask[0]) || exists(zone, zc, algorithm, 0, mask[1]));
 }
 
 /**
@@ -407,7 +574,7 @@ rule1(struct dbw_zone *zone, int algorithm)
  * apply
  */
 static int
-rule2(struct dbw_zone *zone, int algorithm)
+rule2(struct dbw_zone *zone, struct zone_counters *zc, int algorithm)
 {
     static const enum dbw_keystate_state  mask[8][4] = {
         { OMNIPRESENT, NA, OMNIPRESENT, OMNIPRESENT },/*good key state.*/
@@ -422,20 +589,20 @@ rule2(struct dbw_zone *zone, int algorithm)
     /* Return positive value if any of the masks are found.  */
 #ifdef DEBUG_ENFORCER_LOGIC
         ods_log_error("DEBUG rule2");
-        ods_log_error("%d %d %d %d %d %d %d", exists(zone, algorithm, 1, mask[0])
-            , exists_with_successor(zone, algorithm, 1, mask[2], mask[1], DBW_DS)
-            , exists_with_successor(zone, algorithm, 1, mask[5], mask[3], DBW_DNSKEY)
-            , exists_with_successor(zone, algorithm, 1, mask[5], mask[4], DBW_DNSKEY)
-            , exists_with_successor(zone, algorithm, 1, mask[6], mask[3], DBW_DNSKEY)
-            , exists_with_successor(zone, algorithm, 1, mask[6], mask[4], DBW_DNSKEY)
+        ods_log_error("%d %d %d %d %d %d %d", exists(zone, zc, algorithm, 1, mask[0])
+            , exists_with_successor(zone, zc, algorithm, 1, mask[2], mask[1], DBW_DS)
+            , exists_with_successor(zone, zc, algorithm, 1, mask[5], mask[3], DBW_DNSKEY)
+            , exists_with_successor(zone, zc, algorithm, 1, mask[5], mask[4], DBW_DNSKEY)
+            , exists_with_successor(zone, zc, algorithm, 1, mask[6], mask[3], DBW_DNSKEY)
+            , exists_with_successor(zone, zc, algorithm, 1, mask[6], mask[4], DBW_DNSKEY)
             , unsignedOk(zone, algorithm, mask[7], DBW_DS));
 #endif
-    return (exists(zone, algorithm, 1, mask[0])
-        || exists_with_successor(zone, algorithm, 1, mask[2], mask[1], DBW_DS)
-        || exists_with_successor(zone, algorithm, 1, mask[5], mask[3], DBW_DNSKEY)
-        || exists_with_successor(zone, algorithm, 1, mask[5], mask[4], DBW_DNSKEY)
-        || exists_with_successor(zone, algorithm, 1, mask[6], mask[3], DBW_DNSKEY)
-        || exists_with_successor(zone, algorithm, 1, mask[6], mask[4], DBW_DNSKEY)
+    return (exists(zone, zc, algorithm, 1, mask[0])
+        || exists_with_successor(zone, zc, algorithm, 1, mask[2], mask[1], DBW_DS)
+        || exists_with_successor(zone, zc, algorithm, 1, mask[5], mask[3], DBW_DNSKEY)
+        || exists_with_successor(zone, zc, algorithm, 1, mask[5], mask[4], DBW_DNSKEY)
+        || exists_with_successor(zone, zc, algorithm, 1, mask[6], mask[3], DBW_DNSKEY)
+        || exists_with_successor(zone, zc, algorithm, 1, mask[6], mask[4], DBW_DNSKEY)
         || unsignedOk(zone, algorithm, mask[7], DBW_DS));
 }
 
@@ -446,7 +613,7 @@ rule2(struct dbw_zone *zone, int algorithm)
  * apply
  */
 static int
-rule3(struct dbw_zone *zone, int algorithm)
+rule3(struct dbw_zone *zone, struct zone_counters *zc, int algorithm)
 {
     static const enum dbw_keystate_state  mask[6][4] = {
         { NA, OMNIPRESENT, OMNIPRESENT, NA },/* good key state. */
@@ -458,18 +625,18 @@ rule3(struct dbw_zone *zone, int algorithm)
     };
 #ifdef DEBUG_ENFORCER_LOGIC
         ods_log_error("DEBUG rule3");
-        ods_log_error("%d %d %d %d %d", exists(zone, algorithm, 1, mask[0])
-        , exists_with_successor(zone, algorithm, 1, mask[2], mask[1], DBW_DNSKEY)
-        , exists_with_successor(zone, algorithm, 1, mask[4], mask[3], DBW_RRSIG)
+        ods_log_error("%d %d %d %d %d", exists(zone, zc, algorithm, 1, mask[0])
+        , exists_with_successor(zone, zc, algorithm, 1, mask[2], mask[1], DBW_DNSKEY)
+        , exists_with_successor(zone, zc, algorithm, 1, mask[4], mask[3], DBW_RRSIG)
         , unsignedOk(zone, algorithm, mask[5], DBW_DNSKEY)
-        , all_DS_hidden(zone, algorithm));
+        , all_DS_hidden(zone, zc, algorithm));
 #endif
     /* Return positive value if any of the masks are found. */
-    return (exists(zone, algorithm, 1, mask[0])
-        || exists_with_successor(zone, algorithm, 1, mask[2], mask[1], DBW_DNSKEY)
-        || exists_with_successor(zone, algorithm, 1, mask[4], mask[3], DBW_RRSIG)
+    return (exists(zone, zc, algorithm, 1, mask[0])
+        || exists_with_successor(zone, zc, algorithm, 1, mask[2], mask[1], DBW_DNSKEY)
+        || exists_with_successor(zone, zc, algorithm, 1, mask[4], mask[3], DBW_RRSIG)
         || unsignedOk(zone, algorithm, mask[5], DBW_DNSKEY)
-        || all_DS_hidden(zone, algorithm));
+        || all_DS_hidden(zone, zc, algorithm));
 }
 
 /**
@@ -478,8 +645,9 @@ rule3(struct dbw_zone *zone, int algorithm)
  * \return A positive value if the transition is allowed, zero if it is not.
  */
 static int
-dnssecApproval(struct dbw_zone *zone, struct dbw_key *key, enum dbw_keystate_type type,
-    enum dbw_keystate_state next_state, int allow_unsigned)
+dnssecApproval(struct dbw_zone *zone, struct zone_counters *zc, struct dbw_key *key,
+    enum dbw_keystate_type type, enum dbw_keystate_state next_state,
+    int allow_unsigned)
 {
     /* Check if DNSSEC state will be invalid by the transition by checking that
      * all 3 DNSSEC rules apply. Rule 1 only applies if we are not allowing an
@@ -500,20 +668,20 @@ dnssecApproval(struct dbw_zone *zone, struct dbw_key *key, enum dbw_keystate_typ
     int after_change = 0;
 
     /* set flag for each rule */
-    before_change |= ( rule1(zone, key->algorithm) << 0 );
-    before_change |= ( rule2(zone, key->algorithm) << 1 );
-    before_change |= ( rule3(zone, key->algorithm) << 2 );
+    before_change |= ( rule1(zone, zc, key->algorithm) << 0 );
+    before_change |= ( rule2(zone, zc, key->algorithm) << 1 );
+    before_change |= ( rule3(zone, zc, key->algorithm) << 2 );
 
     /* safe current state, apply change and test again.*/
     struct dbw_keystate *keystate = dbw_get_keystate(key, type);
     int current_state = keystate->state;
-    keystate->state = next_state;
+    setState(zc, keystate, next_state);
         /* if we make the rules more sophisticated by using the timing information
          * as well, we also need to set last_change to now here.  */
-        after_change |= ( rule1(zone, key->algorithm) << 0 );
-        after_change |= ( rule2(zone, key->algorithm) << 1 );
-        after_change |= ( rule3(zone, key->algorithm) << 2 );
-    keystate->state = current_state; /* restore */
+        after_change |= ( rule1(zone, zc, key->algorithm) << 0 );
+        after_change |= ( rule2(zone, zc, key->algorithm) << 1 );
+        after_change |= ( rule3(zone, zc, key->algorithm) << 2 );
+    setState(zc, keystate, current_state); /* restore */
 
     /* before => after (implication)
      * If one of the rules isn't satisfied in the before situation we allow
@@ -577,8 +745,8 @@ minTransitionTime(const struct dbw_policy *policy, enum dbw_keystate_type type,
  * a negative value if an error occurred.
  */
 static int
-policyApproval(struct dbw_zone *zone, struct dbw_key *key, enum dbw_keystate_type type,
-    enum dbw_keystate_state next_state)
+policyApproval(struct dbw_zone *zone, struct zone_counters *zc, struct dbw_key *key,
+    enum dbw_keystate_type type, enum dbw_keystate_state next_state)
 {
     static const enum dbw_keystate_state mask[14][4] = {
         /*ZSK*/
@@ -633,9 +801,9 @@ policyApproval(struct dbw_zone *zone, struct dbw_key *key, enum dbw_keystate_typ
         }
         /* We might be doing an algorithm rollover so we check if there are
          * no other good KSK available and ignore the minimize flag if so. */
-        return !exists(zone, key->algorithm, 1, mask[6])
-            && !exists_with_successor(zone, key->algorithm, 1, mask[8], mask[7], DBW_DS)
-            && !exists_with_successor(zone, key->algorithm, 1, mask[11], mask[9], DBW_DNSKEY);
+        return !exists(zone, zc, key->algorithm, 1, mask[6])
+            && !exists_with_successor(zone, zc, key->algorithm, 1, mask[8], mask[7], DBW_DS)
+            && !exists_with_successor(zone, zc, key->algorithm, 1, mask[11], mask[9], DBW_DNSKEY);
 
     case DBW_RRSIGDNSKEY:
         /* The only time not to introduce RRSIG DNSKEY is when the DNSKEY is
@@ -650,9 +818,9 @@ policyApproval(struct dbw_zone *zone, struct dbw_key *key, enum dbw_keystate_typ
         if (ks_dnskey->state == OMNIPRESENT) return 1;
         /* We might be doing an algorithm rollover so we check if there are
          * no other good ZSK available and ignore the minimize flag if so. */
-        return !exists(zone, key->algorithm, 1, mask[0])
-            && !exists_with_successor(zone, key->algorithm, 1, mask[2], mask[1], DBW_DNSKEY)
-            && !exists_with_successor(zone, key->algorithm, 1, mask[4], mask[3], DBW_RRSIG);
+        return !exists(zone, zc, key->algorithm, 1, mask[0])
+            && !exists_with_successor(zone, zc, key->algorithm, 1, mask[2], mask[1], DBW_DNSKEY)
+            && !exists_with_successor(zone, zc, key->algorithm, 1, mask[4], mask[3], DBW_RRSIG);
 
     default:
         ods_log_assert(0);
@@ -974,6 +1142,10 @@ updateZone(struct dbw_db *db, struct dbw_zone *zone, const time_t now,
     track_ttls(zone, now);
     generate_missing_keystates(db, zone, now);
 
+    struct zone_counters counters;
+    struct zone_counters *zc = &counters;
+    if (zone_counters_init(zc, zone)) zc = NULL;
+
     int stable = 0;
     while (!stable) {
         stable = 1;
@@ -997,11 +1169,11 @@ updateZone(struct dbw_db *db, struct dbw_zone *zone, const time_t now,
                     dbw_keystate_state_txt[next_state]);
 
                 /* Check if policy prevents transition. */
-                if (!policyApproval(zone, key, keystate->type, next_state)) continue;
+                if (!policyApproval(zone, zc, key, keystate->type, next_state)) continue;
                 ods_log_verbose("[%s] %s Policy says we can (1/3)", module_str, scmd);
 
                 /* Check if DNSSEC state prevents transition.  */
-                if (!dnssecApproval(zone, key, keystate->type, next_state, allow_unsigned)) continue;
+                if (!dnssecApproval(zone, zc, key, keystate->type, next_state, allow_unsigned)) continue;
                 ods_log_verbose("[%s] %s DNSSEC says we can (2/3)", module_str, scmd);
 
                 returntime_keystate = minTransitionTime(policy, keystate->type, next_state,
@@ -1014,8 +1186,8 @@ updateZone(struct dbw_db *db, struct dbw_zone *zone, const time_t now,
                     {NA, UNRETENTIVE, OMNIPRESENT, NA},
                     {NA, RUMOURED,    OMNIPRESENT, NA}
                 };
-                int zsk_out = exists(zone, key->algorithm, 1, mask[0]);
-                int zsk_in  = exists(zone, key->algorithm, 1, mask[1]);
+                int zsk_out = exists(zone, zc, key->algorithm, 1, mask[0]);
+                int zsk_in  = exists(zone, zc, key->algorithm, 1, mask[1]);
 
                 if (keystate->type == DBW_RRSIG
                     && getstate(key, DBW_DNSKEY)->state == OMNIPRESENT
@@ -1063,7 +1235,7 @@ updateZone(struct dbw_db *db, struct dbw_zone *zone, const time_t now,
                     dbw_keystate_state_txt[keystate->state],
                     dbw_keystate_state_txt[next_state]);
 
-                keystate->state = next_state;
+                setState(zc, keystate, next_state);
                 keystate->last_change = now;
                 keystate->ttl = getZoneTTL(zone, keystate->type, now);
                 /* we don't want DELETED or INSERTED to be marked UPDATE */
@@ -1080,6 +1252,7 @@ updateZone(struct dbw_db *db, struct dbw_zone *zone, const time_t now,
             }
         }
     }
+    if (zc) free(zc->alg);
     return returntime_zone;
 }
 
@@ -1468,7 +1641,8 @@ removeDeadKeys(struct dbw_zone *zone, const time_t now, int mockup)
             minTime(key_time, &first_purge);
             continue;
         }
-        ods_log_info("[%s] %s deleting key: %s", module_str, scmd, key->hsmkey->locator);
+        if (!mockup)
+            ods_log_info("[%s] %s deleting key: %s", module_str, scmd, key->hsmkey->locator);
         for (size_t s = 0; s < key->keystate_count; s++) {
             key->keystate[s]->dirty = DBW_DELETE;
         }
@@ -1534,9 +1708,14 @@ static time_t
 _update(engine_type *engine, struct dbw_db *db, struct dbw_zone *zone, time_t now,
     int *zone_updated, int mockup)
 {
-    ods_log_info("[%s] update zone: %s", module_str, zone->name);
+    /* A simulation is not worth a line in the log */
+    if (!mockup)
+        ods_log_info("[%s] update zone: %s", module_str, zone->name);
 
-	if (engine->config->rollover_notification && zone_db_next_ksk_roll(zone) > 0) {
+	if (mockup) {
+		/* No notifications for simulated rollovers */
+	}
+	else if (engine->config->rollover_notification && zone_db_next_ksk_roll(zone) > 0) {
 		if ((time_t)zone_db_next_ksk_roll(zone) - engine->config->rollover_notification <= now
 		    && (time_t)zone_db_next_ksk_roll(zone) != now) {
 			time_t t = (time_t) zone_db_next_ksk_roll(zone);
@@ -1560,7 +1739,7 @@ _update(engine_type *engine, struct dbw_db *db, struct dbw_zone *zone, time_t no
     int allow_unsigned = 0;
     time_t policy_return_time = updatePolicy(engine, db, zone, now,
         &allow_unsigned, zone_updated, mockup);
-    if (allow_unsigned) {
+    if (allow_unsigned && !mockup) {
         ods_log_info("[%s] No keys configured for %s, zone will become"
            " unsigned eventually", module_str, zone->name);
     }
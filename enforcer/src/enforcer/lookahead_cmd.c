@@ -43,7 +43,7 @@
 
 static const char *module_str = "lookahead_cmd";
 
-#define MAX_ARGS 4
+#define MAX_ARGS 6
 
 static void
 usage(int sockfd)
@@ -51,17 +51,23 @@ usage(int sockfd)
     client_printf(sockfd,
         "look-ahead\n"
         "	--zone <zonename>	aka -z\n"
-        "	--steps <n>		aka -s\n");
+        "	--steps <n>		aka -s\n"
+        "look-ahead\n"
+        "	--all			aka -a\n"
+        "	[--days <n>]		aka -d\n");
 }
 
 static void
 help(int sockfd)
 {
     client_printf(sockfd,
-        "Shows the n next state changes for a zone.\n"
+        "Shows the n next state changes for a zone. Or, for all zones, per day\n"
+        "how many keys are needed and how often DS and signconf changes.\n"
         "\nOptions:\n"
         "zone		Zone to show the state for.\n"
         "steps		Number of steps to take in to the future.\n"
+        "all		Simulate all zones, nothing is committed.\n"
+        "days		Number of days to simulate all zones, default 90.\n"
         "\n"
     );
 }
@@ -200,6 +206,7 @@ purge(struct dbw_list *list)
             left++;
         }
     }
+    dbw_list_reindex(list);
 }
 
 static void
@@ -228,6 +235,298 @@ scrub_deleted(struct dbw_db *db)
     purge(db->keystates);
 }
 
+/* Days the fleet look-ahead simulates by default */
+#define FLEET_DAYS 90
+/* Enforcements of one zone at the same time before it is given up on */
+#define FLEET_MAX_RERUNS 16
+
+/* What happens on a single day of the fleet look-ahead */
+struct fleet_day {
+    unsigned long enforces;
+    unsigned long keys;
+    unsigned long hsmkeys;
+    unsigned long ds_submits;
+    unsigned long ds_retracts;
+    unsigned long signconfs;
+    unsigned long purges;
+};
+
+/* Zones of the fleet look-ahead ordered on the time of their next change */
+struct fleet_event {
+    time_t t;
+    struct dbw_zone *zone;
+};
+
+struct fleet {
+    struct fleet_event *heap;
+    size_t n;
+    size_t size;
+    /* Highest ids in use, rows created by the simulation get the next */
+    int max_id[4];
+};
+
+enum { FLEET_HSMKEY, FLEET_KEY, FLEET_KEYSTATE, FLEET_KEYDEPENDENCY };
+
+static int
+fleet_push(struct fleet *fleet, time_t t, struct dbw_zone *zone)
+{
+    size_t pos;
+    if (fleet->n == fleet->size) {
+        size_t size = fleet->size ? 2 * fleet->size : 1024;
+        struct fleet_event *heap = realloc(fleet->heap,
+            size * sizeof (struct fleet_event));
+        if (!heap) return 1;
+        fleet->heap = heap;
+        fleet->size = size;
+    }
+    pos = fleet->n++;
+    while (pos > 0 && fleet->heap[(pos - 1) / 2].t > t) {
+        fleet->heap[pos] = fleet->heap[(pos - 1) / 2];
+        pos = (pos - 1) / 2;
+    }
+    fleet->heap[pos].t = t;
+    fleet->heap[pos].zone = zone;
+    return 0;
+}
+
+static struct fleet_event
+fleet_pop(struct fleet *fleet)
+{
+    struct fleet_event top = fleet->heap[0];
+    struct fleet_event last = fleet->heap[--fleet->n];
+    size_t pos = 0, child;
+
+    while ((child = 2 * pos + 1) < fleet->n) {
+        if (child + 1 < fleet->n && fleet->heap[child + 1].t < fleet->heap[child].t)
+            child++;
+        if (fleet->heap[child].t >= last.t) break;
+        fleet->heap[pos] = fleet->heap[child];
+        pos = child;
+    }
+    if (fleet->n) fleet->heap[pos] = last;
+    return top;
+}
+
+static int
+max_id(struct dbw_list *list)
+{
+    int id = 0;
+    for (size_t n = 0; n < list->n; n++) {
+        if (list->set[n]->id > id) id = list->set[n]->id;
+    }
+    return id;
+}
+
+/* Give a row created by the simulation an id */
+static void
+fleet_insert(struct fleet *fleet, struct dbrow *row, int table)
+{
+    if (row->dirty != DBW_INSERT) return;
+    row->id = ++fleet->max_id[table];
+    row->dirty = DBW_CLEAN;
+}
+
+/* Remove the rows marked deleted from the lists of their parents */
+static void
+drop_deleted(void **set, int *count)
+{
+    int left = 0;
+    while (left < *count) {
+        if (((struct dbrow *)set[left])->dirty == DBW_DELETE)
+            set[left] = set[--(*count)];
+        else
+            left++;
+    }
+}
+
+/**
+ * Like scrub_deleted() but only for the rows of zone. Deleted rows are left
+ * in the lists of db, that costs some memory but keeps every step
+ * proportional to the size of the zone instead of the entire fleet.
+ */
+static void
+fleet_scrub_zone(struct fleet *fleet, struct dbw_zone *zone, struct fleet_day *day)
+{
+    for (int k = 0; k < zone->key_count; k++) {
+        struct dbw_key *key = zone->key[k];
+        if (key->dirty == DBW_INSERT) {
+            day->keys++;
+            if (key->hsmkey->dirty == DBW_INSERT) day->hsmkeys++;
+        } else if (key->dirty == DBW_DELETE) {
+            struct dbw_hsmkey *hsmkey = key->hsmkey;
+            day->purges++;
+            drop_deleted((void **)hsmkey->key, &hsmkey->key_count);
+            if (hsmkey->dirty == DBW_DELETE) {
+                drop_deleted((void **)hsmkey->policy->hsmkey,
+                    &hsmkey->policy->hsmkey_count);
+            }
+        }
+    }
+    drop_deleted((void **)zone->key, &zone->key_count);
+    drop_deleted((void **)zone->keydependency, &zone->keydependency_count);
+    for (int k = 0; k < zone->key_count; k++) {
+        struct dbw_key *key = zone->key[k];
+        drop_deleted((void **)key->from_keydependency, &key->from_keydependency_count);
+        drop_deleted((void **)key->to_keydependency, &key->to_keydependency_count);
+        fleet_insert(fleet, (struct dbrow *)key->hsmkey, FLEET_HSMKEY);
+        fleet_insert(fleet, (struct dbrow *)key, FLEET_KEY);
+        key->hsmkey_id = key->hsmkey->id;
+    }
+    /* Now all keys have an id the rows referring to them can be updated */
+    for (int k = 0; k < zone->key_count; k++) {
+        struct dbw_key *key = zone->key[k];
+        for (int s = 0; s < key->keystate_count; s++) {
+            fleet_insert(fleet, (struct dbrow *)key->keystate[s], FLEET_KEYSTATE);
+            key->keystate[s]->key_id = key->id;
+        }
+    }
+    for (int d = 0; d < zone->keydependency_count; d++) {
+        struct dbw_keydependency *dep = zone->keydependency[d];
+        if (dep->dirty != DBW_INSERT) continue;
+        fleet_insert(fleet, (struct dbrow *)dep, FLEET_KEYDEPENDENCY);
+        dep->fromkey_id = dep->fromkey->id;
+        dep->tokey_id = dep->tokey->id;
+    }
+}
+
+/* Enforce zone at t without committing, record what happened in day and
+ * return when to enforce it next. */
+static time_t
+fleet_step(engine_type *engine, struct dbw_db *db, struct fleet *fleet,
+    struct dbw_zone *zone, time_t t, struct fleet_day *day)
+{
+    int zone_updated = 0;
+    time_t t_next = update_mockup(engine, db, zone, t, &zone_updated);
+
+    zone->next_change = t_next;
+    day->enforces++;
+    /* The parent is as quick as the simulation */
+    for (int k = 0; k < zone->key_count; k++) {
+        struct dbw_key *key = zone->key[k];
+        if (key->dirty == DBW_DELETE) continue;
+        switch (key->ds_at_parent) {
+            case DBW_DS_AT_PARENT_SUBMIT:
+                key->ds_at_parent = DBW_DS_AT_PARENT_SUBMITTED;
+                day->ds_submits++;
+                break;
+            case DBW_DS_AT_PARENT_RETRACT:
+                key->ds_at_parent = DBW_DS_AT_PARENT_RETRACTED;
+                day->ds_retracts++;
+                break;
+            case DBW_DS_AT_PARENT_SUBMITTED:
+                key->ds_at_parent = DBW_DS_AT_PARENT_SEEN;
+                break;
+            case DBW_DS_AT_PARENT_RETRACTED:
+                key->ds_at_parent = DBW_DS_AT_PARENT_UNSUBMITTED;
+                break;
+            default:
+                continue;
+        }
+        t_next = t;
+    }
+    if (zone->signconf_needs_writing) {
+        zone->signconf_needs_writing = 0;
+        day->signconfs++;
+    }
+    fleet_scrub_zone(fleet, zone, day);
+    return t_next;
+}
+
+static void
+fleet_print(int sockfd, struct fleet_day *day, char const *label)
+{
+    client_printf(sockfd, "%-11s %9lu %7lu %8lu %9lu %10lu %8lu %6lu\n",
+        label, day->enforces, day->keys, day->hsmkeys, day->ds_submits,
+        day->ds_retracts, day->signconfs, day->purges);
+}
+
+/**
+ * Simulate all zones for the next days in time order, as the enforcer
+ * would run them if no other changes were made. Nothing is committed.
+ * Prints per day what the enforcer does and how many keys it needs.
+ */
+static int
+fleet_lookahead(int sockfd, engine_type *engine, struct dbw_db *db, int days)
+{
+    struct fleet fleet;
+    struct fleet_day *histogram, total;
+    time_t start = time_now(), end = start + (time_t)days * 86400;
+    time_t wall = time(NULL);
+    size_t zones = 0;
+    int r = 0;
+
+    memset(&fleet, 0, sizeof (fleet));
+    memset(&total, 0, sizeof (total));
+    if (!(histogram = calloc(days, sizeof (struct fleet_day)))) {
+        client_printf_err(sockfd, "Memory allocation failure\n");
+        return 1;
+    }
+    fleet.max_id[FLEET_HSMKEY] = max_id(db->hsmkeys);
+    fleet.max_id[FLEET_KEY] = max_id(db->keys);
+    fleet.max_id[FLEET_KEYSTATE] = max_id(db->keystates);
+    fleet.max_id[FLEET_KEYDEPENDENCY] = max_id(db->keydependencies);
+
+    for (size_t z = 0; z < db->zones->n; z++) {
+        struct dbw_zone *zone = (struct dbw_zone *)db->zones->set[z];
+        time_t t = zone->next_change < start ? start : zone->next_change;
+        if (zone->policy->passthrough) continue;
+        zone->scratch = 0;
+        zones++;
+        /* Zones waiting on the parent are moved on right away */
+        for (int k = 0; k < zone->key_count; k++) {
+            if (zone->key[k]->ds_at_parent != DBW_DS_AT_PARENT_UNSUBMITTED
+                && zone->key[k]->ds_at_parent != DBW_DS_AT_PARENT_SEEN)
+            {
+                t = start;
+            }
+        }
+        if (t < end && fleet_push(&fleet, t, zone)) r = 1;
+    }
+    while (!r && fleet.n) {
+        struct fleet_event ev = fleet_pop(&fleet);
+        struct fleet_day *day = &histogram[(ev.t - start) / 86400];
+        time_t t_next = fleet_step(engine, db, &fleet, ev.zone, ev.t, day);
+
+        if (t_next < 0 || t_next >= end) continue;
+        if (t_next > ev.t) {
+            ev.zone->scratch = 0;
+        } else if (++ev.zone->scratch > FLEET_MAX_RERUNS) {
+            client_printf(sockfd, "Zone %s does not settle, it is no longer "
+                "simulated\n", ev.zone->name);
+            continue;
+        } else {
+            t_next = ev.t;
+        }
+        r = fleet_push(&fleet, t_next, ev.zone);
+    }
+    if (r) {
+        client_printf_err(sockfd, "Memory allocation failure\n");
+    } else {
+        client_printf(sockfd, "Simulated %zu zones for %d days in %ld "
+            "seconds.\n\n", zones, days, (long)(time(NULL) - wall));
+        client_printf(sockfd, "Date         Enforces    Keys HSMkeys "
+            "DS-submit DS-retract Signconf Purged\n");
+        for (int d = 0; d < days; d++) {
+            char label[32];
+            struct tm tm;
+            time_t t = start + (time_t)d * 86400;
+            strftime(label, sizeof (label), "%Y-%m-%d", localtime_r(&t, &tm));
+            fleet_print(sockfd, &histogram[d], label);
+            total.enforces += histogram[d].enforces;
+            total.keys += histogram[d].keys;
+            total.hsmkeys += histogram[d].hsmkeys;
+            total.ds_submits += histogram[d].ds_submits;
+            total.ds_retracts += histogram[d].ds_retracts;
+            total.signconfs += histogram[d].signconfs;
+            total.purges += histogram[d].purges;
+        }
+        fleet_print(sockfd, &total, "Total");
+    }
+    free(fleet.heap);
+    free(histogram);
+    return r;
+}
+
 /**
  * Handle the 'look-ahead' command.
  *
@@ -240,12 +539,15 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
     int long_index = 0, opt = 0;
     char const *zonename = NULL;
     int steps = 10;
+    int all = 0, days = FLEET_DAYS;
     db_connection_t* dbconn = getconnectioncontext(context);
     engine_type* engine = getglobalcontext(context);
 
     static struct option long_options[] = {
         {"zone", required_argument, 0, 'z'},
         {"steps", required_argument, 0, 's'},
+        {"all", no_argument, 0, 'a'},
+        {"days", required_argument, 0, 'd'},
         {0, 0, 0, 0}
     };
 
@@ -258,7 +560,7 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
     }
 
     optind = 0;
-    while ((opt = getopt_long(argc, (char* const*)argv, "z:s:", long_options, &long_index)) != -1) {
+    while ((opt = getopt_long(argc, (char* const*)argv, "z:s:ad:", long_options, &long_index)) != -1) {
         switch (opt) {
             case 'z':
                 zonename = optarg;
@@ -266,6 +568,12 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
             case 's':
                 steps = atoi(optarg);
                 break;
+            case 'a':
+                all = 1;
+                break;
+            case 'd':
+                days = atoi(optarg);
+                break;
             default:
                 client_printf_err(sockfd, "unknown arguments\n");
                 ods_log_error("[%s] unknown arguments for %s command",
@@ -273,13 +581,22 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
                 return -1;
         }
     }
-    if (!zonename) {
-        client_printf_err(sockfd, "--zone required\n");
+    if (!zonename && !all) {
+        client_printf_err(sockfd, "--zone or --all required\n");
+        return -1;
+    }
+    if (days <= 0) {
+        client_printf_err(sockfd, "--days must be positive\n");
         return -1;
     }
 
     struct dbw_db *db = dbw_fetch(dbconn);
     if (!db) return 1;
+    if (all) {
+        int r = fleet_lookahead(sockfd, engine, db, days);
+        dbw_free(db);
+        return r;
+    }
     struct dbw_zone *zone = dbw_get_zone(db, zonename);
     if (!zone) {
         client_printf_err(sockfd, "Could not find zone %s in database\n", zonename);
@@ -36,20 +36,28 @@
 #include "daemon/engine.h"
 #include "duration.h"
 #include "libhsm.h"
+#include "locks.h"
 
 #include <pthread.h>
 #include <math.h>
+#include <time.h>
 
 #include "hsmkey/hsm_key_factory.h"
 
 /* List of database ID's of recently assigned non-shared hsmkeys. So we can
  * avoid races assigning the same key twice. This avoids backoffs.
  * For shared keys this problem isn't as pronounced since they will generally
- * not need a completely new key */
-#define RU_COUNT 8
+ * not need a completely new key. Every worker may have a key assigned but
+ * not yet committed, zones commit in parallel. Keep this well above the
+ * number of workers. */
+#define RU_COUNT 64
 static int ru_nonshared_keys[RU_COUNT];
 static int ru_index;
 
+/* Generated keys are committed in batches of this size, so waiting zones
+ * can use them before a large request is done. */
+#define KEYGEN_COMMIT_BATCH 64
+
 struct __hsm_key_factory_task {
     engine_type* engine;
     int id; /* id of record */
@@ -253,50 +261,122 @@ create_hsmkey(struct dbw_policykey *policykey, char *locator, int require_backup
     return hsmkey;
 }
 
-static int /*0 success 1 failure */
-generate_one_key(engine_type *engine, struct dbw_db *db,
-    struct dbw_policykey *policykey)
-{
+/* Keys of one policykey being generated by several threads, each with
+ * its own HSM context and thus its own PKCS#11 session. */
+struct keygen_pool {
+    struct dbw_policykey *policykey;
+    char **locators; /* one per key, NULL if generating it failed */
+    int count;
+    int next; /* next key to generate */
+    pthread_mutex_t lock;
+};
 
-     /*Create a HSM context and check that the repository exists*/
+static void
+keygen_worker(void *arg)
+{
+    struct keygen_pool *pool = arg;
     hsm_ctx_t *hsm_ctx;
-    if (!(hsm_ctx = hsm_create_context())) {
-        return 1;
-    }
-    if (!hsm_token_attached(hsm_ctx, policykey->repository)) {
+    int i;
+
+    if (!(hsm_ctx = hsm_create_context())) return;
+    if (!hsm_token_attached(hsm_ctx, pool->policykey->repository)) {
         log_hsm_error(hsm_ctx, "unable to find repository");
         hsm_destroy_context(hsm_ctx);
-        return 1;
+        return;
     }
-    /* Find the HSM repository to get the backup configuration*/
+    for (;;) {
+        (void) pthread_mutex_lock(&pool->lock);
+            i = pool->next < pool->count ? pool->next++ : -1;
+        (void) pthread_mutex_unlock(&pool->lock);
+        if (i < 0) break;
+        pool->locators[i] = generate_libhsm_key(hsm_ctx, pool->policykey);
+        if (!pool->locators[i])
+            log_hsm_error(hsm_ctx, "[hsm_key_factory] failed to generate key");
+    }
+    hsm_destroy_context(hsm_ctx);
+}
+
+/* Generate count keys for policykey, using as many threads as the
+ * repository allows, and add them to db. Returns the number of keys that
+ * could not be generated. */
+static int
+generate_keys(engine_type *engine, struct dbw_db *db,
+    struct dbw_policykey *policykey, int count)
+{
     struct engineconfig_repository *hsm;
+    struct keygen_pool pool;
+    janitor_thread_t *threads;
+    int nthreads, i, error = 0;
+
+    /* Find the HSM repository to get the backup configuration*/
     hsm = hsm_find_repository(engine->config->repositories, policykey->repository);
     if (!hsm) {
         ods_log_error("[hsm_key_factory_generate] unable to find "
             "repository %s needed for key generation", policykey->repository);
-        hsm_destroy_context(hsm_ctx);
-        return 1;
+        return count;
     }
-    char *locator = generate_libhsm_key(hsm_ctx, policykey);
-    if (!locator) {
-        log_hsm_error(hsm_ctx, "[hsm_key_factory] failed to generate key");
-        hsm_destroy_context(hsm_ctx);
-        return 1;
+    nthreads = (int)hsm->keygen_threads < count ? (int)hsm->keygen_threads : count;
+    if (nthreads < 1) nthreads = 1;
+    pool.policykey = policykey;
+    pool.count = count;
+    pool.next = 0;
+    pool.locators = calloc(count, sizeof (char *));
+    threads = calloc(nthreads, sizeof (janitor_thread_t));
+    if (!pool.locators || !threads || pthread_mutex_init(&pool.lock, NULL)) {
+        ods_log_error("[hsm_key_factory_generate] memory error");
+        free(pool.locators);
+        free(threads);
+        return count;
+    }
+    /* The calling worker takes part, the others are started alongside */
+    for (i = 1; i < nthreads; i++) {
+        if (janitor_thread_create(&threads[i], workerthreadclass, keygen_worker, &pool))
+            threads[i] = NULL;
+    }
+    keygen_worker(&pool);
+    for (i = 1; i < nthreads; i++) {
+        if (threads[i]) janitor_thread_join(threads[i]);
     }
-    struct dbw_hsmkey *hsmkey = create_hsmkey(policykey, locator,
+    (void) pthread_mutex_destroy(&pool.lock);
+    free(threads);
+
+    for (i = 0; i < count; i++) {
+        char *locator = pool.locators[i];
+        if (!locator) {
+            error++;
+            continue;
+        }
+        struct dbw_hsmkey *hsmkey = create_hsmkey(policykey, locator,
             hsm->require_backup? HSM_KEY_BACKUP_BACKUP_REQUIRED : HSM_KEY_BACKUP_NO_BACKUP);
-    if (!hsmkey) {
-        ods_log_error("[hsm_key_factory_generate] hsm key creation"
-                   " failed, database or memory error");
-        free(locator);
-        hsm_destroy_context(hsm_ctx);
-        return 1;
+        if (!hsmkey) {
+            free(locator);
+            error++;
+            continue;
+        }
+        if (!dbw_add_hsmkey(db, policykey->policy, hsmkey))//TODO return val
+            ods_log_debug("[hsm_key_factory_generate] generated key %s successfully", locator);
     }
-    if (!dbw_add_hsmkey(db, policykey->policy, hsmkey))//TODO return val
-        ods_log_debug("[hsm_key_factory_generate] generated key %s successfully", locator);
+    free(pool.locators);
+    return error;
+}
 
+/* Remove the hsmkeys of db from index first on from the HSM. Used when
+ * they could not be stored in the database. */
+static void
+remove_generated_keys(struct dbw_db *db, size_t first)
+{
+    hsm_ctx_t *hsm_ctx;
+    if (!(hsm_ctx = hsm_create_context())) return;
+    for (size_t h = first; h < db->hsmkeys->n; h++) {
+        struct dbw_hsmkey *hsmkey = (struct dbw_hsmkey *)db->hsmkeys->set[h];
+        libhsm_key_t *hkey = hsm_find_key_by_id(hsm_ctx, hsmkey->locator);
+        if (!hkey || hsm_remove_key(hsm_ctx, hkey)) {
+            ods_log_error("[hsm_key_factory_generate] unable to remove "
+                "key %s from HSM", hsmkey->locator);
+        }
+        if (hkey) libhsm_key_free(hkey);
+    }
     hsm_destroy_context(hsm_ctx);
-    return 0;
 }
 
 static int
@@ -326,8 +406,9 @@ generate_cb(task_type* task, char const *owner, void *userdata,
     engine_type* engine = userdata;
 
     int duration_time = engine->config->automatic_keygen_duration;
+    int failed = 0;
 
-    while (genq) {
+    while (!failed && genq) {
         struct generate_request *req = genq_pop();
         struct dbw_policykey *pkey = dbw_get_policykey(db, req->policykey_id);
         if (!pkey) {
@@ -343,11 +424,40 @@ generate_cb(task_type* task, char const *owner, void *userdata,
         }
         int error = 0;
         int keys_generated = 0;
-        for (int i = 0; i < req->count; i++) {
-            ods_log_info("Generating %s for policy %s.\n",
+        struct timespec start, end;
+        double elapsed;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        while (keys_generated < req->count) {
+            int n = req->count - keys_generated;
+            if (n > KEYGEN_COMMIT_BATCH) n = KEYGEN_COMMIT_BATCH;
+            ods_log_info("Generating %d %s for policy %s.", n,
                 dbw_enum2txt(dbw_key_role_txt, pkey->role), pkey->policy->name);
-            error += generate_one_key(engine, db, pkey);
-            keys_generated++;
+            size_t first = db->hsmkeys->n;
+            int batch_error = generate_keys(engine, db, pkey, n);
+            if (dbw_commit(db)) {
+                /* This db can't be committed again. Don't leave keys in
+                 * the HSM that are unknown to the database, requeue the
+                 * request and retry with a fresh fetch. */
+                ods_log_error("[hsm_key_factory_generate] unable to store "
+                    "generated keys for policy %s, removing them from HSM",
+                    pkey->policy->name);
+                remove_generated_keys(db, first);
+                genq_push(req->policykey_id, req->zonename,
+                    req->count - keys_generated);
+                failed = 1;
+                break;
+            }
+            error += batch_error;
+            keys_generated += n;
+        }
+        if (keys_generated) {
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            elapsed = (end.tv_sec - start.tv_sec)
+                + (end.tv_nsec - start.tv_nsec) / 1e9;
+            ods_log_info("[hsm_key_factory_generate] generated %d keys for "
+                "policy %s in %.1f seconds, %.1f keys/second",
+                keys_generated - error, pkey->policy->name, elapsed,
+                elapsed > 0 ? (keys_generated - error) / elapsed : 0.0);
         }
         if (!error && keys_generated) {
             if (req->zonename) {
@@ -357,8 +467,8 @@ generate_cb(task_type* task, char const *owner, void *userdata,
                 pkey->policy->scratch = 1;
             }
         }
+        genq_free(req);
     }
-    (void)dbw_commit(db);
     for (size_t p = 0; p < db->policies->n; p++) {
         struct dbw_policy *policy = (struct dbw_policy *)db->policies->set[p];
         if (policy->scratch)
@@ -371,6 +481,7 @@ generate_cb(task_type* task, char const *owner, void *userdata,
         }
     }
     dbw_free(db);
+    if (failed) return schedule_DEFER;
     (void) pthread_mutex_lock(__hsm_key_factory_lock);
         struct generate_request *req = genq;
     (void) pthread_mutex_unlock(__hsm_key_factory_lock);
@@ -470,9 +581,7 @@ hsm_key_factory_get_key(engine_type *engine, struct dbw_db *db,
 void
 hsm_key_factory_release_key_mockup(struct dbw_hsmkey *hsmkey, struct dbw_key *key, int mockup)
 {
-    int c = hsmkey->key_count;
-    if (c == 1 && hsmkey->key[0] == key) c--;
-    if (c > 0) {
+    if (dbw_hsmkey_users(hsmkey, key) > 0) {
         ods_log_debug("[hsm_key_factory_release_key] unable to release hsm_key, in use");
     } else {
         ods_log_debug("[hsm_key_factory_release_key] key %s marked DELETE", hsmkey->locator);
@@ -28,7 +28,10 @@
 #include "config.h"
 
 #include <sys/stat.h>
+#include <sys/wait.h>
+#include <ctype.h>
 #include <getopt.h>
+#include <unistd.h>
 
 #include "cmdhandler.h"
 #include "daemon/engine.h"
@@ -47,25 +50,21 @@
 static const char *module_str = "keystate_ds_x_cmd";
 
 /** Retrieve KEY from HSM, should only be called for DNSKEYs
+ * @param hsm_ctx, HSM context to use
  * @param id, locator of DNSKEY on HSM
  * @param zone, name of zone key belongs to
  * @param algorithm, alg of DNSKEY
  * @param ttl, ttl DS should get. if 0 DNSKEY_TTL is used.
  * @return RR on succes, NULL on error */
 static ldns_rr *
-get_dnskey(const char *id, const char *zone, int alg, uint32_t ttl)
+get_dnskey(hsm_ctx_t *hsm_ctx, const char *id, const char *zone, int alg,
+	uint32_t ttl)
 {
 	libhsm_key_t *key;
 	hsm_sign_params_t *sign_params;
 	ldns_rr *dnskey_rr;
 	/* Code to output the DNSKEY record  (stolen from hsmutil) */
-	hsm_ctx_t *hsm_ctx = hsm_create_context();
-	if (!hsm_ctx) {
-		ods_log_error("[%s] Could not connect to HSM", module_str);
-		return NULL;
-	}
 	if (!(key = hsm_find_key_by_id(hsm_ctx, id))) {
-		hsm_destroy_context(hsm_ctx);
 		return NULL;
 	}
 
@@ -81,7 +80,6 @@ get_dnskey(const char *id, const char *zone, int alg, uint32_t ttl)
 
 	libhsm_key_free(key);
 	hsm_sign_params_free(sign_params);
-	hsm_destroy_context(hsm_ctx);
 	
 	/* Override the TTL in the dnskey rr */
 	if (ttl) ldns_rr_set_ttl(dnskey_rr, ttl);
@@ -89,25 +87,24 @@ get_dnskey(const char *id, const char *zone, int alg, uint32_t ttl)
 	return dnskey_rr;
 }
 
-/** returns non 0 on error */
-static int
-exec_dnskey_by_id(int sockfd, struct dbw_key *key, const char* ds_command,
-	const char* action)
+/** The DNSKEY of key as a single line of text, as sent to the DS
+ * commands. Without trailing newline if cka is set.
+ * @return string to be freed with LDNS_FREE(), NULL on error */
+static char *
+dnskey_record(hsm_ctx_t *hsm_ctx, struct dbw_key *key, int cka)
 {
 	ldns_rr *dnskey_rr;
-	int status, i;
-	char *rrstr, *chrptr, *cp_ds = NULL;
-	struct stat stat_ret;
-        int cka = 0;
-	char *pos = NULL;
+	char *rrstr, *chrptr;
+	int i;
 
-	assert(key);
-	char *locator = key->hsmkey->locator;
 	struct dbw_keystate *dnskey = dbw_get_keystate(key, DBW_DNSKEY);
-	if (!dnskey) return 1;
-	dnskey_rr = get_dnskey(locator, key->zone->name, key->algorithm, dnskey->ttl);
-	if (!dnskey_rr) return 2;
+	if (!dnskey) return NULL;
+	dnskey_rr = get_dnskey(hsm_ctx, key->hsmkey->locator, key->zone->name,
+		key->algorithm, dnskey->ttl);
+	if (!dnskey_rr) return NULL;
 	rrstr = ldns_rr2str(dnskey_rr);
+	ldns_rr_free(dnskey_rr);
+	if (!rrstr) return NULL;
 
 	/* Replace tab with space */
 	for (i = 0; rrstr[i]; ++i) {
@@ -120,179 +117,365 @@ exec_dnskey_by_id(int sockfd, struct dbw_key *key, const char* ds_command,
 		chrptr[0] = '\n';
 		chrptr[1] = '\0';
 	}
+	if (cka) rrstr[strlen(rrstr)-1] = '\0';
+	return rrstr;
+}
 
-	if (!ds_command || ds_command[0] == '\0') {
-		ods_log_info(module_str,
-			"No \"DelegationSigner%sCommand\" "
-			"configured.", action);
-		status = 1;
-	} else {
-                cp_ds = strdup(ds_command);
-                pos = strstr(cp_ds, " --cka_id");
-                if (pos){
-                        cka = 1;
-                        *pos = '\0';
-                        rrstr[strlen(rrstr)-1] = '\0';
-                        pos = NULL;
-                }
+/** Split the configured DS command in the program to run and its
+ * options. " --cka_id" appends the locator to each record, " --batch"
+ * hands all records to one invocation.
+ * @return program path, to be freed, NULL on memory error */
+static char *
+parse_ds_command(const char *ds_command, int *cka, int *batch)
+{
+	char *cp_ds, *pos;
+
+	*cka = *batch = 0;
+	if (!(cp_ds = strdup(ds_command))) return NULL;
+	if ((pos = strstr(cp_ds, " --batch"))) {
+		*batch = 1;
+		memmove(pos, pos + strlen(" --batch"),
+			strlen(pos + strlen(" --batch")) + 1);
+	}
+	if ((pos = strstr(cp_ds, " --cka_id"))) {
+		*cka = 1;
+		*pos = '\0';
+	}
+	return cp_ds;
+}
+
+int
+keystate_ds_command_batched(const char *ds_command)
+{
+	int cka, batch;
+	char *cp_ds;
 
-		if (stat(cp_ds, &stat_ret) != 0) {
+	if (!ds_command || !(cp_ds = parse_ds_command(ds_command, &cka, &batch)))
+		return 0;
+	free(cp_ds);
+	return batch;
+}
+
+/** returns non 0 when the command can not be run */
+static int
+check_ds_command(int sockfd, const char *cp_ds)
+{
+	struct stat stat_ret;
+
+	if (stat(cp_ds, &stat_ret) != 0) {
+		ods_log_error_and_printf(sockfd, module_str,
+			"Cannot stat file %s: %s", cp_ds,
+			strerror(errno));
+		return 2;
+	} else if (S_ISREG(stat_ret.st_mode) && 
+			!(stat_ret.st_mode & S_IXUSR || 
+			  stat_ret.st_mode & S_IXGRP || 
+			  stat_ret.st_mode & S_IXOTH)) {
+		/* Then see if it is a regular file, then if usr, grp or 
+		 * all have execute set */
+		ods_log_error_and_printf(sockfd, module_str,
+			"File %s is not executable", cp_ds);
+		return 3;
+	}
+	return 0;
+}
+
+/** returns non 0 on error */
+static int
+exec_dnskey_by_id(int sockfd, hsm_ctx_t *hsm_ctx, struct dbw_key *key,
+	const char *cp_ds, int cka, const char* action)
+{
+	int status, s;
+	char *rrstr;
+	char *locator = key->hsmkey->locator;
+
+	if (!(rrstr = dnskey_record(hsm_ctx, key, cka))) return 2;
+
+	/* send records to the configured command */
+	FILE *fp = popen(cp_ds, "w");
+	if (fp == NULL) {
+		status = 4;
+		ods_log_error_and_printf(sockfd, module_str,
+			"Failed to run command: %s: %s",cp_ds,
+			strerror(errno));
+	} else {
+		int bytes_written;
+		if (cka)
+			bytes_written = fprintf(fp, "%s; {cka_id = %s}\n", rrstr, locator);
+		else
+			bytes_written = fprintf(fp, "%s", rrstr);
+		s = pclose(fp);
+		if (bytes_written < 0) {
+			status = 5;
+			ods_log_error_and_printf(sockfd,  module_str,
+				 "Failed to write to %s: %s", cp_ds,
+				 strerror(errno));
+		} else if (s == -1) {
+			status = 6;
 			ods_log_error_and_printf(sockfd, module_str,
-				"Cannot stat file %s: %s", cp_ds,
+				"Failed to close %s: %s", cp_ds,
 				strerror(errno));
-			status = 2;
-		} else if (S_ISREG(stat_ret.st_mode) && 
-				!(stat_ret.st_mode & S_IXUSR || 
-				  stat_ret.st_mode & S_IXGRP || 
-				  stat_ret.st_mode & S_IXOTH)) {
-			/* Then see if it is a regular file, then if usr, grp or 
-			 * all have execute set */
-			status = 3;
-			ods_log_error_and_printf(sockfd, module_str,
-				"File %s is not executable", cp_ds);
+		} else if (s == 0) {
+			ods_log_info("key %sed to %s\n",
+				action, cp_ds);
+			client_printf(sockfd, "key %sed to %s\n",
+				action, cp_ds);
+			status = 0;
 		} else {
-			/* send records to the configured command */
-			FILE *fp = popen(cp_ds, "w");
-			if (fp == NULL) {
-				status = 4;
-				ods_log_error_and_printf(sockfd, module_str,
-					"Failed to run command: %s: %s",cp_ds,
-					strerror(errno));
-			} else {
-				int bytes_written;
-				if (cka)
-					bytes_written = fprintf(fp, "%s; {cka_id = %s}\n", rrstr, locator);
-				else
-					bytes_written = fprintf(fp, "%s", rrstr);
-				if (bytes_written < 0) {
-					status = 5;
-					ods_log_error_and_printf(sockfd,  module_str,
-						 "Failed to write to %s: %s", ds_command,
-						 strerror(errno));
-				} else if (pclose(fp) == -1) {
-					status = 6;
-					ods_log_error_and_printf(sockfd, module_str,
-						 "[%s] Failed to write to %s: %s", cp_ds,
-						 strerror(errno));
-				} else {
-                                        int s = pclose(fp);
-                                        if (s == -1) {
-						status = 6;
-						ods_log_error_and_printf(sockfd, module_str,
-							"Failed to close %s: %s", cp_ds,
-							strerror(errno));
-					} else if (s == 0) {
-						ods_log_info("key %sed to %s\n",
-							action, cp_ds);
-						client_printf(sockfd, "key %sed to %s\n",
-                                                        action, cp_ds);
-						status = 0;
-					}
-					else {
-						ods_log_error_and_printf(sockfd, "Failed to run %s", cp_ds);
-                                                status = 7;
-					}
-				}
-			}
+			ods_log_error_and_printf(sockfd, module_str,
+				"Failed to run %s", cp_ds);
+			status = 7;
 		}
 	}
 	LDNS_FREE(rrstr);
-	ldns_rr_free(dnskey_rr);
-	free(cp_ds);
 	return status;
 }
 
-static int
-submit_dnskey_by_id(int sockfd, struct dbw_key *key, engine_type* engine)
+/** Run the batched DS command once for all keys. The records are written
+ * to its standard input, one per line. The command answers on standard
+ * output with one line per record, in the same order, starting with 0
+ * if that record was handled. Records without such a line failed, as do
+ * all records when the command does not exit with 0.
+ * Sets status[i] to 0 for each key handled. */
+static void
+exec_dnskeys_batch(int sockfd, hsm_ctx_t *hsm_ctx, struct dbw_key **keys,
+	int *status, size_t n, const char *cp_ds, int cka, const char *action)
+{
+	char line[ODS_SE_MAXLINE];
+	FILE *in, *out;
+	int fds[2], s, sent = 0;
+	size_t i, next = 0;
+	pid_t pid;
+	char *rrstr;
+
+	for (i = 0; i < n; i++) status[i] = 2;
+	if (!(in = tmpfile())) {
+		ods_log_error_and_printf(sockfd, module_str,
+			"Failed to run command: %s: %s", cp_ds, strerror(errno));
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		if (!(rrstr = dnskey_record(hsm_ctx, keys[i], cka))) continue;
+		if (cka)
+			s = fprintf(in, "%s; {cka_id = %s}\n", rrstr, keys[i]->hsmkey->locator);
+		else
+			s = fprintf(in, "%s", rrstr);
+		LDNS_FREE(rrstr);
+		if (s < 0) break;
+		status[i] = -1; /* awaiting result */
+		sent++;
+	}
+	if (!sent || fflush(in) || fseek(in, 0, SEEK_SET) || pipe(fds)) {
+		if (sent)
+			ods_log_error_and_printf(sockfd, module_str,
+				"Failed to run command: %s: %s", cp_ds, strerror(errno));
+		fclose(in);
+		for (i = 0; i < n; i++) if (status[i] == -1) status[i] = 4;
+		return;
+	}
+	if ((pid = fork()) == 0) {
+		dup2(fileno(in), 0);
+		dup2(fds[1], 1);
+		close(fds[0]);
+		close(fds[1]);
+		execl("/bin/sh", "sh", "-c", cp_ds, (char *)NULL);
+		_exit(127);
+	}
+	close(fds[1]);
+	fclose(in);
+	if (pid == -1 || !(out = fdopen(fds[0], "r"))) {
+		ods_log_error_and_printf(sockfd, module_str,
+			"Failed to run command: %s: %s", cp_ds, strerror(errno));
+		if (pid == -1) close(fds[0]);
+		else {
+			close(fds[0]);
+			(void)waitpid(pid, &s, 0);
+		}
+		for (i = 0; i < n; i++) if (status[i] == -1) status[i] = 4;
+		return;
+	}
+	while (fgets(line, sizeof(line), out)) {
+		while (next < n && status[next] != -1) next++;
+		if (next == n) continue; /* drain */
+		if (line[0] == '0' && (!line[1] || isspace((unsigned char)line[1]))) {
+			status[next] = 0;
+			ods_log_info("key %sed to %s for zone %s\n", action, cp_ds,
+				keys[next]->zone->name);
+			client_printf(sockfd, "key %sed to %s for zone %s\n",
+				action, cp_ds, keys[next]->zone->name);
+		} else {
+			status[next] = 7;
+			ods_str_trim(line, 0);
+			ods_log_error_and_printf(sockfd, module_str,
+				"Failed to %s key of zone %s: %s", action,
+				keys[next]->zone->name, line);
+		}
+	}
+	fclose(out);
+	/* A command that can not be waited for counts as a failed one */
+	s = -1;
+	while (waitpid(pid, &s, 0) == -1 && errno == EINTR);
+	if (s != 0) {
+		ods_log_error_and_printf(sockfd, module_str,
+			"Failed to run %s", cp_ds);
+		/* Exited with an error or killed, its results can not be trusted */
+		for (i = 0; i < n; i++) {
+			if (status[i] != 0) continue;
+			status[i] = 7;
+			ods_log_error_and_printf(sockfd, module_str,
+				"Discarding result of %s for key of zone %s", cp_ds,
+				keys[i]->zone->name);
+		}
+	}
+	for (i = 0; i < n; i++) {
+		if (status[i] != -1) continue;
+		status[i] = 7;
+		ods_log_error_and_printf(sockfd, module_str,
+			"No result from %s for key of zone %s", cp_ds,
+			keys[i]->zone->name);
+	}
+}
+
+/** Hand the DNSKEYs of keys to ds_command, in one invocation if it is
+ * batched or one invocation per key if not. status[i] becomes 0 for each
+ * key handled successfully. */
+static void
+exec_dnskeys(int sockfd, struct dbw_key **keys, int *status, size_t n,
+	const char* ds_command, const char* action)
 {
-    const char* ds_submit_command;
-    ds_submit_command = engine->config->delegation_signer_submit_command;
-    return exec_dnskey_by_id(sockfd, key, ds_submit_command, "submit");
+	hsm_ctx_t *hsm_ctx;
+	char *cp_ds;
+	int cka, batch, s;
+	size_t i;
+
+	for (i = 0; i < n; i++) status[i] = 1;
+	if (!n) return;
+	if (!ds_command || ds_command[0] == '\0') {
+		ods_log_info("[%s] No \"DelegationSigner%sCommand\" "
+			"configured.", module_str, action);
+		return;
+	}
+	if (!(cp_ds = parse_ds_command(ds_command, &cka, &batch))) return;
+	if ((s = check_ds_command(sockfd, cp_ds))) {
+		for (i = 0; i < n; i++) status[i] = s;
+		free(cp_ds);
+		return;
+	}
+	if (!(hsm_ctx = hsm_create_context())) {
+		ods_log_error("[%s] Could not connect to HSM", module_str);
+		free(cp_ds);
+		return;
+	}
+	if (batch) {
+		exec_dnskeys_batch(sockfd, hsm_ctx, keys, status, n, cp_ds, cka, action);
+	} else {
+		for (i = 0; i < n; i++)
+			status[i] = exec_dnskey_by_id(sockfd, hsm_ctx, keys[i], cp_ds, cka, action);
+	}
+	hsm_destroy_context(hsm_ctx);
+	free(cp_ds);
 }
 
+struct ds_list_args {
+    int sockfd;
+    enum dbw_ds_at_parent state;
+};
+
 static int
-retract_dnskey_by_id(int sockfd, struct dbw_key *key, engine_type* engine)
+ds_list_zone(struct dbw_db *db, struct dbw_zone *zone, void *arg)
 {
-    const char* ds_retract_command;
-    ds_retract_command = engine->config->delegation_signer_retract_command;
-    return exec_dnskey_by_id(sockfd, key, ds_retract_command, "retract");
+    struct ds_list_args *args = arg;
+    (void)db;
+    for (size_t k = 0; k < zone->key_count; k++) {
+        struct dbw_key *key = zone->key[k];
+        if (!(key->role & DBW_KSK)) continue;
+        if (key->ds_at_parent != args->state) continue;
+        client_printf(args->sockfd, "%-31s %-13s %-13u %-40s\n", zone->name,
+            dbw_enum2txt(dbw_key_role_txt, key->role), key->keytag,
+            key->hsmkey->locator);
+    }
+    return 0;
 }
 
 static int
 ds_list_keys(db_connection_t *dbconn, int sockfd, enum dbw_ds_at_parent state)
 {
-    const char *fmth = "%-31s %-13s %-13s %-40s\n";
-    const char *fmtl = "%-31s %-13s %-13u %-40s\n";
-
-    struct dbw_db *db = dbw_fetch(dbconn);
-    if (!db) return 1;
+    struct dbw_zone_filter filter = { NULL, NULL, NULL };
+    struct ds_list_args args;
 
-    client_printf(sockfd, fmth, "Zone:", "Key role:", "Keytag:", "Id:");
-    for (size_t z = 0; z < db->zones->n; z++) {
-        struct dbw_zone *zone = (struct dbw_zone *)db->zones->set[z];
-        for (size_t k = 0; k < zone->key_count; k++) {
-            struct dbw_key *key = zone->key[k];
-            if (!(key->role & DBW_KSK)) continue;
-            if (key->ds_at_parent != state) continue;
-            client_printf(sockfd, fmtl, zone->name,
-                dbw_enum2txt(dbw_key_role_txt, key->role), key->keytag,
-                key->hsmkey->locator);
-        }
-    }
-    dbw_free(db);
-    return 0;
+    args.sockfd = sockfd;
+    args.state = state;
+    client_printf(sockfd, "%-31s %-13s %-13s %-40s\n", "Zone:", "Key role:",
+        "Keytag:", "Id:");
+    return dbw_foreach_zone(dbconn, &filter,
+        DBW_F_ZONE|DBW_F_KEY|DBW_F_HSMKEY, 0, ds_list_zone, &args, NULL);
 }
 
-/* Change DS state, when zonename not given do it for all zones!
- */
-int
-change_keys_from_to(db_connection_t *dbconn, int sockfd, const char *zonename,
-    const char *cka_id, int keytag, int state_from,
-    int state_to, engine_type *engine, int cmd)
+/* Change the DS state of the matching keys of the zones in db. Adds the
+ * number of keys matched to key_total. */
+static int
+change_keys(struct dbw_db *db, int sockfd, const char *cka_id, int keytag,
+    int state_from, int state_to, engine_type *engine, int cmd,
+    size_t *key_total)
 {
-    struct dbw_db *db = dbw_fetch(dbconn);
-    if (!db) return 1;
-
-    int key_match = 0;
-    int status = 0;
+    struct dbw_key **keys = NULL, **grown;
+    int *status = NULL;
+    size_t key_match = 0, key_max = 0;
     int need_commit = 0;
     for (size_t z = 0; z < db->zones->n; z++) {
         struct dbw_zone *zone = (struct dbw_zone *)db->zones->set[z];
-        if (zonename && strcmp(zonename, zone->name)) continue;
         for (size_t k = 0; k < zone->key_count; k++) {
             struct dbw_key *key = zone->key[k];
             if (!(key->role & DBW_KSK)) continue;
             if (state_from != key->ds_at_parent) continue;
             if ((keytag != -1) && key->keytag != keytag) continue;
             if (cka_id && strcmp(key->hsmkey->locator, cka_id)) continue;
-            key_match++;
-            status = 0;
-            /* if from is submit also exec dsSubmit command? */
-            if (!cmd && state_from == DBW_DS_AT_PARENT_SUBMIT &&
-                    state_to == DBW_DS_AT_PARENT_SUBMITTED)
-            {
-                status = submit_dnskey_by_id(sockfd, key, engine);
-            }
-            else if (!cmd && state_from == DBW_DS_AT_PARENT_RETRACT &&
-                    state_to == DBW_DS_AT_PARENT_RETRACTED)
-            {
-                status = retract_dnskey_by_id(sockfd, key, engine);
-            }
-
-            if (status == 0) {
-                key->ds_at_parent = state_to;
-                key->dirty = DBW_UPDATE;
-                zone->scratch = 1;
-                struct dbw_keystate *dnskey = dbw_get_keystate(key, DBW_DS);
-                dnskey->last_change = time_now();
-                dnskey->dirty = DBW_UPDATE;
-                need_commit = 1;
+            if (key_match == key_max) {
+                key_max = key_max ? 2 * key_max : 16;
+                if (!(grown = realloc(keys, key_max * sizeof (struct dbw_key *)))) {
+                    free(keys);
+                    client_printf_err(sockfd, "Memory allocation error");
+                    return 1;
+                }
+                keys = grown;
             }
+            keys[key_match++] = key;
         }
     }
+    *key_total += key_match;
+    if (key_match && !(status = calloc(key_match, sizeof (int)))) {
+        free(keys);
+        client_printf_err(sockfd, "Memory allocation error");
+        return 1;
+    }
+    /* if from is submit also exec dsSubmit command? */
+    if (!cmd && state_from == DBW_DS_AT_PARENT_SUBMIT &&
+            state_to == DBW_DS_AT_PARENT_SUBMITTED)
+    {
+        exec_dnskeys(sockfd, keys, status, key_match,
+            engine->config->delegation_signer_submit_command, "submit");
+    }
+    else if (!cmd && state_from == DBW_DS_AT_PARENT_RETRACT &&
+            state_to == DBW_DS_AT_PARENT_RETRACTED)
+    {
+        exec_dnskeys(sockfd, keys, status, key_match,
+            engine->config->delegation_signer_retract_command, "retract");
+    }
+    for (size_t k = 0; k < key_match; k++) {
+        struct dbw_key *key = keys[k];
+        if (status[k] != 0) continue;
+        key->ds_at_parent = state_to;
+        key->dirty = DBW_UPDATE;
+        key->zone->scratch = 1;
+        struct dbw_keystate *dnskey = dbw_get_keystate(key, DBW_DS);
+        dnskey->last_change = time_now();
+        dnskey->dirty = DBW_UPDATE;
+        need_commit = 1;
+    }
+    free(keys);
+    free(status);
     if (need_commit) {
         if (dbw_commit(db)) {
-            dbw_free(db);
             client_printf_err(sockfd, "Error committing to database");
             return 1;
         }
@@ -302,9 +485,51 @@ change_keys_from_to(db_connection_t *dbconn, int sockfd, const char *zonename,
             enforce_task_flush_zone(engine, zone->name);
         }
     }
-    dbw_free(db);
-    client_printf(sockfd, "%d KSK matches found.\n", key_match);
-    client_printf(sockfd, "%d KSKs changed.\n", key_match);
+    return 0;
+}
+
+/* Zones read at once when changing the keys of all zones */
+#define DS_ZONES_PER_FETCH 64
+
+/* Change DS state, when zonename not given do it for all zones! All zones
+ * are read, changed and committed a page at a time.
+ */
+int
+change_keys_from_to(db_connection_t *dbconn, int sockfd, const char *zonename,
+    const char *cka_id, int keytag, int state_from,
+    int state_to, engine_type *engine, int cmd)
+{
+    struct dbw_zone_filter filter = { NULL, NULL, NULL };
+    struct dbw_db *db;
+    char **names;
+    ssize_t n;
+    size_t key_match = 0;
+    int r = 0;
+
+    if (zonename) {
+        if (!(db = dbw_fetch_zones(dbconn, &zonename, 1, DBW_F_ALL))) return 1;
+        r = change_keys(db, sockfd, cka_id, keytag, state_from, state_to,
+            engine, cmd, &key_match);
+        dbw_free(db);
+    } else {
+        if ((n = dbw_zone_names(dbconn, &filter, &names)) < 0) return 1;
+        for (ssize_t i = 0; !r && i < n; i += DS_ZONES_PER_FETCH) {
+            size_t page = n - i < DS_ZONES_PER_FETCH ? n - i : DS_ZONES_PER_FETCH;
+            if (!(db = dbw_fetch_zones(dbconn, (char const **)&names[i], page,
+                    DBW_F_ALL)))
+            {
+                r = 1;
+                break;
+            }
+            r = change_keys(db, sockfd, cka_id, keytag, state_from, state_to,
+                engine, cmd, &key_match);
+            dbw_free(db);
+        }
+        dbw_names_free(names, n);
+    }
+    if (r) return 1;
+    client_printf(sockfd, "%d KSK matches found.\n", (int)key_match);
+    client_printf(sockfd, "%d KSKs changed.\n", (int)key_match);
     return (!key_match);
 }
 
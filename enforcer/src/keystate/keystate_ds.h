@@ -35,6 +35,10 @@ change_keys_from_to(db_connection_t *dbconn, int sockfd, const char *zonename,
     const char *cka_id, int keytag, int state_from,
     int state_to, engine_type *engine, int cmd);
 
+/* Non-zero if the DS command is configured with " --batch", and takes
+ * the records of all keys in one invocation. */
+int keystate_ds_command_batched(const char *ds_command);
+
 int run_ds_cmd(int sockfd, const char *cmd,
     db_connection_t *dbconn, key_data_ds_at_parent_t state_from,
     key_data_ds_at_parent_t state_to, engine_type* engine);
@@ -49,9 +49,25 @@ keystate_ds_submit_task_perform(task_type* task, char const *zonename, void *use
 	return schedule_SUCCESS;
 }
 
+static time_t
+keystate_ds_submit_task_perform_all(task_type* task, char const *owner, void *userdata,
+	void* context)
+{
+    db_connection_t* dbconn = (db_connection_t*) context;
+	(void)change_keys_from_to(dbconn, -1, NULL, NULL, -1,
+		KEY_DATA_DS_AT_PARENT_SUBMIT, KEY_DATA_DS_AT_PARENT_SUBMITTED,
+		(engine_type*)userdata, 0);
+	return schedule_SUCCESS;
+}
+
 task_type *
 keystate_ds_submit_task(engine_type *engine, char const *owner)
 {
+	if (!owner) {
+		return task_create(strdup("[all zones]"), TASK_CLASS_ENFORCER,
+			TASK_TYPE_DSSUBMIT, keystate_ds_submit_task_perform_all, engine,
+			NULL, time_now());
+	}
 	return task_create(strdup(owner), TASK_CLASS_ENFORCER, TASK_TYPE_DSSUBMIT,
 		keystate_ds_submit_task_perform, engine, NULL, time_now());
 }
@@ -30,6 +30,8 @@
 #ifndef _KEYSTATE_DS_SUBMIT_TASK_H_
 #define _KEYSTATE_DS_SUBMIT_TASK_H_
 
+/* Task handing the DS records of zone owner to the submit command. With
+ * owner NULL the task handles all zones at once. */
 task_type *
 keystate_ds_submit_task(engine_type *engine, char const *owner);
 
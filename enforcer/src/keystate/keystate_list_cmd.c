@@ -179,39 +179,58 @@ print_sorted_keys(int sockfd, int keyrole, const char *keystate, struct dbw_zone
 
 }
 
+struct list_args {
+    int sockfd;
+    int keyrole;
+    const char *keystate;
+    void (*printkey)(int sockfd, struct dbw_key *key, char *tchange);
+    size_t zones;
+};
+
 static int
-perform_keystate_list(int sockfd, db_connection_t *dbconn, const char* zonename,
+list_zone(struct dbw_db *db, struct dbw_zone *zone, void *arg)
+{
+    struct list_args *args = (struct list_args *)arg;
+    (void)db;
+    args->zones++;
+    print_sorted_keys(args->sockfd, args->keyrole, args->keystate, zone,
+        args->printkey);
+    return 0;
+}
+
+/* Print the keys of the zones matching filter a page of zones at a time,
+ * at most limit zones if not 0. */
+static int
+perform_keystate_list(int sockfd, db_connection_t *dbconn,
+    struct dbw_zone_filter const *filter, size_t limit, int parsable,
     int keyrole, const char* keystate, void (printheader)(int sockfd),
     void (printkey)(int sockfd, struct dbw_key *key, char* tchange))
 {
-    struct dbw_db *db = dbw_fetch(dbconn);
-    if (!db) {
+    struct list_args args = {sockfd, keyrole, keystate, printkey, 0};
+    char *next = NULL;
+
+    if (printheader) (*printheader)(sockfd);
+    if (dbw_foreach_zone(dbconn, filter, DBW_F_ALL, limit, list_zone,
+            &args, &next))
+    {
         client_printf_err(sockfd, "Unable to get list of keys, memory "
             "allocation or database error!\n");
         return 1;
     }
-    if (printheader) (*printheader)(sockfd);
-
-    if (zonename) {
-        struct dbw_zone *zone = dbw_get_zone(db, zonename);
-        if (zone)
-            print_sorted_keys(sockfd, keyrole, keystate, zone, printkey);
-        else
-            client_printf_err(sockfd, "Unable to get zone %s from database!\n", zonename);
+    if (!args.zones && filter->pattern
+        && !filter->pattern[strcspn(filter->pattern, "*?[\\")])
+    {
+        client_printf_err(sockfd, "Unable to get zone %s from database!\n",
+            filter->pattern);
     }
-    else {
-        sort_policies((const struct dbw_policy **)db->policies->set, db->policies->n);
-
-        for (size_t i = 0; i < db->policies->n; i++) {
-            struct dbw_policy *policy = (struct dbw_policy *) db->policies->set[i];
-            sort_zones((const struct dbw_zone **)policy->zone, policy->zone_count);
-            for (size_t z = 0; z < policy->zone_count; z++) {
-                struct dbw_zone *zone = policy->zone[z];
-                print_sorted_keys(sockfd, keyrole, keystate, zone, printkey);
-            }
-        }
+    if (next) {
+        if (parsable)
+            client_printf(sockfd, "after;%s\n", next);
+        else
+            client_printf(sockfd, "More zones follow, continue with "
+                "--after %s\n", next);
+        free(next);
     }
-    dbw_free(db);
     return 0;
 }
 
@@ -224,9 +243,12 @@ usage(int sockfd)
 		"	[--debug]				aka -d\n"
 		"	[--full]				aka -f\n"
 		"	[--parsable]				aka -p\n"
-		"	[--zone]				aka -z  \n"
+		"	[--zone <pattern>]			aka -z  \n"
+		"	[--policy <policy>]\n"
                 "	[--keytype]				aka -t  \n"
 		"	[--keystate | --all]			aka -k | -a  \n"
+		"	[--limit <zones>]\n"
+		"	[--after <zone>]\n"
 	);
 }
 
@@ -240,10 +262,16 @@ help(int sockfd)
 		"debug		print information about the keystate\n"
 		"full		print information about the keystate and keytags\n"
 		"parsable	output machine parsable list\n"
-		"zone		limit the output to the specific zone\n"
+		"zone		limit the output to the specific zone, or the zones\n"
+		"		matching a shell wildcard pattern\n"
+		"policy		limit the output to the zones of policy\n"
 		"keytype	limit the output to the given type, can be ZSK, KSK, or CSK\n"
 		"keystate	limit the output to the given state\n"
-		"all		print keys in all states (including generate) \n\n");
+		"all		print keys in all states (including generate) \n"
+		"limit		list the keys of at most this many zones. If more zones\n"
+		"		follow the last line tells where to continue, as\n"
+		"		\"after;<zone>\" with --parsable\n"
+		"after		list the zones sorted after this zone\n\n");
 }
 
 static void
@@ -292,26 +320,25 @@ printverbosekey(int sockfd, struct dbw_key * key, char* tchange)
 }
 
 static void
-printFullkey(int sockfd, zone_db_t* zone, key_data_t* key, char* tchange, hsm_key_t* hsmkey) {
-    (void)tchange;
+printFullkey(int sockfd, struct dbw_key *key, char *tchange) {
     client_printf(sockfd,
             "%-31s %-8s %-9s %d %s %-12s %-12s %-12s %-12s %d %4d    %s\n",
-            zone_db_name(zone),
-            key_data_role_text(key),
+            key->zone->name,
+            dbw_enum2txt(dbw_key_role_txt, key->role),
             map_keystate(key),
-            key_data_keytag(key),
-            hsm_key_locator(hsmkey),
-            key_state_state_text(key_data_cached_ds(key)),
-            key_state_state_text(key_data_cached_dnskey(key)),
-            key_state_state_text(key_data_cached_rrsigdnskey(key)),
-            key_state_state_text(key_data_cached_rrsig(key)),
-            key_data_publish(key),
-            key_data_active_ksk(key) | key_data_active_zsk(key),
+            key->keytag,
+            key->hsmkey->locator,
+            dbw_enum2txt(dbw_keystate_state_txt, dbw_get_keystate(key, DBW_DS)->state),
+            dbw_enum2txt(dbw_keystate_state_txt, dbw_get_keystate(key, DBW_DNSKEY)->state),
+            dbw_enum2txt(dbw_keystate_state_txt, dbw_get_keystate(key, DBW_RRSIGDNSKEY)->state),
+            dbw_enum2txt(dbw_keystate_state_txt, dbw_get_keystate(key, DBW_RRSIG)->state),
+            key->publish,
+            key->active_ksk | key->active_zsk,
             tchange);
 }
 
 static void
-printverboseparsablekey(int sockfd, zone_db_t* zone, struct dbw_key* key, char* tchange, hsm_key_t* hsmkey) {
+printverboseparsablekey(int sockfd, struct dbw_key *key, char *tchange) {
     client_printf(sockfd,
         "%s;%s;%s;%s;%d;%d;%s;%s;%d\n",
         key->zone->name,
@@ -364,14 +391,15 @@ printdebugparsablekey(int sockfd, struct dbw_key *key, char *tchange)
 static int
 run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
 {
-    #define NARGV 12
+    #define NARGV 18
     const char *argv[NARGV];
     int success, argIndex;
     int argc = 0, bVerbose = 0, bDebug = 0, bFull = 0, bParsable = 0, bAll = 0;
     int long_index = 0, opt = 0;
     const char* keytype = NULL;
     const char* keystate = NULL;
-    const char* zonename = NULL;
+    struct dbw_zone_filter filter = {NULL, NULL, NULL};
+    long limit = 0;
     db_connection_t* dbconn = getconnectioncontext(context);
 
     static struct option long_options[] = {
@@ -383,6 +411,9 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
         {"keytype", required_argument, 0, 't'},
         {"keystate", required_argument, 0, 'e'},
         {"all", no_argument, 0, 'a'},
+        {"policy", required_argument, 0, 'P'},
+        {"limit", required_argument, 0, 'l'},
+        {"after", required_argument, 0, 'A'},
         {0, 0, 0, 0}
     };
 
@@ -412,7 +443,20 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
                 bParsable = 1;
                 break;
             case 'z':
-                zonename = optarg;
+                filter.pattern = optarg;
+                break;
+            case 'P':
+                filter.policy = optarg;
+                break;
+            case 'l':
+                limit = atol(optarg);
+                if (limit <= 0) {
+                    client_printf_err(sockfd, "--limit must be positive\n");
+                    return -1;
+                }
+                break;
+            case 'A':
+                filter.after = optarg;
                 break;
             case 't':
                 keytype = optarg;
@@ -452,27 +496,28 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
     }
 
     if (bFull) {
-        success = perform_keystate_list(sockfd, dbconn, zonename, keytype, keystate, NULL, &printFullkey);
+        success = perform_keystate_list(sockfd, dbconn, &filter, limit, 0, keyrole,
+            keystate, NULL, &printFullkey);
     } else if (bDebug) {
         if (bParsable) {
-            success = perform_keystate_list(sockfd, dbconn, zonename, keyrole,
+            success = perform_keystate_list(sockfd, dbconn, &filter, limit, bParsable, keyrole,
                 keystate, NULL, &printdebugparsablekey);
         } else {
-            success = perform_keystate_list(sockfd, dbconn, zonename, keyrole,
+            success = perform_keystate_list(sockfd, dbconn, &filter, limit, bParsable, keyrole,
                 keystate, &printdebugheader, &printdebugkey);
         }
     } else if (bVerbose) {
         if (bParsable) {
-            success = perform_keystate_list(sockfd, dbconn, zonename, keyrole,
+            success = perform_keystate_list(sockfd, dbconn, &filter, limit, bParsable, keyrole,
                 keystate, NULL, &printverboseparsablekey);
         } else {
-            success = perform_keystate_list(sockfd, dbconn, zonename, keyrole,
+            success = perform_keystate_list(sockfd, dbconn, &filter, limit, bParsable, keyrole,
                 keystate, &printverboseheader, &printverbosekey);
         }
     } else {
         if (bParsable)
             client_printf_err(sockfd, "-p option only available in combination with -v and -d.\n");
-        success = perform_keystate_list(sockfd, dbconn, zonename, keyrole,
+        success = perform_keystate_list(sockfd, dbconn, &filter, limit, bParsable, keyrole,
             keystate, &printcompatheader, &printcompatkey);
     }
     return success;
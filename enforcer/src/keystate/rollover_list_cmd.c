@@ -29,6 +29,7 @@
 
 #include "config.h"
 #include <getopt.h>
+#include <assert.h>
 
 #include "db/dbw.h"
 #include "daemon/engine.h"
@@ -79,60 +80,74 @@ map_keytime(const struct dbw_zone *zone, const struct dbw_key *key)
     return strdup(ct);
 }
 
-static void
-print_key(int sockfd, const char* fmt, const struct dbw_key *key)
+struct list_args {
+    int sockfd;
+    int parsable;
+    size_t zones;
+};
+
+static int
+print_zone(struct dbw_db *db, struct dbw_zone *zone, void *arg)
 {
-    const char *role;
-    switch (key->role) {
-        case KEY_DATA_ROLE_KSK: role = "KSK"; break;
-        case KEY_DATA_ROLE_ZSK: role = "ZSK"; break;
-        case KEY_DATA_ROLE_CSK: role = "CSK"; break;
-        default:
-            assert(0);
+    struct list_args *args = (struct list_args *)arg;
+    const char* fmt = args->parsable ? "%s;%s;%s\n" : "%-31s %-8s %-30s\n";
+    (void)db;
+
+    args->zones++;
+    for (size_t k = 0; k < zone->key_count; k++) {
+        struct dbw_key *key = zone->key[k];
+        const char *role;
+        switch (key->role) {
+            case KEY_DATA_ROLE_KSK: role = "KSK"; break;
+            case KEY_DATA_ROLE_ZSK: role = "ZSK"; break;
+            case KEY_DATA_ROLE_CSK: role = "CSK"; break;
+            default:
+                assert(0);
+        }
+        char *tchange = map_keytime(zone, key);
+        client_printf(args->sockfd, fmt, zone->name, role, tchange);
+        free(tchange);
     }
-    char *tchange = map_keytime(key->zone, key);
-    client_printf(sockfd, fmt, key->zone->name, role, tchange);
-    free(tchange);
+    return 0;
 }
 
 /**
- * List all keys and their rollover time. If listed_zone is set limit
- * to that zone
+ * List all keys and their rollover time of the zones matching filter,
+ * a page of zones at a time.
  * \param sockfd client socket
- * \param listed_zone name of the zone
+ * \param filter zones to list
+ * \param limit list at most this many zones, all if 0
+ * \param parsable machine parsable output
  * \param dbconn active database connection
  * \return 0 ok, 1 fail.
  */
 static int
-perform_rollover_list(int sockfd, const char *listed_zone,
-    db_connection_t *dbconn)
+perform_rollover_list(int sockfd, struct dbw_zone_filter const *filter,
+    size_t limit, int parsable, db_connection_t *dbconn)
 {
-    struct dbw_list *keys;
-    const char* fmt = "%-31s %-8s %-30s\n";
+    struct list_args args = {sockfd, parsable, 0};
+    char *next = NULL;
 
-    struct dbw_db *db = dbw_fetch(dbconn);
-    /*struct dbw_list *policies = dbw_policies_all_filtered(dbconn, NULL, listed_zone, 0);*/
-
-    if (!db) {
+    if (!parsable) {
+        client_printf(sockfd, "Keys:\n");
+        client_printf(sockfd, "%-31s %-8s %-30s\n", "Zone:", "Keytype:",
+            "Rollover expected:");
+    }
+    if (dbw_foreach_zone(dbconn, filter, DBW_F_ALL, limit, print_zone,
+            &args, &next))
+    {
         ods_log_error("[%s] error enumerating rollovers", module_str);
         client_printf(sockfd, "error enumerating rollovers\n");
         return 1;
     }
-    client_printf(sockfd, "Keys:\n");
-    client_printf(sockfd, fmt, "Zone:", "Keytype:", "Rollover expected:");
-
-    for (size_t p = 0; p < db->policies->n; p++) {
-        struct dbw_policy *policy = (struct dbw_policy *)db->policies->set[p];
-        for (size_t z = 0; z < policy->zone_count; z++) {
-            struct dbw_zone *zone = policy->zone[z];
-            if (listed_zone && strcmp(listed_zone, zone->name)) continue;
-            for (size_t k = 0; k < zone->key_count; k++) {
-                struct dbw_key *key = zone->key[k];
-                print_key(sockfd, fmt, key);
-            }
-        }
+    if (next) {
+        if (parsable)
+            client_printf(sockfd, "after;%s\n", next);
+        else
+            client_printf(sockfd, "More zones follow, continue with "
+                "--after %s\n", next);
+        free(next);
     }
-    dbw_free(db);
     return 0;
 }
 
@@ -141,7 +156,11 @@ usage(int sockfd)
 {
     client_printf(sockfd, 
         "rollover list\n"
-        "	[--zone <zone>]				aka -z\n"
+        "	[--zone <pattern>]			aka -z\n"
+        "	[--policy <policy>]\n"
+        "	[--parsable]				aka -p\n"
+        "	[--limit <zones>]\n"
+        "	[--after <zone>]\n"
     );
 }
 
@@ -151,20 +170,31 @@ help(int sockfd)
 	client_printf(sockfd,
 		"List the expected dates and times of upcoming rollovers. This can be used to get an idea of upcoming works.\n"
 		"\nOptions:\n"
-		"zone	name of the zone\n\n");
+		"zone		name of the zone, or a shell wildcard pattern\n"
+		"policy		limit the output to the zones of policy\n"
+		"parsable	output machine parsable list\n"
+		"limit		list the keys of at most this many zones. If more\n"
+		"		zones follow the last line tells where to continue, as\n"
+		"		\"after;<zone>\" with --parsable\n"
+		"after		list the zones sorted after this zone\n\n");
 }
 
 static int
 run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
 {
-	#define NARGV 4
+	#define NARGV 12
 	const char *argv[NARGV];
-	int argc = 0, long_index = 0, opt = 0;
-	const char *zone = NULL;
+	int argc = 0, long_index = 0, opt = 0, parsable = 0;
+	struct dbw_zone_filter filter = {NULL, NULL, NULL};
+	long limit = 0;
         db_connection_t* dbconn = getconnectioncontext(context);
 
 	static struct option long_options[] = {
 		{"zone", required_argument, 0, 'z'},
+		{"policy", required_argument, 0, 'P'},
+		{"parsable", no_argument, 0, 'p'},
+		{"limit", required_argument, 0, 'l'},
+		{"after", required_argument, 0, 'A'},
 		{0, 0, 0, 0}
 	};
 	
@@ -180,10 +210,26 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
 	}
 
 	optind = 0;
-	while ((opt = getopt_long(argc, (char* const*)argv, "z:", long_options, &long_index)) != -1) {
+	while ((opt = getopt_long(argc, (char* const*)argv, "z:p", long_options, &long_index)) != -1) {
 		switch (opt) {
 			case 'z':
-				zone = optarg;
+				filter.pattern = optarg;
+				break;
+			case 'P':
+				filter.policy = optarg;
+				break;
+			case 'p':
+				parsable = 1;
+				break;
+			case 'l':
+				limit = atol(optarg);
+				if (limit <= 0) {
+					client_printf_err(sockfd, "--limit must be positive\n");
+					return -1;
+				}
+				break;
+			case 'A':
+				filter.after = optarg;
 				break;
 			default:
 				client_printf_err(sockfd, "unknown arguments\n");
@@ -192,7 +238,7 @@ run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
 				return -1;
 		}
 	}
-	return perform_rollover_list(sockfd, zone, dbconn);
+	return perform_rollover_list(sockfd, &filter, (size_t)limit, parsable, dbconn);
 }
 
 struct cmd_func_block rollover_list_funcblock = {
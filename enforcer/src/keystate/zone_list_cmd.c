@@ -32,6 +32,7 @@
  */
 
 #include "config.h"
+#include <getopt.h>
 
 #include "cmdhandler.h"
 #include "daemon/enforcercommands.h"
@@ -50,14 +51,30 @@ static const char *module_str = "zone_list_cmd";
 static void
 usage(int sockfd)
 {
-    client_printf(sockfd, "zone list\n");
+    client_printf(sockfd,
+        "zone list\n"
+        "	[--zone <pattern>]			aka -z\n"
+        "	[--policy <policy>]\n"
+        "	[--parsable]				aka -p\n"
+        "	[--limit <zones>]\n"
+        "	[--after <zone>]\n"
+    );
 }
 
 static void
 help(int sockfd)
 {
     client_printf(sockfd,
-        "List all zones currently in the database.\n\n"
+        "List all zones currently in the database.\n"
+        "\nOptions:\n"
+        "zone		limit the output to the zone, or the zones matching a\n"
+        "		shell wildcard pattern\n"
+        "policy		limit the output to the zones of policy\n"
+        "parsable	output machine parsable list\n"
+        "limit		list at most this many zones. If more zones follow the\n"
+        "		last line tells where to continue, as \"after;<zone>\"\n"
+        "		with --parsable\n"
+        "after		list the zones sorted after this zone\n\n"
     );
 }
 
@@ -75,44 +92,118 @@ time_to_human(time_t t, char *buf, size_t buflen)
 
 }
 
+struct list_args {
+    int sockfd;
+    int parsable;
+    size_t zones;
+};
+
 static int
-run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
+list_zone(struct dbw_db *db, struct dbw_zone *z, void *arg)
 {
     const char* fmt = "%-31s %-13s %-26s %-34s\n";
+    struct list_args *args = (struct list_args *)arg;
     char buf[32];
+    (void)db;
+
+    if (args->parsable) {
+        client_printf(args->sockfd, "%s;%s;%ld;%s\n", z->name,
+            z->policy->name, (long)z->next_change, z->signconf_path);
+    } else {
+        if (!args->zones) {
+            client_printf(args->sockfd, "Zones:\n");
+            client_printf(args->sockfd, fmt, "Zone:", "Policy:",
+                "Next change:", "Signer Configuration:");
+        }
+        client_printf(args->sockfd, fmt, z->name, z->policy->name,
+            time_to_human(z->next_change, buf, sizeof(buf)), z->signconf_path);
+    }
+    args->zones++;
+    return 0;
+}
+
+static int
+run(int sockfd, cmdhandler_ctx_type* context, char *cmd)
+{
+    #define NARGV 12
+    const char *argv[NARGV];
+    int argc, opt, long_index = 0;
+    struct list_args args = {sockfd, 0, 0};
+    struct dbw_zone_filter filter = {NULL, NULL, NULL};
+    long limit = 0;
+    char *next = NULL;
     db_connection_t* dbconn = getconnectioncontext(context);
     engine_type* engine = getglobalcontext(context);
-    (void)cmd;
-
-    ods_log_debug("[%s] %s command", module_str, zone_list_funcblock.cmdname);
 
-    struct dbw_db *db = dbw_fetch_filtered(dbconn, DBW_F_POLICY|DBW_F_ZONE);
-    if (!db) return 1;
+    static struct option long_options[] = {
+        {"zone", required_argument, 0, 'z'},
+        {"policy", required_argument, 0, 'P'},
+        {"parsable", no_argument, 0, 'p'},
+        {"limit", required_argument, 0, 'l'},
+        {"after", required_argument, 0, 'A'},
+        {0, 0, 0, 0}
+    };
 
-    client_printf(sockfd, "Database set to: %s\n", engine->config->datastore);
+    ods_log_debug("[%s] %s command", module_str, zone_list_funcblock.cmdname);
 
-    if (!db->zones->n) {
-        client_printf(sockfd, "No zones in database.\n");
-        dbw_free(db);
-        return 0;
+    argc = ods_str_explode(cmd, NARGV, argv);
+    if (argc == -1) {
+        ods_log_error("[%s] too many arguments for %s command",
+                module_str, zone_list_funcblock.cmdname);
+        client_printf_err(sockfd, "too many arguments\n");
+        return -1;
+    }
+    optind = 0;
+    while ((opt = getopt_long(argc, (char* const*)argv, "z:p", long_options, &long_index)) != -1) {
+        switch (opt) {
+            case 'z':
+                filter.pattern = optarg;
+                break;
+            case 'P':
+                filter.policy = optarg;
+                break;
+            case 'p':
+                args.parsable = 1;
+                break;
+            case 'l':
+                limit = atol(optarg);
+                if (limit <= 0) {
+                    client_printf_err(sockfd, "--limit must be positive\n");
+                    return -1;
+                }
+                break;
+            case 'A':
+                filter.after = optarg;
+                break;
+            default:
+                client_printf_err(sockfd, "unknown arguments\n");
+                ods_log_error("[%s] unknown arguments for %s command",
+                        module_str, zone_list_funcblock.cmdname);
+                return -1;
+        }
     }
-    client_printf(sockfd, "Zones:\n");
-    client_printf(sockfd, fmt, "Zone:", "Policy:", "Next change:",
-        "Signer Configuration:");
 
-    sort_policies((const struct dbw_policy **)db->policies->set, db->policies->n);
-    for (size_t p = 0; p < db->policies->n; p++) {
-        struct dbw_policy *policy = (struct dbw_policy *)db->policies->set[p];
+    if (!args.parsable)
+        client_printf(sockfd, "Database set to: %s\n", engine->config->datastore);
 
-        sort_zones((const struct dbw_zone **)policy->zone, policy->zone_count);
+    if (dbw_foreach_zone(dbconn, &filter, DBW_F_POLICY|DBW_F_ZONE,
+            (size_t)limit, list_zone, &args, &next))
+        return 1;
 
-        for (size_t i = 0; i < policy->zone_count; i++) {
-            struct dbw_zone *z = policy->zone[i];
-            client_printf(sockfd, fmt, z->name, z->policy->name,
-                time_to_human(z->next_change, buf, sizeof(buf)), z->signconf_path);
-        }
+    if (!args.zones && !args.parsable) {
+        if (filter.pattern || filter.policy || filter.after)
+            client_printf(sockfd, "No zones match.\n");
+        else
+            client_printf(sockfd, "No zones in database.\n");
+    }
+    if (next) {
+        if (args.parsable)
+            client_printf(sockfd, "after;%s\n", next);
+        else
+            client_printf(sockfd, "More zones follow, continue with "
+                "--after %s\n", next);
+        free(next);
     }
-    dbw_free(db);
     return 0;
 }
 
@@ -248,7 +248,17 @@ int zonelist_import(int sockfd, engine_type* engine, db_connection_t *dbconn,
 {
     xmlDocPtr doc;
     xmlNodePtr root;
-    struct dbw_db *db = dbw_fetch(dbconn);
+    char const **names;
+    size_t n = 0;
+    struct dbw_db *db;
+
+    /* Keys are only needed to delete zones. The zones of a large zonelist
+     * are diffed against the database in one pass and inserted in batches
+     * by dbw_commit(). */
+    if (do_delete)
+        db = dbw_fetch(dbconn);
+    else
+        db = dbw_fetch_filtered(dbconn, DBW_F_POLICY|DBW_F_ZONE);
     if (!db) return ZONELIST_IMPORT_ERR_DATABASE;
 
     /* Validate, parse and walk the XML. */
@@ -312,6 +322,7 @@ int zonelist_import(int sockfd, engine_type* engine, db_connection_t *dbconn,
 
         /*hsm_key_factory_schedule_generate_all(engine, 0);*/
         /* schedule all changed zones */
+        names = calloc(db->zones->n, sizeof (char const *));
         for (size_t z = 0; z < db->zones->n; z++) {
             struct dbw_zone *zone = (struct dbw_zone *)db->zones->set[z];
             if (!zone->scratch) {
@@ -330,8 +341,14 @@ int zonelist_import(int sockfd, engine_type* engine, db_connection_t *dbconn,
                 client_printf(sockfd, "Updated zone %s successfully\n", zone->name);
             }
 
-            enforce_task_flush_zone(engine, zone->name);
+            if (names)
+                names[n++] = zone->name;
+            else
+                enforce_task_flush_zone(engine, zone->name);
         }
+        /* Thousands of new zones are enforced in waves, not all at once */
+        enforce_task_flush_zones(engine, names, n);
+        free(names);
         r = ZONELIST_IMPORT_OK;
     } else {
         r = ZONELIST_IMPORT_NO_CHANGE;
@@ -33,6 +33,7 @@
 #include "file.h"
 #include "daemon/engine.h"
 #include "db/dbw.h"
+#include "signconf/signer_notify.h"
 
 #include "signconf/signconf_task.h"
 
@@ -41,33 +42,40 @@ static const char *module_str = "signconf_cmd";
 static time_t
 perform(task_type* task, char const *zonename, void *userdata, void *context)
 {
-    (void)userdata;
     int ret;
-    char cmd[SYSTEM_MAXLEN];
+    engine_type* engine = (engine_type*) userdata;
     db_connection_t* dbconn = (db_connection_t*) context;
 
     ods_log_info("[%s] performing signconf for zone %s", module_str,
         zonename);
 
-    /* exports all that have "needswriting set */
+    /* exports all that have "needswriting set. A retry after a failed
+     * notification has nothing to export but must still notify. */
     ret = signconf_export_zone(zonename, dbconn);
-    if (ret == SIGNCONF_EXPORT_NO_CHANGE) {
+    if (ret == SIGNCONF_EXPORT_NO_CHANGE && !task->backoff) {
         ods_log_info("[%s] signconf done, no change", module_str);
         return schedule_SUCCESS;
-    } else if (ret) {
+    } else if (ret && ret != SIGNCONF_EXPORT_NO_CHANGE) {
         ods_log_error("[%s] signconf failed", module_str);
         return schedule_DEFER;
     }
 
     ods_log_info("[%s] signconf done for zone %s, notifying signer",
         module_str, zonename);
-        
-    /* TODO: do this better, connect directly or use execve() */
-    if (snprintf(cmd, sizeof(cmd), "%s %s", SIGNER_CLI_UPDATE, zonename) >= (int)sizeof(cmd)
-        || system(cmd))
-    {
+
+    ret = signer_notify_zone(engine, zonename);
+    if (ret > 0) {
+        /* The signer answered. For a zone it does not know yet it
+         * reloads its zone list by itself, asking again would not help. */
+        ods_log_error("[%s] signer failed to update zone %s",
+            module_str, zonename);
+    } else if (ret < 0) {
         ods_log_error("[%s] unable to notify signer of signconf changes for zone %s!",
             module_str, zonename);
+        /* A signer that is down reads all signconfs when it starts, stop
+         * asking once the backoff is at its maximum. */
+        if (task->backoff < ODS_SE_MAX_BACKOFF)
+            return schedule_DEFER;
     }
     return schedule_SUCCESS;
 }
@@ -77,7 +85,7 @@ signconf_task_flush_zone(engine_type *engine, db_connection_t *dbconn,
     const char* zonename)
 {
     task_type* task = task_create(strdup(zonename), TASK_CLASS_ENFORCER,
-        TASK_TYPE_SIGNCONF, perform, NULL, NULL, time_now());
+        TASK_TYPE_SIGNCONF, perform, engine, NULL, time_now());
     (void) schedule_task(engine->taskq, task, 1, 0);
 }
 
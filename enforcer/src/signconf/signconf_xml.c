@@ -38,6 +38,9 @@
 #include <libxml/parser.h>
 #include <libxml/tree.h>
 #include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 static int __free(char **p) {
@@ -49,6 +52,46 @@ static int __free(char **p) {
     return 0;
 }
 
+/**
+ * Check if a file holds exactly the given content.
+ * \return non-zero if it does, 0 if it differs or can not be read.
+ */
+static int
+file_has_content(char const *path, char const *content, size_t size)
+{
+    struct stat st;
+    char *buf;
+    FILE *fd;
+    int same;
+
+    if (stat(path, &st) || (size_t)st.st_size != size) return 0;
+    if (!(fd = fopen(path, "r"))) return 0;
+    if (!(buf = malloc(size ? size : 1))) {
+        fclose(fd);
+        return 0;
+    }
+    same = fread(buf, 1, size, fd) == size && !memcmp(buf, content, size);
+    free(buf);
+    fclose(fd);
+    return same;
+}
+
+/**
+ * Write content to a new file.
+ * \return 0 on success.
+ */
+static int
+file_write_content(char const *path, char const *content, size_t size)
+{
+    FILE *fd;
+    int error;
+
+    if (!(fd = fopen(path, "w"))) return 1;
+    error = fwrite(content, 1, size, fd) != size;
+    if (fclose(fd)) error = 1;
+    return error;
+}
+
 /**
  * Export the signconf XML for the given zone that uses the given policy.
  * \param[in] sockfd a socket fd.
@@ -57,7 +100,8 @@ static int __free(char **p) {
  * \param[in] force if non-zero it will force the export for all zones even if
  * there are no updates for the zones.
  * \return SIGNCONF_EXPORT_ERR_* on error, otherwise SIGNCONF_EXPORT_OK or
- * SIGNCONF_EXPORT_NO_CHANGE.
+ * SIGNCONF_EXPORT_NO_CHANGE. The latter is also returned when the exported
+ * document is identical to the signconf on disk, which is then left alone.
  */
 static int
 signconf_xml_export(int sockfd, struct dbw_zone *zone, int force)
@@ -71,6 +115,8 @@ signconf_xml_export(int sockfd, struct dbw_zone *zone, int force)
     xmlNodePtr node4;
     xmlNodePtr node5;
     xmlNodePtr keys;
+    xmlChar *content = NULL;
+    int content_size = 0;
     duration_type* duration;
     char* duration_text = NULL;
     char text[1024];
@@ -270,17 +316,40 @@ signconf_xml_export(int sockfd, struct dbw_zone *zone, int force)
         }
     }
 
-    unlink(path);
-    if (xmlSaveFormatFileEnc(path, doc, "UTF-8", 1) == -1) {
+    xmlDocDumpFormatMemoryEnc(doc, &content, &content_size, "UTF-8", 1);
+    xmlFreeDoc(doc);
+    if (!content) {
         ods_log_error("[signconf_export] Unable to write signconf for zone "
             "%s, LibXML error!", zone->name);
         if (sockfd > -1)
             client_printf_err(sockfd, "Unable to write signconf for zone "
                 "%s, LibXML error!\n", zone->name);
-        xmlFreeDoc(doc);
+        return SIGNCONF_EXPORT_ERR_XML;
+    }
+
+    /* Rewriting an identical signconf would only make the signer reload
+     * it, keep the old file and its mtime. */
+    if (file_has_content(zone->signconf_path, (char *)content, content_size)) {
+        xmlFree(content);
+        if (zone->signconf_needs_writing) {
+            zone->signconf_needs_writing = 0;
+            dbw_mark_dirty((struct dbrow *)zone);
+        }
+        return SIGNCONF_EXPORT_NO_CHANGE;
+    }
+
+    unlink(path);
+    if (file_write_content(path, (char *)content, content_size)) {
+        ods_log_error("[signconf_export] Unable to write signconf for zone "
+            "%s, write failed!", zone->name);
+        if (sockfd > -1)
+            client_printf_err(sockfd, "Unable to write signconf for zone "
+                "%s, write failed!\n", zone->name);
+        xmlFree(content);
+        unlink(path);
         return SIGNCONF_EXPORT_ERR_FILE;
     }
-    xmlFreeDoc(doc);
+    xmlFree(content);
 
     if (check_rng(path, OPENDNSSEC_SCHEMA_DIR "/signconf.rng", 0)) {
         ods_log_error("[signconf_export] Unable to validate the exported "
@@ -310,18 +379,21 @@ signconf_xml_export(int sockfd, struct dbw_zone *zone, int force)
 int
 signconf_export_zone(char const *zonename, db_connection_t* dbconn)
 {
-    struct dbw_db *db = dbw_fetch(dbconn);
+    struct dbw_db *db = dbw_fetch_zone(dbconn, zonename);
     if (!db) return SIGNCONF_EXPORT_ERR_DATABASE;
     struct dbw_zone *zone = dbw_get_zone(db, zonename);
     if (!zone) {
         ods_log_error("[signconf_export] Unable to fetch zone %s from"
             " database", zonename);
+        dbw_free(db);
         return SIGNCONF_EXPORT_ERR_DATABASE;
     }
     /* We always force. Since now it is scheduled per zone */
     int ret = signconf_xml_export(-1, zone, 1);
-    if (ret == SIGNCONF_EXPORT_OK) {
-        ret = dbw_commit(db);
+    if (ret == SIGNCONF_EXPORT_OK
+        || (ret == SIGNCONF_EXPORT_NO_CHANGE && zone->dirty))
+    {
+        if (dbw_commit(db)) ret = SIGNCONF_EXPORT_ERR_DATABASE;
     }
     dbw_free(db);
     return ret;
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2011 Surfnet 
+ * Copyright (c) 2011 .SE (The Internet Infrastructure Foundation).
+ * Copyright (c) 2011 OpenDNSSEC AB (svb)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "config.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "clientpipe.h"
+#include "file.h"
+#include "log.h"
+
+#include "signconf/signer_notify.h"
+
+static const char *module_str = "signer_notify";
+
+/* Commands written before reading back their replies. Replies are a
+ * line of text and an exit code, this keeps both socket buffers far
+ * from full so neither side blocks on write. */
+#define SIGNER_NOTIFY_BATCH 64
+/* Seconds to wait for the signer to take or answer a batch. */
+#define SIGNER_NOTIFY_TIMEOUT 60
+#define SIGNER_NOTIFY_CMD "update "
+
+/* A queued notification, owned by the caller waiting for its status */
+struct notify_request {
+    char const *name;
+    int status; /* 0 when updated, 1 when the signer failed, -1 unreached */
+    int done;   /* status is final, set under notify_lock */
+};
+
+static pthread_mutex_t notify_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t notify_done = PTHREAD_COND_INITIALIZER;
+static struct notify_request **pending = NULL;
+static size_t pending_n = 0, pending_max = 0;
+static int flushing = 0;
+/* Owned by the flusher, or by whoever holds notify_lock if there is none */
+static int sockfd = -1;
+
+static int
+connect_signer(char const *path)
+{
+    struct sockaddr_un servaddr;
+    struct timeval tv;
+    int fd;
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+        ods_log_error("[%s] socket creation failed: %s", module_str,
+            strerror(errno));
+        return -1;
+    }
+    memset(&servaddr, 0, sizeof(servaddr));
+    servaddr.sun_family = AF_UNIX;
+    strncpy(servaddr.sun_path, path, sizeof(servaddr.sun_path) - 1);
+    if (connect(fd, (const struct sockaddr*) &servaddr, sizeof(servaddr)) == -1) {
+        ods_log_error("[%s] unable to connect to signer (\"%s\"): %s",
+            module_str, path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    tv.tv_sec = SIGNER_NOTIFY_TIMEOUT;
+    tv.tv_usec = 0;
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) == -1
+        || setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) == -1)
+    {
+        ods_log_error("[%s] unable to set timeout on signer socket: %s",
+            module_str, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Write one STDIN frame per zone in a single write. 0 on success. */
+static int
+send_batch(int fd, struct notify_request **reqs, size_t n)
+{
+    size_t i, len, size = 0, pos = 0;
+    char *buf;
+    int ret;
+
+    for (i = 0; i < n; i++)
+        size += 3 + strlen(SIGNER_NOTIFY_CMD) + strlen(reqs[i]->name);
+    if (!(buf = malloc(size))) return 1;
+    for (i = 0; i < n; i++) {
+        len = strlen(SIGNER_NOTIFY_CMD) + strlen(reqs[i]->name);
+        buf[pos] = CLIENT_OPC_STDIN;
+        *(uint16_t *)(buf+pos+1) = htons((uint16_t)len);
+        memcpy(buf+pos+3, SIGNER_NOTIFY_CMD, strlen(SIGNER_NOTIFY_CMD));
+        memcpy(buf+pos+3+strlen(SIGNER_NOTIFY_CMD), reqs[i]->name,
+            strlen(reqs[i]->name));
+        pos += 3 + len;
+    }
+    ret = (ods_writen(fd, buf, size) == -1);
+    if (ret) {
+        ods_log_error("[%s] write to signer failed: %s", module_str,
+            strerror(errno));
+    }
+    free(buf);
+    return ret;
+}
+
+/* Read frames until an exit code came back for each of the n commands.
+ * Output of the commands is dropped. *acked counts the commands
+ * answered, their status is set from the exit code. 0 on success. */
+static int
+read_replies(int fd, struct notify_request **reqs, size_t n, size_t *acked)
+{
+    char buf[ODS_SE_MAXLINE+3];
+    size_t pos = 0, framelen;
+    ssize_t r;
+
+    while (*acked < n) {
+        r = read(fd, buf+pos, sizeof(buf)-pos);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) {
+            ods_log_error("[%s] read from signer failed: %s", module_str,
+                r ? strerror(errno) : "connection closed");
+            return 1;
+        }
+        pos += r;
+        while (pos >= 3 && *acked < n) {
+            framelen = 3 + ntohs(*(uint16_t *)(buf+1));
+            if (framelen > sizeof(buf)) {
+                ods_log_error("[%s] message from signer too big", module_str);
+                return 1;
+            }
+            if (framelen > pos) break;
+            if (buf[0] == CLIENT_OPC_EXIT && framelen == 4) {
+                if (buf[3]) {
+                    ods_log_error("[%s] signer failed to update zone %s, "
+                        "exit code %d", module_str, reqs[*acked]->name, buf[3]);
+                }
+                reqs[*acked]->status = (buf[3] != 0);
+                (*acked)++;
+            }
+            pos -= framelen;
+            memmove(buf, buf+framelen, pos);
+        }
+    }
+    return 0;
+}
+
+/* Send all requests to the signer, reconnecting once if the connection
+ * turns out to be stale. Commands already answered are not resent;
+ * an update being run twice is harmless. Requests not answered are left
+ * unreached. */
+static void
+deliver(char const *path, struct notify_request **reqs, size_t n)
+{
+    size_t acked = 0, done, batch;
+    int retried = 0;
+
+    while (acked < n) {
+        batch = n - acked < SIGNER_NOTIFY_BATCH ? n - acked : SIGNER_NOTIFY_BATCH;
+        done = 0;
+        if (sockfd == -1 && (sockfd = connect_signer(path)) == -1)
+            break;
+        if (!send_batch(sockfd, reqs+acked, batch)
+            && !read_replies(sockfd, reqs+acked, batch, &done))
+        {
+            acked += batch;
+            continue;
+        }
+        acked += done;
+        close(sockfd);
+        sockfd = -1;
+        if (retried++) break;
+    }
+    for (; acked < n; acked++)
+        reqs[acked]->status = -1;
+}
+
+int
+signer_notify_zone(engine_type *engine, char const *zonename)
+{
+    struct notify_request req, **batch;
+    size_t n;
+
+    req.name = zonename;
+    req.status = -1;
+    req.done = 0;
+    pthread_mutex_lock(&notify_lock);
+    if (pending_n == pending_max) {
+        n = pending_max ? 2 * pending_max : SIGNER_NOTIFY_BATCH;
+        batch = realloc(pending, n * sizeof(struct notify_request *));
+        if (!batch) {
+            pthread_mutex_unlock(&notify_lock);
+            return -1;
+        }
+        pending = batch;
+        pending_max = n;
+    }
+    pending[pending_n++] = &req;
+    if (flushing) {
+        /* Whoever is flushing picks it up before finishing. */
+        while (!req.done)
+            pthread_cond_wait(&notify_done, &notify_lock);
+        pthread_mutex_unlock(&notify_lock);
+        return req.status;
+    }
+    flushing = 1;
+    while (pending_n) {
+        batch = pending;
+        n = pending_n;
+        pending = NULL;
+        pending_n = pending_max = 0;
+        pthread_mutex_unlock(&notify_lock);
+        deliver(engine->config->clisock_filename_signer, batch, n);
+        pthread_mutex_lock(&notify_lock);
+        while (n) batch[--n]->done = 1;
+        free(batch);
+        pthread_cond_broadcast(&notify_done);
+    }
+    flushing = 0;
+    pthread_mutex_unlock(&notify_lock);
+    return req.status;
+}
+
+void
+signer_notify_close(void)
+{
+    pthread_mutex_lock(&notify_lock);
+    if (!flushing && sockfd != -1) {
+        close(sockfd);
+        sockfd = -1;
+    }
+    pthread_mutex_unlock(&notify_lock);
+}
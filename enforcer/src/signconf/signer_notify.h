@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2011 Surfnet 
+ * Copyright (c) 2011 .SE (The Internet Infrastructure Foundation).
+ * Copyright (c) 2011 OpenDNSSEC AB (svb)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _SIGNCONF_SIGNER_NOTIFY_H_
+#define _SIGNCONF_SIGNER_NOTIFY_H_
+
+#include "daemon/engine.h"
+
+/**
+ * Tell the signer the signconf of a zone changed, as "ods-signer update
+ * <zone>" would. The request is queued; whichever caller finds no flush
+ * in progress sends everything queued so far over one connection to the
+ * signer command socket, pipelined, and collects the exit codes. Other
+ * callers wait for the flush to answer their zone. Writes and reads on
+ * the socket time out after a minute.
+ *
+ * \param engine, engine whose config holds the signer socket name.
+ * \param zonename, zone to notify about.
+ * \return 0 if the signer updated the zone, 1 if the signer failed to
+ *         update it, -1 if the signer could not be reached.
+ */
+int signer_notify_zone(engine_type *engine, char const *zonename);
+
+/**
+ * Close the connection to the signer, if any. Next notification
+ * reconnects.
+ */
+void signer_notify_close(void);
+
+#endif
@@ -654,7 +654,6 @@ dnsout_send_notify(zone_type* z, names_view_type view)
     ods_log_assert(z->name);
     names_viewlookupone(view, NULL, LDNS_RR_TYPE_SOA, NULL, &soa);
     ods_log_assert(soa);
-    soa = ldns_rr_clone(soa);
     notify_enable(z->notify, soa);
 }
 
@@ -215,7 +215,7 @@ rrset_sign(signconf_type* signconf, names_view_type view, recordset_type record,
     /* Transmogrify rrset */
     if (ldns_rr_list_rr_count(rrset) <= 0) {
         /* Empty RRset, no signatures needed */
-        if(rrset) ldns_rr_list_free(rrset);
+        if(rrset) ldns_rr_list_deep_free(rrset);
         free(matchedsignatures);
         return 0;
     }
@@ -234,12 +234,12 @@ rrset_sign(signconf_type* signconf, names_view_type view, recordset_type record,
 
     /* Skip delegation, glue and occluded RRsets */
     if (dstatus != LDNS_RR_TYPE_SOA) {
-        if(rrset) ldns_rr_list_free(rrset);
+        if(rrset) ldns_rr_list_deep_free(rrset);
         free(matchedsignatures);
         return 0;
     }
     if (delegpt != LDNS_RR_TYPE_SOA && rrtype != LDNS_RR_TYPE_DS) {
-        if(rrset) ldns_rr_list_free(rrset);
+        if(rrset) ldns_rr_list_deep_free(rrset);
         free(matchedsignatures);
         return 0;
     }
@@ -249,8 +249,8 @@ rrset_sign(signconf_type* signconf, names_view_type view, recordset_type record,
      */
     for (int i=0; i<nmatchedsignatures; i++) {
         if(matchedsignatures[i].signature) {
-            expiration = ldns_rdf2native_int32(ldns_rr_rrsig_expiration(matchedsignatures[i].signature->rr));
-            inception = ldns_rdf2native_int32(ldns_rr_rrsig_inception(matchedsignatures[i].signature->rr));
+            expiration = names_signatureexpiration(matchedsignatures[i].signature);
+            inception = names_signatureinception(matchedsignatures[i].signature);
         }
         if (matchedsignatures[i].key && matchedsignatures[i].key->ksk && !matchedsignatures[i].key->zsk && rrtype != LDNS_RR_TYPE_DNSKEY) {
             /* If KSK don't sign other RRsets */
@@ -322,7 +322,7 @@ rrset_sign(signconf_type* signconf, names_view_type view, recordset_type record,
             rrsig = lhsm_sign(ctx, rrset, matchedsignatures[i].key, inception, expiration);
             if (rrsig == NULL) {
                 ods_log_crit("unable to sign RRset[%i]: lhsm_sign() failed", rrtype);
-                if(rrset) ldns_rr_list_free(rrset);
+                if(rrset) ldns_rr_list_deep_free(rrset);
                 free(matchedsignatures);
                 return ODS_STATUS_HSM_ERR;
             }
@@ -340,7 +340,7 @@ rrset_sign(signconf_type* signconf, names_view_type view, recordset_type record,
                     ods_log_error("unable to publish dnskeys for zone %s: error decoding literal dnskey", signconf->name);
                     if(apex)
                         ldns_rdf_free(apex);
-                    if(rrset) ldns_rr_list_free(rrset);
+                    if(rrset) ldns_rr_list_deep_free(rrset);
                     free(matchedsignatures);
                     return status;
                 }
@@ -354,7 +354,7 @@ rrset_sign(signconf_type* signconf, names_view_type view, recordset_type record,
     }
 
     /* RRset signing completed */
-    if(rrset) ldns_rr_list_free(rrset);
+    if(rrset) ldns_rr_list_deep_free(rrset);
     free(matchedsignatures);
     return 0;
 }
@@ -637,6 +637,7 @@ zone_update_serial(zone_type* zone, names_view_type view)
         serial = ldns_rdf2native_int32(ldns_rr_rdf(rr, 2));
         zone->inboundserial = malloc(sizeof(uint16_t));
         *(zone->inboundserial) = serial;
+        ldns_rr_free(rr);
         rr = NULL;
     }
     /* FIXME set min TTL from signconf */
@@ -656,7 +657,6 @@ zone_update_serial(zone_type* zone, names_view_type view)
         names_recordsetvalidfrom(d, serial);
     }
     names_recordlookupone(d, LDNS_RR_TYPE_SOA, NULL, &rr);
-    rr = ldns_rr_clone(rr);;
     names_recorddelall(d, LDNS_RR_TYPE_SOA);
     if(zone->outboundserial)
         free(zone->outboundserial);
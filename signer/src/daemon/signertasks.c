@@ -130,9 +130,7 @@ signdomain(struct worker_context* superior, hsm_ctx_t* ctx, recordset_type recor
     ldns_rr_type rrtype;
     time_t expiration = INT_MAX;
     time_t rrsigexpirationtime;
-    ldns_rr* rrsig;
     struct signature_struct** rrsigs;
-    ldns_rdf* rrsigexpiration;
 
     for (iter=names_recordalltypes(record); names_iterate(&iter,&rrtype); names_advance(&iter,NULL)) {
         if ((status = rrset_sign(superior->zone->signconf, superior->view, record, rrtype, ctx, superior->clock_in)) != ODS_STATUS_OK)
@@ -145,9 +143,7 @@ signdomain(struct worker_context* superior, hsm_ctx_t* ctx, recordset_type recor
 
     names_recordlookupall(record, LDNS_RR_TYPE_RRSIG, NULL, NULL, &rrsigs);
     for(int i=0; rrsigs[i]; i++) {
-        rrsig = rrsigs[i]->rr;
-        rrsigexpiration = ldns_rr_rrsig_expiration(rrsig);
-        rrsigexpirationtime = ldns_rdf2native_time_t(rrsigexpiration);
+        rrsigexpirationtime = names_signatureexpiration(rrsigs[i]);
         if(rrsigexpirationtime < expiration)
             expiration = rrsigexpirationtime;
     }
@@ -556,8 +556,6 @@ upgraderecords(zone_type* zone, names_view_type view)
     recordset_type record;
     time_t expiration = LONG_MAX;
     struct signature_struct** rrsigs;
-    ldns_rr* rrsig;
-    ldns_rdf* rrsigexpiration;
     time_t rrsigexpirationtime;
     uint32_t serial;
     serial = *zone->outboundserial;
@@ -566,9 +564,7 @@ upgraderecords(zone_type* zone, names_view_type view)
         names_recordsetvalidfrom(record, serial);
         names_recordlookupall(record, LDNS_RR_TYPE_RRSIG, NULL, NULL, &rrsigs);
         for(int i=0; rrsigs[i]; i++) {
-            rrsig = rrsigs[i]->rr;
-            rrsigexpiration = ldns_rr_rrsig_expiration(rrsig);
-            rrsigexpirationtime = ldns_rdf2native_time_t(rrsigexpiration);
+            rrsigexpirationtime = names_signatureexpiration(rrsigs[i]);
             if(rrsigexpirationtime < expiration)
                 expiration = rrsigexpirationtime;
         }
@@ -535,5 +535,6 @@ zone_start(zone_type* zone)
             free(zone->inboundserial);
         zone->inboundserial = malloc(sizeof(uint32_t));
         *zone->inboundserial = serial;
+        ldns_rr_free(rr);
     }
 }
@@ -435,7 +435,7 @@ testIterator(void)
     prev = NULL;
     ttl = 60;
     name = "example.com";
-    record = names_recordcreate((char**)&name);
+    record = names_recordcreate((char**)&name, NULL);
     origin = ldns_rdf_new_frm_str(LDNS_RDF_TYPE_DNAME, "example.com.");
     ldns_rr_new_frm_str(&rr, "example.com. 86400 IN SOA ns1.example.com. postmaster.example.com. 2009060301 10800 3600 604800 86400", ttl, origin, &prev);
     names_recordadddata(record, rr);
@@ -512,6 +512,459 @@ testAnnotate(void)
     testAnnotateItem("com", "com");
 }
 
+void
+testCanonicalOrder(void)
+{
+    /* the example ordering from RFC 4034 section 6.1 */
+    const char* names[] = { "example", "a.example", "yljkjljk.a.example", "Z.a.example", "zABC.a.EXAMPLE",
+                            "z.example", "\\001.z.example", "*.z.example", "\\200.z.example", NULL };
+    recordset_type previous;
+    recordset_type record;
+    recordset_type ancestor;
+    int i;
+    previous = names_recordcreatetemp(names[0]);
+    for(i=1; names[i]; i++) {
+        record = names_recordcreatetemp(names[i]);
+        CU_ASSERT(names_recordcomparename(previous, record) < 0);
+        names_recorddispose(previous);
+        previous = record;
+    }
+    names_recorddispose(previous);
+    ancestor = names_recordcreatetemp("A.Example.");
+    record = names_recordcreatetemp("www.a.example");
+    CU_ASSERT(names_recordisdescendant(record, ancestor));
+    CU_ASSERT(names_recordisdescendant(ancestor, ancestor));
+    CU_ASSERT(!names_recordisdescendant(ancestor, record));
+    names_recorddispose(record);
+    record = names_recordcreatetemp("ba.example");
+    CU_ASSERT(!names_recordisdescendant(record, ancestor));
+    names_recorddispose(record);
+    names_recorddispose(ancestor);
+}
+
+static recordset_type*
+createrecords(const char* format, int count)
+{
+    int i;
+    char name[64];
+    recordset_type* records;
+    records = malloc(sizeof(recordset_type) * count);
+    assert(records);
+    for(i=0; i<count; i++) {
+        snprintf(name, sizeof(name), format, i);
+        records[i] = names_recordcreatetemp(name);
+    }
+    return records;
+}
+
+static void
+disposerecords(recordset_type* records, int count)
+{
+    int i;
+    for(i=0; i<count; i++)
+        names_recorddispose(records[i]);
+    free(records);
+}
+
+static void
+countrelease(void* arg, void* key, void* val)
+{
+    (void)key;
+    (void)val;
+    *(int*)arg += 1;
+}
+
+void
+testIndexSnapshot(void)
+{
+    const int count = 200;
+    int i, n;
+    recordset_type* records;
+    recordset_type* extra;
+    recordset_type record;
+    names_iterator iter;
+    names_index_type index;
+    names_index_type snapshot;
+    records = createrecords("n%03d.example.com", count);
+    extra = createrecords("m%03d.example.com", count);
+    names_indexcreate(&index, "namerevision");
+    for(i=0; i<count; i++)
+        names_indexinsert(index, records[i], NULL);
+    names_indexclone(&snapshot, index);
+    /* change the original, the snapshot must not see any of it */
+    for(i=0; i<count; i+=2)
+        names_indexremove(index, records[i]);
+    for(i=0; i<count; i++)
+        names_indexinsert(index, extra[i], NULL);
+    n = 0;
+    for(iter=names_indexiterator(snapshot); names_iterate(&iter, &record); names_advance(&iter, NULL)) {
+        CU_ASSERT_PTR_EQUAL(record, (n < count ? records[n] : NULL));
+        ++n;
+    }
+    CU_ASSERT_EQUAL(n, count);
+    CU_ASSERT_PTR_EQUAL(names_indexlookupkey(snapshot, "n000.example.com"), records[0]);
+    CU_ASSERT_PTR_NULL(names_indexlookupkey(snapshot, "m000.example.com"));
+    n = 0;
+    for(iter=names_indexiterator(index); names_iterate(&iter, &record); names_advance(&iter, NULL))
+        ++n;
+    CU_ASSERT_EQUAL(n, count + count / 2);
+    CU_ASSERT_PTR_NULL(names_indexlookupkey(index, "n000.example.com"));
+    CU_ASSERT_PTR_EQUAL(names_indexlookupkey(index, "n001.example.com"), records[1]);
+    CU_ASSERT_PTR_EQUAL(names_indexlookupkey(index, "m000.example.com"), extra[0]);
+    names_indexdestroy(index, NULL, NULL);
+    /* the snapshot outlives the index it was taken from */
+    n = 0;
+    for(iter=names_indexiterator(snapshot); names_iterate(&iter, &record); names_advance(&iter, NULL)) {
+        CU_ASSERT_PTR_EQUAL(record, (n < count ? records[n] : NULL));
+        ++n;
+    }
+    CU_ASSERT_EQUAL(n, count);
+    names_indexdestroy(snapshot, NULL, NULL);
+    disposerecords(records, count);
+    disposerecords(extra, count);
+}
+
+void
+testIndexRelease(void)
+{
+    const int count = 100;
+    int i, released;
+    recordset_type* records;
+    names_index_type index;
+    names_index_type clone;
+    names_iterator iter;
+    records = createrecords("n%03d.example.com", count);
+    names_indexcreate(&index, "namerevision");
+    for(i=0; i<count; i++)
+        names_indexinsert(index, records[i], NULL);
+    /* nodes shared with a clone are only released with the last tree */
+    names_indexclone(&clone, index);
+    released = 0;
+    names_indexdestroy(index, countrelease, &released);
+    CU_ASSERT_EQUAL(released, 0);
+    released = 0;
+    names_indexdestroy(clone, countrelease, &released);
+    CU_ASSERT_EQUAL(released, count);
+    /* as are nodes held by an iterator */
+    names_indexcreate(&index, "namerevision");
+    for(i=0; i<count; i++)
+        names_indexinsert(index, records[i], NULL);
+    iter = names_indexiterator(index);
+    released = 0;
+    names_indexdestroy(index, countrelease, &released);
+    CU_ASSERT_EQUAL(released, 0);
+    names_end(&iter);
+    /* a changed clone copies the path to the change, destroying the
+     * original releases exactly the nodes replaced in the clone */
+    names_indexcreate(&index, "namerevision");
+    for(i=0; i<count; i++)
+        names_indexinsert(index, records[i], NULL);
+    names_indexclone(&clone, index);
+    names_indexremove(clone, records[0]);
+    released = 0;
+    names_indexdestroy(index, countrelease, &released);
+    CU_ASSERT(released > 0);
+    CU_ASSERT(released < count);
+    CU_ASSERT_PTR_EQUAL(names_indexlookupkey(clone, "n001.example.com"), records[1]);
+    released = 0;
+    names_indexdestroy(clone, countrelease, &released);
+    CU_ASSERT_EQUAL(released, count - 1);
+    disposerecords(records, count);
+}
+
+void
+testIndexCursor(void)
+{
+    /* An AVL tree of n nodes is less than 1.45*log2(n+2) deep, so no tree
+     * comes near the 64 levels of a cursor.  Ascending inserts make for
+     * the most rotations and the deepest paths there are.
+     */
+    const int count = 65536;
+    int i, n;
+    recordset_type* records;
+    recordset_type record;
+    recordset_type previous;
+    names_iterator iter;
+    names_index_type index;
+    names_index_type clone;
+    records = createrecords("n%05d.example.com", count);
+    names_indexcreate(&index, "namerevision");
+    for(i=0; i<count; i++)
+        names_indexinsert(index, records[i], NULL);
+    names_indexclone(&clone, index);
+    for(i=0; i<count; i+=3)
+        names_indexremove(index, records[i]);
+    n = 0;
+    previous = NULL;
+    for(iter=names_indexiterator(index); names_iterate(&iter, &record); names_advance(&iter, NULL)) {
+        if(previous) {
+            CU_ASSERT(names_recordcomparename(previous, record) < 0);
+            CU_ASSERT_PTR_EQUAL(names_indexlookupnext(index, previous), record);
+        }
+        previous = record;
+        ++n;
+    }
+    CU_ASSERT_EQUAL(n, count - (count + 2) / 3);
+    CU_ASSERT_PTR_EQUAL(names_indexlookupnext(index, previous), records[1]);
+    n = 0;
+    for(iter=names_indexiterator(clone); names_iterate(&iter, &record); names_advance(&iter, NULL)) {
+        CU_ASSERT_PTR_EQUAL(record, (n < count ? records[n] : NULL));
+        ++n;
+    }
+    CU_ASSERT_EQUAL(n, count);
+    /* lookups of the next record step through the tree the same way */
+    for(i=0; i<count-1; i++)
+        CU_ASSERT_PTR_EQUAL(names_indexlookupnext(clone, records[i]), records[i+1]);
+    CU_ASSERT_PTR_EQUAL(names_indexlookupnext(clone, records[count-1]), records[0]);
+    names_indexdestroy(index, NULL, NULL);
+    names_indexdestroy(clone, NULL, NULL);
+    disposerecords(records, count);
+}
+
+static const char* iteratornames[] = { "example.com", "a.example.com", "b.example.com", "x.b.example.com", "y.b.example.com", "c.example.com", "example.org", NULL };
+
+static names_iterator
+indexrange(names_iterator (*func)(names_index_type, va_list), names_index_type index, ...)
+{
+    va_list ap;
+    names_iterator iter;
+    va_start(ap, index);
+    iter = func(index, ap);
+    va_end(ap);
+    return iter;
+}
+
+static int
+notbelowb(recordset_type record)
+{
+    return strstr(names_recordgetname(record), "b.example.com") == NULL;
+}
+
+static void
+checkiterator(names_iterator iter, recordset_type* records, int* expected, int count)
+{
+    int n = 0;
+    recordset_type record;
+    for(; names_iterate(&iter, &record); names_advance(&iter, NULL)) {
+        CU_ASSERT(n < count);
+        if(n < count)
+            CU_ASSERT_PTR_EQUAL(record, records[expected[n]]);
+        ++n;
+    }
+    CU_ASSERT_EQUAL(n, count);
+}
+
+static void
+checkjoin(names_iterator iter, recordset_type* records, int* expected, int count)
+{
+    int n = 0;
+    struct dual item;
+    for(; names_iterate(&iter, &item); names_advance(&iter, NULL)) {
+        CU_ASSERT(n < count);
+        if(n < count) {
+            CU_ASSERT_PTR_EQUAL(item.src, records[expected[n]]);
+            CU_ASSERT_PTR_EQUAL(item.dst, (expected[n] % 2 ? records[expected[n]] : NULL));
+        }
+        ++n;
+    }
+    CU_ASSERT_EQUAL(n, count);
+}
+
+void
+testIndexSelect(void)
+{
+    int i, count;
+    recordset_type* records;
+    names_index_type index;
+    names_index_type expiry;
+    names_index_type secondary;
+    int subtree[] = { 2, 3, 4 };
+    int other[] = { 6 };
+    int expiring[] = { 6, 5, 4 };
+    int joined[] = { 0, 1, 5, 6 };
+    for(count=0; iteratornames[count]; count++)
+        ;
+    records = malloc(sizeof(recordset_type) * count);
+    assert(records);
+    names_indexcreate(&index, "namerevision");
+    names_indexcreate(&expiry, "expiry");
+    names_indexcreate(&secondary, "namerevision");
+    for(i=0; i<count; i++) {
+        records[i] = names_recordcreatetemp(iteratornames[i]);
+        names_recordsetexpiry(records[i], 100 - 10 * i);
+        names_indexinsert(index, records[i], NULL);
+        names_indexinsert(expiry, records[i], NULL);
+        if(i % 2)
+            names_indexinsert(secondary, records[i], NULL);
+    }
+    /* selecting stops at the first record outside the subtree */
+    checkiterator(indexrange(names_iteratordescendants, index, "b.example.com"), records, subtree, 3);
+    checkiterator(indexrange(names_iteratordescendants, index, "example.org"), records, other, 1);
+    checkiterator(indexrange(names_iteratordescendants, index, "z.example.com"), records, NULL, 0);
+    /* and at the first record not expiring before the refresh time */
+    checkiterator(indexrange(names_iteratorexpiring, expiry, (time_t)70), records, expiring, 3);
+    checkiterator(indexrange(names_iteratorexpiring, expiry, (time_t)0), records, NULL, 0);
+    /* records the filter rejects are skipped, the iteration goes on */
+    checkjoin(names_indexjoin(index, secondary, notbelowb, names_indexlookup), records, joined, 4);
+    names_indexdestroy(index, NULL, NULL);
+    names_indexdestroy(expiry, NULL, NULL);
+    names_indexdestroy(secondary, NULL, NULL);
+    disposerecords(records, count);
+}
+
+void
+testIndexIteratorUpdate(void)
+{
+    int i, count;
+    struct dual item;
+    recordset_type record;
+    recordset_type* records;
+    recordset_type* extra;
+    names_iterator iter;
+    names_iterator subtree;
+    names_iterator join;
+    names_index_type index;
+    names_index_type secondary;
+    int all[] = { 1, 2, 3, 4, 5, 6 };
+    int below[] = { 3, 4 };
+    int joined[] = { 1, 5, 6 };
+    for(count=0; iteratornames[count]; count++)
+        ;
+    records = malloc(sizeof(recordset_type) * count);
+    assert(records);
+    names_indexcreate(&index, "namerevision");
+    names_indexcreate(&secondary, "namerevision");
+    for(i=0; i<count; i++) {
+        records[i] = names_recordcreatetemp(iteratornames[i]);
+        names_indexinsert(index, records[i], NULL);
+        if(i % 2)
+            names_indexinsert(secondary, records[i], NULL);
+    }
+    extra = createrecords("n%03d.example.com", 100);
+    iter = names_indexiterator(index);
+    subtree = indexrange(names_iteratordescendants, index, "b.example.com");
+    join = names_indexjoin(index, secondary, notbelowb, names_indexlookup);
+    CU_ASSERT(names_iterate(&iter, &record));
+    CU_ASSERT_PTR_EQUAL(record, records[0]);
+    CU_ASSERT(names_iterate(&subtree, &record));
+    CU_ASSERT_PTR_EQUAL(record, records[2]);
+    CU_ASSERT(names_iterate(&join, &item));
+    CU_ASSERT_PTR_EQUAL(item.src, records[0]);
+    names_advance(&iter, NULL);
+    names_advance(&subtree, NULL);
+    names_advance(&join, NULL);
+    /* the iterators keep walking the trees as they were when they started,
+     * whatever happens to the indices since
+     */
+    for(i=0; i<count; i++) {
+        names_indexremove(index, records[i]);
+        names_indexremove(secondary, records[i]);
+    }
+    for(i=0; i<100; i++) {
+        names_indexinsert(index, extra[i], NULL);
+        names_indexinsert(secondary, extra[i], NULL);
+    }
+    names_indexdestroy(index, NULL, NULL);
+    names_indexdestroy(secondary, NULL, NULL);
+    checkiterator(iter, records, all, 6);
+    checkiterator(subtree, records, below, 2);
+    checkjoin(join, records, joined, 3);
+    disposerecords(records, count);
+    disposerecords(extra, 100);
+}
+
+void
+testRecordWire(void)
+{
+    int i;
+    char str[512];
+    ldns_rr* rr;
+    ldns_rr* rrs[5];
+    ldns_rr* rrsig;
+    ldns_rr* expected;
+    ldns_rdf* origin;
+    ldns_rdf* rrprev = NULL;
+    ldns_rr_list* list;
+    struct signature_struct** sigs;
+    recordset_type record;
+    const char* signature = "FV0gZ8FAaqlFnJ6jFuBj4DSImeftLaRdOXhjGxUZuZe29PkkuZP9u2cb9n4SSXRSn88rEHoSff8nPKwYKCOzOxlgHx7q4FZwmGrLrmV7Sfjp41O7DI4P8F/APVwfuc4d63uQq3C2opXgFv76L0CQ/+9mIOxthjL7hVy00UDPzWM=";
+
+    origin = ldns_rdf_new_frm_str(LDNS_RDF_TYPE_DNAME, "example.com.");
+    record = names_recordcreatetemp("domain.example.com.");
+    for(i=0; i<5; i++) {
+        snprintf(str, sizeof(str), "domain.example.com. A 10.0.0.%d", i);
+        ldns_rr_new_frm_str(&rrs[i], str, 60 + i, origin, &rrprev);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(rrs[i]);
+        names_recordadddata(record, rrs[i]);
+    }
+    /* adding the same rdata again does not add another record */
+    rr = ldns_rr_clone(rrs[0]);
+    names_recordadddata(record, rr);
+    ldns_rr_free(rr);
+
+    names_recordlookupall(record, LDNS_RR_TYPE_A, NULL, &list, NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(list);
+    CU_ASSERT_EQUAL(ldns_rr_list_rr_count(list), 5);
+    for(i=0; i<5 && i<(int)ldns_rr_list_rr_count(list); i++) {
+        CU_ASSERT_EQUAL(ldns_rr_compare(ldns_rr_list_rr(list, i), rrs[i]), 0);
+        CU_ASSERT_EQUAL(ldns_rr_ttl(ldns_rr_list_rr(list, i)), ldns_rr_ttl(rrs[i]));
+    }
+    ldns_rr_list_deep_free(list);
+
+    /* the record to delete is only used to find the packed record, it stays
+     * with the caller */
+    names_recorddeldata(record, LDNS_RR_TYPE_A, rrs[2]);
+    CU_ASSERT_EQUAL(ldns_rr_get_type(rrs[2]), LDNS_RR_TYPE_A);
+    CU_ASSERT(!names_recordhasdata(record, LDNS_RR_TYPE_A, rrs[2], 0));
+    for(i=0; i<5; i++)
+        if(i != 2)
+            CU_ASSERT(names_recordhasdata(record, LDNS_RR_TYPE_A, rrs[i], 1));
+    names_recordlookupall(record, LDNS_RR_TYPE_A, NULL, &list, NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(list);
+    CU_ASSERT_EQUAL(ldns_rr_list_rr_count(list), 4);
+    if(ldns_rr_list_rr_count(list) == 4) {
+        CU_ASSERT_EQUAL(ldns_rr_compare(ldns_rr_list_rr(list, 1), rrs[1]), 0);
+        CU_ASSERT_EQUAL(ldns_rr_compare(ldns_rr_list_rr(list, 2), rrs[3]), 0);
+        CU_ASSERT_EQUAL(ldns_rr_ttl(ldns_rr_list_rr(list, 2)), ldns_rr_ttl(rrs[3]));
+        CU_ASSERT_EQUAL(ldns_rr_compare(ldns_rr_list_rr(list, 3), rrs[4]), 0);
+    }
+    ldns_rr_list_deep_free(list);
+
+    /* the record takes over both the signature and its key locator */
+    snprintf(str, sizeof(str), "domain.example.com. RRSIG A 7 3 60 20300101000000 20200101000000 55490 example.com. %s", signature);
+    ldns_rr_new_frm_str(&expected, str, 60, origin, &rrprev);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(expected);
+    names_recordaddsignature(record, LDNS_RR_TYPE_A, ldns_rr_clone(expected), strdup("locateme"), 257);
+    /* a signature over a set the record does not have is dropped */
+    names_recordaddsignature(record, LDNS_RR_TYPE_MX, ldns_rr_clone(expected), strdup("dropped"), 256);
+    names_recordlookupall(record, LDNS_RR_TYPE_RRSIG, NULL, NULL, &sigs);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(sigs);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(sigs[0]);
+    CU_ASSERT_PTR_NULL(sigs[1]);
+    CU_ASSERT_EQUAL(names_signatureexpiration(sigs[0]), 1893456000);
+    CU_ASSERT_EQUAL(names_signatureinception(sigs[0]), 1577836800);
+    CU_ASSERT_STRING_EQUAL(sigs[0]->keylocator, "locateme");
+    CU_ASSERT_EQUAL(sigs[0]->keyflags, 257);
+    rrsig = names_recordsignature(record, sigs[0]);
+    CU_ASSERT_EQUAL(ldns_rr_compare(rrsig, expected), 0);
+    ldns_rr_free(rrsig);
+    free(sigs);
+
+    /* removing the last record of a set also drops its signatures */
+    for(i=0; i<5; i++)
+        names_recorddeldata(record, LDNS_RR_TYPE_A, rrs[i]);
+    CU_ASSERT(!names_recordhasdata(record, LDNS_RR_TYPE_A, NULL, 0));
+    names_recordlookupall(record, LDNS_RR_TYPE_RRSIG, NULL, NULL, &sigs);
+    CU_ASSERT_PTR_NULL(sigs[0]);
+    free(sigs);
+
+    names_recorddispose(record);
+    ldns_rr_free(expected);
+    for(i=0; i<5; i++)
+        ldns_rr_free(rrs[i]);
+    ldns_rdf_deep_free(rrprev);
+    ldns_rdf_deep_free(origin);
+}
 
 void
 testMarshalling(void)
@@ -543,7 +996,7 @@ testMarshalling(void)
     names_recordadddata(record, rr2);
     names_recordadddata(record, rr3);
     ldns_rr_new_frm_str(&rrsig, "domain.example.com. RRSIG A 7 3 86400 20180525135557 20180525125459 55490 example.com. FV0gZ8FAaqlFnJ6jFuBj4DSImeftLaRdOXhjGxUZuZe29PkkuZP9u2cb9n4SSXRSn88rEHoSff8nPKwYKCOzOxlgHx7q4FZwmGrLrmV7Sfjp41O7DI4P8F/APVwfuc4d63uQq3C2opXgFv76L0CQ/+9mIOxthjL7hVy00UDPzWM=", 60, origin, &rrprev);
-    names_recordaddsignature(record,LDNS_RR_TYPE_A, rrsig, "locateme", 0);
+    names_recordaddsignature(record,LDNS_RR_TYPE_A, rrsig, strdup("locateme"), 0);
     names_recordsetexpiry(record, 111);
     names_recordsetvalidfrom(record, 222);
     names_recordsetvalidupto(record, 333);
@@ -1000,6 +1453,13 @@ extern void testNothing(void);
 extern void testIterator(void);
 extern void testConfig(void);
 extern void testAnnotate(void);
+extern void testCanonicalOrder(void);
+extern void testIndexSnapshot(void);
+extern void testIndexRelease(void);
+extern void testIndexCursor(void);
+extern void testIndexSelect(void);
+extern void testIndexIteratorUpdate(void);
+extern void testRecordWire(void);
 extern void testStatefile(void);
 extern void testTransferfile(void);
 extern void testBasic(void);
@@ -1023,6 +1483,13 @@ struct test_struct {
     { "signer", "testIterator",        "test of iterator" },
     { "signer", "testConfig",          "test config" },
     { "signer", "testAnnotate",        "test of denial annotation" },
+    { "signer", "testCanonicalOrder",  "test of canonical name order" },
+    { "signer", "testIndexSnapshot",   "test of index snapshots" },
+    { "signer", "testIndexRelease",    "test of index node release" },
+    { "signer", "testIndexCursor",     "test of ordered index walks" },
+    { "signer", "testIndexSelect",     "test of index range selection" },
+    { "signer", "testIndexIteratorUpdate", "test of iterators over changing indices" },
+    { "signer", "testRecordWire",      "test of packed record data" },
     { "signer", "testMarshalling",     "test marshalling" },
     { "signer", "testStatefile",       "test statefile usage" },
     { "signer", "testTransferfile",    "test transferfile usage" },
@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2018 NLNet Labs.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <ldns/ldns.h>
+#include "utilities.h"
+#include "proto.h"
+
+/* The records of a zone consist of many small allocations, like the owner
+ * name, the arrays of resource record sets and signatures and the optional
+ * validity integers.  These are taken from an arena shared by all the views
+ * of a zone.  Small allocations are rounded up to a number of size classes
+ * and carved from large chunks, freed allocations are kept on a free list per
+ * size class to be reused by the next revision of a record.  The chunks
+ * themselves are only released, all at once, when the arena is destroyed
+ * together with the base view of the zone.  Allocations larger than the
+ * largest size class are passed on to malloc.
+ *
+ * Memory freed into the arena is therefore never given back to the system
+ * while the zone exists, the arena stays as large as the zone was at its
+ * largest.  Only removing the zone releases it.
+ *
+ * The signer workers of a zone allocate and free concurrently.  To keep them
+ * from serializing on the lock of the arena each thread uses one of a number
+ * of caches of the arena, holding free lists of its own.  These are refilled
+ * from the arena, and overflow back into it, a batch of slots at a time.
+ */
+
+#define CHUNKSIZE 65536
+#define NCACHES   16
+#define BATCHSIZE 32
+
+static const size_t sizeclasses[] = { 8, 16, 24, 32, 40, 48, 56, 64, 96, 128, 192, 256 };
+#define NSIZECLASSES (sizeof(sizeclasses)/sizeof(sizeclasses[0]))
+
+struct chunk {
+    struct chunk* next;
+    size_t used;
+};
+
+struct freeslot {
+    struct freeslot* next;
+};
+
+struct cache {
+    pthread_mutex_t lock;
+    struct freeslot* freelists[NSIZECLASSES];
+    int nfree[NSIZECLASSES];
+};
+
+struct names_arena_struct {
+    pthread_mutex_t lock;
+    struct chunk* chunks;
+    struct freeslot* freelists[NSIZECLASSES];
+    struct cache caches[NCACHES];
+    int nlocators;
+    char** locators;
+};
+
+static int
+sizeclass(size_t size)
+{
+    int i;
+    for(i=0; i<(int)NSIZECLASSES; i++)
+        if(size <= sizeclasses[i])
+            return i;
+    return -1;
+}
+
+static pthread_once_t cacheonce = PTHREAD_ONCE_INIT;
+static pthread_key_t cachekey;
+static int ncachethreads = 0;
+
+static void
+cachekeycreate(void)
+{
+    CHECK(pthread_key_create(&cachekey, NULL));
+}
+
+/* Threads are assigned a cache number on first use, the same in every arena. */
+static struct cache*
+threadcache(names_arena_type arena)
+{
+    intptr_t number;
+    CHECK(pthread_once(&cacheonce, cachekeycreate));
+    number = (intptr_t)pthread_getspecific(cachekey);
+    if(number == 0) {
+        number = __sync_add_and_fetch(&ncachethreads, 1);
+        CHECK(pthread_setspecific(cachekey, (void*)number));
+    }
+    return &arena->caches[(number - 1) % NCACHES];
+}
+
+/* Move a batch of free slots from the arena to the cache, carving new ones
+ * when the arena has no more.  Must be called with the cache locked.
+ */
+static void
+cacherefill(names_arena_type arena, struct cache* cache, int cls)
+{
+    int count;
+    struct chunk* chunk;
+    struct freeslot* slot;
+    CHECK(pthread_mutex_lock(&arena->lock));
+    for(count=0; count<BATCHSIZE; count++) {
+        if(arena->freelists[cls]) {
+            slot = arena->freelists[cls];
+            arena->freelists[cls] = slot->next;
+        } else {
+            chunk = arena->chunks;
+            if(chunk == NULL || chunk->used + sizeclasses[cls] > CHUNKSIZE) {
+                CHECKALLOC(chunk = malloc(CHUNKSIZE));
+                chunk->next = arena->chunks;
+                chunk->used = sizeof(struct chunk);
+                arena->chunks = chunk;
+            }
+            slot = (struct freeslot*) &((char*)chunk)[chunk->used];
+            chunk->used += sizeclasses[cls];
+        }
+        slot->next = cache->freelists[cls];
+        cache->freelists[cls] = slot;
+    }
+    CHECK(pthread_mutex_unlock(&arena->lock));
+    cache->nfree[cls] += count;
+}
+
+/* Hand a batch of free slots of the cache back to the arena, for other
+ * threads to use.  Must be called with the cache locked.
+ */
+static void
+cachedrain(names_arena_type arena, struct cache* cache, int cls)
+{
+    int count;
+    struct freeslot* first;
+    struct freeslot* last;
+    first = last = cache->freelists[cls];
+    for(count=1; count<BATCHSIZE; count++)
+        last = last->next;
+    cache->freelists[cls] = last->next;
+    cache->nfree[cls] -= BATCHSIZE;
+    CHECK(pthread_mutex_lock(&arena->lock));
+    last->next = arena->freelists[cls];
+    arena->freelists[cls] = first;
+    CHECK(pthread_mutex_unlock(&arena->lock));
+}
+
+names_arena_type
+names_arenacreate(void)
+{
+    int i, j;
+    names_arena_type arena;
+    CHECKALLOC(arena = malloc(sizeof(struct names_arena_struct)));
+    CHECK(pthread_mutex_init(&arena->lock, NULL));
+    arena->chunks = NULL;
+    for(i=0; i<(int)NSIZECLASSES; i++)
+        arena->freelists[i] = NULL;
+    for(j=0; j<NCACHES; j++) {
+        CHECK(pthread_mutex_init(&arena->caches[j].lock, NULL));
+        for(i=0; i<(int)NSIZECLASSES; i++) {
+            arena->caches[j].freelists[i] = NULL;
+            arena->caches[j].nfree[i] = 0;
+        }
+    }
+    arena->nlocators = 0;
+    arena->locators = NULL;
+    return arena;
+}
+
+void
+names_arenadestroy(names_arena_type arena)
+{
+    int i;
+    struct chunk* chunk;
+    if(arena == NULL)
+        return;
+    while(arena->chunks) {
+        chunk = arena->chunks;
+        arena->chunks = chunk->next;
+        free(chunk);
+    }
+    for(i=0; i<arena->nlocators; i++)
+        free(arena->locators[i]);
+    free(arena->locators);
+    for(i=0; i<NCACHES; i++)
+        CHECK(pthread_mutex_destroy(&arena->caches[i].lock));
+    CHECK(pthread_mutex_destroy(&arena->lock));
+    free(arena);
+}
+
+void*
+names_arenaalloc(names_arena_type arena, size_t size)
+{
+    int cls;
+    void* ptr;
+    struct cache* cache;
+    if(size == 0)
+        return NULL;
+    if(arena == NULL || (cls = sizeclass(size)) < 0) {
+        CHECKALLOC(ptr = malloc(size));
+        return ptr;
+    }
+    cache = threadcache(arena);
+    CHECK(pthread_mutex_lock(&cache->lock));
+    if(cache->freelists[cls] == NULL)
+        cacherefill(arena, cache, cls);
+    ptr = cache->freelists[cls];
+    cache->freelists[cls] = cache->freelists[cls]->next;
+    cache->nfree[cls] -= 1;
+    CHECK(pthread_mutex_unlock(&cache->lock));
+    return ptr;
+}
+
+void
+names_arenafree(names_arena_type arena, void* ptr, size_t size)
+{
+    int cls;
+    struct cache* cache;
+    struct freeslot* slot;
+    if(ptr == NULL)
+        return;
+    if(arena == NULL || (cls = sizeclass(size)) < 0) {
+        free(ptr);
+        return;
+    }
+    slot = ptr;
+    cache = threadcache(arena);
+    CHECK(pthread_mutex_lock(&cache->lock));
+    slot->next = cache->freelists[cls];
+    cache->freelists[cls] = slot;
+    cache->nfree[cls] += 1;
+    if(cache->nfree[cls] > 2 * BATCHSIZE)
+        cachedrain(arena, cache, cls);
+    CHECK(pthread_mutex_unlock(&cache->lock));
+}
+
+void*
+names_arenarealloc(names_arena_type arena, void* ptr, size_t oldsize, size_t newsize)
+{
+    void* newptr;
+    if(arena == NULL || (sizeclass(oldsize) < 0 && sizeclass(newsize) < 0)) {
+        if(newsize == 0) {
+            free(ptr);
+            return NULL;
+        }
+        CHECKALLOC(newptr = realloc(ptr, newsize));
+        return newptr;
+    }
+    if(ptr != NULL && newsize > 0 && sizeclass(oldsize) == sizeclass(newsize))
+        return ptr;
+    newptr = names_arenaalloc(arena, newsize);
+    if(ptr != NULL && newptr != NULL)
+        memcpy(newptr, ptr, (oldsize < newsize ? oldsize : newsize));
+    names_arenafree(arena, ptr, oldsize);
+    return newptr;
+}
+
+char*
+names_arenastrdup(names_arena_type arena, const char* str)
+{
+    char* copy;
+    size_t size;
+    if(str == NULL)
+        return NULL;
+    size = strlen(str) + 1;
+    copy = names_arenaalloc(arena, size);
+    memcpy(copy, str, size);
+    return copy;
+}
+
+void
+names_arenastrfree(names_arena_type arena, char* str)
+{
+    if(str)
+        names_arenafree(arena, str, strlen(str) + 1);
+}
+
+/* Key locators are repeated in every signature made by the same key, there
+ * are only a few of them in a zone.  The arena keeps a single copy of each,
+ * the string passed in is taken over by the arena.
+ */
+const char*
+names_arenalocator(names_arena_type arena, char* locator)
+{
+    int i;
+    const char* interned;
+    if(arena == NULL || locator == NULL)
+        return locator;
+    CHECK(pthread_mutex_lock(&arena->lock));
+    for(i=0; i<arena->nlocators; i++)
+        if(!strcmp(arena->locators[i], locator))
+            break;
+    if(i == arena->nlocators) {
+        arena->nlocators += 1;
+        CHECKALLOC(arena->locators = realloc(arena->locators, sizeof(char*) * arena->nlocators));
+        arena->locators[i] = locator;
+    } else {
+        free(locator);
+    }
+    interned = arena->locators[i];
+    CHECK(pthread_mutex_unlock(&arena->lock));
+    return interned;
+}
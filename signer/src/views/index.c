@@ -32,24 +32,340 @@
 #include <time.h>
 #include <ldns/ldns.h>
 #include "uthash.h"
+#include "utilities.h"
 #include "proto.h"
 
 typedef int (*comparefunction)(const void *, const void *);
 typedef int (*acceptfunction)(recordset_type newitem, recordset_type currentitem, int* cmp);
 
+/* Indices are persistent AVL trees.  A node may be shared by the trees of
+ * several indices, which is tracked by a reference count.  Nodes referenced
+ * only once belong to a single tree and are changed in place, shared nodes
+ * are copied, together with the path leading to them, before a change.  This
+ * way views created from the same base share the structure of their indices
+ * and only pay for the records they change.  Because views live in different
+ * threads the reference counts are changed atomically.
+ */
+#define MAXDEPTH 64
+
+struct names_index_node {
+    struct names_index_node* left;
+    struct names_index_node* right;
+    recordset_type record;
+    int height;
+    int refs;
+};
+typedef struct names_index_node* names_index_node;
+
 struct names_index_struct {
     const char* keyname;
-    ldns_rbtree_t* tree;
+    names_index_node root;
     acceptfunction acceptfunc;
+    comparefunction comparfunc;
 };
 
-struct names_iterator_struct {
-    int (*iterate)(names_iterator*iter, void**);
-    int (*advance)(names_iterator*iter, void**);
-    int (*end)(names_iterator*iter);
-    ldns_rbnode_t* current;
+struct cursor {
+    int depth;
+    names_index_node path[MAXDEPTH];
 };
 
+struct destroyinfo {
+    void (*free)(void* arg, void* key, void* val);
+    void* arg;
+};
+
+static names_index_node
+noderetain(names_index_node node)
+{
+    if(node)
+        __sync_add_and_fetch(&node->refs, 1);
+    return node;
+}
+
+static void
+noderelease(names_index_node node, struct destroyinfo* user)
+{
+    if(node && __sync_sub_and_fetch(&node->refs, 1) == 0) {
+        noderelease(node->left, user);
+        noderelease(node->right, user);
+        if(user && user->free) {
+            user->free(user->arg, (void*)node->record, (void*)node->record);
+        }
+        free(node);
+    }
+}
+
+/* Return the node to be changed in place of the given one, a copy when the
+ * node is also part of another tree.
+ */
+static names_index_node
+nodeunshare(names_index_node node)
+{
+    names_index_node copy;
+    if(node->refs == 1)
+        return node;
+    CHECKALLOC(copy = malloc(sizeof(struct names_index_node)));
+    copy->left = noderetain(node->left);
+    copy->right = noderetain(node->right);
+    copy->record = node->record;
+    copy->height = node->height;
+    copy->refs = 1;
+    noderelease(node, NULL);
+    return copy;
+}
+
+static inline int
+nodeheight(names_index_node node)
+{
+    return (node ? node->height : 0);
+}
+
+static void
+nodeupdate(names_index_node node)
+{
+    int left = nodeheight(node->left);
+    int right = nodeheight(node->right);
+    node->height = 1 + (left > right ? left : right);
+}
+
+static names_index_node
+rotateleft(names_index_node node)
+{
+    names_index_node pivot;
+    pivot = node->right = nodeunshare(node->right);
+    node->right = pivot->left;
+    pivot->left = node;
+    nodeupdate(node);
+    nodeupdate(pivot);
+    return pivot;
+}
+
+static names_index_node
+rotateright(names_index_node node)
+{
+    names_index_node pivot;
+    pivot = node->left = nodeunshare(node->left);
+    node->left = pivot->right;
+    pivot->right = node;
+    nodeupdate(node);
+    nodeupdate(pivot);
+    return pivot;
+}
+
+static names_index_node
+nodebalance(names_index_node node)
+{
+    int balance;
+    nodeupdate(node);
+    balance = nodeheight(node->left) - nodeheight(node->right);
+    if(balance > 1) {
+        if(nodeheight(node->left->left) < nodeheight(node->left->right)) {
+            node->left = nodeunshare(node->left);
+            node->left = rotateleft(node->left);
+        }
+        node = rotateright(node);
+    } else if(balance < -1) {
+        if(nodeheight(node->right->right) < nodeheight(node->right->left)) {
+            node->right = nodeunshare(node->right);
+            node->right = rotateright(node->right);
+        }
+        node = rotateleft(node);
+    }
+    return node;
+}
+
+static names_index_node
+nodesearch(names_index_type index, const void* key)
+{
+    int cmp;
+    names_index_node node = index->root;
+    while(node) {
+        cmp = index->comparfunc(key, node->record);
+        if(cmp == 0)
+            break;
+        node = (cmp < 0 ? node->left : node->right);
+    }
+    return node;
+}
+
+/* insert a record which is known not to be present yet */
+static names_index_node
+nodeinsert(names_index_type index, names_index_node node, recordset_type record)
+{
+    if(node == NULL) {
+        CHECKALLOC(node = malloc(sizeof(struct names_index_node)));
+        node->left = node->right = NULL;
+        node->record = record;
+        node->height = 1;
+        node->refs = 1;
+        return node;
+    }
+    node = nodeunshare(node);
+    if(index->comparfunc(record, node->record) < 0) {
+        node->left = nodeinsert(index, node->left, record);
+    } else {
+        node->right = nodeinsert(index, node->right, record);
+    }
+    return nodebalance(node);
+}
+
+/* replace the record of a node with one that is known to compare equal */
+static names_index_node
+nodereplace(names_index_type index, names_index_node node, recordset_type record)
+{
+    int cmp;
+    node = nodeunshare(node);
+    cmp = index->comparfunc(record, node->record);
+    if(cmp < 0) {
+        node->left = nodereplace(index, node->left, record);
+    } else if(cmp > 0) {
+        node->right = nodereplace(index, node->right, record);
+    } else {
+        node->record = record;
+    }
+    return node;
+}
+
+static names_index_node
+noderemovefirst(names_index_node node, recordset_type* record)
+{
+    names_index_node right;
+    node = nodeunshare(node);
+    if(node->left == NULL) {
+        *record = node->record;
+        right = node->right;
+        free(node);
+        return right;
+    }
+    node->left = noderemovefirst(node->left, record);
+    return nodebalance(node);
+}
+
+/* remove the node of a key which is known to be present */
+static names_index_node
+noderemove(names_index_type index, names_index_node node, const void* key)
+{
+    int cmp;
+    names_index_node child;
+    node = nodeunshare(node);
+    cmp = index->comparfunc(key, node->record);
+    if(cmp < 0) {
+        node->left = noderemove(index, node->left, key);
+    } else if(cmp > 0) {
+        node->right = noderemove(index, node->right, key);
+    } else if(node->left == NULL || node->right == NULL) {
+        child = (node->left ? node->left : node->right);
+        free(node);
+        return child;
+    } else {
+        node->right = noderemovefirst(node->right, &node->record);
+    }
+    return nodebalance(node);
+}
+
+static int
+indexdelete(names_index_type index, const void* key)
+{
+    if(nodesearch(index, key) == NULL)
+        return 0;
+    index->root = noderemove(index, index->root, key);
+    return 1;
+}
+
+static names_index_node
+cursorcurrent(struct cursor* cursor)
+{
+    return (cursor->depth > 0 ? cursor->path[cursor->depth - 1] : NULL);
+}
+
+static void
+cursordescend(struct cursor* cursor, names_index_node node, int leftmost)
+{
+    while(node) {
+        assert(cursor->depth < MAXDEPTH);
+        cursor->path[cursor->depth++] = node;
+        node = (leftmost ? node->left : node->right);
+    }
+}
+
+static void
+cursorfirst(struct cursor* cursor, names_index_node root)
+{
+    cursor->depth = 0;
+    cursordescend(cursor, root, 1);
+}
+
+static void
+cursornext(struct cursor* cursor)
+{
+    names_index_node child;
+    names_index_node node = cursorcurrent(cursor);
+    if(node == NULL)
+        return;
+    if(node->right) {
+        cursordescend(cursor, node->right, 1);
+    } else {
+        do {
+            child = cursor->path[--cursor->depth];
+        } while(cursor->depth > 0 && cursor->path[cursor->depth - 1]->right == child);
+    }
+}
+
+static void
+cursorprevious(struct cursor* cursor)
+{
+    names_index_node child;
+    names_index_node node = cursorcurrent(cursor);
+    if(node == NULL)
+        return;
+    if(node->left) {
+        cursordescend(cursor, node->left, 0);
+    } else {
+        do {
+            child = cursor->path[--cursor->depth];
+        } while(cursor->depth > 0 && cursor->path[cursor->depth - 1]->left == child);
+    }
+}
+
+/* Position the cursor on the last node not after the key and return whether
+ * it is an exact match.  The cursor is empty when all nodes are after the key.
+ */
+static int
+cursorseek(struct cursor* cursor, names_index_type index, const void* key)
+{
+    int cmp, depth = 0;
+    names_index_node node = index->root;
+    cursor->depth = 0;
+    while(node) {
+        assert(cursor->depth < MAXDEPTH);
+        cursor->path[cursor->depth++] = node;
+        cmp = index->comparfunc(key, node->record);
+        if(cmp == 0)
+            return 1;
+        if(cmp < 0) {
+            node = node->left;
+        } else {
+            depth = cursor->depth;
+            node = node->right;
+        }
+    }
+    cursor->depth = depth;
+    return 0;
+}
+
+/* position the cursor on the first node not before the key */
+static void
+cursorseekfrom(struct cursor* cursor, names_index_type index, const void* key)
+{
+    if(!cursorseek(cursor, index, key)) {
+        if(cursor->depth == 0) {
+            cursorfirst(cursor, index->root);
+        } else {
+            cursornext(cursor);
+        }
+    }
+}
+
 int
 names_indexcreate(names_index_type* index, const char* keyname)
 {
@@ -61,23 +377,20 @@ names_indexcreate(names_index_type* index, const char* keyname)
     assert(comparfunc);
     (*index)->keyname = strdup(keyname);
     (*index)->acceptfunc = acceptfunc;
-    (*index)->tree = ldns_rbtree_create(comparfunc);
+    (*index)->comparfunc = comparfunc;
+    (*index)->root = NULL;
     return 0;
 }
 
-struct destroyinfo {
-    void (*free)(void* arg, void* key, void* val);
-    void* arg;
-};
-
-static void
-disposenode(ldns_rbnode_t* node, void* cargo)
+int
+names_indexclone(names_index_type* index, names_index_type source)
 {
-    struct destroyinfo* user = cargo;
-    if(user && user->free) {
-        user->free(user->arg, (void*)node->key, (void*)node->data);
-    }
-    free(node);
+    *index = malloc(sizeof(struct names_index_struct));
+    (*index)->keyname = strdup(source->keyname);
+    (*index)->acceptfunc = source->acceptfunc;
+    (*index)->comparfunc = source->comparfunc;
+    (*index)->root = noderetain(source->root);
+    return 0;
 }
 
 void
@@ -86,34 +399,44 @@ names_indexdestroy(names_index_type index, void (*userfunc)(void* arg, void* key
     struct destroyinfo cargo;
     cargo.free = userfunc;
     cargo.arg = userarg;
-    ldns_traverse_postorder(index->tree, disposenode, (userfunc?&cargo:NULL));
-    ldns_rbtree_free(index->tree);
+    noderelease(index->root, (userfunc?&cargo:NULL));
     free((void*)index->keyname);
     free(index);
 }
 
+const char*
+names_indexkeyname(names_index_type index)
+{
+    return index->keyname;
+}
+
+int
+names_indexaccept(names_index_type index, recordset_type record)
+{
+    return index->acceptfunc(record, NULL, NULL);
+}
+
+size_t
+names_indexnodesize(void)
+{
+    return sizeof(struct names_index_node);
+}
+
 int
 names_indexinsert(names_index_type index, recordset_type record, recordset_type* existing) {
     int cmp;
-    ldns_rbnode_t* node;
+    names_index_node node;
     if (existing && *existing) {
-        node = ldns_rbtree_delete(index->tree, *existing);
-        free(node);
+        indexdelete(index, *existing);
     }
     if (record) {
         if (index->acceptfunc(record, NULL, NULL)) {
-            node = malloc(sizeof (ldns_rbnode_t));
-            assert(record);
-            node->key = record;
-            node->data = record;
-            if (!ldns_rbtree_insert(index->tree, node)) {
-                free(node);
-                node = ldns_rbtree_search(index->tree, record);
-                assert(node);
+            node = nodesearch(index, record);
+            if (node != NULL) {
                 if (existing && *existing == NULL) {
-                    *existing = (recordset_type) node->data;
+                    *existing = node->record;
                 }
-                switch (index->acceptfunc(record, (recordset_type) node->data, &cmp)) {
+                switch (index->acceptfunc(record, node->record, &cmp)) {
                     case 0:
                         logger_message(&names_logcommitlog, logger_noctx, logger_DIAG, "      record ignored from %s no match after found\n", index->keyname);
                         if(existing) {
@@ -122,29 +445,27 @@ names_indexinsert(names_index_type index, recordset_type record, recordset_type*
                         return 0;
                     case 1:
                         logger_message(&names_logcommitlog, logger_noctx, logger_DIAG, "      record rewritten in %s matched after found\n", index->keyname);
-                        node->key = record;
-                        node->data = record;
+                        index->root = nodereplace(index, index->root, record);
                         return 1;
                     case 2:
                         logger_message(&names_logcommitlog, logger_noctx, logger_DIAG, "      record deleted in %s dropped after found\n", index->keyname);
-                        node = ldns_rbtree_delete(index->tree, node->key);
-                        free(node);
+                        index->root = noderemove(index, index->root, node->record);
                         return 0;
                     default:
                         abort(); // FIXME
                 }
             } else {
                 logger_message(&names_logcommitlog, logger_noctx, logger_DIAG, "      record inserted in %s after not found\n", index->keyname);
+                index->root = nodeinsert(index, index->root, record);
                 return 1;
             }
         } else {
-            node = ldns_rbtree_search(index->tree, record);
+            node = nodesearch(index, record);
             if (node != NULL) {
-                if (index->acceptfunc(record, (recordset_type) node->data, &cmp) == 0) {
-                    if (cmp == 0 && node->key == record) {
+                if (index->acceptfunc(record, node->record, &cmp) == 0) {
+                    if (cmp == 0 && node->record == record) {
                         logger_message(&names_logcommitlog, logger_noctx, logger_DIAG, "      record not accepted and deleted from in %s\n", index->keyname);
-                        node = ldns_rbtree_delete(index->tree, node->key);
-                        free(node);
+                        index->root = noderemove(index, index->root, record);
                     } else {
                         logger_message(&names_logcommitlog, logger_noctx, logger_DIAG, "      record not accepted and withheld from deletion from in %s\n", index->keyname);
                     }
@@ -179,50 +500,110 @@ names_indexlookupkey(names_index_type index, const char* keyvalue)
 recordset_type
 names_indexlookup(names_index_type index, recordset_type find)
 {
-    ldns_rbnode_t* node;
-    node = ldns_rbtree_search(index->tree, find);
-    return (node != NULL && node != LDNS_RBTREE_NULL) ? (recordset_type) node->data : NULL;
+    names_index_node node;
+    node = nodesearch(index, find);
+    return (node != NULL ? node->record : NULL);
 }
 
 recordset_type
 names_indexlookupnext(names_index_type index, recordset_type find)
 {
-    ldns_rbnode_t* node;
-    node = ldns_rbtree_search(index->tree, find);
-    if(node != NULL && node != LDNS_RBTREE_NULL) {
-        node = ldns_rbtree_next(node);
-        if(node == NULL || node == LDNS_RBTREE_NULL) {
-            node = ldns_rbtree_first(index->tree);
-        }
+    struct cursor cursor;
+    names_index_node node;
+    if(!cursorseek(&cursor, index, find))
+        return NULL;
+    cursornext(&cursor);
+    node = cursorcurrent(&cursor);
+    if(node == NULL) {
+        cursorfirst(&cursor, index->root);
+        node = cursorcurrent(&cursor);
     }
-    return (node != NULL && node != LDNS_RBTREE_NULL) ? (recordset_type) node->data : NULL;
+    return (node != NULL ? node->record : NULL);
 }
 
 int
 names_indexremove(names_index_type index, recordset_type d)
 {
-    ldns_rbnode_t* node;
-    node = ldns_rbtree_delete(index->tree, d);
-    if(node) {
-        free(node);
-        return 1;
-    } else
-        return 0;
+    return indexdelete(index, d);
+}
+
+/* Iterators walk the nodes of the tree as it was when the iteration started,
+ * one node at a time.  Iterators over a range of an index have a select
+ * function that decides on each record whether to return it (1), skip it (0)
+ * or stop the iteration (-1).  Stopping early or ending the iteration
+ * therefore saves the work for the remaining records.
+ */
+struct names_iterator_struct {
+    int (*iterate)(names_iterator*iter, void**);
+    int (*advance)(names_iterator*iter, void**);
+    int (*end)(names_iterator*iter);
+    names_index_node root;
+    struct cursor cursor;
+    int (*select)(struct names_iterator_struct* iter, recordset_type record);
+    recordset_type find;
+    int serial;
+    time_t refreshtime;
+    char* name;
+    recordset_type current;
+    struct names_index_struct lookup;
+    int (*filter)(recordset_type record);
+    recordset_type (*match)(names_index_type index, recordset_type record);
+    struct dual dual;
+};
+
+static void
+iteratordestroy(struct names_iterator_struct* iter)
+{
+    noderelease(iter->root, NULL);
+    noderelease(iter->lookup.root, NULL);
+    if(iter->find)
+        names_recorddispose(iter->find);
+    free(iter->name);
+    free(iter);
+}
+
+static void
+iteratorsettle(struct names_iterator_struct* iter)
+{
+    names_index_node node;
+    int selected;
+    while((node = cursorcurrent(&iter->cursor)) != NULL) {
+        selected = (iter->select ? iter->select(iter, node->record) : 1);
+        if(selected > 0) {
+            return;
+        } else if(selected < 0) {
+            iter->cursor.depth = 0;
+            return;
+        }
+        cursornext(&iter->cursor);
+    }
+}
+
+/* Join iterators return a struct dual by value, others the record. */
+static void
+iteratoritem(struct names_iterator_struct* iter, names_index_node node, void** item)
+{
+    if(item) {
+        if(iter->match)
+            memcpy(item, &iter->dual, sizeof(struct dual));
+        else
+            *item = (node ? (void*) node->record : NULL);
+    }
 }
 
 static int
 iterateimpl(names_iterator* i, void** item)
 {
     struct names_iterator_struct** iter = i;
-    if (item)
-        *item = NULL;
+    names_index_node node;
     if (*iter) {
-        if ((*iter)->current != NULL && (*iter)->current != LDNS_RBTREE_NULL) {
-            if (item)
-                *item = (void*) (*iter)->current->data;
+        node = cursorcurrent(&(*iter)->cursor);
+        if (node != NULL) {
+            iteratoritem(*iter, node, item);
             return 1;
         } else {
-            free(*iter);
+            iteratoritem(*iter, NULL, (*iter)->match ? NULL : item);
+            iteratordestroy(*iter);
             *iter = NULL;
         }
     }
@@ -233,18 +614,19 @@ static int
 advanceimpl(names_iterator*i, void** item)
 {
     struct names_iterator_struct** iter = i;
-    if (item)
-        *item = NULL;
+    names_index_node node;
     if (*iter) {
-        if((*iter)->current != NULL && (*iter)->current != LDNS_RBTREE_NULL) {
-            (*iter)->current = ldns_rbtree_next((*iter)->current);
-            if((*iter)->current != NULL && (*iter)->current != LDNS_RBTREE_NULL) {
-                if(item)
-                    *item = (void*)  (*iter)->current->data;
+        if(cursorcurrent(&(*iter)->cursor) != NULL) {
+            cursornext(&(*iter)->cursor);
+            iteratorsettle(*iter);
+            node = cursorcurrent(&(*iter)->cursor);
+            if(node != NULL) {
+                iteratoritem(*iter, node, item);
                 return 1;
             }
         }
-        free(*iter);
+        iteratoritem(*iter, NULL, (*iter)->match ? NULL : item);
+        iteratordestroy(*iter);
         *iter = NULL;
     }
     return 0;
@@ -253,48 +635,106 @@ advanceimpl(names_iterator*i, void** item)
 static int
 endimpl(names_iterator*iter)
 {
-    if(*iter) free(*iter);
-        *iter = NULL;
+    if(*iter) {
+        iteratordestroy(*iter);
+    }
+    *iter = NULL;
     return 0;
 }
 
-names_iterator
-names_indexiterator(names_index_type index)
+/* The iterator keeps a reference to the tree as it was when the iteration
+ * started, so the index may be changed while iterating over it.
+ */
+static struct names_iterator_struct*
+iteratorcreate(names_index_type index, int (*select)(struct names_iterator_struct*, recordset_type))
 {
-    names_iterator iter;
-    iter = malloc(sizeof(struct names_iterator_struct));
+    struct names_iterator_struct* iter;
+    CHECKALLOC(iter = malloc(sizeof(struct names_iterator_struct)));
     iter->iterate = iterateimpl;
     iter->advance = advanceimpl;
     iter->end = endimpl;
-    iter->current = (index->tree != NULL ? ldns_rbtree_first(index->tree) : NULL);
+    iter->root = noderetain(index->root);
+    iter->cursor.depth = 0;
+    iter->select = select;
+    iter->find = NULL;
+    iter->name = NULL;
+    iter->current = NULL;
+    iter->lookup.root = NULL;
+    iter->filter = NULL;
+    iter->match = NULL;
+    return iter;
+}
+
+names_iterator
+names_indexiterator(names_index_type index)
+{
+    names_iterator iter;
+    iter = iteratorcreate(index, NULL);
+    cursorfirst(&iter->cursor, iter->root);
     return iter;
 }
 
+static int
+selectjoin(struct names_iterator_struct* iter, recordset_type record)
+{
+    if(iter->filter && !iter->filter(record))
+        return 0;
+    iter->dual.src = record;
+    iter->dual.dst = iter->match(&iter->lookup, record);
+    return 1;
+}
+
+/* Iterate over the records of the primary index accepted by the filter,
+ * returning pairs of the record and the record the match function finds
+ * for it in the secondary index.  The lookups are done in the secondary
+ * index as it was when the iteration started.
+ */
+names_iterator
+names_indexjoin(names_index_type primary, names_index_type secondary, int (*filter)(recordset_type), recordset_type (*match)(names_index_type, recordset_type))
+{
+    names_iterator iter;
+    iter = iteratorcreate(primary, selectjoin);
+    iter->lookup = *secondary;
+    iter->lookup.root = noderetain(secondary->root);
+    iter->filter = filter;
+    iter->match = match;
+    cursorfirst(&iter->cursor, iter->root);
+    iteratorsettle(iter);
+    return iter;
+}
+
+static int
+selectdescendants(struct names_iterator_struct* iter, recordset_type record)
+{
+    return (names_recordisdescendant(record, iter->find) ? 1 : -1);
+}
+
 names_iterator
 names_iteratordescendants(names_index_type index, va_list ap)
 {
     const char* find;
-    const char* found;
-    int findlen;
-    recordset_type record;
-    ldns_rbnode_t* node;
+    struct cursor previous;
+    names_index_node node;
     names_iterator iter;
-    iter = names_iterator_createrefs(NULL);
+    iter = iteratorcreate(index, selectdescendants);
     find = va_arg(ap, char*);
-    findlen = strlen(find);
-    record = names_recordcreatetemp(find);
-    (void) ldns_rbtree_find_less_equal(index->tree, record, &node);
-    names_recorddispose(record);
-    while (node && node != LDNS_RBTREE_NULL) {
-        record = (recordset_type) node->key;
-        found = names_recordgetname(record);
-        if (!strncmp(find, found, findlen) && (found[findlen - 1] == '\0' || found[findlen - 1] == '.')) {
-            names_iterator_addptr(iter, record);
-        } else {
-            break;
+    iter->find = names_recordcreatetemp(find);
+    (void) cursorseek(&iter->cursor, index, iter->find);
+    node = cursorcurrent(&iter->cursor);
+    if (node == NULL) {
+        cursorfirst(&iter->cursor, iter->root);
+    } else if (names_recordisdescendant(node->record, iter->find)) {
+        /* other revisions of the name itself may precede the node found */
+        previous = iter->cursor;
+        cursorprevious(&previous);
+        while ((node = cursorcurrent(&previous)) != NULL && names_recordisdescendant(node->record, iter->find)) {
+            iter->cursor = previous;
+            cursorprevious(&previous);
         }
-        node = ldns_rbtree_previous(node);
+    } else {
+        cursornext(&iter->cursor);
     }
+    iteratorsettle(iter);
     return iter;
 }
 
@@ -318,177 +758,196 @@ names_parent(const char* child)
     return name;
 }
 
-/* This function can be optimized a lot. */
-names_iterator
-names_iteratorancestors(names_index_type index, va_list ap)
+/* Move up to the closest ancestor of the current name present in the index,
+ * the iterator is exhausted when no more ancestors are present.
+ */
+static void
+nextancestor(struct names_iterator_struct* iter)
 {
+    char* parent;
     recordset_type record;
-    ldns_rbnode_t* node;
-    names_iterator iter;
-    char* name;
-    char* parent = NULL;
-
-    name = va_arg(ap, char*);
-    iter = names_iterator_createrefs(NULL);
-    do {
-        if(parent) {
-            name = parent;
-            parent = names_parent(name);
-            free(name);
-        } else
-            parent = names_parent(name);
+    iter->current = NULL;
+    while(iter->current == NULL && iter->name != NULL) {
+        parent = names_parent(iter->name);
+        free(iter->name);
+        iter->name = parent;
         if (parent) {
             record = names_recordcreatetemp(parent);
-            node = ldns_rbtree_search(index->tree, record);
+            iter->current = names_indexlookup(&iter->lookup, record);
             names_recorddispose(record);
-            if (node && node != LDNS_RBTREE_NULL) {
-                names_iterator_addptr(iter, node->data);
+        }
+    }
+}
+
+static int
+iterateancestors(names_iterator* i, void** item)
+{
+    struct names_iterator_struct** iter = i;
+    if (item)
+        *item = NULL;
+    if (*iter) {
+        if ((*iter)->current != NULL) {
+            if (item)
+                *item = (void*) (*iter)->current;
+            return 1;
+        } else {
+            iteratordestroy(*iter);
+            *iter = NULL;
+        }
+    }
+    return 0;
+}
+
+static int
+advanceancestors(names_iterator* i, void** item)
+{
+    struct names_iterator_struct** iter = i;
+    if (item)
+        *item = NULL;
+    if (*iter) {
+        if ((*iter)->current != NULL) {
+            nextancestor(*iter);
+            if ((*iter)->current != NULL) {
+                if (item)
+                    *item = (void*) (*iter)->current;
+                return 1;
             }
         }
-    } while(parent);
-    if(parent)
-        free(parent);
+        iteratordestroy(*iter);
+        *iter = NULL;
+    }
+    return 0;
+}
+
+names_iterator
+names_iteratorancestors(names_index_type index, va_list ap)
+{
+    names_iterator iter;
+    char* name;
+    name = va_arg(ap, char*);
+    iter = iteratorcreate(index, NULL);
+    iter->iterate = iterateancestors;
+    iter->advance = advanceancestors;
+    iter->lookup = *index;
+    iter->lookup.root = noderetain(iter->root);
+    CHECKALLOC(iter->name = strdup(name));
+    nextancestor(iter);
+    return iter;
+}
+
+static int
+selectexpiring(struct names_iterator_struct* iter, recordset_type record)
+{
+    if(names_recordhasexpiry(record) && names_recordgetexpiry(record) >= iter->refreshtime)
+        return -1;
+    return 1;
+}
+
+names_iterator
+names_iteratorexpiring(names_index_type index, va_list ap)
+{
+    names_iterator iter;
+    iter = iteratorcreate(index, selectexpiring);
+    iter->refreshtime = va_arg(ap,time_t);
+    cursorfirst(&iter->cursor, iter->root);
+    iteratorsettle(iter);
+    return iter;
+}
+
+/* Position a new iterator on the first record of the index not before the
+ * given, temporary, record.  The iterator takes over the record.
+ */
+static names_iterator
+iteratorrange(names_index_type index, recordset_type find, int (*select)(struct names_iterator_struct*, recordset_type))
+{
+    names_iterator iter;
+    iter = iteratorcreate(index, select);
+    iter->find = find;
+    cursorseekfrom(&iter->cursor, index, find);
     return iter;
 }
 
+static int
+selectchangedeletes(struct names_iterator_struct* iter, recordset_type record)
+{
+    int since;
+    if(names_recordvalidfrom(record,&since)) {
+        return (since <= iter->serial ? 1 : 0);
+    } else {
+        abort(); // FIXME cannot happen
+    }
+}
+
 names_iterator
 names_iteratorchangedeletes(names_index_type index, va_list ap)
 {
     recordset_type find;
-    recordset_type found;
-    int serial, since;
-    ldns_rbnode_t* node;
     names_iterator iter;
+    int serial;
 
     serial = va_arg(ap, int);
     find = names_recordcreatetemp(NULL);
     names_recordsetvalidupto(find, serial);
-    iter = names_iterator_createrefs(NULL);
-
-    if(!ldns_rbtree_find_less_equal(index->tree, find, &node)) {
-        if(node == NULL || node == LDNS_RBTREE_NULL) {
-            node = ldns_rbtree_first(index->tree);
-        } else {
-            node = ldns_rbtree_next(node);
-        }
-    }
-    while (node && node != LDNS_RBTREE_NULL) {
-        found = (recordset_type) node->key;
-        if(names_recordvalidfrom(found,&since)) {
-            if(since <= serial) {
-                names_iterator_addptr(iter, found);
-            }
-        } else {
-            abort(); // FIXME cannot happen
-        }
-        node = ldns_rbtree_next(node);
-    }
-
-    names_recorddispose(find);
+    iter = iteratorrange(index, find, selectchangedeletes);
+    iter->serial = serial;
+    iteratorsettle(iter);
     return iter;
 }
 
+static int
+selectchangeinserts(struct names_iterator_struct* iter, recordset_type record)
+{
+    return (!names_recordvalidupto(record,NULL) ? 1 : 0);
+}
+
 names_iterator
 names_iteratorchangeinserts(names_index_type index, va_list ap)
 {
     recordset_type find;
-    recordset_type found;
-    int serial, since;
-    ldns_rbnode_t* node;
     names_iterator iter;
+    int serial;
 
     serial = va_arg(ap, int);
     find = names_recordcreatetemp(NULL);
     names_recordsetvalidfrom(find, serial);
-    iter = names_iterator_createrefs(NULL);
-
-    if(!ldns_rbtree_find_less_equal(index->tree, find, &node)) {
-        if(node == NULL || node == LDNS_RBTREE_NULL) {
-            node = ldns_rbtree_first(index->tree);
-        } else {
-            node = ldns_rbtree_next(node);
-        }
-    }
-    while (node && node != LDNS_RBTREE_NULL) {
-        found = (recordset_type) node->key;
-        if(!names_recordvalidupto(found,NULL)) {
-            names_iterator_addptr(iter, found);
-        }
-        node = ldns_rbtree_next(node);
-    }
-
-    names_recorddispose(find);
+    iter = iteratorrange(index, find, selectchangeinserts);
+    iteratorsettle(iter);
     return iter;
 }
 
+static int
+selectchanges(struct names_iterator_struct* iter, recordset_type record)
+{
+    return (names_recordcomparename(record, iter->find) ? -1 : 1);
+}
+
 names_iterator
 names_iteratorchanges(names_index_type index, va_list ap)
 {
     recordset_type find;
-    recordset_type found;
+    names_iterator iter;
     const char* name;
     int serial;
-    ldns_rbnode_t* node;
-    names_iterator iter;
 
     name = va_arg(ap, const char*);
     serial = va_arg(ap, int);
     find = names_recordcreatetemp(name);
     names_recordsetvalidfrom(find, serial);
-    iter = names_iterator_createrefs(NULL);
-            char*t= NULL;
-
-    if(!ldns_rbtree_find_less_equal(index->tree, find, &node)) {
-        if(node == NULL || node == LDNS_RBTREE_NULL) {
-            node = ldns_rbtree_first(index->tree);
-        } else {
-            node = ldns_rbtree_next(node);
-        }
-    }
-    while (node && node != LDNS_RBTREE_NULL) {
-        found = (recordset_type) node->key;
-        if(strcmp(names_recordgetname(found), name)) {
-            break;
-        }
-        names_iterator_addptr(iter, found);
-        node = ldns_rbtree_next(node);
-    }
-
-    names_recorddispose(find);
+    iter = iteratorrange(index, find, selectchanges);
+    iteratorsettle(iter);
     return iter;
 }
 
-
 names_iterator
 names_iteratoroutdated(names_index_type index, va_list ap)
 {
     recordset_type find;
-    recordset_type found;
     int serial;
-    ldns_rbnode_t* node;
-    names_iterator iter;
 
     serial = va_arg(ap, int);
     find = names_recordcreatetemp(NULL);
     names_recordsetvalidupto(find, serial);
-    iter = names_iterator_createrefs(NULL);
-            char*t= NULL;
-
-    if(!ldns_rbtree_find_less_equal(index->tree, find, &node)) {
-        if(node == NULL || node == LDNS_RBTREE_NULL) {
-            node = ldns_rbtree_first(index->tree);
-        } else {
-            node = ldns_rbtree_next(node);
-        }
-    }
-    while (node && node != LDNS_RBTREE_NULL) {
-        found = (recordset_type) node->key;
-        names_iterator_addptr(iter, found);
-        node = ldns_rbtree_next(node);
-    }
-
-    names_recorddispose(find);
-    return iter;
+    return iteratorrange(index, find, NULL);
 }
 
 void
@@ -327,6 +327,75 @@ marshallldnsrr(marshall_handle h, void* member)
     return size;
 }
 
+/* A block of packed resource records, prefixed by its length as uint32_t. */
+int
+marshallwire(marshall_handle h, void* member)
+{
+    unsigned char** wire = (unsigned char**)member;
+    unsigned char* copy;
+    int size;
+    int len;
+    uint32_t length;
+    switch(h->mode) {
+        case COPY:
+            if(*wire) {
+                memcpy(&length, *wire, sizeof(uint32_t));
+                copy = malloc(sizeof(uint32_t) + length);
+                memcpy(copy, *wire, sizeof(uint32_t) + length);
+                *wire = copy;
+            }
+            break;
+        case FREE:
+            free(*wire);
+            break;
+        case READ:
+            size = marshallinteger(h, &len);
+            if(len >= 0) {
+                length = len;
+                *wire = malloc(sizeof(uint32_t) + length);
+                memcpy(*wire, &length, sizeof(uint32_t));
+                read(h->fd, &(*wire)[sizeof(uint32_t)], length);
+                size += len;
+            } else {
+                *wire = NULL;
+            }
+            break;
+        case WRITE:
+            if(*wire) {
+                memcpy(&length, *wire, sizeof(uint32_t));
+                len = length;
+                size = marshallinteger(h, &len);
+                write(h->fd, &(*wire)[sizeof(uint32_t)], length);
+                size += len;
+            } else {
+                len = -1;
+                size = marshallinteger(h, &len);
+            }
+            break;
+        case COUNT:
+            if(*wire) {
+                memcpy(&length, *wire, sizeof(uint32_t));
+                len = length;
+            } else {
+                len = -1;
+            }
+            size = marshallinteger(h, &len);
+            size += (len > 0 ? len : 0);
+            break;
+        case PRINT:
+            if(*wire) {
+                memcpy(&length, *wire, sizeof(uint32_t));
+                size = fprintf(h->fp, "<%lu bytes>", (unsigned long)length);
+            } else {
+                size = fprintf(h->fp, "NULL");
+            }
+            break;
+        default:
+            size = -1;
+    }
+    return size;
+}
+
 int
 marshallsigs(marshall_handle h, void* member)
 {
@@ -334,7 +403,8 @@ marshallsigs(marshall_handle h, void* member)
     int i, size;
     size = marshalling(h, "sigs", &(signatures->sigs), &(signatures->nsigs), sizeof(struct signatures_struct), marshallself);
     for(i=0; i<signatures->nsigs; i++) {
-        size += marshalling(h, "rr", &(signatures->sigs[i].rr), NULL, 0, marshallldnsrr);
+        size += marshalling(h, "wire", &(signatures->sigs[i].wire), NULL, 0, marshallwire);
+        size += marshalling(h, "class", &(signatures->sigs[i].rrclass), NULL, 0, marshallinteger);
         size += marshalling(h, "keylocator", &(signatures->sigs[i].keylocator), NULL, 0, marshallstring);
         size += marshalling(h, "keyflags", &(signatures->sigs[i].keyflags), NULL, 0, marshallinteger);
         size += marshalling(h, NULL, NULL, &(signatures->nsigs), i, marshallself);
@@ -347,7 +417,7 @@ marshallfunc(int (*memberfunction)(marshall_handle,void*))
 {
     if(memberfunction == NULL || memberfunction == marshallself) {
         return SELF;
-    } else if(memberfunction == marshallinteger || memberfunction == marshallstring || memberfunction == marshallstringarray || memberfunction == marshallldnsrr) {
+    } else if(memberfunction == marshallinteger || memberfunction == marshallstring || memberfunction == marshallstringarray || memberfunction == marshallldnsrr || memberfunction == marshallwire) {
         return BASIC;
     } else {
         return OBJECT;
@@ -404,7 +474,7 @@ marshalling(marshall_handle h, const char* name, void* members, int *membercount
                 if(membercount) {
                     size = marshallinteger(h, membercount);
                     if(*membercount >= 0) {
-                        array = malloc(*membercount * membersize);
+                        array = calloc(*membercount, membersize);
                         *(char**)members = array;
                         dest = (char*) array;
                         if(memberfunction != NULL && memberfunction != marshallself) {
@@ -44,6 +44,7 @@ int marshallinteger(marshall_handle h, void* member);
 int marshallint64(marshall_handle h, void* member);
 int marshallstring(marshall_handle h, void* member);
 int marshallldnsrr(marshall_handle h, void* member);
+int marshallwire(marshall_handle h, void* member);
 int marshallsigs(marshall_handle h, void* member);
 int marshallstringarray(marshall_handle h, void* member);
 int marshalling(marshall_handle h, const char* name, void* members, int *membercount, size_t membersize, int (*memberfunction)(marshall_handle,void*));
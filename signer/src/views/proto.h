@@ -32,6 +32,7 @@ typedef struct recordset_struct* recordset_type;
 typedef struct names_index_struct* names_index_type;
 typedef struct names_table_struct* names_table_type;
 typedef struct names_view_struct* names_view_type;
+typedef struct names_arena_struct* names_arena_type;
 
 #include "signer/signconf.h"
 #include "signer/zone.h"
@@ -50,7 +51,8 @@ extern const char* names_view_BACKUP[];
 extern logger_cls_type names_logcommitlog;
 
 struct signature_struct {
-    ldns_rr* rr;
+    unsigned char* wire;
+    ldns_rr_class rrclass;
     const char* keylocator;
     int keyflags;
 };
@@ -139,10 +141,19 @@ struct names_view_zone {
     signconf_type** signconf;
 };
 
-recordset_type names_recordcreate(char**name);
+names_arena_type names_arenacreate(void);
+void names_arenadestroy(names_arena_type arena);
+void* names_arenaalloc(names_arena_type arena, size_t size);
+void* names_arenarealloc(names_arena_type arena, void* ptr, size_t oldsize, size_t newsize);
+void names_arenafree(names_arena_type arena, void* ptr, size_t size);
+char* names_arenastrdup(names_arena_type arena, const char* str);
+void names_arenastrfree(names_arena_type arena, char* str);
+const char* names_arenalocator(names_arena_type arena, char* locator);
+
+recordset_type names_recordcreate(char**name, names_arena_type arena);
 recordset_type names_recordcreatetemp(const char*name);
 void names_recordannotate(recordset_type d, struct names_view_zone* zone);
-recordset_type names_recordcopy(recordset_type, int clear);
+recordset_type names_recordcopy(recordset_type, int clear, names_arena_type arena);
 void names_recorddispose(recordset_type);
 void names_recorddisposal(recordset_type record, int doit);
 const char* names_recordgetname(recordset_type dict);
@@ -150,6 +161,8 @@ int names_recordgetrevision(recordset_type dict);
 const char *names_recordgetsummary(recordset_type dict, char**);
 const char* names_recordgetdenial(recordset_type dict);
 int names_recordcompare_namerevision(recordset_type a, recordset_type b);
+int names_recordcomparename(recordset_type a, recordset_type b);
+int names_recordisdescendant(recordset_type record, recordset_type ancestor);
 int names_recordhasdata(recordset_type record, ldns_rr_type recordtype, ldns_rr* rr, int exact);
 void names_recordadddata(recordset_type d, ldns_rr* rr);
 void names_recorddeldata(recordset_type d, ldns_rr_type rrtype, ldns_rr* rr);
@@ -173,6 +186,9 @@ size_t names_recordextend(recordset_type);
 
 void names_recordlookupone(recordset_type record, ldns_rr_type type, ldns_rr* template, ldns_rr** rr);
 void names_recordlookupall(recordset_type record, ldns_rr_type type, ldns_rr* template, ldns_rr_list** rrs, struct signature_struct*** rrsigs);
+ldns_rr* names_recordsignature(recordset_type record, struct signature_struct* signature);
+uint32_t names_signatureexpiration(struct signature_struct* signature);
+uint32_t names_signatureinception(struct signature_struct* signature);
 
 struct dual {
     recordset_type src;
@@ -180,6 +196,10 @@ struct dual {
 };
 
 int names_indexcreate(names_index_type*, const char* keyname);
+int names_indexclone(names_index_type*, names_index_type source);
+int names_indexaccept(names_index_type, recordset_type);
+const char* names_indexkeyname(names_index_type);
+size_t names_indexnodesize(void);
 recordset_type names_indexlookup(names_index_type, recordset_type);
 recordset_type names_indexlookupnext(names_index_type index, recordset_type find);
 recordset_type names_indexlookupkey(names_index_type, const char* keyvalue);
@@ -188,6 +208,7 @@ int names_indexremovekey(names_index_type,const char* keyvalue);
 int names_indexinsert(names_index_type index, recordset_type d, recordset_type* existing);
 void names_indexdestroy(names_index_type, void (*userfunc)(void* arg, void* key, void* val), void* userarg);
 names_iterator names_indexiterator(names_index_type);
+names_iterator names_indexjoin(names_index_type primary, names_index_type secondary, int (*filter)(recordset_type), recordset_type (*match)(names_index_type, recordset_type));
 
 /* Table structures are used internally by views to record changes made in
  * the view.  A table is a set of changes, also dubbed a changelog.
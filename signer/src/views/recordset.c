@@ -29,6 +29,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <time.h>
 #include <ldns/ldns.h>
 #include "uthash.h"
@@ -36,23 +37,27 @@
 #include "logging.h"
 #include "proto.h"
 
-struct item {
-    ldns_rr* rr;
-};
-
 struct itemset {
     ldns_rr_type rrtype;
+    ldns_rr_class rrclass;
     int nitems;
-    struct item* items;
+    unsigned char* items;
     struct signatures_struct* signatures;
 };
 
+/* All memory hanging off a record is taken from the arena of the record, or
+ * from malloc if there is no arena as with records read back from a state
+ * file or used for lookups.
+ */
 struct recordset_struct {
+    names_arena_type arena;
     char* name;
+    unsigned char* key;
     int revision;
     int marker;
     ldns_rr* spanhashrr;
     char* spanhash;
+    int spanbyname;
     struct signatures_struct* spansignatures;
     int* validupto;
     int* validfrom;
@@ -61,69 +66,373 @@ struct recordset_struct {
     struct itemset* itemsets;
 };
 
+/* The resource records of a set are kept together in a single block of
+ * memory, starting with the number of bytes that follow.  Every record is
+ * stored as its TTL and rdata length followed by its rdata, in uncompressed
+ * wire format.  The owner name, type and class are those of the set and not
+ * repeated.  A signature is stored the same way, as a block with a single
+ * RRSIG record.  Resource records are only turned into ldns_rr structures
+ * when they are handed out.
+ */
+#define WIRELEN(W)  (*(uint32_t*)(W))
+#define WIREDATA(W) ((W) + sizeof(uint32_t))
+#define ENTRYLEN(E) (6 + ldns_read_uint16(&(E)[4]))
+
+static unsigned char*
+wireappend(names_arena_type arena, unsigned char* wire, ldns_rr* rr)
+{
+    size_t oldlen, rdlen;
+    unsigned char* entry;
+    ldns_buffer* buffer;
+    CHECKALLOC(buffer = ldns_buffer_new(ldns_rr_uncompressed_size(rr)));
+    ldns_rr_rdata2buffer_wire(buffer, rr);
+    rdlen = ldns_buffer_position(buffer);
+    oldlen = (wire ? WIRELEN(wire) : 0);
+    wire = names_arenarealloc(arena, wire, (wire ? sizeof(uint32_t) + oldlen : 0), sizeof(uint32_t) + oldlen + 6 + rdlen);
+    entry = WIREDATA(wire) + oldlen;
+    ldns_write_uint32(entry, ldns_rr_ttl(rr));
+    ldns_write_uint16(&entry[4], rdlen);
+    memcpy(&entry[6], ldns_buffer_begin(buffer), rdlen);
+    WIRELEN(wire) = oldlen + 6 + rdlen;
+    ldns_buffer_free(buffer);
+    return wire;
+}
+
+static unsigned char*
+wireremove(names_arena_type arena, unsigned char* wire, unsigned char* entry)
+{
+    size_t len, oldlen, offset;
+    len = ENTRYLEN(entry);
+    oldlen = WIRELEN(wire);
+    offset = entry - WIREDATA(wire);
+    if(len == oldlen) {
+        names_arenafree(arena, wire, sizeof(uint32_t) + oldlen);
+        return NULL;
+    }
+    memmove(entry, entry + len, oldlen - offset - len);
+    WIRELEN(wire) = oldlen - len;
+    return names_arenarealloc(arena, wire, sizeof(uint32_t) + oldlen, sizeof(uint32_t) + oldlen - len);
+}
+
+static unsigned char*
+wirecopy(names_arena_type arena, const unsigned char* wire)
+{
+    unsigned char* copy;
+    if(wire == NULL)
+        return NULL;
+    copy = names_arenaalloc(arena, sizeof(uint32_t) + WIRELEN(wire));
+    memcpy(copy, wire, sizeof(uint32_t) + WIRELEN(wire));
+    return copy;
+}
+
+static void
+wirefree(names_arena_type arena, unsigned char* wire)
+{
+    if(wire)
+        names_arenafree(arena, wire, sizeof(uint32_t) + WIRELEN(wire));
+}
+
+static ldns_rr*
+wirerr(const unsigned char* entry, const ldns_rdf* owner, ldns_rr_type rrtype, ldns_rr_class rrclass)
+{
+    size_t pos = 4;
+    ldns_rr* rr;
+    CHECKALLOC(rr = ldns_rr_new());
+    ldns_rr_set_owner(rr, ldns_rdf_clone(owner));
+    ldns_rr_set_type(rr, rrtype);
+    ldns_rr_set_class(rr, rrclass);
+    ldns_rr_set_ttl(rr, ldns_read_uint32(entry));
+    if(ldns_wire2rdf(rr, entry, ENTRYLEN(entry), &pos) != LDNS_STATUS_OK) {
+        ldns_rr_free(rr);
+        return NULL;
+    }
+    return rr;
+}
+
 static void
-disposesignature(struct signatures_struct** signatures)
+disposesignature(names_arena_type arena, struct signatures_struct** signatures)
 {
     int i;
     if(*signatures) {
         for (i=0; i<(*signatures)->nsigs; i++) {
-            free((void*)(*signatures)->sigs[i].keylocator);
-            ldns_rr_free((*signatures)->sigs[i].rr);
+            if(arena == NULL)
+                free((void*)(*signatures)->sigs[i].keylocator);
+            wirefree(arena, (*signatures)->sigs[i].wire);
         }
-        free((*signatures)->sigs);
-        free((*signatures));
+        names_arenafree(arena, (*signatures)->sigs, sizeof(struct signature_struct) * (*signatures)->nsigs);
+        names_arenafree(arena, *signatures, sizeof(struct signatures_struct));
         *signatures = NULL;
     }
 }
 
-void
-disposeitemset(struct itemset* itemset)
+static void
+disposeitemset(names_arena_type arena, struct itemset* itemset)
+{
+    wirefree(arena, itemset->items);
+    disposesignature(arena, &(itemset->signatures));
+}
+
+/* The owner name is kept alongside its presentation form as a canonical key.
+ * The labels of the name are lowercased and stored starting at the root, each
+ * followed by a zero byte, so that comparing two keys with memcmp gives the
+ * canonical DNSSEC name order (RFC 4034 section 6.1) and a name is a prefix
+ * of the keys of all names below it.  Zero and one bytes inside a label are
+ * escaped as 0x01 0x01 and 0x01 0x02 to keep the separator the lowest byte.
+ * The key starts with its length in two bytes.
+ */
+#define KEYLEN(K) (((K)[0] << 8) | (K)[1])
+
+static unsigned char*
+ownerkey(names_arena_type arena, const char* name)
+{
+    int i, j, len, nlabels, keylen;
+    unsigned char c;
+    unsigned char* decoded;
+    int* labels;
+    unsigned char* key;
+    if (!name)
+        return NULL;
+    len = strlen(name);
+    CHECKALLOC(decoded = malloc(len + 1));
+    CHECKALLOC(labels = malloc(sizeof(int) * (len + 2)));
+    nlabels = 0;
+    labels[0] = 0;
+    for (i=0, j=0; i<len; ) {
+        if (name[i] == '.') {
+            if (j > labels[nlabels])
+                labels[++nlabels] = j;
+            i++;
+            continue;
+        }
+        if (name[i] == '\\' && i+3 < len && isdigit((unsigned char)name[i+1]) && isdigit((unsigned char)name[i+2]) && isdigit((unsigned char)name[i+3])) {
+            c = (name[i+1]-'0')*100 + (name[i+2]-'0')*10 + (name[i+3]-'0');
+            i += 4;
+        } else if (name[i] == '\\' && i+1 < len) {
+            c = name[i+1];
+            i += 2;
+        } else {
+            c = name[i++];
+        }
+        decoded[j++] = (c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+    }
+    if (j > labels[nlabels])
+        labels[++nlabels] = j;
+    keylen = 0;
+    for (i=0; i<j; i++)
+        keylen += (decoded[i] <= 1 ? 2 : 1);
+    keylen += nlabels;
+    key = names_arenaalloc(arena, keylen + 2);
+    key[0] = keylen >> 8;
+    key[1] = keylen & 0xff;
+    keylen = 2;
+    for (; nlabels > 0; nlabels--) {
+        for (i=labels[nlabels-1]; i<labels[nlabels]; i++) {
+            if (decoded[i] <= 1) {
+                key[keylen++] = 1;
+                key[keylen++] = decoded[i] + 1;
+            } else {
+                key[keylen++] = decoded[i];
+            }
+        }
+        key[keylen++] = '\0';
+    }
+    free(labels);
+    free(decoded);
+    return key;
+}
+
+static unsigned char*
+copykey(names_arena_type arena, const unsigned char* key)
+{
+    unsigned char* copy;
+    if (!key)
+        return NULL;
+    copy = names_arenaalloc(arena, KEYLEN(key) + 2);
+    memcpy(copy, key, KEYLEN(key) + 2);
+    return copy;
+}
+
+static int
+comparekeys(const unsigned char* a, const unsigned char* b)
+{
+    int alen, blen, rc;
+    if (!a || !b)
+        return (a ? 1 : 0) - (b ? 1 : 0);
+    alen = KEYLEN(a);
+    blen = KEYLEN(b);
+    rc = memcmp(&a[2], &b[2], (alen < blen ? alen : blen));
+    if (rc == 0)
+        rc = alen - blen;
+    return rc;
+}
+
+int
+names_recordcomparename(recordset_type a, recordset_type b)
+{
+    return comparekeys(a->key, b->key);
+}
+
+int
+names_recordisdescendant(recordset_type record, recordset_type ancestor)
+{
+    if (!record->key || !ancestor->key)
+        return 0;
+    if (KEYLEN(record->key) < KEYLEN(ancestor->key))
+        return 0;
+    return !memcmp(&record->key[2], &ancestor->key[2], KEYLEN(ancestor->key));
+}
+
+/* The denial name used for NSEC is the name with its labels reversed and
+ * separated by a tilde, which is kept for display.  The NSEC chain itself is
+ * ordered on the canonical key.
+ */
+static char*
+reversedname(names_arena_type arena, const char* name)
+{
+    int i, j, end, len, l;
+    char* reversed;
+    end = len = strlen(name);
+    reversed = names_arenaalloc(arena, len+1);
+    reversed[end--] = '\0';
+    for (i=0; i<len; ) {
+        for (j=0; name[i+j]; j++) {
+            if (name[i+j] == '.')
+                break;
+        }
+        l = j;
+        for(j=0; j<l; j++) {
+            reversed[end--] = name[i+l-j-1];
+        }
+        i += l;
+        if (i != len) {
+            reversed[end--] = '~';
+            i++;
+        }
+    }
+    return reversed;
+}
+
+static ldns_rdf*
+recordowner(recordset_type record)
+{
+    ldns_rdf* owner;
+    CHECKALLOC(owner = ldns_dname_new_frm_str(record->name));
+    return owner;
+}
+
+/* Find the packed record of a set with the same rdata as the given resource
+ * record, in the way ldns_rr_compare would.  Comparing the wire format rdata
+ * suffices unless it contains domain names, which are compared in canonical
+ * form.
+ */
+static unsigned char*
+wirefind(recordset_type record, struct itemset* itemset, ldns_rr* rr)
+{
+    int j, dnames;
+    ldns_buffer* rdata;
+    ldns_rdf* owner = NULL;
+    ldns_rr* other;
+    unsigned char* entry;
+    unsigned char* found = NULL;
+    const ldns_rr_descriptor* descriptor;
+    if(itemset->items == NULL || ldns_rr_get_class(rr) != itemset->rrclass)
+        return NULL;
+    descriptor = ldns_rr_descript(itemset->rrtype);
+    dnames = (descriptor != NULL && descriptor->_dname_count > 0);
+    CHECKALLOC(rdata = ldns_buffer_new(ldns_rr_uncompressed_size(rr)));
+    ldns_rr_rdata2buffer_wire(rdata, rr);
+    for(j=0, entry=WIREDATA(itemset->items); j<itemset->nitems && !found; j++, entry+=ENTRYLEN(entry)) {
+        if(!dnames) {
+            if((size_t)ENTRYLEN(entry) - 6 == ldns_buffer_position(rdata) && !memcmp(&entry[6], ldns_buffer_begin(rdata), ldns_buffer_position(rdata)))
+                found = entry;
+        } else {
+            if(owner == NULL)
+                owner = recordowner(record);
+            other = wirerr(entry, owner, itemset->rrtype, itemset->rrclass);
+            if(other && !ldns_rr_compare(rr, other))
+                found = entry;
+            ldns_rr_free(other);
+        }
+    }
+    if(owner)
+        ldns_rdf_deep_free(owner);
+    ldns_buffer_free(rdata);
+    return found;
+}
+
+static int
+issignature(struct signatures_struct* signatures, struct signature_struct* signature)
+{
+    return signatures && signature >= signatures->sigs && signature < &signatures->sigs[signatures->nsigs];
+}
+
+ldns_rr*
+names_recordsignature(recordset_type record, struct signature_struct* signature)
 {
-    int j;
-    for(j=0; j<itemset->nitems; j++) {
-        ldns_rr_free(itemset->items[j].rr);
+    ldns_rr* rr;
+    ldns_rdf* owner;
+    if(issignature(record->spansignatures, signature) && record->spanhashrr) {
+        owner = ldns_rdf_clone(ldns_rr_owner(record->spanhashrr));
+    } else {
+        owner = recordowner(record);
     }
-    free(itemset->items);
-    disposesignature(&(itemset->signatures));
+    rr = wirerr(WIREDATA(signature->wire), owner, LDNS_RR_TYPE_RRSIG, signature->rrclass);
+    ldns_rdf_deep_free(owner);
+    return rr;
 }
 
+/* offsets of the expiration and inception in the RRSIG rdata (RFC 4034) */
+uint32_t
+names_signatureexpiration(struct signature_struct* signature)
+{
+    return ldns_read_uint32(&WIREDATA(signature->wire)[6 + 8]);
+}
+
+uint32_t
+names_signatureinception(struct signature_struct* signature)
+{
+    return ldns_read_uint32(&WIREDATA(signature->wire)[6 + 12]);
+}
+
+/* The record takes over the signature and the allocated key locator, also
+ * when the signature is dropped because the record has no such set.
+ */
 void
 names_recordaddsignature(recordset_type d, ldns_rr_type rrtype, ldns_rr* rrsig, const char* keylocator, int keyflags)
 {
-    int i, j;
+    int i;
+    struct signatures_struct** signatures;
     for(i=0; i<d->nitemsets; i++)
         if(rrtype == d->itemsets[i].rrtype)
             break;
     if (i<d->nitemsets) {
-        if(!d->itemsets[i].signatures) {
-            d->itemsets[i].signatures = malloc(sizeof(struct signatures_struct));
-            d->itemsets[i].signatures->nsigs = 0;
-            d->itemsets[i].signatures->sigs = NULL;
-        }
-        d->itemsets[i].signatures->nsigs += 1;
-        d->itemsets[i].signatures->sigs = realloc(d->itemsets[i].signatures->sigs, sizeof(struct signature_struct) * d->itemsets[i].signatures->nsigs);
-        d->itemsets[i].signatures->sigs[d->itemsets[i].signatures->nsigs-1].rr = rrsig;
-        d->itemsets[i].signatures->sigs[d->itemsets[i].signatures->nsigs-1].keylocator = keylocator;
-        d->itemsets[i].signatures->sigs[d->itemsets[i].signatures->nsigs-1].keyflags = keyflags;
+        signatures = &d->itemsets[i].signatures;
     } else if(rrtype == LDNS_RR_TYPE_NSEC || rrtype == LDNS_RR_TYPE_NSEC3) {
-        if(!d->spansignatures) {
-            d->spansignatures = malloc(sizeof(struct signatures_struct));
-            d->spansignatures->nsigs = 0;
-            d->spansignatures->sigs = NULL;            
-        }
-        d->spansignatures->nsigs += 1;
-        d->spansignatures->sigs = realloc(d->spansignatures->sigs, sizeof(struct signature_struct) * d->spansignatures->nsigs);
-        d->spansignatures->sigs[d->spansignatures->nsigs-1].rr = rrsig;
-        d->spansignatures->sigs[d->spansignatures->nsigs-1].keylocator = keylocator;
-        d->spansignatures->sigs[d->spansignatures->nsigs-1].keyflags = keyflags;
+        signatures = &d->spansignatures;
+    } else {
+        ldns_rr_free(rrsig);
+        free((void*)keylocator);
+        return;
+    }
+    if(!*signatures) {
+        *signatures = names_arenaalloc(d->arena, sizeof(struct signatures_struct));
+        (*signatures)->nsigs = 0;
+        (*signatures)->sigs = NULL;
     }
+    (*signatures)->nsigs += 1;
+    (*signatures)->sigs = names_arenarealloc(d->arena, (*signatures)->sigs, sizeof(struct signature_struct) * ((*signatures)->nsigs - 1), sizeof(struct signature_struct) * (*signatures)->nsigs);
+    (*signatures)->sigs[(*signatures)->nsigs-1].wire = wireappend(d->arena, NULL, rrsig);
+    (*signatures)->sigs[(*signatures)->nsigs-1].rrclass = ldns_rr_get_class(rrsig);
+    (*signatures)->sigs[(*signatures)->nsigs-1].keylocator = names_arenalocator(d->arena, (char*)keylocator);
+    (*signatures)->sigs[(*signatures)->nsigs-1].keyflags = keyflags;
+    ldns_rr_free(rrsig);
 }
 
 int
 names_recordcompare_namerevision(recordset_type a, recordset_type b)
 {
     int rc;
-    rc = strcmp(a->name, b->name);
+    rc = comparekeys(a->key, b->key);
     if(rc == 0) {
         if(a->revision != 0 && b->revision != 0) {
             rc = a->revision - b->revision;
@@ -133,13 +442,15 @@ names_recordcompare_namerevision(recordset_type a, recordset_type b)
 }
 
 static recordset_type
-recordcreate()
+recordcreate(names_arena_type arena)
 {
     struct recordset_struct* dict;
-    dict = malloc(sizeof(struct recordset_struct));
+    dict = names_arenaalloc(arena, sizeof(struct recordset_struct));
+    dict->arena = arena;
     dict->nitemsets = 0;
     dict->itemsets = NULL;
     dict->spanhash = NULL;
+    dict->spanbyname = 0;
     dict->spanhashrr = NULL;
     dict->spansignatures = NULL;
     dict->validupto = NULL;
@@ -150,15 +461,16 @@ recordcreate()
 }
 
 recordset_type
-names_recordcreate(char** name)
+names_recordcreate(char** name, names_arena_type arena)
 {
     struct recordset_struct* dict;
-    dict = recordcreate();
+    dict = recordcreate(arena);
     if (name) {
-        dict->name = *name = ((*name) ? strdup(*name) : NULL);
+        dict->name = *name = names_arenastrdup(arena, *name);
     } else {
         dict->name = NULL;
     }
+    dict->key = ownerkey(arena, dict->name);
     dict->revision = 1;
     return dict;
 }
@@ -167,8 +479,9 @@ recordset_type
 names_recordcreatetemp(const char* name)
 {
     recordset_type dict;
-    dict = recordcreate();
+    dict = recordcreate(NULL);
     dict->name = (name ? strdup(name) : NULL);
+    dict->key = ownerkey(NULL, dict->name);
     dict->revision = 0;
     return dict;
 }
@@ -176,6 +489,7 @@ names_recordcreatetemp(const char* name)
 void
 names_recordannotate(recordset_type d, struct names_view_zone* zone)
 {
+    char* spanhash;
     if(zone) {
         if(zone->signconf && *(zone->signconf) && (*(zone->signconf))->nsec3params) {
             nsec3params_type* n3p = (*zone->signconf)->nsec3params;
@@ -191,7 +505,10 @@ names_recordannotate(recordset_type d, struct names_view_zone* zone)
              */
             hashed_label = ldns_nsec3_hash_name(dname, n3p->algorithm, n3p->iterations, n3p->salt_len, n3p->salt_data);
             hashed_ownername = ldns_dname_cat_clone(hashed_label, apex);
-            d->spanhash = ldns_rdf2str(hashed_ownername);
+            spanhash = ldns_rdf2str(hashed_ownername);
+            d->spanhash = names_arenastrdup(d->arena, spanhash);
+            free(spanhash);
+            d->spanbyname = 0;
             ldns_rdf_deep_free(hashed_ownername);
             ldns_rdf_deep_free(hashed_label);
             ldns_rdf_deep_free(apex);
@@ -206,71 +523,55 @@ names_recordannotate(recordset_type d, struct names_view_zone* zone)
              * ldns_rdf_deep_free(rdf);
              * ldns_rdf_deep_free(revrdf);
              */
-            int i, j, end, len, l;
-            end = len = strlen(d->name);
-            d->spanhash = malloc(len+1);
-            d->spanhash[end--] = '\0';
-            for (i=0; i<len; ) {
-                for (j=0; d->name[i+j]; j++) {
-                    if (d->name[i+j] == '.')
-                        break;
-                }
-                l = j;
-                for(j=0; j<l; j++) {
-                    d->spanhash[end--] = d->name[i+l-j-1];
-                }
-                i += l;
-                if (i != len) {
-                    d->spanhash[end--] = '~';
-                    i++;
-                }
-            }
+            d->spanhash = reversedname(d->arena, d->name);
+            d->spanbyname = 1;
         }
     } else {
         if(d->spanhash)
-            free(d->spanhash);
+            names_arenastrfree(d->arena, d->spanhash);
         if(d->spanhashrr)
             ldns_rr_free(d->spanhashrr);
         d->spanhash = NULL;
         d->spanhashrr = NULL;
+        d->spanbyname = 0;
     }
 }
 
 recordset_type
-names_recordcopy(recordset_type dict, int clear)
+names_recordcopy(recordset_type dict, int clear, names_arena_type arena)
 {
-    int i, j;
+    int i;
     struct recordset_struct* target;
-    char* name = dict->name;
-    target = (struct recordset_struct*) names_recordcreate(&name);
+    target = recordcreate(arena);
+    target->name = names_arenastrdup(arena, dict->name);
+    target->key = copykey(arena, dict->key);
     target->revision = dict->revision + 1;
     target->nitemsets = dict->nitemsets;
-    CHECKALLOC(target->itemsets = malloc(sizeof(struct itemset) * target->nitemsets));
+    target->itemsets = names_arenaalloc(arena, sizeof(struct itemset) * target->nitemsets);
     for(i=0; i<target->nitemsets; i++) {
         target->itemsets[i].rrtype = dict->itemsets[i].rrtype;
+        target->itemsets[i].rrclass = dict->itemsets[i].rrclass;
         target->itemsets[i].nitems = dict->itemsets[i].nitems;
-        target->itemsets[i].items = malloc(sizeof(struct item) * dict->itemsets[i].nitems);
+        target->itemsets[i].items = wirecopy(arena, dict->itemsets[i].items);
         target->itemsets[i].signatures = NULL;
-        for(j=0; j<dict->itemsets[i].nitems; j++) {
-            target->itemsets[i].items[j].rr = ldns_rr_clone(dict->itemsets[i].items[j].rr);
-        }
     }
-    target->spanhash = (dict->spanhash ? strdup(dict->spanhash) : NULL);
+    target->spanhash = names_arenastrdup(arena, dict->spanhash);
+    target->spanbyname = dict->spanbyname;
     target->spanhashrr = (dict->spanhashrr ? ldns_rr_clone(dict->spanhashrr) : NULL);
-    disposesignature(&target->spansignatures);
+    disposesignature(arena, &target->spansignatures);
     if(clear == 0) {
         if(dict->expiry) {
-            target->expiry = malloc(sizeof(int64_t));
+            target->expiry = names_arenaalloc(arena, sizeof(int64_t));
             *(target->expiry) = *(dict->expiry);
         } else
             target->expiry = NULL;
         if(dict->validfrom) {
-            target->validfrom = malloc(sizeof(int));
+            target->validfrom = names_arenaalloc(arena, sizeof(int));
             *(target->validfrom) = *(dict->validfrom);
         } else
             target->validfrom = NULL;
         if(dict->validupto) {
-            target->validupto = malloc(sizeof(int));
+            target->validupto = names_arenaalloc(arena, sizeof(int));
             *(target->validupto) = *(dict->validupto);
         } else
             target->validupto = NULL;
@@ -281,7 +582,8 @@ names_recordcopy(recordset_type dict, int clear)
 int
 names_recordhasdata(recordset_type record, ldns_rr_type recordtype, ldns_rr* rr, int exact)
 {
-    int i, j;
+    int i;
+    unsigned char* entry;
     if(!record)
         return 0;
     if(recordtype == 0) { /* note there is no rrtype of 0 in DNS */
@@ -294,12 +596,10 @@ names_recordhasdata(recordset_type record, ldns_rr_type recordtype, ldns_rr* rr,
             if(rr == NULL) {
                 return record->itemsets[i].nitems > 0;
             } else {
-                for(j=0; j<record->itemsets[i].nitems; j++)
-                    if(!ldns_rr_compare(rr, record->itemsets[i].items[j].rr))
-                        break;
-                if (j<record->itemsets[i].nitems) {
+                entry = wirefind(record, &record->itemsets[i], rr);
+                if (entry) {
                     if(exact) {
-                        if(ldns_rr_ttl(record->itemsets[i].items[j].rr) != ldns_rr_ttl(rr))
+                        if(ldns_read_uint32(entry) != ldns_rr_ttl(rr))
                             return 0;
                         return  1;
                     } else
@@ -314,7 +614,7 @@ names_recordhasdata(recordset_type record, ldns_rr_type recordtype, ldns_rr* rr,
 void
 names_recordadddata(recordset_type d, ldns_rr* rr)
 {
-    int i, j;
+    int i;
     ldns_rr_type rrtype;
     rrtype = ldns_rr_get_type(rr);
     for(i=0; i<d->nitemsets; i++)
@@ -322,71 +622,55 @@ names_recordadddata(recordset_type d, ldns_rr* rr)
             break;
     if (i==d->nitemsets) {
         d->nitemsets += 1;
-        CHECKALLOC(d->itemsets = realloc(d->itemsets, sizeof(struct itemset) * d->nitemsets));
+        d->itemsets = names_arenarealloc(d->arena, d->itemsets, sizeof(struct itemset) * (d->nitemsets - 1), sizeof(struct itemset) * d->nitemsets);
         d->itemsets[i].rrtype = rrtype;
+        d->itemsets[i].rrclass = ldns_rr_get_class(rr);
         d->itemsets[i].items = NULL;
         d->itemsets[i].nitems = 0;
         d->itemsets[i].signatures = NULL;
     }
-    for(j=0; j<d->itemsets[i].nitems; j++)
-        if(!ldns_rr_compare(rr, d->itemsets[i].items[j].rr))
-            break;
-    if (j==d->itemsets[i].nitems) {
+    if (!wirefind(d, &d->itemsets[i], rr)) {
         d->itemsets[i].nitems += 1;
-        d->itemsets[i].items = realloc(d->itemsets[i].items, sizeof(struct item) * d->itemsets[i].nitems);
-        d->itemsets[i].items[j].rr = ldns_rr_clone(rr);
+        d->itemsets[i].items = wireappend(d->arena, d->itemsets[i].items, rr);
     }
 }
 
+static void
+removeitemset(recordset_type d, int i)
+{
+    disposeitemset(d->arena, &(d->itemsets[i]));
+    d->nitemsets -= 1;
+    for(; i<d->nitemsets; i++)
+        d->itemsets[i] = d->itemsets[i+1];
+    if(d->nitemsets > 0) {
+        d->itemsets = names_arenarealloc(d->arena, d->itemsets, sizeof(struct itemset) * (d->nitemsets + 1), sizeof(struct itemset) * d->nitemsets);
+    } else {
+        names_arenafree(d->arena, d->itemsets, sizeof(struct itemset));
+        d->itemsets = NULL;
+    }
+}
+
+/* The rr only selects the record to remove and stays with the caller. */
 void
 names_recorddeldata(recordset_type d, ldns_rr_type rrtype, ldns_rr* rr)
 {
-    int i, j;
+    int i;
+    unsigned char* entry;
     for(i=0; i<d->nitemsets; i++)
         if(rrtype == d->itemsets[i].rrtype)
             break;
     if (i<d->nitemsets) {
         if(rr) {
-            for(j=0; j<d->itemsets[i].nitems; j++)
-                if(ldns_rr_compare(rr, d->itemsets[i].items[j].rr))
-                    break;
-            if (j<d->itemsets[i].nitems) {
-                ldns_rr_free(d->itemsets[i].items[j].rr);
+            entry = wirefind(d, &d->itemsets[i], rr);
+            if (entry) {
                 d->itemsets[i].nitems -= 1;
-                for(; j<d->itemsets[i].nitems; j++) {
-                    d->itemsets[i].items[j] = d->itemsets[i].items[j+1];
-                }
-                if(d->itemsets[i].nitems > 0) {
-                    d->itemsets[i].items = realloc(d->itemsets[i].items, sizeof(struct item) * d->itemsets[i].nitems);
-                } else {
-                    free(d->itemsets[i].items);
-                    d->itemsets[i].items = NULL;
-                    d->nitemsets -= 1;
-                    for(; i<d->nitemsets; i++)
-                        d->itemsets[i] = d->itemsets[i+1];
-                    if(d->nitemsets > 0) {
-                        CHECKALLOC(d->itemsets = realloc(d->itemsets, sizeof(struct itemset) * d->nitemsets));
-                    } else {
-                        free(d->itemsets);
-                        d->itemsets = NULL;
-                    }
+                d->itemsets[i].items = wireremove(d->arena, d->itemsets[i].items, entry);
+                if(d->itemsets[i].nitems == 0) {
+                    removeitemset(d, i);
                 }
             }
         } else {
-            for(j=0; j<d->itemsets[i].nitems; j++) {
-                ldns_rr_free(d->itemsets[i].items[j].rr);
-            }
-            free(d->itemsets[i].items);
-            d->itemsets[i].items = NULL;
-            d->nitemsets -= 1;
-            for(; i<d->nitemsets; i++)
-                d->itemsets[i] = d->itemsets[i+1];
-            if(d->nitemsets > 0) {
-                CHECKALLOC(d->itemsets = realloc(d->itemsets, sizeof(struct itemset) * d->nitemsets));
-            } else {
-                free(d->itemsets);
-                d->itemsets = NULL;
-            }
+            removeitemset(d, i);
         }
     }
 }
@@ -394,31 +678,20 @@ names_recorddeldata(recordset_type d, ldns_rr_type rrtype, ldns_rr* rr)
 void
 names_recorddelall(recordset_type d, ldns_rr_type rrtype)
 {
-    int i, j;
-    for(i=0; i<d->nitemsets; i++) {
-        if(rrtype==0 || d->itemsets[i].rrtype == rrtype) {
-            disposeitemset(&(d->itemsets[i]));
-            if(rrtype != 0)
-                break;
-        }
-    }
+    int i;
     if(rrtype == 0) {
-        free(d->itemsets);
+        for(i=0; i<d->nitemsets; i++)
+            disposeitemset(d->arena, &(d->itemsets[i]));
+        names_arenafree(d->arena, d->itemsets, sizeof(struct itemset) * d->nitemsets);
         d->itemsets = NULL;
         d->nitemsets = 0;
-    } else if(i<d->nitemsets) {
-        d->itemsets[i].items = NULL;
-        d->nitemsets -= 1;
-        for (; i < d->nitemsets; i++)
-            d->itemsets[i] = d->itemsets[i + 1];
-        if (d->nitemsets > 0) {
-            CHECKALLOC(d->itemsets = realloc(d->itemsets, sizeof (struct itemset) * d->nitemsets));
-        } else {
-            for(i=0; i<d->nitemsets; i++)
-                disposeitemset(&(d->itemsets[i]));
-            free(d->itemsets);
-            d->itemsets = NULL;
-        }        
+    } else {
+        for(i=0; i<d->nitemsets; i++) {
+            if(d->itemsets[i].rrtype == rrtype) {
+                removeitemset(d, i);
+                break;
+            }
+        }
     }
 }
 
@@ -437,16 +710,6 @@ names_recordalltypes(recordset_type d)
     return iter;
 }
 
-static void names_recordallvaluestrings_func(names_iterator iter, void* base, int index, void* dst)
-{
-    struct item* items = (struct item*) base;
-    char** ptr = (char**)dst;
-    free(*ptr);
-    if (index >= 0)
-        *ptr = ldns_rr2str(items[index].rr);
-    else
-        *ptr = NULL;
-}
 names_iterator
 names_recordallvaluestrings(recordset_type d, ldns_rr_type rrtype)
 {
@@ -457,13 +720,22 @@ names_recordallvaluestrings(recordset_type d, ldns_rr_type rrtype)
     }
     if(i<d->nitemsets) {
         int j;
+        ldns_rr* rr;
+        ldns_rdf* owner;
+        unsigned char* entry;
         names_iterator iter = names_iterator_createrefs(free);
-        for(j=0; j<d->itemsets[i].nitems; j++) {
-            names_iterator_addptr(iter, ldns_rr2str(d->itemsets[i].items[j].rr));
+        owner = recordowner(d);
+        for(j=0, entry=WIREDATA(d->itemsets[i].items); j<d->itemsets[i].nitems; j++, entry+=ENTRYLEN(entry)) {
+            rr = wirerr(entry, owner, d->itemsets[i].rrtype, d->itemsets[i].rrclass);
+            names_iterator_addptr(iter, ldns_rr2str(rr));
+            ldns_rr_free(rr);
         }
+        ldns_rdf_deep_free(owner);
         if(d->itemsets[i].signatures) {
             for(j=0; j<d->itemsets[i].signatures->nsigs; j++) {
-                names_iterator_addptr(iter, ldns_rr2str(d->itemsets[i].signatures->sigs[j].rr));
+                rr = names_recordsignature(d, &d->itemsets[i].signatures->sigs[j]);
+                names_iterator_addptr(iter, ldns_rr2str(rr));
+                ldns_rr_free(rr);
             }
         }
         return iter;
@@ -471,10 +743,13 @@ names_recordallvaluestrings(recordset_type d, ldns_rr_type rrtype)
         if(rrtype == LDNS_RR_TYPE_NSEC || rrtype == LDNS_RR_TYPE_NSEC3) {
             int j;
             names_iterator iter = names_iterator_createrefs(free);
+            ldns_rr* rr;
             names_iterator_addptr(iter, ldns_rr2str(d->spanhashrr));
             if(d->spansignatures) {
                 for(j=0; j<d->spansignatures->nsigs; j++) {
-                    names_iterator_addptr(iter, ldns_rr2str(d->spansignatures->sigs[j].rr));
+                    rr = names_recordsignature(d, &d->spansignatures->sigs[j]);
+                    names_iterator_addptr(iter, ldns_rr2str(rr));
+                    ldns_rr_free(rr);
                 }
             }
             return iter;            
@@ -486,25 +761,25 @@ names_recordallvaluestrings(recordset_type d, ldns_rr_type rrtype)
 void
 names_recorddispose(recordset_type dict)
 {
-    int i, j;
+    int i;
+    names_arena_type arena = dict->arena;
     for(i=0; i<dict->nitemsets; i++) {
-        for(j=0; j<dict->itemsets[i].nitems; j++) {
-            ldns_rr_free(dict->itemsets[i].items[j].rr);
-        }
-        disposesignature(&dict->itemsets[i].signatures);
-        free(dict->itemsets[i].items);
+        disposeitemset(arena, &dict->itemsets[i]);
+    }
+    names_arenafree(arena, dict->itemsets, sizeof(struct itemset) * dict->nitemsets);
+    names_arenastrfree(arena, dict->name);
+    if(dict->key) {
+        names_arenafree(arena, dict->key, KEYLEN(dict->key) + 2);
     }
-    free(dict->itemsets);
-    free(dict->name);
-    free(dict->spanhash);
+    names_arenastrfree(arena, dict->spanhash);
     if(dict->spanhashrr) {
         ldns_rr_free(dict->spanhashrr);
     }
-    disposesignature(&dict->spansignatures);
-    free(dict->validupto);
-    free(dict->validfrom);
-    free(dict->expiry);
-    free(dict);
+    disposesignature(arena, &dict->spansignatures);
+    names_arenafree(arena, dict->validupto, sizeof(int));
+    names_arenafree(arena, dict->validfrom, sizeof(int));
+    names_arenafree(arena, dict->expiry, sizeof(int64_t));
+    names_arenafree(arena, dict, sizeof(struct recordset_struct));
 }
 
 void
@@ -565,7 +840,7 @@ void
 names_recordsetvalidupto(recordset_type record, int value)
 {
     assert(record->validupto == NULL);
-    record->validupto = malloc(sizeof(int));
+    record->validupto = names_arenaalloc(record->arena, sizeof(int));
     *(record->validupto) = value;
 }
 
@@ -581,7 +856,7 @@ void
 names_recordsetvalidfrom(recordset_type record, int value)
 {
     assert(record->validfrom == NULL);
-    record->validfrom = malloc(sizeof(int));
+    record->validfrom = names_arenaalloc(record->arena, sizeof(int));
     *(record->validfrom) = value;
 }
 
@@ -618,7 +893,7 @@ void
 names_recordsetexpiry(recordset_type record, int64_t value)
 {
     assert(record->expiry == NULL);
-    record->expiry = malloc(sizeof(int64_t));
+    record->expiry = names_arenaalloc(record->arena, sizeof(int64_t));
     *(record->expiry) = value;
 }
 
@@ -627,7 +902,7 @@ marshall(marshall_handle h, void* ptr)
 {
     recordset_type d = ptr;
     int size = 0;
-    int i, j;
+    int i;
     size += marshalling(h, "name", &(d->name), NULL, 0, marshallstring);
     size += marshalling(h, "marker", &(d->marker), NULL, 0, marshallinteger);
     size += marshalling(h, "revision", &(d->revision), NULL, 0, marshallinteger);
@@ -640,14 +915,21 @@ marshall(marshall_handle h, void* ptr)
     size += marshalling(h, "itemsets", &(d->itemsets), &(d->nitemsets), sizeof(struct itemset), marshallself);
     for(i=0; i<d->nitemsets; i++) {
         size += marshalling(h, "itemname", &(d->itemsets[i].rrtype), NULL, 0, marshallinteger);
-        size += marshalling(h, "items", &(d->itemsets[i].items), &(d->itemsets[i].nitems), sizeof(struct item), marshallself);
-        for(j=0; j<d->itemsets[i].nitems; j++) {
-            size += marshalling(h, "rr", &(d->itemsets[i].items[j].rr), NULL, 0, marshallldnsrr);
-            size += marshalling(h, NULL, NULL, &(d->itemsets[i].nitems), j, marshallself);
-        }
+        size += marshalling(h, "itemclass", &(d->itemsets[i].rrclass), NULL, 0, marshallinteger);
+        size += marshalling(h, "nitems", &(d->itemsets[i].nitems), NULL, 0, marshallinteger);
+        size += marshalling(h, "items", &(d->itemsets[i].items), NULL, 0, marshallwire);
         size += marshalling(h, "signatures", &(d->itemsets[i].signatures), marshall_OPTIONAL, sizeof(struct signatures_struct), marshallsigs);
         size += marshalling(h, NULL, NULL, &(d->nitemsets), i, marshallself);
     }
+    if(d->name && !d->key) {
+        /* the key is not stored, rebuild it after reading the record */
+        d->key = ownerkey(d->arena, d->name);
+        if(d->spanhash) {
+            char* reversed = reversedname(NULL, d->name);
+            d->spanbyname = !strcmp(reversed, d->spanhash);
+            free(reversed);
+        }
+    }
     return size;
 }
 
@@ -670,20 +952,17 @@ names_recordextend(recordset_type record)
     size = sizeof(struct recordset_struct);
     size += record->nitemsets * sizeof(struct itemset);
     for(i=0; i<record->nitemsets; i++) {
-        size += record->itemsets[i].nitems * sizeof(struct item);
-        for(j=0; j<record->itemsets[i].nitems; j++) {
-            size += ldns_rr_uncompressed_size(record->itemsets[i].items[j].rr);
-        }
+        size += (record->itemsets[i].items ? sizeof(uint32_t) + WIRELEN(record->itemsets[i].items) : 0);
         if(record->itemsets[i].signatures) {
             size += sizeof(struct signatures_struct);
             size += record->itemsets[i].signatures->nsigs * sizeof(struct signature_struct);
             for(j=0; j<record->itemsets[i].signatures->nsigs; j++) {
-                size += (record->itemsets[i].signatures->sigs[j].keylocator ? strlen(record->itemsets[i].signatures->sigs[j].keylocator) : 0);
-                size += ldns_rr_uncompressed_size(record->itemsets[i].signatures->sigs[j].rr);
+                size += sizeof(uint32_t) + WIRELEN(record->itemsets[i].signatures->sigs[j].wire);
             }
         }
     }
     size += (record->name ? strlen(record->name) : 0);
+    size += (record->key ? KEYLEN(record->key) + 2 : 0);
     size += (record->spanhash ? strlen(record->spanhash) : 0);
     if(record->spanhashrr) {
         size += ldns_rr_uncompressed_size(record->spanhashrr);
@@ -692,8 +971,7 @@ names_recordextend(recordset_type record)
         size += sizeof(struct signatures_struct);
         size += record->spansignatures->nsigs * sizeof(struct signature_struct);
         for(j=0; j<record->spansignatures->nsigs; j++) {
-            size += (record->spansignatures->sigs[j].keylocator ? strlen(record->spansignatures->sigs[j].keylocator) : 0);
-            size += ldns_rr_uncompressed_size(record->spansignatures->sigs[j].rr);
+            size += sizeof(uint32_t) + WIRELEN(record->spansignatures->sigs[j].wire);
         }
     }
     size += (record->validupto ? sizeof(int) : 0);
@@ -728,7 +1006,7 @@ comparenamerevision(recordset_type newitem, recordset_type curitem, int* cmp)
     if (curitem) {
         if (cmp) {
             assert(newitem);
-            *cmp = strcmp(newitem->name, curitem->name);
+            *cmp = comparekeys(newitem->key, curitem->key);
             if(*cmp == 0 && newitem->revision != 0) {
                 *cmp = newitem->revision - curitem->revision;
             }
@@ -744,9 +1022,9 @@ comparenamehierarchy(recordset_type newitem, recordset_type curitem, int* cmp)
         if (cmp) {
             assert(newitem);
             assert(curitem);
-            *cmp = strcmp(curitem->name, newitem->name);
+            *cmp = comparekeys(newitem->key, curitem->key);
             if(*cmp == 0 && newitem->revision != 0) {
-                *cmp = curitem->revision - newitem->revision;
+                *cmp = newitem->revision - curitem->revision;
             }
         }
     }
@@ -760,7 +1038,7 @@ compareexpiry(recordset_type newitem, recordset_type curitem, int* cmp)
         if (cmp) {
             *cmp = (newitem->expiry?*(newitem->expiry):0) - (curitem->expiry?*(curitem->expiry):0);
             if(*cmp == 0) {
-                *cmp = strcmp(newitem->name,curitem->name);
+                *cmp = comparekeys(newitem->key, curitem->key);
                 if(*cmp == 0) {
                     if(newitem->revision >= curitem->revision) {
                         return 2;
@@ -788,7 +1066,11 @@ comparedenialname(recordset_type newitem, recordset_type curitem, int* cmp)
             right = curitem->spanhash;
             if(!left) left = "";
             if(!right) right = "";
-            *cmp = strcmp(left, right);
+            if(newitem->spanbyname && curitem->spanbyname) {
+                *cmp = comparekeys(newitem->key, curitem->key);
+            } else {
+                *cmp = strcmp(left, right);
+            }
             /* in case *cmp == 0 then we could make an assertion that
              * the names of a and b also need to be the same, otherwise
              * we have a hash collision we cannot continue with.
@@ -805,7 +1087,7 @@ compareupcomingset(recordset_type newitem, recordset_type curitem, int* cmp)
 {
     int c;
     if(curitem) {
-        c = strcmp(newitem->name, curitem->name);
+        c = comparekeys(newitem->key, curitem->key);
         if(cmp)
             *cmp = c;
         if(c == 0) {
@@ -823,7 +1105,7 @@ compareincomingset(recordset_type newitem, recordset_type curitem, int* cmp)
     int rc = 1;
     int compare;
     if(curitem) {
-        compare = strcmp(newitem->name, curitem->name);
+        compare = comparekeys(newitem->key, curitem->key);
         if(cmp)
             *cmp = compare;
         if(compare == 0) {
@@ -846,7 +1128,7 @@ compareready(recordset_type newitem, recordset_type curitem, int* cmp)
 {
     int c;
     if (curitem) {
-        c = strcmp(curitem->name, newitem->name);
+        c = comparekeys(curitem->key, newitem->key);
         if (cmp)
             *cmp = c;
         if (c == 0) {
@@ -867,7 +1149,7 @@ comparecurrentset(recordset_type newitem, recordset_type curitem, int* cmp)
 {
     if (curitem) {
         if (cmp) {
-            *cmp = strcmp(curitem->name, newitem->name);
+            *cmp = comparekeys(curitem->key, newitem->key);
         }
     }
     if (newitem->validupto)
@@ -883,7 +1165,7 @@ comparecurrentsetnew(recordset_type newitem, recordset_type curitem, int* cmp)
     int rc = 1;
     int c = 0;
     if (curitem) {
-        c = strcmp(curitem->name, newitem->name);
+        c = comparekeys(curitem->key, newitem->key);
         if (cmp)
             *cmp = c;
         if (c == 0) {
@@ -907,7 +1189,7 @@ comparerelevantset(recordset_type newitem, recordset_type curitem, int* cmp)
 {
     int c;
     if (curitem) {
-        c = strcmp(curitem->name, newitem->name);
+        c = comparekeys(curitem->key, newitem->key);
         if (cmp)
             *cmp = c;
         if (c == 0) {
@@ -927,7 +1209,7 @@ comparesignedset(recordset_type newitem, recordset_type curitem, int* cmp)
     const char* right;
     if (curitem) {
         if (cmp) {
-            *cmp = strcmp(curitem->name, newitem->name);
+            *cmp = comparekeys(curitem->key, newitem->key);
         }
     }
     if (newitem->validupto) {
@@ -947,7 +1229,7 @@ comparechangesset(recordset_type newitem, recordset_type curitem, int* cmp)
 {
     if (curitem) {
         if (cmp) {
-            *cmp = strcmp(newitem->name, curitem->name);
+            *cmp = comparekeys(newitem->key, curitem->key);
             if(*cmp == 0) {
                 if(newitem->validfrom) {
                     *cmp = *(newitem->validfrom) - *(curitem->validfrom);
@@ -974,7 +1256,7 @@ compareinsertsset(recordset_type newitem, recordset_type curitem, int* cmp)
         if (cmp) {
             *cmp = *newitem->validfrom - *curitem->validfrom;
             if(*cmp == 0 && newitem->name) {
-                *cmp = strcmp(newitem->name, curitem->name);
+                *cmp = comparekeys(newitem->key, curitem->key);
             }
         }
     }
@@ -1000,10 +1282,10 @@ comparedeletesset(recordset_type newitem, recordset_type curitem, int* cmp)
                 *cmp = *newitem->validupto - *curitem->validupto;
             }
             if(*cmp == 0)
-                *cmp = strcmp(newitem->name, curitem->name);
+                *cmp = comparekeys(newitem->key, curitem->key);
         }
         if (cmp && newitem->name) {
-            *cmp = strcmp(newitem->name, curitem->name);
+            *cmp = comparekeys(newitem->key, curitem->key);
         }
     }
     if (!newitem->validfrom) {
@@ -1028,7 +1310,7 @@ compareoutdatedset(recordset_type newitem, recordset_type curitem, int* cmp)
                 *cmp = *newitem->validupto - *curitem->validupto;
             }
             if(*cmp == 0 && newitem->name != NULL)
-                *cmp = strcmp(curitem->name, newitem->name);
+                *cmp = comparekeys(curitem->key, newitem->key);
             if(*cmp == 0 && newitem->name != NULL)
                 *cmp = curitem->revision - newitem->revision;
         }
@@ -1082,25 +1364,25 @@ names_recordindexfunction(const char* keyname, int (**acceptfunc)(recordset_type
 void
 names_recordlookupone(recordset_type record, ldns_rr_type recordtype, ldns_rr* template, ldns_rr** rr)
 {
-    int i, j;
+    int i;
+    unsigned char* entry;
+    ldns_rdf* owner;
     assert(record);
     assert(recordtype != 0);
     *rr = NULL;
     for(i=0; i<record->nitemsets; i++)
         if(record->itemsets[i].rrtype == recordtype)
             break;
-    if (i<record->nitemsets) {
-        if(rr == NULL) {
-            if(record->itemsets[i].nitems > 0) {
-                *rr = record->itemsets[i].items[0].rr;
-            }
+    if (i<record->nitemsets && record->itemsets[i].nitems > 0) {
+        if(template == NULL) {
+            entry = WIREDATA(record->itemsets[i].items);
         } else {
-            for(j=0; j<record->itemsets[i].nitems; j++)
-                if(!template || !ldns_rr_compare(template, record->itemsets[i].items[j].rr))
-                    break;
-            if (j<record->itemsets[i].nitems) {
-                *rr = record->itemsets[i].items[j].rr;
-            }
+            entry = wirefind(record, &record->itemsets[i], template);
+        }
+        if (entry) {
+            owner = recordowner(record);
+            *rr = wirerr(entry, owner, recordtype, record->itemsets[i].rrclass);
+            ldns_rdf_deep_free(owner);
         }
     }
 }
@@ -1110,6 +1392,8 @@ names_recordlookupall(recordset_type record, ldns_rr_type rrtype, ldns_rr* templ
 {
     int i, j;
     int nrrsigs = 0;
+    unsigned char* entry;
+    ldns_rdf* owner;
     assert(record);
     if(rrs)
         *rrs = NULL;
@@ -1138,14 +1422,16 @@ names_recordlookupall(recordset_type record, ldns_rr_type rrtype, ldns_rr* templ
         }
     }
     if (i<record->nitemsets) {
-        *rrs = ldns_rr_list_new();
+        if(rrs)
+            *rrs = ldns_rr_list_new();
         if(template == NULL) {
             if(record->itemsets[i].nitems > 0) {
                 if(rrs) {
-                    for(j=0; j<record->itemsets[i].nitems; j++) {
-                        assert(record->itemsets[i].items[j].rr);
-                        ldns_rr_list_push_rr(*rrs, record->itemsets[i].items[j].rr);
+                    owner = recordowner(record);
+                    for(j=0, entry=WIREDATA(record->itemsets[i].items); j<record->itemsets[i].nitems; j++, entry+=ENTRYLEN(entry)) {
+                        ldns_rr_list_push_rr(*rrs, wirerr(entry, owner, rrtype, record->itemsets[i].rrclass));
                     }
+                    ldns_rdf_deep_free(owner);
                 }
                 if(rrsigs && record->itemsets[i].signatures) {
                     for(j=0; j<record->itemsets[i].signatures->nsigs; j++) {
@@ -1156,13 +1442,12 @@ names_recordlookupall(recordset_type record, ldns_rr_type rrtype, ldns_rr* templ
                 }
             }
         } else {
-            for(j=0; j<record->itemsets[i].nitems; j++)
-                if(!ldns_rr_compare(template, record->itemsets[i].items[j].rr))
-                    break;
-            if (j<record->itemsets[i].nitems) {
+            entry = wirefind(record, &record->itemsets[i], template);
+            if (entry) {
                 if(rrs) {
-                    assert(record->itemsets[i].items[j].rr);
-                    ldns_rr_list_push_rr(*rrs, record->itemsets[i].items[j].rr);
+                    owner = recordowner(record);
+                    ldns_rr_list_push_rr(*rrs, wirerr(entry, owner, rrtype, record->itemsets[i].rrclass));
+                    ldns_rdf_deep_free(owner);
                 }
             }
         }
@@ -1172,7 +1457,7 @@ names_recordlookupall(recordset_type record, ldns_rr_type rrtype, ldns_rr* templ
                 *rrs = ldns_rr_list_new();
             if(rrs) {
                 assert(record->spanhashrr);
-                ldns_rr_list_push_rr(*rrs, record->spanhashrr);
+                ldns_rr_list_push_rr(*rrs, ldns_rr_clone(record->spanhashrr));
             }
             if(record->spansignatures)
                 for(j=0; j<record->spansignatures->nsigs; j++) {
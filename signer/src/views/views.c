@@ -38,6 +38,7 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <pthread.h>
 #include <ldns/ldns.h>
 #include "uthash.h"
 #include "utilities.h"
@@ -61,9 +62,22 @@ struct searchfunc {
     names_indexrange_func search;
 };
 
+/* An index as a view created from the base would start out with, for a view
+ * with the given primary index.
+ */
+struct snapshot {
+    char* primary;
+    char* keyname;
+    names_index_type index;
+};
+
 struct names_view_struct {
     const char* viewname;
     names_view_type base;
+    names_arena_type arena;
+    pthread_mutex_t snapshotlock;
+    int nsnapshots;
+    struct snapshot* snapshots;
     struct names_view_zone zonedata;
     names_table_type changelog;
     int viewid;
@@ -156,7 +170,7 @@ names_underwrite(names_view_type view, recordset_type* record)
     changed(view, *record, MOD, &dict);
     if(dict && *dict == NULL) {
         names_indexremove(view->indices[0], *record);
-        *dict = names_recordcopy(*record, 1);
+        *dict = names_recordcopy(*record, 1, view->arena);
         names_indexinsert(view->indices[0], *dict, NULL);
     }
     *record = *dict;
@@ -169,7 +183,7 @@ names_overwrite(names_view_type view, recordset_type* record)
     changed(view, *record, MOD, &dict);
     if(dict && *dict == NULL) {
         names_indexremove(view->indices[0], *record);
-        *dict = names_recordcopy(*record, -1);
+        *dict = names_recordcopy(*record, -1, view->arena);
         names_indexinsert(view->indices[0], *dict, NULL);
     }
     *record = *dict;
@@ -182,7 +196,7 @@ names_update(names_view_type view, recordset_type* record)
     changed(view, *record, UPD, &dict);
     if(dict && *dict == NULL) {
         names_indexremove(view->indices[0], *record);
-        *dict = names_recordcopy(*record, 0);
+        *dict = names_recordcopy(*record, 0, view->arena);
         names_indexinsert(view->indices[0], *dict, NULL);
     }
     *record = *dict;
@@ -202,7 +216,7 @@ names_place(names_view_type view, const char* name)
     content = names_indexlookupkey(view->indices[0], name);
     if(content == NULL) {
         newname = (char*)name;
-        content = names_recordcreate(&newname);
+        content = names_recordcreate(&newname, view->arena);
         names_recordannotate(content, &view->zonedata);
         names_indexinsert(view->indices[0], content, NULL);
         changed(view, content, ADD, NULL);
@@ -229,13 +243,70 @@ names_remove(names_view_type view, recordset_type record)
     changed(view, record, DEL, NULL);
 }
 
+/* The indices of views are built only once for every combination of primary
+ * index and index key, as long as the base does not change.  Views clone
+ * these snapshots and share their structure until they change it.  Where the
+ * base has the same index already its tree is shared instead.  Must be
+ * called with the snapshot lock of the base held.
+ */
+static names_index_type
+snapshot(names_view_type base, const char* primary, const char* keyname)
+{
+    int i;
+    names_iterator iter;
+    recordset_type content;
+    names_index_type source;
+    names_index_type index;
+    for(i=0; i<base->nsnapshots; i++) {
+        if(!strcmp(base->snapshots[i].primary, primary) && !strcmp(base->snapshots[i].keyname, keyname))
+            return base->snapshots[i].index;
+    }
+    index = NULL;
+    if(!strcmp(primary, names_indexkeyname(base->indices[0]))) {
+        for(i=0; i<base->nindices && index == NULL; i++) {
+            if(!strcmp(keyname, names_indexkeyname(base->indices[i])))
+                names_indexclone(&index, base->indices[i]);
+        }
+    }
+    if(index == NULL) {
+        if(strcmp(primary, keyname)) {
+            source = snapshot(base, primary, primary);
+        } else {
+            source = base->indices[0];
+        }
+        names_indexcreate(&index, keyname);
+        for(iter=names_indexiterator(source); names_iterate(&iter, &content); names_advance(&iter, NULL)) {
+            names_indexinsert(index, content, NULL);
+        }
+    }
+    base->nsnapshots += 1;
+    CHECKALLOC(base->snapshots = realloc(base->snapshots, sizeof(struct snapshot) * base->nsnapshots));
+    base->snapshots[base->nsnapshots-1].primary = strdup(primary);
+    base->snapshots[base->nsnapshots-1].keyname = strdup(keyname);
+    base->snapshots[base->nsnapshots-1].index = index;
+    return index;
+}
+
+/* Must be called with the snapshot lock of the view held. */
+static void
+dropsnapshots(names_view_type view)
+{
+    int i;
+    for(i=0; i<view->nsnapshots; i++) {
+        names_indexdestroy(view->snapshots[i].index, NULL, NULL);
+        free(view->snapshots[i].primary);
+        free(view->snapshots[i].keyname);
+    }
+    free(view->snapshots);
+    view->snapshots = NULL;
+    view->nsnapshots = 0;
+}
+
 names_view_type
 names_viewcreate(names_view_type base, const char* viewname, const char** keynames)
 {
     names_view_type view;
     int i, nindices;
-    names_iterator iter;
-    recordset_type content;
     if(base && base->base) {
         base = base->base;
     }
@@ -245,6 +316,10 @@ names_viewcreate(names_view_type base, const char* viewname, const char** keynam
     view = malloc(sizeof(struct names_view_struct)+sizeof(names_index_type)*(nindices));
     view->viewname = (viewname ? strdup(viewname) : NULL);
     view->base = base;
+    view->arena = (base ? base->arena : names_arenacreate());
+    CHECK(pthread_mutex_init(&view->snapshotlock, NULL));
+    view->nsnapshots = 0;
+    view->snapshots = NULL;
     view->zonedata.apex = (base ? base->zonedata.apex : NULL);
     view->zonedata.defaultttl = NULL;
     view->zonedata.signconf = (base ? base->zonedata.signconf : NULL);
@@ -254,10 +329,18 @@ names_viewcreate(names_view_type base, const char* viewname, const char** keynam
     view->nsearchfuncs = 0;
     view->searchfuncs = NULL;
     view->nindices = nindices;
+    if(base != NULL)
+        CHECK(pthread_mutex_lock(&base->snapshotlock));
     for(i=0; i<nindices; i++) {
-        names_indexcreate(&view->indices[i], keynames[i]);
+        if(base != NULL) {
+            names_indexclone(&view->indices[i], snapshot(base, keynames[0], keynames[i]));
+        } else {
+            names_indexcreate(&view->indices[i], keynames[i]);
+        }
         names_indexsearchfunction(view->indices[i], view, keynames[i]);
     }
+    if(base != NULL)
+        CHECK(pthread_mutex_unlock(&base->snapshotlock));
     if(!strcmp(viewname,names_view_PREPARE[0])) {
         names_viewaddsearchfunction2(view, view->indices[1], view->indices[2], names_iteratorincoming);
     } else if(!strcmp(viewname,names_view_NEIGHB[0])) {
@@ -266,14 +349,6 @@ names_viewcreate(names_view_type base, const char* viewname, const char** keynam
         names_viewaddsearchfunction2(view, view->indices[0], view->indices[2], names_iteratordenialchainupdates);
     }
     if(base != NULL) {
-        for(iter=names_indexiterator(base->indices[0]); names_iterate(&iter, &content); names_advance(&iter, NULL)) {
-            names_indexinsert(view->indices[0], content, NULL);
-        }
-        for(iter=names_indexiterator(view->indices[0]); names_iterate(&iter, &content); names_advance(&iter, NULL)) {
-            for(i=1; i<nindices; i++) {
-                names_indexinsert(view->indices[i], content, NULL);
-            }
-        }
         view->commitlog = base->commitlog;
     } else {
         view->commitlog = NULL;
@@ -298,12 +373,17 @@ names_viewdestroy(names_view_type view)
     marshall_handle store = NULL;
     names_commitlogunsubscribe(view->viewid, view->commitlog);
     names_commitlogdestroy(view->changelog);
+    CHECK(pthread_mutex_lock(&view->snapshotlock));
+    dropsnapshots(view);
+    CHECK(pthread_mutex_unlock(&view->snapshotlock));
+    CHECK(pthread_mutex_destroy(&view->snapshotlock));
     for(i=1; i<view->nindices; i++) {
         names_indexdestroy(view->indices[i], NULL, NULL);
     }
     if(view->base == NULL || view->base == view) {
         names_commitlogdestroyall(view->commitlog, &store);
         names_indexdestroy(view->indices[0], disposedict, NULL);
+        names_arenadestroy(view->arena);
     } else {
         names_indexdestroy(view->indices[0], NULL, NULL);
     }
@@ -317,13 +397,6 @@ names_viewdestroy(names_view_type view)
     free(view);
 }
 
-typedef int (*acceptfunction)(recordset_type newitem, recordset_type currentitem, int* cmp);
-struct names_index_struct {
-    const char* keyname;
-    ldns_rbtree_t* tree;
-    acceptfunction acceptfunc;
-};
-
 void
 names_viewvalidate(names_view_type view)
 {
@@ -343,7 +416,7 @@ names_viewvalidate(names_view_type view)
         }
     }
     if(view->viewid == 0) {
-        fprintf(stderr,"total memory size of records is %d, index nodes are %lu\n",size,sizeof(ldns_rbnode_t));
+        fprintf(stderr,"total memory size of records is %d, index nodes are %lu\n",size,(unsigned long)names_indexnodesize());
     }
     fprintf(stderr,"view %s contains %d records in primary index%s",view->viewname,count,(view->nindices>1?" in other indices:":""));
     for(i=1; i<view->nindices; i++) {
@@ -360,10 +433,10 @@ names_viewvalidate(names_view_type view)
                 //names_dumprecord(stderr,compare);
                 fail = 1; // assert(compare == record);
             }
-            if(view->indices[i]->acceptfunc(record,NULL,NULL) != 1) {
+            if(names_indexaccept(view->indices[i], record) != 1) {
                 fprintf(stderr,"RECORD IN INDEX %s SHOULD NOT BE IN INDEX %s\n",*(char**)view->indices[i],names_recordgetsummary(record,&temp1));
                 //names_dumprecord(stderr,record);
-                assert(view->indices[i]->acceptfunc(record,NULL,NULL) == 1);
+                assert(names_indexaccept(view->indices[i], record) == 1);
             }
             ++count;
         }
@@ -427,58 +500,20 @@ names_viewiterator(names_view_type view, names_indexrange_func func, ...)
 names_iterator
 names_iteratorincoming(names_index_type primary, names_index_type secondary, va_list ap)
 {
-    struct dual entry;
-    recordset_type record;
-    names_iterator iter;
-    names_iterator result;
-    result = names_iterator_createdata(sizeof(struct dual));
-    for (iter=names_indexiterator(primary); names_iterate(&iter,&record); names_advance(&iter,NULL)) {
-        entry.src = record;
-        entry.dst = names_indexlookup(secondary, record);
-        names_iterator_adddata(result,&entry);
-    }
-    return result;
+    return names_indexjoin(primary, secondary, NULL, names_indexlookup);
 }
 
-names_iterator
-names_iteratorexpiring(names_index_type index, va_list ap)
+static int
+hasdenial(recordset_type record)
 {
-    recordset_type record;
-    names_iterator iter;
-    names_iterator result;
-    time_t refreshtime;
-    refreshtime = va_arg(ap,time_t);
-    result = names_iterator_createrefs(NULL);
-    for (iter=names_indexiterator(index); names_iterate(&iter,&record); names_advance(&iter,NULL)) {
-        if(names_recordhasexpiry(record) && names_recordgetexpiry(record) >= refreshtime) {
-            names_end(&iter);
-            break;
-        } else {
-            names_iterator_addptr(result, record);
-        }
-    }
-    return result;
+    return names_recordgetdenial(record) != NULL;
 }
 
 names_iterator
 names_iteratordenialchainupdates(names_index_type primary, names_index_type secondary, va_list ap)
 {
     /* a database implementation can do this in a single query */
-    struct dual entry;
-    recordset_type record;
-    names_iterator iter;
-    names_iterator result;
-    result = names_iterator_createdata(sizeof(struct dual));
-    for (iter=names_indexiterator(primary); names_iterate(&iter,&record); names_advance(&iter,NULL)) {
-        if(names_recordgetdenial(record)) {
-            entry.src = record;
-            entry.dst = names_indexlookupnext(secondary, record);
-            assert(entry.src);
-            assert(entry.dst);
-            names_iterator_adddata(result,&entry);
-        }
-    }
-    return result;
+    return names_indexjoin(primary, secondary, hasdenial, names_indexlookupnext);
 }
 
 static void
@@ -514,6 +549,10 @@ updateview(names_view_type view, names_table_type* mychangelog)
     recordset_type existing;
 
     changelog = NULL;
+    if(view->base == NULL) {
+        /* No snapshots may be taken from the base while it is updated */
+        CHECK(pthread_mutex_lock(&view->snapshotlock));
+    }
 
     logger_message(&names_logcommitlog,logger_noctx,logger_DIAG,"update view %s commit %p\n",view->viewname,(mychangelog?(void*)*mychangelog:NULL));
     while((names_commitlogpoppush(view->commitlog, view->viewid, &changelog, mychangelog))) {
@@ -553,6 +592,11 @@ updateview(names_view_type view, names_table_type* mychangelog)
             }
         }
     }
+    if(view->base == NULL) {
+        /* views created from now on need to see the updated base */
+        dropsnapshots(view);
+        CHECK(pthread_mutex_unlock(&view->snapshotlock));
+    }
     names_recordgetsummary(NULL,&temp1);
     names_recordgetsummary(NULL,&temp2);
     return conflict;
@@ -593,7 +637,7 @@ names_viewconfig(names_view_type view, signconf_type** signconf)
     return 0;
 }
 
-static char filemagic[8] = "\0ODS-S1\n";
+static char filemagic[8] = "\0ODS-S2\n";
 
 int
 names_viewrestore(names_view_type view, const char* apex, int basefd, const char* filename)
@@ -612,8 +656,17 @@ names_viewrestore(names_view_type view, const char* apex, int basefd, const char
         else
             fd = open(filename, O_RDWR|O_LARGEFILE);
         if(fd >= 0) {
-            read(fd,buffer,sizeof(buffer));
-            assert(memcmp(buffer,filemagic,sizeof(filemagic))==0);
+            if(read(fd,buffer,sizeof(buffer)) != sizeof(buffer) || memcmp(buffer,filemagic,sizeof(filemagic))) {
+                /* state files of older releases kept resource records in
+                 * presentation format, discard them and resign from backup */
+                ods_log_warning("[views] ignoring state file %s of zone %s in an older format", filename, apex);
+                close(fd);
+                if(basefd >= 0)
+                    unlinkat(basefd, filename, 0);
+                else
+                    unlink(filename);
+                return 1;
+            }
             input = marshallcreate(marshall_INPUT, fd);
             do {
                 names_recordmarshall(&record, input);
@@ -731,6 +784,7 @@ names_dumpviewinfo(FILE* fp, names_view_type view)
             while((rr = ldns_rr_list_pop_rr(rrs))) {
                 serial = ldns_rdf2native_int32(ldns_rr_rdf(rr, 2));
                 fprintf(stderr," %d",(int)serial);
+                ldns_rr_free(rr);
             }
             ldns_rr_list_free(rrs);
         }
@@ -775,7 +829,6 @@ names_viewlookupall(names_view_type view, ldns_rdf* dname, ldns_rr_type type, ld
 {
     recordset_type record;
     struct signature_struct** rrsigs;
-    ldns_rr* rrsig = NULL;
     char* name;
     name = (dname ? ldns_rdf2str(dname) : NULL);
     record = names_take(view, 0, name);
@@ -783,13 +836,12 @@ names_viewlookupall(names_view_type view, ldns_rdf* dname, ldns_rr_type type, ld
         *signatures = ldns_rr_list_new();
         names_recordlookupall(record, type, NULL, rrs, &rrsigs);
         for(int i=0; rrsigs[i]; i++) {
-            rrsig = rrsigs[i]->rr;
-            ldns_rr_list_push_rr(*signatures, rrsig);
+            ldns_rr_list_push_rr(*signatures, names_recordsignature(record, rrsigs[i]));
         }
         free(rrsigs);
     } else {
         *rrs = NULL;
-        *rrsigs = NULL;
+        *signatures = NULL;
     }
     if(name)
         free(name);
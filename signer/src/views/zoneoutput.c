@@ -90,6 +90,7 @@ writezoneapex(names_view_type view, FILE* fp)
         soa = ldns_rr2str(rr);
         fprintf(fp, "%s", soa);
         free(soa);
+        ldns_rr_free(rr);
     }
 }
 
@@ -0,0 +1,70 @@
+NUMBER_ZONES=10000
+WORKER_COUNTS="1 2 4 8"
+STATUS=0
+MYEND=0
+MYSTART=0
+RUN=0
+DEBUG_OUTPUT=/dev/null
+#DEBUG_OUTPUT=/tmp/log
+RESULTS_OUTPUT="performance_results.log"
+
+[ x$DEBUG_OUTPUT != "x/dev/null" ] && rm -f $DEBUG_OUTPUT
+
+killall fakesigner.sh >> $DEBUG_OUTPUT 2>&1
+killall nc >> $DEBUG_OUTPUT 2>&1
+
+# Wait until no task is due and all workers wait for work, that is when an
+# enforce of all zones is done.
+wait_for_idle() {
+  while [ 1 ] ; do
+    QUEUE=`$INSTALL_ROOT/$KSM_UTIL queue 2>/dev/null`
+    if echo "$QUEUE" | grep -q "All worker threads idle" &&
+      ! echo "$QUEUE" | grep -q "Next task scheduled immediately" ; then
+      break
+    fi
+    sleep 1
+  done
+}
+
+# Restart the enforcer with $1 worker threads
+set_enforcer_workers() {
+  ods_stop_enforcer >> $DEBUG_OUTPUT 2>&1
+  sed -i "/<Enforcer>/,/<\/Enforcer>/ s|<WorkerThreads>[0-9]*</WorkerThreads>|<WorkerThreads>$1</WorkerThreads>|" \
+    $INSTALL_ROOT/etc/opendnssec/conf.xml
+  ods_start_enforcer >> $DEBUG_OUTPUT 2>&1
+  STATUS=$?
+  check_status set_enforcer_workers q
+}
+
+# Do the work...
+echo "******** WORKING ********" >> $DEBUG_OUTPUT 2>&1
+echo "enforcer workers,time to enforce $NUMBER_ZONES zones" > $RESULTS_OUTPUT 2>&1
+log_this fakesignerlog ./fakesigner.sh &
+
+generate_zonelist_xml $NUMBER_ZONES 1
+cp -- zonelist.1-$NUMBER_ZONES.xml $INSTALL_ROOT/etc/opendnssec/zonelist.xml
+log_this test_output "Importing zonelist zonelist.1-$NUMBER_ZONES.xml"
+$INSTALL_ROOT/$KSM_UTIL zonelist import >> $DEBUG_OUTPUT 2>&1
+STATUS=$?
+check_status zonelist_import q
+rm zonelist.1-*
+$INSTALL_ROOT/$KSM_UTIL hsm key gen -d P1Y >> $DEBUG_OUTPUT 2>&1
+# The first enforce introduces keys for every zone, not part of the timing
+wait_for_idle
+
+for WORKERS in $WORKER_COUNTS ; do
+  set_enforcer_workers $WORKERS
+  wait_for_idle
+  log_this test_output "Enforcing zones with $WORKERS workers"
+  MYSTART=`date +%s%N`
+  $INSTALL_ROOT/$KSM_UTIL enforce >> $DEBUG_OUTPUT 2>&1
+  STATUS=$?
+  check_status enforce q
+  wait_for_idle
+  MYEND=`date +%s%N`
+  calc_runtime
+  echo "$WORKERS,$RUN" >> $RESULTS_OUTPUT 2>&1
+done
+
+killall fakesigner.sh >> $DEBUG_OUTPUT 2>&1
+killall nc >> $DEBUG_OUTPUT 2>&1
@@ -0,0 +1,31 @@
+#!/usr/bin/env bash
+#
+#TEST: Times a full enforce of 10000 zones with 1, 2, 4 and 8 enforcer workers.
+#TEST: Designed to work in CentOS on titan - portability is questionable
+
+if [ -n "$HAVE_MYSQL" ]; then
+        ods_setup_conf conf.xml conf-mysql.xml
+fi &&
+
+ods_reset_env &&
+source performance_test_utils.sh &&
+
+ods_start_enforcer &&
+
+source ./performance_test.sh &&
+
+ods_stop_enforcer &&
+
+echo && 
+echo "************OK******************" &&
+echo &&
+cat performance_results.log &&
+
+return 0
+
+echo
+echo "************ERROR******************"
+echo
+ods_kill
+return 1
+
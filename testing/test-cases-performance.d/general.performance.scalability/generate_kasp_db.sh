@@ -0,0 +1,101 @@
+#!/usr/bin/env bash
+#
+# Print SQL that fills the enforcer database with $2 zones spread round robin
+# over the policies bench1 to bench$1, which must already be imported. $3 is
+# the install root used for the signconf and adapter paths. The statements
+# work for both SQLite and MySQL.
+#
+# Every policy has one KSK shared by all of its zones and every zone has its
+# own ZSK. Of the zones 80% are in a steady state, 15% are halfway through a
+# ZSK rollover and 5% are halfway through a KSK rollover, waiting for the DS
+# swap at the parent. All keys are recent so no zone needs a new key, but
+# the records of the zones in a rollover last changed two days ago so the
+# first enforce moves them along.
+
+awk -v policies="$1" -v zones="$2" -v root="$3" -v now="`date +%s`" '
+function policy_id(p) {
+  return "(SELECT id FROM policy WHERE name = '\''bench" p "'\'')"
+}
+
+# Rows are batched in multi row inserts of at most 500 rows.
+function row(table, columns, values) {
+  if (table != batch_table || batch_rows >= 500) {
+    flush()
+    printf "INSERT INTO %s (%s) VALUES\n(%s)", table, columns, values
+    batch_table = table
+  } else {
+    printf ",\n(%s)", values
+  }
+  batch_rows++
+}
+
+function flush() {
+  if (batch_rows) print ";"
+  batch_table = ""
+  batch_rows = 0
+}
+
+function hsmkey(p, role, state, bits) {
+  hsmkeys++
+  row("hsmKey", "id, policyId, locator, state, bits, algorithm, role, inception, isRevoked, keyType, repository, backup",
+    hsmkeys ", " policy_id(p) ", '\''" sprintf("bench%027d", hsmkeys) "'\'', " state ", " bits ", 8, " role ", " inception ", 0, 1, '\''SoftHSM'\'', 0")
+  return hsmkeys
+}
+
+# Add a key to zone z with the DS, RRSIG, DNSKEY and RRSIGDNSKEY states in s
+# (4 = NA).
+function key(z, hsm, role, introducing, ds_at_parent, s,    n, i, state) {
+  keys++
+  row("keyData", "id, zoneId, hsmKeyId, algorithm, inception, role, introducing, shouldRevoke, standby, activeZsk, publish, activeKsk, dsAtParent, keytag, minimize",
+    keys ", " z ", " hsm ", 8, " inception ", " role ", " introducing ", 0, 0, " (role == 2 && introducing) ", 1, " (role == 1 && introducing) ", " ds_at_parent ", " int(rand() * 65536) ", 0")
+  n = split(s, state, " ")
+  for (i = 1; i <= n; i++) {
+    keystates++
+    keystate[keystates] = keystates ", " keys ", " (i - 1) ", " state[i] ", " changed ", 0, 3600"
+  }
+}
+
+BEGIN {
+  srand(1)
+  inception = now - 30 * 86400
+  changed = now - 2 * 86400
+
+  print "BEGIN;"
+  print "DELETE FROM keyDependency;"
+  print "DELETE FROM keyState;"
+  print "DELETE FROM keyData;"
+  print "DELETE FROM hsmKey;"
+  print "DELETE FROM zone;"
+
+  for (p = 1; p <= policies; p++)
+    ksk[p] = hsmkey(p, 1, 3, 2048)
+
+  for (z = 1; z <= zones; z++) {
+    p = (z - 1) % policies + 1
+    name = sprintf("bench%06d.example", z)
+    row("zone", "id, policyId, name, signconfNeedsWriting, signconfPath, nextChange, ttlEndDs, ttlEndDk, ttlEndRs, rollKskNow, rollZskNow, rollCskNow, inputAdapterType, inputAdapterUri, outputAdapterType, outputAdapterUri, nextKskRoll, nextZskRoll, nextCskRoll",
+      z ", " policy_id(p) ", '\''" name "'\'', 0, '\''" root "/var/opendnssec/signconf/" name ".xml'\'', " (now + 86400) ", 0, 0, 0, 0, 0, 0, '\''File'\'', '\''" root "/var/opendnssec/unsigned/zone.txt'\'', '\''File'\'', '\''" root "/var/opendnssec/signed/" name "'\'', 0, 0, 0")
+  }
+
+  for (z = 1; z <= zones; z++) {
+    p = (z - 1) % policies + 1
+    mix = z % 20
+    if (mix == 0) {
+      key(z, ksk[p], 1, 0, 4, "3 4 2 2")
+      key(z, hsmkey(p, 1, 2, 2048), 1, 1, 2, "1 4 2 2")
+    } else {
+      key(z, ksk[p], 1, 1, 3, "2 4 2 2")
+    }
+    if (mix >= 17) {
+      key(z, hsmkey(p, 2, 2, 1024), 2, 0, 0, "4 3 2 4")
+      key(z, hsmkey(p, 2, 2, 1024), 2, 1, 0, "4 1 2 4")
+    } else {
+      key(z, hsmkey(p, 2, 2, 1024), 2, 1, 0, "4 2 2 4")
+    }
+  }
+
+  for (i = 1; i <= keystates; i++)
+    row("keyState", "id, keyDataId, type, state, lastChange, minimize, ttl", keystate[i])
+  flush()
+  print "COMMIT;"
+}'
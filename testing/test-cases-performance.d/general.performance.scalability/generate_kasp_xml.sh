@@ -0,0 +1,19 @@
+#!/usr/bin/env bash
+#
+# Print a KASP file with $1 copies of the default policy of kasp.xml, named
+# bench1 to bench$1.
+
+awk -v policies="$1" '
+/<Policy name="default">/ { copy = 1 }
+copy { policy = policy $0 "\n" }
+/<\/Policy>/ && copy { copy = 0 }
+END {
+  print "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+  print "<KASP>"
+  for (p = 1; p <= policies; p++) {
+    text = policy
+    sub(/name="default"/, "name=\"bench" p "\"", text)
+    printf "%s", text
+  }
+  print "</KASP>"
+}' kasp.xml
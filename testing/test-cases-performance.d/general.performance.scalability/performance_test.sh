@@ -0,0 +1,115 @@
+NUMBER_POLICIES=${NUMBER_POLICIES:-10}
+NUMBER_ZONES=${NUMBER_ZONES:-10000}
+STATUS=0
+MYEND=0
+MYSTART=0
+RUN=0
+DEBUG_OUTPUT=/dev/null
+#DEBUG_OUTPUT=/tmp/log
+RESULTS_OUTPUT="performance_results.log"
+
+if [ -n "$HAVE_MYSQL" ]; then
+  BACKEND=mysql
+else
+  BACKEND=sqlite
+fi
+
+[ x$DEBUG_OUTPUT != "x/dev/null" ] && rm -f $DEBUG_OUTPUT
+
+killall fakesigner.sh >> $DEBUG_OUTPUT 2>&1
+killall nc >> $DEBUG_OUTPUT 2>&1
+
+# Wait until no task is due and all workers wait for work, that is when an
+# enforce of all zones is done.
+wait_for_idle() {
+  while [ 1 ] ; do
+    QUEUE=`$INSTALL_ROOT/$KSM_UTIL queue 2>/dev/null`
+    if echo "$QUEUE" | grep -q "All worker threads idle" &&
+      ! echo "$QUEUE" | grep -q "Next task scheduled immediately" ; then
+      break
+    fi
+    sleep 1
+  done
+}
+
+# Print the number of queries and rows fetched by the enforcer so far
+db_counters() {
+  $INSTALL_ROOT/$KSM_UTIL dbstats 2>/dev/null |
+    awk -F: '/^Queries:/ { q = $2 } /^Rows fetched:/ { r = $2 } END { print q + 0, r + 0 }'
+}
+
+# Reset the peak resident set size of the enforcer so that the next
+# peak_rss only covers what happens from now on
+reset_peak_rss() {
+  echo 5 > /proc/`pgrep -x $ENFORCERD`/clear_refs 2>/dev/null
+}
+
+peak_rss() {
+  awk '/^VmHWM:/ { print $2 }' /proc/`pgrep -x $ENFORCERD`/status
+}
+
+# Time phase $1, which runs the rest of the arguments as an ods-enforcer
+# command, and append wall time, queries, rows fetched and peak RSS of the
+# enforcer to the results.
+measure_phase() {
+  PHASE=$1
+  shift
+  log_this test_output "Measuring $PHASE"
+  wait_for_idle
+  BEFORE=`db_counters`
+  reset_peak_rss
+  MYSTART=`date +%s%N`
+  $INSTALL_ROOT/$KSM_UTIL "$@" > phase_output 2>&1
+  STATUS=$?
+  check_status $PHASE q
+  wait_for_idle
+  MYEND=`date +%s%N`
+  calc_runtime
+  AFTER=`db_counters`
+  set -- $BEFORE $AFTER
+  echo "$PHASE,$BACKEND,$NUMBER_POLICIES,$NUMBER_ZONES,$RUN,$(( $3 - $1 )),$(( $4 - $2 )),`peak_rss`" >> $RESULTS_OUTPUT 2>&1
+  cat phase_output >> $DEBUG_OUTPUT 2>&1
+  rm -f phase_output
+}
+
+# Load the synthetic database with the enforcer stopped
+load_database() {
+  ./generate_kasp_db.sh $NUMBER_POLICIES $NUMBER_ZONES $INSTALL_ROOT > kasp_db.sql
+  if [ -n "$HAVE_MYSQL" ]; then
+    mysql -u test -ptest test < kasp_db.sql
+  else
+    sqlite3 $INSTALL_ROOT/var/opendnssec/kasp.db < kasp_db.sql
+  fi
+  STATUS=$?
+  rm -f kasp_db.sql
+  check_status load_database q
+}
+
+# Do the work...
+echo "******** WORKING ********" >> $DEBUG_OUTPUT 2>&1
+echo "phase,backend,policies,zones,wall_seconds,queries,rows,peak_rss_kb" > $RESULTS_OUTPUT 2>&1
+log_this fakesignerlog ./fakesigner.sh &
+
+log_this test_output "Importing $NUMBER_POLICIES policies"
+./generate_kasp_xml.sh $NUMBER_POLICIES > $INSTALL_ROOT/etc/opendnssec/kasp.xml
+$INSTALL_ROOT/$KSM_UTIL policy import >> $DEBUG_OUTPUT 2>&1
+STATUS=$?
+check_status policy_import q
+wait_for_idle
+
+log_this test_output "Loading $NUMBER_ZONES zones"
+ods_stop_enforcer >> $DEBUG_OUTPUT 2>&1
+load_database
+ods_start_enforcer >> $DEBUG_OUTPUT 2>&1
+STATUS=$?
+check_status start_enforcer q
+
+# The first enforce moves the zones halfway a rollover along, the second one
+# finds nothing to do.
+measure_phase enforce enforce
+measure_phase enforce_steady enforce
+measure_phase key_list key list --verbose
+measure_phase zonelist_export zonelist export
+
+killall fakesigner.sh >> $DEBUG_OUTPUT 2>&1
+killall nc >> $DEBUG_OUTPUT 2>&1
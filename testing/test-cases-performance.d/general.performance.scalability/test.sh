@@ -0,0 +1,32 @@
+#!/usr/bin/env bash
+#
+#TEST: Measures wall time, database queries, rows fetched and peak RSS of the
+#TEST: enforcer on a synthetic database of NUMBER_POLICIES policies and
+#TEST: NUMBER_ZONES zones with a realistic mix of keys in rollover.
+#TEST: Designed to work in CentOS on titan - portability is questionable
+
+if [ -n "$HAVE_MYSQL" ]; then
+        ods_setup_conf conf.xml conf-mysql.xml
+fi &&
+
+ods_reset_env &&
+source performance_test_utils.sh &&
+
+ods_start_enforcer &&
+
+source ./performance_test.sh &&
+
+ods_stop_enforcer &&
+
+echo && 
+echo "************OK******************" &&
+echo &&
+cat performance_results.log &&
+
+return 0
+
+echo
+echo "************ERROR******************"
+echo
+ods_kill
+return 1
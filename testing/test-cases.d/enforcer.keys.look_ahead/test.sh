@@ -82,6 +82,11 @@ echo -n "LINE: ${LINENO} " && log_grep ods-enforcer-look-ahead-list2 stdout "10[
 echo -n "LINE: ${LINENO} " && log_grep ods-enforcer-look-ahead-list2 stdout "10[[:space:]]*KSK[[:space:]]*hidden[[:space:]]*rumoured[[:space:]]*rumoured[[:space:]]*NA.*1[[:space:]]*1" &&
 echo -n "LINE: ${LINENO} " && log_grep ods-enforcer-look-ahead-list2 stdout "10[[:space:]]*ZSK[[:space:]]*NA[[:space:]]*rumoured[[:space:]]*NA[[:space:]]*hidden.*1[[:space:]]*0" &&
 
+# Whole fleet
+echo -n "LINE: ${LINENO} " && log_this ods-enforcer-look-ahead-all ods-enforcer look-ahead --all --days 30 &&
+echo -n "LINE: ${LINENO} " && log_grep ods-enforcer-look-ahead-all stdout "Simulated 1 zones for 30 days" &&
+echo -n "LINE: ${LINENO} " && log_grep ods-enforcer-look-ahead-all stdout "^Total[[:space:]]*[1-9][0-9]*[[:space:]]" &&
+
 echo -n "LINE: ${LINENO} " && ods_stop_enforcer &&
 return 0
 